@@ -2,10 +2,12 @@
  * Copyright (C) 2024 EmbeddedSolutions.pl
  */
 #include "em/ble_prov_svc.h"
+#include "em/bms.h"
 #include "em/button.h"
 #include "em/dispatcher.h"
 #include "em/evt.h"
 #include "em/http_ota.h"
+#include "em/inverter.h"
 #include "em/protocol.h"
 #include "em/scheduler.h"
 #include "em/slip.h"
@@ -169,6 +171,10 @@ void app_main(void)
   });
 
   protocol_register_rx_handler(dispatcher_handler);
+  inv_init();
+#if CONFIG_EM_BMS
+  bms_init();
+#endif /* CONFIG_EM_BMS */
 
   http_ota_init();
 
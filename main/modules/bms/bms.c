@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#include "em/bms.h"
+#include "em/protocol.h"
+#include "em/pylontech_protocol.h"
+#include "em/serial_client.h"
+
+#include <assert.h>
+#include <esp_err.h>
+#include <esp_macros.h>
+#include <sdkconfig.h>
+#include <time.h>
+
+#include <esp_log.h>
+#define LOG_TAG "BMS"
+
+#if CONFIG_EM_BMS
+
+#define PERCENT (100u)
+
+_Static_assert(CONFIG_EM_BMS_UART_PORT_NUM != CONFIG_EM_UART_PORT_NUM, "BMS needs its own UART, the inverter uses it");
+#if CONFIG_ESP_CONSOLE_UART && (CONFIG_ESP_CONSOLE_UART_NUM == CONFIG_EM_BMS_UART_PORT_NUM)
+#error "BMS UART is the console UART, move the console to USB Serial/JTAG"
+#endif
+_Static_assert(CONFIG_EM_BMS_FIRST_ADR + CONFIG_EM_BMS_PACKS <= UINT8_MAX, "Pack addresses exceed the ADR field");
+
+// request id of every pack differs by its address, handler per pack
+static serial_rsp_handler_t rsp_handlers[CONFIG_EM_BMS_PACKS];
+
+static serial_protocol_t protocols[] = {
+    {.parse_func = pylontech_rsp_parse,
+     .serialize_func = pylontech_serialize,
+     .baud_rate = CONFIG_EM_BMS_BAUD_RATE,
+     .data_bits = 8,
+     .stop_bits = 1,
+     .parity = false,
+     .rsp_handlers = rsp_handlers,
+     .handlers_cnt = CONFIG_EM_BMS_PACKS},
+};
+
+static em_sc_t bms_sc = {.uart = {.port = CONFIG_EM_BMS_UART_PORT_NUM,
+                                  .txd = CONFIG_EM_BMS_UART_TXD,
+                                  .rxd = CONFIG_EM_BMS_UART_RXD},
+                         .supported_protocols = protocols,
+                         .supported_protocols_cnt = sizeof(protocols) / sizeof(protocols[0])};
+
+// offsets from the lowest cell, shifted right until the spread fits a byte, returns the shift
+static uint8_t encode_cells(const uint16_t *cells, uint8_t cells_num, uint16_t *base, uint8_t *offsets)
+{
+  uint16_t min = UINT16_MAX;
+  uint16_t max = 0;
+
+  for (uint8_t i = 0; i < cells_num; i++) {
+    min = cells[i] < min ? cells[i] : min;
+    max = cells[i] > max ? cells[i] : max;
+  }
+
+  uint8_t shift = 0;
+
+  while (cells_num > 0 && ((max - min) >> shift) > UINT8_MAX) {
+    shift++;
+  }
+
+  for (uint8_t i = 0; i < cells_num; i++) {
+    offsets[i] = (uint8_t)((cells[i] - min) >> shift);
+  }
+
+  *base = cells_num > 0 ? min : 0;
+  return shift;
+}
+
+// called from the serial client task
+static int analog_handler(void *data, size_t data_len)
+{
+  ESP_UNUSED(data_len);
+  assert(data != NULL);
+
+  const pylontech_analog_t *analog = (const pylontech_analog_t *)data;
+  uint8_t pack = analog->adr - CONFIG_EM_BMS_FIRST_ADR;
+
+  if (analog->adr < CONFIG_EM_BMS_FIRST_ADR || pack >= CONFIG_EM_BMS_PACKS) {
+    ESP_LOGW(LOG_TAG, "Unknown pack adr=%d", analog->adr);
+    return -1;
+  }
+
+  uint8_t soc = 0;
+
+  if (analog->total > 0) {
+    uint64_t percent = (uint64_t)analog->remaining * PERCENT / analog->total;
+    soc = (uint8_t)(percent < PERCENT ? percent : PERCENT);
+  }
+
+  uint16_t cell_base = 0;
+  uint8_t cell_offsets[PYLONTECH_MAX_CELLS];
+  uint8_t cell_shift = encode_cells(analog->cells, analog->cells_num, &cell_base, cell_offsets);
+
+  ESP_LOGI(LOG_TAG, "Pack %d %lumV %ldmA soc=%d%% cells=%d min=%dmV", pack, analog->voltage, analog->current, soc,
+           analog->cells_num, cell_base);
+
+  int ret = protocol_send_bms_pack(time(NULL), pack, analog->voltage, analog->current, soc, analog->remaining,
+                                   analog->total, analog->cycles, cell_base, cell_shift, cell_offsets,
+                                   analog->cells_num, analog->temps, analog->temps_num);
+
+  if (ret != ESP_OK) {
+    ESP_LOGW(LOG_TAG, "Send pack %d err=%d", pack, ret);
+    return ret;
+  }
+
+  return 0;
+}
+
+int bms_init(void)
+{
+  ESP_LOGI(LOG_TAG, "Init start");
+
+  for (uint8_t i = 0; i < CONFIG_EM_BMS_PACKS; i++) {
+    rsp_handlers[i].protocol_idx = 0;
+    rsp_handlers[i].msg_type = PYLONTECH_RQ_ID(PYLONTECH_CID2_ANALOG, CONFIG_EM_BMS_FIRST_ADR + i);
+    rsp_handlers[i].msg_handler = analog_handler;
+  }
+
+  em_sc_init(&bms_sc, 0);
+
+  for (uint8_t i = 0; i < CONFIG_EM_BMS_PACKS; i++) {
+    uint8_t adr = CONFIG_EM_BMS_FIRST_ADR + i;
+
+    if (em_sc_send_periodic(&bms_sc, rsp_handlers[i].msg_type, &adr, sizeof(adr), CONFIG_EM_BMS_POLL_MS) != 0) {
+      ESP_LOGE(LOG_TAG, "Failed to poll pack %d", i);
+      return -1;
+    }
+  }
+
+  ESP_LOGI(LOG_TAG, "Init done");
+  return 0;
+}
+
+#else
+
+int bms_init(void)
+{
+  ESP_LOGE(LOG_TAG, "BMS disabled");
+  return -1;
+}
+
+#endif /* CONFIG_EM_BMS */
@@ -0,0 +1,15 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#ifndef BMS_H
+#define BMS_H
+
+/*
+ * Pylontech packs on RS485, analog values of every pack are polled on their own period and sent to the server
+ * with cell voltages as offsets from the lowest cell.
+ * The packs have their own serial client on EM_BMS_UART_PORT_NUM, next to the inverter one.
+ */
+int bms_init(void);
+
+#endif /* BMS_H */
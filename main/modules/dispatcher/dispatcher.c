@@ -6,6 +6,7 @@
 #include "em/coredump.h"
 #include "em/evt.h"
 #include "em/http_ota.h"
+#include "em/inverter.h"
 #include "em/protocol.h"
 #include "em/scheduler.h"
 #include "em/storage.h"
@@ -152,6 +153,95 @@ static int environment_set_position_handler(void *data)
   return ESP_OK;
 }
 
+static int inverter_set_deadband_handler(void *data)
+{
+  assert(data);
+
+  inverter_deadband_msg_t *msg = (inverter_deadband_msg_t *)data;
+  return inv_deadband_set(msg->channel, msg->threshold, msg->max_silence);
+}
+
+static int inverter_set_batch_handler(void *data)
+{
+  assert(data);
+
+  inverter_set_batch_msg_t *msg = (inverter_set_batch_msg_t *)data;
+  const char *items[INVERTER_SET_ITEMS];
+
+  for (uint32_t i = 0; i < ARRAY_LENGTH(items); i++) {
+    items[i] = msg->items[i];
+  }
+
+  // result vector follows once the batch is applied
+  return inv_set_batch(msg->id, items, msg->items_len, msg->items_num);
+}
+
+static int inverter_set_poll_plan_handler(void *data)
+{
+  assert(data);
+
+  inverter_poll_plan_msg_t *msg = (inverter_poll_plan_msg_t *)data;
+  inv_poll_plan_t plan = {0};
+
+  if (msg->polls_num > INV_POLL_PLAN_MAX_ITEMS || msg->deadbands_num > INV_POLL_PLAN_MAX_DEADBANDS) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  plan.polls_num = (uint8_t)msg->polls_num;
+  memcpy(plan.cmds, msg->cmds, msg->polls_num * sizeof(plan.cmds[0]));
+  memcpy(plan.intervals, msg->intervals, msg->polls_num * sizeof(plan.intervals[0]));
+  memcpy(plan.priorities, msg->priorities, msg->polls_num * sizeof(plan.priorities[0]));
+  plan.deadbands_num = (uint8_t)msg->deadbands_num;
+  memcpy(plan.channels, msg->channels, msg->deadbands_num * sizeof(plan.channels[0]));
+  memcpy(plan.thresholds, msg->thresholds, msg->deadbands_num * sizeof(plan.thresholds[0]));
+  memcpy(plan.max_silences, msg->max_silences, msg->deadbands_num * sizeof(plan.max_silences[0]));
+
+  return inv_poll_plan_set(&plan);
+}
+
+static int energy_price_day_handler(void *data)
+{
+  assert(data);
+
+  energy_price_day_msg_t *msg = (energy_price_day_msg_t *)data;
+  return inv_charge_plan_set_prices(msg->tariff, msg->day_time, msg->price_factor, msg->prices, msg->prices_len);
+}
+
+static int inverter_history_query_handler(void *data)
+{
+  assert(data);
+
+  inverter_history_query_msg_t *msg = (inverter_history_query_msg_t *)data;
+  return inv_history_query(msg->channel, msg->from, msg->to, msg->resolution, msg->points);
+}
+
+// read from the published snapshot, the serial client task may be updating the measurements meanwhile
+static int send_inverter_measurements(void)
+{
+  inv_snapshot_t snapshot;
+
+  if (inv_snapshot_read(&snapshot) != 0) {
+    return ESP_ERR_TIMEOUT;
+  }
+
+  if (snapshot.grid.timestamp == 0) {
+    return ESP_ERR_INVALID_STATE; // nothing measured or restored yet
+  }
+
+  const uint8_t channels[] = {
+    INV_CH_GRID_VOLTAGE, INV_CH_GRID_POWER, INV_CH_GRID_FREQ, INV_CH_BATTERY_VOLTAGE, INV_CH_BATTERY_POWER,
+    INV_CH_AC_OUT_VOLTAGE, INV_CH_AC_OUT_POWER, INV_CH_AC_OUT_FREQ, INV_CH_PV_VOLTAGE, INV_CH_PV_POWER,
+  };
+  const int32_t values[] = {
+    snapshot.grid.voltage, snapshot.grid.power, snapshot.grid.freq, snapshot.battery.voltage,
+    snapshot.battery.charge_power, snapshot.ac_output.voltage, (int32_t)snapshot.ac_output.power,
+    snapshot.ac_output.freq, snapshot.pv.voltage, (int32_t)snapshot.pv.power,
+  };
+  _Static_assert(sizeof(channels) == sizeof(values) / sizeof(values[0]), "Channel without value");
+
+  return protocol_send_inverter_measurements(snapshot.grid.timestamp, channels, values, sizeof(channels));
+}
+
 static int coredump_confirmed_handler(void *data)
 {
   ESP_UNUSED(data);
@@ -277,6 +367,51 @@ static int get_handler(void *data)
     //send_relay_meter_current_limit();
   } break;
 
+  case MSGTYPE_INVERTER_MEASUREMENT:
+    ESP_LOGI(LOG_TAG, "Get %s", __STRINGIFY(MSGTYPE_INVERTER_MEASUREMENT));
+    return send_inverter_measurements();
+
+  case MSGTYPE_INVERTER_DEADBAND: {
+    ESP_LOGI(LOG_TAG, "Get %s", __STRINGIFY(MSGTYPE_INVERTER_DEADBAND));
+    uint32_t threshold = 0;
+    uint32_t max_silence = 0;
+
+    if (msg->param >= INV_CH_CNT || inv_deadband_get((uint8_t)msg->param, &threshold, &max_silence) != ESP_OK) {
+      return ESP_ERR_INVALID_ARG;
+    }
+
+    protocol_send_inverter_deadband((uint8_t)msg->param, threshold, max_silence);
+  } break;
+
+  case MSGTYPE_INVERTER_POLL_PLAN: {
+    ESP_LOGI(LOG_TAG, "Get %s", __STRINGIFY(MSGTYPE_INVERTER_POLL_PLAN));
+    inv_poll_plan_t plan;
+    inverter_poll_plan_msg_t reply = {.type = MSGTYPE_INVERTER_POLL_PLAN};
+    inv_poll_plan_get(&plan);
+
+    reply.polls_num = plan.polls_num;
+    memcpy(reply.cmds, plan.cmds, plan.polls_num * sizeof(reply.cmds[0]));
+    memcpy(reply.intervals, plan.intervals, plan.polls_num * sizeof(reply.intervals[0]));
+    memcpy(reply.priorities, plan.priorities, plan.polls_num * sizeof(reply.priorities[0]));
+    reply.deadbands_num = plan.deadbands_num;
+    memcpy(reply.channels, plan.channels, plan.deadbands_num * sizeof(reply.channels[0]));
+    memcpy(reply.thresholds, plan.thresholds, plan.deadbands_num * sizeof(reply.thresholds[0]));
+    memcpy(reply.max_silences, plan.max_silences, plan.deadbands_num * sizeof(reply.max_silences[0]));
+
+    protocol_send_inverter_poll_plan(&reply);
+  } break;
+
+  case MSGTYPE_INVERTER_SETTING: {
+    ESP_LOGI(LOG_TAG, "Get %s", __STRINGIFY(MSGTYPE_INVERTER_SETTING));
+
+    if (msg->param >= INV_SETTINGS_CNT) {
+      return ESP_ERR_INVALID_ARG;
+    }
+
+    // sent from the cache or once the inverter responds
+    return inv_setting_get((uint8_t)msg->param, msg->max_age);
+  }
+
   case MSGTYPE_ENERGY_ACCUMULATED: {
     ESP_LOGI(LOG_TAG, "Get %s", __STRINGIFY(MSGTYPE_ENERGY_ACCUMULATED));
     //send_relay_energy_accumulated();
@@ -318,6 +453,11 @@ static tcp_mapper_t mapper[] = {
   {.cb = wireless_set_channel_handle, .type = MSGTYPE_WIRELESS_SET_CHANNEL},
   {.cb = environment_cloud_cover_handler, .type = MSGTYPE_ENVIRONMENT_CLOUD_COVER},
   {.cb = environment_set_position_handler, .type = MSGTYPE_ENVIRONMENT_SET_POSITION},
+  {.cb = inverter_set_deadband_handler, .type = MSGTYPE_INVERTER_SET_DEADBAND},
+  {.cb = inverter_history_query_handler, .type = MSGTYPE_INVERTER_HISTORY_QUERY},
+  {.cb = inverter_set_batch_handler, .type = MSGTYPE_INVERTER_SET_BATCH},
+  {.cb = inverter_set_poll_plan_handler, .type = MSGTYPE_INVERTER_SET_POLL_PLAN},
+  {.cb = energy_price_day_handler, .type = MSGTYPE_ENERGYPRICE_DAY},
   {.cb = coredump_confirmed_handler, .type = MSGTYPE_DIAG_COREDUMP_CONFIRMED},
   {.cb = status_handler, .type = MSGTYPE_STATUS},
   {.cb = get_handler, .type = MSGTYPE_GET},
@@ -121,6 +121,7 @@ static void tcp_client_event_handler(void *arg, esp_event_base_t event_base, int
   switch (event_id) {
   case EM_TCP_CLIENT_EVENT_ONLINE: {
     protocol_register_tx_handler(em_tcp_client_send);
+    protocol_register_tx_shared_handler(em_tcp_client_send_shared);
 
     storage_device_t device = storage_device();
 
@@ -139,6 +140,7 @@ static void tcp_client_event_handler(void *arg, esp_event_base_t event_base, int
 
   case EM_TCP_CLIENT_EVENT_OFFLINE: {
     protocol_register_tx_handler(NULL);
+    protocol_register_tx_shared_handler(NULL);
     break;
   }
 
@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#include "em/burst.h"
+#include "em/inverter.h"
+#include "em/protocol.h"
+#include "em/scheduler.h"
+#include "em/tscodec.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <esp_err.h>
+#include <esp_macros.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <sdkconfig.h>
+
+#include <esp_log.h>
+#define LOG_TAG "INV_BURST"
+
+#if CONFIG_EM_INVERTER_BURST_CAPTURE
+
+#define PRE_SAMPLES   CONFIG_EM_INVERTER_BURST_PRE_SAMPLES
+#define POST_SAMPLES  CONFIG_EM_INVERTER_BURST_POST_SAMPLES
+#define RING_LEN      (PRE_SAMPLES + POST_SAMPLES)
+#define DATA_LEN      (1024u) // compressed channels, fits the largest TCP buffer together with the header
+#define SEND_RETRY_MS (1000u) // buffer pool exhausted or connection down
+#define US_IN_MS      (1000LL)
+
+typedef enum {
+  BURST_ARMED = 0,  // pre-trigger ring is filled
+  BURST_CAPTURING,  // post-trigger samples are added
+  BURST_READY,      // frozen until sent
+} burst_state_t;
+
+typedef struct {
+  inv_burst_sample_t ring[RING_LEN];
+  uint16_t head;       // next slot
+  uint16_t count;      // samples in the ring
+  uint16_t post_added; // samples added after the trigger
+  inv_burst_trigger_t trigger;
+  uint32_t detail;
+  int64_t trigger_us;
+  time_t trigger_ts;
+  burst_state_t state;
+} burst_t;
+
+static const uint8_t channel_ids[INV_BURST_CHANNELS_CNT] = {
+  INV_CH_GRID_VOLTAGE,
+  INV_CH_GRID_FREQ,
+  INV_CH_AC_OUT_VOLTAGE,
+  INV_CH_AC_OUT_POWER,
+  INV_CH_BATTERY_VOLTAGE,
+  INV_CH_BATTERY_POWER,
+  INV_CH_PV_POWER,
+};
+
+static const inv_burst_channel_t step_channels[] = {
+  INV_BURST_AC_OUT_POWER,
+  INV_BURST_BATTERY_POWER,
+  INV_BURST_PV_POWER,
+};
+
+// ring is written by the serial client task until ready, then read by the scheduler callback
+static burst_t burst = {0};
+static portMUX_TYPE burst_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t data[DATA_LEN];
+
+static void send_burst_handler(uint32_t param, void *usr_ctx)
+{
+  ESP_UNUSED(param);
+  ESP_UNUSED(usr_ctx);
+
+  taskENTER_CRITICAL(&burst_lock);
+  bool ready = burst.state == BURST_READY;
+  taskEXIT_CRITICAL(&burst_lock);
+
+  if (!ready) {
+    return;
+  }
+
+  uint16_t first = (uint16_t)((burst.head + RING_LEN - burst.count) % RING_LEN);
+  uint16_t counts[INV_BURST_CHANNELS_CNT];
+  uint16_t lens[INV_BURST_CHANNELS_CNT];
+  uint16_t restart;
+  em_tscodec_t codec;
+  size_t used = 0;
+
+  for (uint32_t ch = 0; ch < INV_BURST_CHANNELS_CNT; ch++) {
+    // single restart point, the burst is decoded as a whole
+    em_tscodec_init(&codec, &data[used], DATA_LEN - used, &restart, 1, UINT16_MAX);
+
+    for (uint16_t i = 0; i < burst.count; i++) {
+      const inv_burst_sample_t *s = &burst.ring[(first + i) % RING_LEN];
+
+      // channels not fitting the buffer are cut short, count tells how many samples were kept
+      if (em_tscodec_append(&codec, (s->time_us - burst.trigger_us) / US_IN_MS, s->values[ch]) != 0) {
+        break;
+      }
+    }
+
+    counts[ch] = (uint16_t)codec.count;
+    lens[ch] = (uint16_t)codec.len;
+    used += codec.len;
+  }
+
+  uint16_t pre = burst.count - burst.post_added;
+  int ret = protocol_send_inverter_burst(burst.trigger, burst.detail, burst.trigger_ts, pre, channel_ids, counts, lens,
+                                         INV_BURST_CHANNELS_CNT, data, (uint16_t)used);
+
+  if (ret != ESP_OK) {
+    ESP_LOGW(LOG_TAG, "Send burst err=%d", ret);
+    scheduler_set_callback(send_burst_handler, SCH_PARAM_NONE, SCH_CTX_NONE, SEND_RETRY_MS);
+    return;
+  }
+
+  ESP_LOGI(LOG_TAG, "Burst sent, %u samples in %zu bytes", burst.count, used);
+
+  taskENTER_CRITICAL(&burst_lock);
+  burst.head = 0;
+  burst.count = 0;
+  burst.state = BURST_ARMED;
+  taskEXIT_CRITICAL(&burst_lock);
+}
+
+static void burst_trigger(inv_burst_trigger_t trigger, uint32_t detail)
+{
+  taskENTER_CRITICAL(&burst_lock);
+  bool armed = burst.state == BURST_ARMED;
+
+  if (armed) {
+    burst.state = BURST_CAPTURING;
+  }
+  taskEXIT_CRITICAL(&burst_lock);
+
+  if (!armed) {
+    return; // one burst at a time, later triggers are captured by the current one
+  }
+
+  burst.trigger = trigger;
+  burst.detail = detail;
+  burst.trigger_us = esp_timer_get_time();
+  burst.trigger_ts = time(NULL);
+  burst.post_added = 0;
+  ESP_LOGI(LOG_TAG, "Trigger %d detail=%#lx, %u samples before", trigger, detail, burst.count);
+}
+
+static void check_power_step(const inv_burst_sample_t *sample)
+{
+  if (CONFIG_EM_INVERTER_BURST_POWER_STEP_W == 0 || burst.count == 0) {
+    return;
+  }
+
+  const inv_burst_sample_t *prev = &burst.ring[(burst.head + RING_LEN - 1) % RING_LEN];
+
+  for (uint32_t i = 0; i < sizeof(step_channels) / sizeof(step_channels[0]); i++) {
+    inv_burst_channel_t ch = step_channels[i];
+
+    if (abs(sample->values[ch] - prev->values[ch]) >= CONFIG_EM_INVERTER_BURST_POWER_STEP_W) {
+      burst_trigger(INV_BURST_TRIGGER_POWER_STEP, channel_ids[ch]);
+      return;
+    }
+  }
+}
+
+void inv_burst_init(void)
+{
+  memset(&burst, 0, sizeof(burst));
+  ESP_LOGI(LOG_TAG, "Burst capture %d+%d samples", PRE_SAMPLES, POST_SAMPLES);
+}
+
+void inv_burst_add(const inv_burst_sample_t *sample)
+{
+  assert(sample != NULL);
+
+  taskENTER_CRITICAL(&burst_lock);
+  burst_state_t state = burst.state;
+  taskEXIT_CRITICAL(&burst_lock);
+
+  if (state == BURST_READY) {
+    return;
+  }
+
+  if (state == BURST_ARMED) {
+    // step sample becomes the first one after the trigger
+    check_power_step(sample);
+  }
+
+  burst.ring[burst.head] = *sample;
+  burst.head = (burst.head + 1) % RING_LEN;
+
+  if (burst.count < RING_LEN) {
+    burst.count++;
+  }
+
+  taskENTER_CRITICAL(&burst_lock);
+  bool ready = burst.state == BURST_CAPTURING && ++burst.post_added >= POST_SAMPLES;
+
+  if (ready) {
+    burst.state = BURST_READY;
+  }
+  taskEXIT_CRITICAL(&burst_lock);
+
+  if (ready) {
+    scheduler_set_callback(send_burst_handler, SCH_PARAM_NONE, SCH_CTX_NONE, SCH_NO_DELAY);
+  }
+}
+
+void inv_burst_mode_changed(uint32_t mode)
+{
+  if ((char)mode != '\0' && strchr(CONFIG_EM_INVERTER_BURST_TRIGGER_MODES, (char)mode) != NULL) {
+    burst_trigger(INV_BURST_TRIGGER_MODE, mode);
+  }
+}
+
+void inv_burst_warnings_raised(uint64_t raised)
+{
+  uint64_t masked = raised & (uint64_t)CONFIG_EM_INVERTER_BURST_WARNING_MASK;
+
+  if (masked != 0) {
+    burst_trigger(INV_BURST_TRIGGER_WARNING, (uint32_t)masked);
+  }
+}
+
+#else
+
+void inv_burst_init(void)
+{
+}
+
+void inv_burst_add(const inv_burst_sample_t *sample)
+{
+  ESP_UNUSED(sample);
+}
+
+void inv_burst_mode_changed(uint32_t mode)
+{
+  ESP_UNUSED(mode);
+}
+
+void inv_burst_warnings_raised(uint64_t raised)
+{
+  ESP_UNUSED(raised);
+}
+
+#endif /* CONFIG_EM_INVERTER_BURST_CAPTURE */
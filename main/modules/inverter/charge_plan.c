@@ -0,0 +1,408 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#include "em/charge_plan.h"
+#include "em/history.h"
+#include "em/inverter.h"
+#include "em/protocol.h"
+#include "em/scheduler.h"
+#include "em/storage.h"
+#include "em/time.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <esp_err.h>
+#include <esp_macros.h>
+#include <freertos/FreeRTOS.h>
+#include <sdkconfig.h>
+
+#include <esp_log.h>
+#define LOG_TAG "INV_PLAN"
+
+#if CONFIG_EM_INVERTER_CHARGE_PLAN
+
+#define FIRST_PLAN_MS     (30000u) // first measurements and the time sync after boot
+#define RETRY_MS          (60000u) // time not synced or battery state unknown
+#define BUSY_RETRY_MS     (10000u) // batch from the server in progress
+#define PLAN_NOW_MS       (1u)     // next tick, the plan runs from the timer task only
+#define SLOT_GUARD_MS     (1000u)  // planned after the slot boundary
+#define PRICE_RQ_PERIOD_S (SECONDS_IN_HOUR)
+#define PROFILE_DAYS      (3u)
+#define MAX_SLOTS         (MAX_PRICE_DAYS * QUARTERS_IN_DAY)
+#define MS_IN_S           (1000u)
+#define PERCENT           (100)
+
+#define BATTERY_WH     CONFIG_EM_INVERTER_CHARGE_PLAN_BATTERY_WH
+#define MIN_SOC        CONFIG_EM_INVERTER_CHARGE_PLAN_MIN_SOC
+#define CHARGE_W       CONFIG_EM_INVERTER_CHARGE_PLAN_CHARGE_W
+#define EFFICIENCY_PCT CONFIG_EM_INVERTER_CHARGE_PLAN_EFFICIENCY_PCT
+
+typedef enum {
+  SLOT_HOLD = 0,  // battery is kept for the expensive slots
+  SLOT_CHARGE,    // battery is charged from the grid
+  SLOT_DISCHARGE, // battery feeds the loads
+  SLOT_NONE,      // nothing applied since boot or the last batch failed
+} slot_mode_t;
+
+// output source and charger priorities of the mode
+static const char *const mode_items[][2] = {
+  [SLOT_HOLD] = {"POP01", "PCP03"},      // solar, grid, battery - solar only charging
+  [SLOT_CHARGE] = {"POP00", "PCP02"},    // grid, solar, battery - solar and grid charging
+  [SLOT_DISCHARGE] = {"POP02", "PCP03"}, // solar, battery, grid - solar only charging
+};
+
+static const char *const mode_names[] = {
+  [SLOT_HOLD] = "hold",
+  [SLOT_CHARGE] = "charge",
+  [SLOT_DISCHARGE] = "discharge",
+};
+
+// remaining slots of the stored days, index 0 is the current slot
+typedef struct {
+  storage_price_day_t days[MAX_PRICE_DAYS];
+  int16_t prices[MAX_SLOTS];
+  int32_t net_wh[MAX_SLOTS]; // loads not covered by PV, negative for PV surplus
+  uint8_t modes[MAX_SLOTS];
+  uint16_t order[MAX_SLOTS];
+  int32_t profile_w[QUARTERS_IN_DAY]; // net load of the quarters of the day
+  int64_t profile_day;                // day the profile was built for
+  uint8_t applied;                    // slot_mode_t confirmed by the batch result
+  uint8_t pending;                    // slot_mode_t of the batch in progress
+  time_t price_rq_time;
+} plan_t;
+
+// touched only by the plan handler in the timer task, except applied and pending taken under plan_lock
+static plan_t plan = {.applied = SLOT_NONE, .pending = SLOT_NONE};
+static portMUX_TYPE plan_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// average AC output minus PV of every quarter of the day over the last days, zero without history
+static void build_profile(int64_t day)
+{
+  for (uint32_t q = 0; q < QUARTERS_IN_DAY; q++) {
+    int64_t sum = 0;
+    uint32_t days = 0;
+
+    for (uint32_t d = 1; d <= PROFILE_DAYS; d++) {
+      time_t ts = (time_t)(day - (int64_t)d * SECONDS_IN_DAY + q * SECONDS_IN_QUARTER);
+      em_rrd_slot_t load;
+      em_rrd_slot_t pv;
+
+      if (inv_history_read(INV_CH_AC_OUT_POWER, INV_HISTORY_TIER_QUARTER, ts, &load) != 0 || load.count == 0) {
+        continue;
+      }
+
+      int32_t pv_w = 0;
+
+      if (inv_history_read(INV_CH_PV_POWER, INV_HISTORY_TIER_QUARTER, ts, &pv) == 0 && pv.count > 0) {
+        pv_w = pv.sum / pv.count;
+      }
+
+      sum += load.sum / load.count - pv_w;
+      days++;
+    }
+
+    plan.profile_w[q] = days > 0 ? (int32_t)(sum / days) : 0;
+  }
+
+  plan.profile_day = day;
+}
+
+static int32_t slot_net_wh(int64_t start, uint32_t slot_s)
+{
+  int64_t ws = 0;
+
+  for (int64_t t = start; t < start + slot_s; t += SECONDS_IN_QUARTER) {
+    uint32_t q = (uint32_t)((t - plan.profile_day) / SECONDS_IN_QUARTER) % QUARTERS_IN_DAY;
+    int64_t len = start + slot_s - t < SECONDS_IN_QUARTER ? start + slot_s - t : SECONDS_IN_QUARTER;
+    ws += plan.profile_w[q] * len;
+  }
+
+  return (int32_t)(ws / SECONDS_IN_HOUR);
+}
+
+// day following the first one is used when it has the same slots and price unit
+static uint16_t collect_slots(time_t now, uint32_t *slot_s)
+{
+  const storage_price_day_t *today = &plan.days[0];
+  const storage_price_day_t *tomorrow = &plan.days[1];
+  uint16_t days_num = 1;
+
+  if (storage_energy_price_list((time_t)(today->day + SECONDS_IN_DAY), &plan.days[1]) &&
+      tomorrow->prices_len == today->prices_len && tomorrow->price_factor == today->price_factor) {
+    days_num = 2;
+  }
+
+  *slot_s = SECONDS_IN_DAY / today->prices_len;
+  uint16_t first = (uint16_t)((now - today->day) / *slot_s);
+  uint16_t n = 0;
+
+  for (uint16_t d = 0; d < days_num; d++) {
+    for (uint16_t i = d == 0 ? first : 0; i < plan.days[d].prices_len; i++) {
+      plan.prices[n] = plan.days[d].prices[i];
+      plan.net_wh[n] = slot_net_wh(plan.days[d].day + (int64_t)i * *slot_s, *slot_s);
+      n++;
+    }
+  }
+
+  return n;
+}
+
+// stable, by price
+static void sort_slots(uint16_t n, bool descending)
+{
+  for (uint16_t i = 0; i < n; i++) {
+    plan.order[i] = i;
+  }
+
+  for (uint16_t i = 1; i < n; i++) {
+    for (uint16_t j = i; j > 0; j--) {
+      int16_t prev = plan.prices[plan.order[j - 1]];
+      int16_t cur = plan.prices[plan.order[j]];
+
+      if (descending ? prev >= cur : prev <= cur) {
+        break;
+      }
+
+      uint16_t idx = plan.order[j];
+      plan.order[j] = plan.order[j - 1];
+      plan.order[j - 1] = idx;
+    }
+  }
+}
+
+static void plan_slots(uint16_t n, uint32_t slot_s, uint8_t soc)
+{
+  int32_t usable = BATTERY_WH * (PERCENT - MIN_SOC) / PERCENT;
+  int32_t stored = soc > MIN_SOC ? BATTERY_WH * (soc - MIN_SOC) / PERCENT : 0;
+  int32_t need = 0;
+  int16_t discharge_price = INT16_MAX; // cheapest slot covered by the battery
+  uint16_t last_discharge = 0;
+
+  memset(plan.modes, SLOT_HOLD, n);
+
+  // the most expensive loads are covered first, until the usable capacity runs out
+  sort_slots(n, true);
+  for (uint16_t k = 0; k < n && need < usable; k++) {
+    uint16_t i = plan.order[k];
+
+    if (plan.net_wh[i] <= 0) {
+      continue;
+    }
+
+    plan.modes[i] = SLOT_DISCHARGE;
+    need += plan.net_wh[i];
+    discharge_price = plan.prices[i] < discharge_price ? plan.prices[i] : discharge_price;
+    last_discharge = i > last_discharge ? i : last_discharge;
+  }
+
+  if (need == 0) {
+    return;
+  }
+
+  // PV surplus before the last discharge charges the battery for free
+  int32_t deficit = (need < usable ? need : usable) - stored;
+
+  for (uint16_t i = 0; i < last_discharge; i++) {
+    deficit += plan.net_wh[i] < 0 ? plan.net_wh[i] : 0;
+  }
+
+  // charging pays off only below the discharge price reduced by the round trip losses
+  int32_t charge_wh = (int32_t)((int64_t)CHARGE_W * slot_s / SECONDS_IN_HOUR * EFFICIENCY_PCT / PERCENT);
+  sort_slots(n, false);
+
+  for (uint16_t k = 0; k < n && deficit > 0; k++) {
+    uint16_t i = plan.order[k];
+
+    if ((int32_t)plan.prices[i] * PERCENT > (int32_t)discharge_price * EFFICIENCY_PCT) {
+      break;
+    }
+
+    if (i >= last_discharge || plan.modes[i] != SLOT_HOLD) {
+      continue;
+    }
+
+    plan.modes[i] = SLOT_CHARGE;
+    deficit -= charge_wh;
+  }
+}
+
+// the last known tariff is asked for the days missing, at most once per period
+static void request_prices(time_t now, bool today_known)
+{
+  if (plan.price_rq_time != 0 && now - plan.price_rq_time < PRICE_RQ_PERIOD_S) {
+    return;
+  }
+
+  uint16_t tariff = today_known ? plan.days[0].tariff : 0;
+  time_t day = today_known ? (time_t)(plan.days[0].day + SECONDS_IN_DAY) : now;
+
+  if (!today_known && storage_energy_price_list(now - SECONDS_IN_DAY, &plan.days[1])) {
+    tariff = plan.days[1].tariff;
+  }
+
+  if (protocol_send_energy_price_day_get(tariff, day) == ESP_OK) {
+    plan.price_rq_time = now;
+  }
+}
+
+static uint8_t applied_mode(void)
+{
+  taskENTER_CRITICAL(&plan_lock);
+  uint8_t mode = plan.applied;
+  taskEXIT_CRITICAL(&plan_lock);
+  return mode;
+}
+
+// returns false when another batch is in progress, the mode counts as applied once its batch succeeds
+static bool apply(uint8_t mode)
+{
+  // claimed before the batch starts, its result can come before inv_set_batch() returns
+  taskENTER_CRITICAL(&plan_lock);
+  uint8_t pending = plan.pending;
+  bool applied = pending == SLOT_NONE && mode == plan.applied;
+  if (pending == SLOT_NONE && !applied) {
+    plan.pending = mode;
+  }
+  taskEXIT_CRITICAL(&plan_lock);
+
+  if (pending != SLOT_NONE) {
+    return pending == mode;
+  }
+
+  if (applied) {
+    return true;
+  }
+
+  const uint8_t lens[] = {strlen(mode_items[mode][0]), strlen(mode_items[mode][1])};
+  int ret = inv_set_batch(INV_SET_BATCH_ID_CHARGE_PLAN, mode_items[mode], lens, sizeof(lens) / sizeof(lens[0]));
+
+  if (ret != ESP_OK) {
+    taskENTER_CRITICAL(&plan_lock);
+    plan.pending = SLOT_NONE;
+    taskEXIT_CRITICAL(&plan_lock);
+    return ret != ESP_ERR_INVALID_STATE;
+  }
+
+  ESP_LOGI(LOG_TAG, "Slot mode %s requested", mode_names[mode]);
+  return true;
+}
+
+static void plan_handler(uint32_t param, void *usr_ctx)
+{
+  ESP_UNUSED(param);
+  ESP_UNUSED(usr_ctx);
+
+  time_t now = time(NULL);
+  inv_snapshot_t snapshot;
+
+  if (now < em_utils_get_compile_time() || inv_snapshot_read(&snapshot) != 0 || snapshot.battery.timestamp == 0 ||
+      (snapshot.stale & INV_STALE_MEAS)) {
+    scheduler_set_callback(plan_handler, SCH_PARAM_NONE, SCH_CTX_NONE, RETRY_MS);
+    return;
+  }
+
+  bool today_known = storage_energy_price_list(now, &plan.days[0]);
+  bool tomorrow_known =
+    today_known && storage_energy_price_list((time_t)(plan.days[0].day + SECONDS_IN_DAY), &plan.days[1]);
+
+  if (!tomorrow_known) {
+    request_prices(now, today_known);
+  }
+
+  if (!today_known) {
+    // grid charging is never left running, self consumption until the prices are known
+    if (applied_mode() != SLOT_NONE && !apply(SLOT_DISCHARGE)) {
+      scheduler_set_callback(plan_handler, SCH_PARAM_NONE, SCH_CTX_NONE, BUSY_RETRY_MS);
+      return;
+    }
+
+    scheduler_set_callback(plan_handler, SCH_PARAM_NONE, SCH_CTX_NONE, RETRY_MS);
+    return;
+  }
+
+  if (plan.profile_day != plan.days[0].day) {
+    build_profile(plan.days[0].day);
+  }
+
+  uint32_t slot_s = 0;
+  uint16_t n = collect_slots(now, &slot_s);
+  plan_slots(n, slot_s, snapshot.battery.soc);
+
+  ESP_LOGI(LOG_TAG, "%u slots, soc=%u%% price=%d", n, snapshot.battery.soc, plan.prices[0]);
+
+  if (!apply(plan.modes[0])) {
+    scheduler_set_callback(plan_handler, SCH_PARAM_NONE, SCH_CTX_NONE, BUSY_RETRY_MS);
+    return;
+  }
+
+  uint32_t to_next_s = slot_s - (uint32_t)((now - plan.days[0].day) % slot_s);
+  scheduler_set_callback(plan_handler, SCH_PARAM_NONE, SCH_CTX_NONE, to_next_s * MS_IN_S + SLOT_GUARD_MS);
+}
+
+void inv_charge_plan_init(void)
+{
+  scheduler_set_callback(plan_handler, SCH_PARAM_NONE, SCH_CTX_NONE, FIRST_PLAN_MS);
+}
+
+static void replan(void)
+{
+  scheduler_set_callback(plan_handler, SCH_PARAM_NONE, SCH_CTX_NONE, PLAN_NOW_MS);
+}
+
+void inv_charge_plan_batch_done(bool success)
+{
+  taskENTER_CRITICAL(&plan_lock);
+  uint8_t mode = plan.pending;
+  plan.pending = SLOT_NONE;
+  plan.applied = success ? mode : SLOT_NONE;
+  taskEXIT_CRITICAL(&plan_lock);
+
+  if (mode == SLOT_NONE) {
+    return;
+  }
+
+  if (success) {
+    ESP_LOGI(LOG_TAG, "Slot mode %s applied", mode_names[mode]);
+    return;
+  }
+
+  // priorities are unknown now, the mode of the slot is set again
+  ESP_LOGW(LOG_TAG, "Slot mode %s failed", mode_names[mode]);
+  scheduler_set_callback(plan_handler, SCH_PARAM_NONE, SCH_CTX_NONE, RETRY_MS);
+}
+
+#else
+
+void inv_charge_plan_init(void)
+{
+}
+
+void inv_charge_plan_batch_done(bool success)
+{
+  ESP_UNUSED(success);
+}
+
+static void replan(void)
+{
+}
+
+#endif /* CONFIG_EM_INVERTER_CHARGE_PLAN */
+
+int inv_charge_plan_set_prices(uint16_t tariff, time_t day, int8_t price_factor, const int16_t *prices,
+                               uint16_t prices_len)
+{
+  assert(prices);
+
+  // equal slots, at least a quarter long
+  if (prices_len == 0 || prices_len > QUARTERS_IN_DAY || SECONDS_IN_DAY % prices_len != 0) {
+    ESP_LOGW(LOG_TAG, "Price list of %u slots refused", prices_len);
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  storage_set_energy_price_list(tariff, price_factor, day, prices, prices_len);
+  replan();
+  return ESP_OK;
+}
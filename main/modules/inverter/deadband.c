@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#include "em/deadband.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <esp_err.h>
+#include <sdkconfig.h>
+
+#include <esp_log.h>
+#define LOG_TAG "INV_DB"
+
+#define US_IN_S (1000000LL)
+
+typedef struct {
+  uint32_t threshold;
+  uint32_t max_silence_s;
+  int32_t value;   // last fed value
+  int32_t sent;    // last reported value
+  int64_t sent_us; // time of the last report
+  bool fed;
+  bool reported;
+} deadband_ch_t;
+
+static const uint32_t default_thresholds[INV_CH_CNT] = {
+  [INV_CH_GRID_VOLTAGE] = INV_MIN_AC_VOLTAGE_DIFF,
+  [INV_CH_GRID_POWER] = INV_MIN_POWER_DIFF,
+  [INV_CH_GRID_FREQ] = INV_MIN_FREQ_DIFF,
+  [INV_CH_BATTERY_VOLTAGE] = INV_MIN_DC_VOLTAGE_DIFF,
+  [INV_CH_BATTERY_POWER] = INV_MIN_POWER_DIFF,
+  [INV_CH_AC_OUT_VOLTAGE] = INV_MIN_AC_VOLTAGE_DIFF,
+  [INV_CH_AC_OUT_POWER] = INV_MIN_POWER_DIFF,
+  [INV_CH_AC_OUT_FREQ] = INV_MIN_FREQ_DIFF,
+  [INV_CH_PV_VOLTAGE] = INV_MIN_DC_VOLTAGE_DIFF,
+  [INV_CH_PV_POWER] = INV_MIN_POWER_DIFF,
+  [INV_CH_ENERGY_GRID_CONSUMED] = INV_MIN_ENERGY_DIFF,
+  [INV_CH_ENERGY_GRID_PROVIDED] = INV_MIN_ENERGY_DIFF,
+  [INV_CH_ENERGY_AC_OUTPUT] = INV_MIN_ENERGY_DIFF,
+  [INV_CH_ENERGY_PV] = INV_MIN_ENERGY_DIFF,
+  [INV_CH_ENERGY_BATTERY_CHARGE] = INV_MIN_ENERGY_DIFF,
+  [INV_CH_ENERGY_BATTERY_DISCHARGE] = INV_MIN_ENERGY_DIFF,
+};
+
+static deadband_ch_t channels[INV_CH_CNT];
+
+static bool is_pending(const deadband_ch_t *ch, int64_t now_us)
+{
+  if (!ch->fed) {
+    return false;
+  }
+
+  if (!ch->reported) {
+    return true;
+  }
+
+  uint32_t diff = (uint32_t)llabs((int64_t)ch->value - ch->sent);
+
+  if (diff != 0 && diff >= ch->threshold) {
+    return true;
+  }
+
+  return ch->max_silence_s != 0 && (now_us - ch->sent_us) >= (int64_t)ch->max_silence_s * US_IN_S;
+}
+
+void inv_deadband_init(void)
+{
+  for (uint32_t i = 0; i < INV_CH_CNT; i++) {
+    channels[i] = (deadband_ch_t){
+      .threshold = default_thresholds[i],
+      .max_silence_s = CONFIG_EM_INVERTER_DEADBAND_MAX_SILENCE_S,
+    };
+  }
+}
+
+void inv_deadband_feed(inv_channel_t channel, int32_t value)
+{
+  assert(channel < INV_CH_CNT);
+
+  channels[channel].value = value;
+  channels[channel].fed = true;
+}
+
+size_t inv_deadband_collect(uint8_t *out_channels, int32_t *values, size_t max_cnt, int64_t now_us)
+{
+  assert(out_channels && values);
+
+  size_t cnt = 0;
+
+  for (uint32_t i = 0; i < INV_CH_CNT && cnt < max_cnt; i++) {
+    if (is_pending(&channels[i], now_us)) {
+      out_channels[cnt] = (uint8_t)i;
+      values[cnt] = channels[i].value;
+      cnt++;
+    }
+  }
+
+  return cnt;
+}
+
+void inv_deadband_commit(const uint8_t *out_channels, const int32_t *values, size_t cnt, int64_t now_us)
+{
+  assert(out_channels && values);
+
+  for (size_t i = 0; i < cnt; i++) {
+    assert(out_channels[i] < INV_CH_CNT);
+    deadband_ch_t *ch = &channels[out_channels[i]];
+    ch->sent = values[i];
+    ch->sent_us = now_us;
+    ch->reported = true;
+  }
+}
+
+void inv_deadband_reset(inv_channel_t channel)
+{
+  assert(channel < INV_CH_CNT);
+
+  channels[channel].threshold = default_thresholds[channel];
+  channels[channel].max_silence_s = CONFIG_EM_INVERTER_DEADBAND_MAX_SILENCE_S;
+}
+
+int inv_deadband_set(uint8_t channel, uint32_t threshold, uint32_t max_silence_s)
+{
+  if (channel >= INV_CH_CNT) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  ESP_LOGI(LOG_TAG, "Channel %d threshold=%lu max_silence=%lus", channel, threshold, max_silence_s);
+  channels[channel].threshold = threshold;
+  channels[channel].max_silence_s = max_silence_s;
+  return ESP_OK;
+}
+
+int inv_deadband_get(uint8_t channel, uint32_t *threshold, uint32_t *max_silence_s)
+{
+  assert(threshold && max_silence_s);
+
+  if (channel >= INV_CH_CNT) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  *threshold = channels[channel].threshold;
+  *max_silence_s = channels[channel].max_silence_s;
+  return ESP_OK;
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#include "em/energy.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <esp_log.h>
+#define LOG_TAG "INV_ENERGY"
+
+#define MAX_GAP_US ((int64_t)CONFIG_EM_INVERTER_MAX_INTEGRATION_GAP_MS * 1000)
+
+// energy in mWs of linear power change from p0 to p1 (same sign) over dt_us
+static uint64_t trapezoid_mws(uint32_t p0, uint32_t p1, int64_t dt_us)
+{
+  return ((uint64_t)p0 + p1) * (uint64_t)dt_us / 2000;
+}
+
+void inv_energy_integrator_reset(inv_energy_integrator_t *ei)
+{
+  assert(ei != NULL);
+  memset(ei, 0, sizeof(*ei));
+}
+
+void inv_energy_integrate(inv_energy_integrator_t *ei, int64_t now_us, int32_t power, uint64_t *pos_ws,
+                          uint64_t *neg_ws)
+{
+  assert(ei != NULL);
+  assert(pos_ws != NULL);
+  assert(neg_ws != NULL);
+
+  *pos_ws = 0;
+  *neg_ws = 0;
+
+  if (ei->last_us == 0 || now_us <= ei->last_us) {
+    ei->last_us = now_us;
+    ei->last_power = power;
+    return;
+  }
+
+  int64_t dt_us = now_us - ei->last_us;
+  int32_t p0 = ei->last_power;
+  int32_t p1 = power;
+
+  if (dt_us > MAX_GAP_US) {
+    // missed polls - shape of power in between is unknown, hold last value for max gap only
+    ESP_LOGW(LOG_TAG, "Gap %lld ms, integrating %d ms only", dt_us / 1000, CONFIG_EM_INVERTER_MAX_INTEGRATION_GAP_MS);
+    ei->skipped_us += dt_us - MAX_GAP_US;
+    dt_us = MAX_GAP_US;
+    p1 = p0;
+  }
+
+  uint64_t pos_mws = ei->pos_rem_mws;
+  uint64_t neg_mws = ei->neg_rem_mws;
+
+  if ((p0 >= 0) == (p1 >= 0)) {
+    uint64_t e = trapezoid_mws(abs(p0), abs(p1), dt_us);
+
+    if (p0 >= 0) {
+      pos_mws += e;
+    } else {
+      neg_mws += e;
+    }
+  } else {
+    // split at zero crossing, each part is a triangle
+    uint32_t a0 = abs(p0);
+    uint32_t a1 = abs(p1);
+    int64_t t0_us = (int64_t)((uint64_t)dt_us * a0 / (a0 + a1));
+    uint64_t e0 = trapezoid_mws(a0, 0, t0_us);
+    uint64_t e1 = trapezoid_mws(0, a1, dt_us - t0_us);
+
+    if (p0 >= 0) {
+      pos_mws += e0;
+      neg_mws += e1;
+    } else {
+      neg_mws += e0;
+      pos_mws += e1;
+    }
+  }
+
+  *pos_ws = pos_mws / 1000;
+  *neg_ws = neg_mws / 1000;
+  ei->pos_rem_mws = pos_mws % 1000;
+  ei->neg_rem_mws = neg_mws % 1000;
+  ei->last_us = now_us;
+  ei->last_power = power;
+}
@@ -0,0 +1,273 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#include "em/energy_reconcile.h"
+#include "em/energy_store.h"
+#include "em/inverter_priv.h"
+#include "em/protocol.h"
+#include "em/rs232_2400_protocol.h"
+#include "em/scheduler.h"
+#include "em/time.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <esp_attr.h>
+#include <esp_macros.h>
+#include <esp_rom_crc.h>
+#include <freertos/FreeRTOS.h>
+#include <sdkconfig.h>
+
+#include <esp_log.h>
+#define LOG_TAG "INV_ERECON"
+
+#define RTC_MAGIC            (0x45524543UL) // "EREC"
+#define FIRST_ROUND_DELAY_MS (60000u)       // lets identification and first measurements through
+#define STEP_INTERVAL_MS     (5000u)
+#define ROUND_INTERVAL_MS    (CONFIG_EM_INVERTER_ENERGY_POLL_S * 1000u)
+#define RQ_TIMEOUT_MS        (2000u)
+#define RQ_RETRIES           (1u)
+#define RQ_MAX_LEN           (16u)
+#define WS_IN_WH             (3600LL)
+#define WH_IN_KWH            (1000LL)
+#define MIN_CORRECTION_WS    ((int64_t)CONFIG_EM_INVERTER_RECONCILE_MIN_WH * WS_IN_WH)
+#define GAP_MARGIN_WH        (WH_IN_KWH) // resolution of the lifetime counter
+#define WITHHELD_DIVIDER     (2u)        // at most half of the integrated energy pays the debt, counter keeps moving
+
+typedef struct {
+  uint32_t magic;
+  uint32_t day;          // yyyymmdd of the day reference, 0 - none
+  uint32_t day_ref_wh;   // inverter daily counter at the reference
+  uint64_t day_ref_ws;   // PV total at the reference
+  time_t day_ref_time;
+  int64_t correction_ws; // added (positive) and withheld (negative) since the day reference
+  uint64_t gap_ws;       // filled since the day reference
+  uint64_t debt_ws;      // excess not withheld yet
+  bool total_valid;
+  uint32_t total_ref_kwh; // inverter lifetime counter at the reference
+  uint64_t total_ref_ws;  // PV total at the reference
+  uint32_t crc;
+} rtc_reconcile_t;
+
+typedef struct {
+  time_t timestamp;
+  uint32_t inverter_wh;   // daily counter change since the reference
+  uint32_t integrated_wh; // integrated since the reference, without corrections
+} drift_t;
+
+static const uint16_t counter_cmds[INV_ENERGY_COUNTERS_CNT] = {
+  EM_RS232_2400_QET, EM_RS232_2400_QEY, EM_RS232_2400_QEM, EM_RS232_2400_QED, EM_RS232_2400_QEH,
+};
+
+// not initialized on software reset, content is valid only with matching magic and CRC
+static RTC_NOINIT_ATTR rtc_reconcile_t rtc;
+
+// owned by the serial client task, only the polled day comes from the scheduler callback
+static uint32_t counters[INV_ENERGY_COUNTERS_CNT];
+static drift_t drift = {0};
+static uint32_t polled_day;
+static portMUX_TYPE polled_day_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void rtc_commit(void)
+{
+  rtc.crc = esp_rom_crc32_le(0, (const uint8_t *)&rtc, offsetof(rtc_reconcile_t, crc));
+}
+
+static void day_reference(uint32_t day, uint32_t day_wh, uint64_t total_ws, time_t now)
+{
+  rtc.day = day;
+  rtc.day_ref_wh = day_wh;
+  rtc.day_ref_ws = total_ws;
+  rtc.day_ref_time = now;
+  rtc.correction_ws = 0;
+  rtc.gap_ws = 0;
+  rtc_commit();
+
+  memset(&drift, 0, sizeof(drift));
+  drift.timestamp = now;
+}
+
+static void reconcile_day(uint32_t day_wh)
+{
+  time_t now = time(NULL);
+  uint64_t total_ws = inv_energy_store_total(INV_ENERGY_PV);
+
+  taskENTER_CRITICAL(&polled_day_lock);
+  uint32_t day = polled_day;
+  taskEXIT_CRITICAL(&polled_day_lock);
+
+  if (rtc.day != day || day_wh < rtc.day_ref_wh) {
+    ESP_LOGI(LOG_TAG, "Day %lu reference %luWh", day, day_wh);
+    day_reference(day, day_wh, total_ws, now);
+    return;
+  }
+
+  int64_t inverter_ws = (int64_t)(day_wh - rtc.day_ref_wh) * WS_IN_WH;
+  int64_t counted_ws = (int64_t)(total_ws - rtc.day_ref_ws);
+  int64_t err_ws = inverter_ws - (counted_ws - (int64_t)rtc.debt_ws);
+
+  drift.timestamp = now;
+  drift.inverter_wh = day_wh - rtc.day_ref_wh;
+  drift.integrated_wh = (uint32_t)((counted_ws - rtc.correction_ws - (int64_t)rtc.gap_ws) / WS_IN_WH);
+
+  if (err_ws >= MIN_CORRECTION_WS) {
+    // excess found earlier and not withheld yet turned out to be real
+    int64_t forgiven = err_ws < (int64_t)rtc.debt_ws ? err_ws : (int64_t)rtc.debt_ws;
+    rtc.debt_ws -= (uint64_t)forgiven;
+    err_ws -= forgiven;
+
+    if (err_ws > 0) {
+      inv_add_energy_correction((uint64_t)err_ws);
+      rtc.correction_ws += err_ws;
+    }
+
+    rtc_commit();
+    ESP_LOGI(LOG_TAG, "Day missing %lldWh, debt %lluWh", err_ws / WS_IN_WH, rtc.debt_ws / WS_IN_WH);
+  } else if (err_ws <= -MIN_CORRECTION_WS) {
+    rtc.debt_ws += (uint64_t)(-err_ws);
+    rtc_commit();
+    ESP_LOGI(LOG_TAG, "Day excess %lldWh, debt %lluWh", -err_ws / WS_IN_WH, rtc.debt_ws / WS_IN_WH);
+  }
+}
+
+static void reconcile_total(uint32_t total_kwh)
+{
+  uint64_t total_ws = inv_energy_store_total(INV_ENERGY_PV);
+
+  if (!rtc.total_valid || total_kwh < rtc.total_ref_kwh) {
+    ESP_LOGI(LOG_TAG, "Lifetime reference %lukWh", total_kwh);
+    rtc.total_valid = true;
+    rtc.total_ref_kwh = total_kwh;
+    rtc.total_ref_ws = total_ws;
+    rtc_commit();
+    return;
+  }
+
+  int64_t inverter_wh = (int64_t)(total_kwh - rtc.total_ref_kwh) * WH_IN_KWH;
+  int64_t counted_wh = ((int64_t)(total_ws - rtc.total_ref_ws) - (int64_t)rtc.debt_ws) / WS_IN_WH;
+  int64_t gap_wh = inverter_wh - counted_wh - GAP_MARGIN_WH;
+
+  if (gap_wh > 0) {
+    // downtime not covered by the daily counter, e.g. spanning midnight
+    ESP_LOGI(LOG_TAG, "Gap filled %lldWh", gap_wh);
+    inv_add_energy_correction((uint64_t)(gap_wh * WS_IN_WH));
+    rtc.gap_ws += (uint64_t)(gap_wh * WS_IN_WH);
+  } else if (counted_wh <= inverter_wh + GAP_MARGIN_WH) {
+    return; // keep the reference, differences below the counter resolution add up
+  }
+
+  rtc.total_ref_kwh = total_kwh;
+  rtc.total_ref_ws = inv_energy_store_total(INV_ENERGY_PV);
+  rtc_commit();
+}
+
+static void report_drift(void)
+{
+  if (rtc.day == 0) {
+    return; // no daily counter read yet
+  }
+
+  int64_t correction_wh = rtc.correction_ws / WS_IN_WH;
+  uint32_t gap_wh = (uint32_t)(rtc.gap_ws / WS_IN_WH);
+
+  ESP_LOGI(LOG_TAG, "Drift inverter=%luWh integrated=%luWh correction=%lldWh gap=%luWh", drift.inverter_wh,
+           drift.integrated_wh, correction_wh, gap_wh);
+
+  int ret = protocol_send_inverter_energy_drift(drift.timestamp, rtc.day_ref_time, drift.inverter_wh,
+                                                drift.integrated_wh, (int32_t)correction_wh, gap_wh, counters,
+                                                INV_ENERGY_COUNTERS_CNT);
+
+  if (ret != 0) {
+    // next round sends the metric again
+    ESP_LOGW(LOG_TAG, "Send drift err=%d", ret);
+  }
+}
+
+static void poll_step_handler(uint32_t step, void *user_ctx)
+{
+  ESP_UNUSED(user_ctx);
+  assert(step < INV_ENERGY_COUNTERS_CNT);
+
+  time_t now = time(NULL);
+
+  if (now < em_utils_get_compile_time()) {
+    // dated inquiries need synchronized time
+    scheduler_set_callback(poll_step_handler, INV_ENERGY_COUNTER_TOTAL, SCH_CTX_NONE, ROUND_INTERVAL_MS);
+    return;
+  }
+
+  struct tm date;
+  uint8_t payload[RQ_MAX_LEN];
+  localtime_r(&now, &date);
+  size_t len = rs232_2400_energy_rq(counter_cmds[step], &date, payload, sizeof(payload));
+
+  if (step == INV_ENERGY_COUNTER_DAY) {
+    taskENTER_CRITICAL(&polled_day_lock);
+    polled_day = (uint32_t)(date.tm_year + 1900) * 10000u + (uint32_t)(date.tm_mon + 1) * 100u + (uint32_t)date.tm_mday;
+    taskEXIT_CRITICAL(&polled_day_lock);
+  }
+
+  if (len == 0 || em_sc_send(&sc, counter_cmds[step], payload, len, RQ_TIMEOUT_MS, RQ_RETRIES) != 0) {
+    ESP_LOGW(LOG_TAG, "Send counter[%lu] failed", step);
+  }
+
+  if (step + 1 < INV_ENERGY_COUNTERS_CNT) {
+    scheduler_set_callback(poll_step_handler, step + 1, SCH_CTX_NONE, STEP_INTERVAL_MS);
+  } else {
+    scheduler_set_callback(poll_step_handler, INV_ENERGY_COUNTER_TOTAL, SCH_CTX_NONE, ROUND_INTERVAL_MS);
+  }
+}
+
+void inv_energy_reconcile_init(void)
+{
+  if (rtc.magic != RTC_MAGIC ||
+      rtc.crc != esp_rom_crc32_le(0, (const uint8_t *)&rtc, offsetof(rtc_reconcile_t, crc))) {
+    memset(&rtc, 0, sizeof(rtc));
+    rtc.magic = RTC_MAGIC;
+    rtc_commit();
+  } else {
+    ESP_LOGI(LOG_TAG, "References restored from RTC memory, debt %lluWh", rtc.debt_ws / WS_IN_WH);
+  }
+
+  scheduler_set_callback(poll_step_handler, INV_ENERGY_COUNTER_TOTAL, SCH_CTX_NONE, FIRST_ROUND_DELAY_MS);
+}
+
+void inv_energy_reconcile_counter(inv_energy_counter_t counter, uint32_t value)
+{
+  assert(counter < INV_ENERGY_COUNTERS_CNT);
+  counters[counter] = value;
+
+  switch (counter) {
+  case INV_ENERGY_COUNTER_TOTAL:
+    reconcile_total(value);
+    break;
+  case INV_ENERGY_COUNTER_DAY:
+    reconcile_day(value);
+    break;
+  case INV_ENERGY_COUNTER_HOUR:
+    report_drift(); // last one of the round
+    break;
+  default:
+    break;
+  }
+}
+
+uint64_t inv_energy_reconcile_filter(uint64_t energy)
+{
+  if (rtc.debt_ws == 0) {
+    return energy;
+  }
+
+  uint64_t withheld = energy / WITHHELD_DIVIDER;
+
+  if (withheld > rtc.debt_ws) {
+    withheld = rtc.debt_ws;
+  }
+
+  rtc.debt_ws -= withheld;
+  rtc.correction_ws -= (int64_t)withheld;
+  rtc_commit();
+  return energy - withheld;
+}
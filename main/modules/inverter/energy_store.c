@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#include "em/energy_store.h"
+#include "em/storage.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <esp_attr.h>
+#include <esp_rom_crc.h>
+#include <esp_timer.h>
+
+#include <esp_log.h>
+#define LOG_TAG "INV_ESTORE"
+
+#define RTC_MAGIC            (0x45434E54UL) // "ECNT"
+#define US_IN_MS             (1000LL)
+#define BUDGET_WINDOW_US     (24LL * 3600LL * 1000LL * US_IN_MS)
+#define CHECKPOINT_MIN_DELTA ((uint64_t)CONFIG_EM_INVERTER_CHECKPOINT_MIN_WH * 3600U)
+
+typedef struct {
+  uint32_t magic;
+  uint64_t total[INV_ENERGY_CHANNELS_CNT]; // in Ws
+  uint32_t crc;
+} rtc_counters_t;
+
+// not initialized on software reset, content is valid only with matching magic and CRC
+static RTC_NOINIT_ATTR rtc_counters_t rtc_counters;
+
+static uint64_t checkpoint_sum;   // sum of all counters at the last flash checkpoint
+static int64_t checkpoint_us;     // time of the last flash checkpoint
+static int64_t budget_window_us;  // start of the current budget window
+static uint16_t budget_writes;    // flash writes in the current budget window
+
+static uint32_t rtc_crc(void)
+{
+  return esp_rom_crc32_le(0, (const uint8_t *)&rtc_counters, offsetof(rtc_counters_t, crc));
+}
+
+static uint64_t counters_sum(void)
+{
+  uint64_t sum = 0;
+
+  for (size_t i = 0; i < INV_ENERGY_CHANNELS_CNT; i++) {
+    sum += rtc_counters.total[i];
+  }
+
+  return sum;
+}
+
+static storage_energy_counters_t to_storage(void)
+{
+  storage_energy_counters_t c = {
+    .grid_consumed = rtc_counters.total[INV_ENERGY_GRID_CONSUMED],
+    .grid_provided = rtc_counters.total[INV_ENERGY_GRID_PROVIDED],
+    .ac_output = rtc_counters.total[INV_ENERGY_AC_OUTPUT],
+    .pv = rtc_counters.total[INV_ENERGY_PV],
+    .battery_charge = rtc_counters.total[INV_ENERGY_BATTERY_CHARGE],
+    .battery_discharge = rtc_counters.total[INV_ENERGY_BATTERY_DISCHARGE],
+  };
+
+  return c;
+}
+
+static void checkpoint_check(void)
+{
+  int64_t now_us = esp_timer_get_time();
+  uint64_t sum = counters_sum();
+  uint64_t delta = sum - checkpoint_sum;
+  int64_t since_us = now_us - checkpoint_us;
+
+  if (now_us - budget_window_us >= BUDGET_WINDOW_US) {
+    budget_window_us = now_us;
+    budget_writes = 0;
+  }
+
+  bool save = delta > 0 && ((delta >= CHECKPOINT_MIN_DELTA && since_us >= CONFIG_EM_INVERTER_CHECKPOINT_MIN_INTERVAL_S * 1000LL * US_IN_MS) ||
+                            since_us >= CONFIG_EM_INVERTER_CHECKPOINT_MAX_INTERVAL_S * 1000LL * US_IN_MS);
+
+  if (save && budget_writes >= CONFIG_EM_INVERTER_CHECKPOINT_DAILY_BUDGET) {
+    // keep RAM copy fresh for shutdown dump, flash waits for the next window
+    save = false;
+  }
+
+  storage_energy_counters_t c = to_storage();
+  storage_set_energy_counters(&c, save);
+
+  if (save) {
+    budget_writes++;
+    checkpoint_sum = sum;
+    checkpoint_us = now_us;
+    ESP_LOGI(LOG_TAG, "Checkpoint %u/%d", budget_writes, CONFIG_EM_INVERTER_CHECKPOINT_DAILY_BUDGET);
+  }
+}
+
+void inv_energy_store_init(void)
+{
+  if (rtc_counters.magic == RTC_MAGIC && rtc_counters.crc == rtc_crc()) {
+    ESP_LOGI(LOG_TAG, "Counters restored from RTC memory");
+  } else {
+    storage_energy_counters_t c = storage_energy_counters();
+    rtc_counters.magic = RTC_MAGIC;
+    rtc_counters.total[INV_ENERGY_GRID_CONSUMED] = c.grid_consumed;
+    rtc_counters.total[INV_ENERGY_GRID_PROVIDED] = c.grid_provided;
+    rtc_counters.total[INV_ENERGY_AC_OUTPUT] = c.ac_output;
+    rtc_counters.total[INV_ENERGY_PV] = c.pv;
+    rtc_counters.total[INV_ENERGY_BATTERY_CHARGE] = c.battery_charge;
+    rtc_counters.total[INV_ENERGY_BATTERY_DISCHARGE] = c.battery_discharge;
+    rtc_counters.crc = rtc_crc();
+    ESP_LOGI(LOG_TAG, "Counters restored from flash");
+  }
+
+  checkpoint_sum = counters_sum();
+  checkpoint_us = esp_timer_get_time();
+  budget_window_us = checkpoint_us;
+  budget_writes = 0;
+}
+
+void inv_energy_store_add(inv_energy_channel_t channel, uint64_t energy)
+{
+  assert(channel < INV_ENERGY_CHANNELS_CNT);
+
+  if (energy == 0) {
+    return;
+  }
+
+  rtc_counters.total[channel] += energy;
+  rtc_counters.crc = rtc_crc();
+  checkpoint_check();
+}
+
+uint64_t inv_energy_store_total(inv_energy_channel_t channel)
+{
+  assert(channel < INV_ENERGY_CHANNELS_CNT);
+  return rtc_counters.total[channel];
+}
@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#include "em/history.h"
+#include "em/fixed.h"
+#include "em/time.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <esp_partition.h>
+#include <spi_flash_mmap.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include <esp_log.h>
+#define LOG_TAG "INV_HIST"
+
+#define HISTORY_PARTITION_LABEL   "history"
+#define HISTORY_PARTITION_SUBTYPE (0x40)
+#define HISTORY_CHANNELS_CNT      (4u)
+
+#define SLOTS_PER_SECTOR (SPI_FLASH_SEC_SIZE / sizeof(em_rrd_slot_t))
+// writing into a used sector erases it, one spare sector keeps the retention when that drops the oldest periods
+#define RING_SLOTS(retention) ((((retention) + SLOTS_PER_SECTOR - 1) / SLOTS_PER_SECTOR + 1) * SLOTS_PER_SECTOR)
+
+#define MINUTE_RETENTION  (2u * 60u)
+#define QUARTER_RETENTION (7u * 24u * 4u)
+#define HOUR_RETENTION    (90u * 24u)
+#define DAY_RETENTION     (2u * 366u)
+
+#define MINUTE_SLOTS  RING_SLOTS(MINUTE_RETENTION)
+#define QUARTER_SLOTS RING_SLOTS(QUARTER_RETENTION)
+#define HOUR_SLOTS    RING_SLOTS(HOUR_RETENTION)
+#define DAY_SLOTS     RING_SLOTS(DAY_RETENTION)
+
+#define SERIES_SLOTS (MINUTE_SLOTS + QUARTER_SLOTS + HOUR_SLOTS + DAY_SLOTS)
+#define SERIES_SIZE  (SERIES_SLOTS * sizeof(em_rrd_slot_t))
+#define HISTORY_SIZE (HISTORY_CHANNELS_CNT * SERIES_SIZE)
+
+_Static_assert(sizeof(em_rrd_slot_t) == 16, "slot must not straddle flash pages");
+_Static_assert(HISTORY_SIZE == 0x50000, "partitions.csv history size");
+
+typedef struct {
+  em_rrd_t rrd;
+  uint32_t offset; // in the partition
+  inv_channel_t channel;
+} history_series_t;
+
+static const em_rrd_tier_t tiers[INV_HISTORY_TIERS_CNT] = {
+  {.step_s = SECONDS_IN_MINUTE, .slots = MINUTE_SLOTS, .retention = MINUTE_RETENTION},
+  {.step_s = SECONDS_IN_QUARTER, .slots = QUARTER_SLOTS, .retention = QUARTER_RETENTION},
+  {.step_s = SECONDS_IN_HOUR, .slots = HOUR_SLOTS, .retention = HOUR_RETENTION},
+  {.step_s = SECONDS_IN_DAY, .slots = DAY_SLOTS, .retention = DAY_RETENTION},
+};
+
+// ring of the tier starts at this slot of the series
+static const uint32_t tier_offsets[INV_HISTORY_TIERS_CNT] = {
+  0,
+  MINUTE_SLOTS,
+  MINUTE_SLOTS + QUARTER_SLOTS,
+  MINUTE_SLOTS + QUARTER_SLOTS + HOUR_SLOTS,
+};
+
+static const inv_channel_t history_channels[HISTORY_CHANNELS_CNT] = {
+  INV_CH_GRID_POWER,
+  INV_CH_BATTERY_POWER,
+  INV_CH_AC_OUT_POWER,
+  INV_CH_PV_POWER,
+};
+
+static history_series_t series[HISTORY_CHANNELS_CNT];
+static const esp_partition_t *partition = NULL;
+static StaticSemaphore_t history_mtx_data;
+static SemaphoreHandle_t history_mtx;
+
+static size_t slot_offset(const history_series_t *s, uint8_t tier, uint32_t idx)
+{
+  return s->offset + (tier_offsets[tier] + idx) * sizeof(em_rrd_slot_t);
+}
+
+static bool slot_erased(const em_rrd_slot_t *slot)
+{
+  const uint8_t *raw = (const uint8_t *)slot;
+
+  for (size_t i = 0; i < sizeof(*slot); i++) {
+    if (raw[i] != 0xFF) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static int flash_read(void *ctx, uint8_t tier, uint32_t idx, em_rrd_slot_t *slot)
+{
+  return esp_partition_read(partition, slot_offset(ctx, tier, idx), slot, sizeof(*slot));
+}
+
+static int flash_write(void *ctx, uint8_t tier, uint32_t idx, const em_rrd_slot_t *slot)
+{
+  size_t offset = slot_offset(ctx, tier, idx);
+  em_rrd_slot_t old;
+  esp_err_t err = esp_partition_read(partition, offset, &old, sizeof(old));
+
+  if (err != ESP_OK) {
+    return err;
+  }
+
+  // slot holds a period of the previous ring lap, rest of the sector is at least as old
+  if (!slot_erased(&old)) {
+    err = esp_partition_erase_range(partition, offset - (offset % SPI_FLASH_SEC_SIZE), SPI_FLASH_SEC_SIZE);
+
+    if (err != ESP_OK) {
+      return err;
+    }
+  }
+
+  return esp_partition_write(partition, offset, slot, sizeof(*slot));
+}
+
+static history_series_t *find_series(inv_channel_t channel)
+{
+  for (uint32_t i = 0; i < HISTORY_CHANNELS_CNT; i++) {
+    if (series[i].channel == channel) {
+      return &series[i];
+    }
+  }
+
+  return NULL;
+}
+
+int inv_history_init(void)
+{
+  history_mtx = xSemaphoreCreateMutexStatic(&history_mtx_data);
+
+  for (uint32_t i = 0; i < HISTORY_CHANNELS_CNT; i++) {
+    em_rrd_backend_t backend = {.write = flash_write, .read = flash_read, .ctx = &series[i]};
+
+    series[i].channel = history_channels[i];
+    series[i].offset = i * SERIES_SIZE;
+
+    if (em_rrd_init(&series[i].rrd, tiers, INV_HISTORY_TIERS_CNT, &backend) != 0) {
+      ESP_LOGE(LOG_TAG, "Failed init history[%lu]", i);
+      return -1;
+    }
+  }
+
+  partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, HISTORY_PARTITION_SUBTYPE, HISTORY_PARTITION_LABEL);
+
+  if (partition == NULL || partition->size < HISTORY_SIZE) {
+    ESP_LOGW(LOG_TAG, "No history partition, history disabled");
+    partition = NULL;
+    return -1;
+  }
+
+  ESP_LOGI(LOG_TAG, "History %u channels, %zu bytes each", HISTORY_CHANNELS_CNT, SERIES_SIZE);
+  return 0;
+}
+
+void inv_history_add(inv_channel_t channel, int32_t power, time_t now)
+{
+  if (partition == NULL || now < em_utils_get_compile_time()) {
+    return; // disabled or time not synchronized
+  }
+
+  history_series_t *s = find_series(channel);
+  assert(s != NULL);
+
+  xSemaphoreTake(history_mtx, portMAX_DELAY);
+  int ret = em_rrd_add(&s->rrd, now, em_fixed_sat_i16(power));
+  xSemaphoreGive(history_mtx);
+
+  if (ret != 0) {
+    ESP_LOGW(LOG_TAG, "Add ch=%d err=%d", channel, ret);
+  }
+}
+
+int inv_history_read(inv_channel_t channel, inv_history_tier_t tier, time_t ts, em_rrd_slot_t *slot)
+{
+  assert(slot != NULL);
+  assert(tier < INV_HISTORY_TIERS_CNT);
+
+  history_series_t *s = find_series(channel);
+
+  if (partition == NULL || s == NULL) {
+    return -1;
+  }
+
+  xSemaphoreTake(history_mtx, portMAX_DELAY);
+  int ret = em_rrd_read(&s->rrd, tier, ts, slot);
+  xSemaphoreGive(history_mtx);
+  return ret;
+}
+
+int inv_history_iter_init(em_rrd_iter_t *it, inv_channel_t channel, inv_history_tier_t tier, time_t from, time_t to)
+{
+  assert(it != NULL);
+  assert(tier < INV_HISTORY_TIERS_CNT);
+
+  history_series_t *s = find_series(channel);
+
+  if (partition == NULL || s == NULL) {
+    return -1;
+  }
+
+  em_rrd_iter_init(it, &s->rrd, tier, from, to, time(NULL));
+  return 0;
+}
+
+bool inv_history_iter_next(em_rrd_iter_t *it, em_rrd_slot_t *slot)
+{
+  assert(it != NULL);
+
+  xSemaphoreTake(history_mtx, portMAX_DELAY);
+  bool ret = em_rrd_iter_next(it, slot);
+  xSemaphoreGive(history_mtx);
+  return ret;
+}
+
+inv_history_tier_t inv_history_select_tier(time_t from, uint32_t resolution_s)
+{
+  if (partition == NULL) {
+    return INV_HISTORY_TIER_DAY;
+  }
+
+  // all series share the tier table
+  return (inv_history_tier_t)em_rrd_select_tier(&series[0].rrd, from, time(NULL), resolution_s);
+}
+
+uint32_t inv_history_tier_step(inv_history_tier_t tier)
+{
+  assert(tier < INV_HISTORY_TIERS_CNT);
+  return tiers[tier].step_s;
+}
@@ -0,0 +1,334 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#include "em/downsample.h"
+#include "em/history.h"
+#include "em/inverter.h"
+#include "em/protocol.h"
+#include "em/scheduler.h"
+#include "em/time.h"
+#include "em/tscodec.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+#include <esp_err.h>
+#include <esp_macros.h>
+#include <freertos/FreeRTOS.h>
+
+#include <esp_log.h>
+#define LOG_TAG "INV_HQRY"
+
+#define PAGE_ENTRIES     CONFIG_EM_INVERTER_HISTORY_PAGE_ENTRIES
+#define PAGE_INTERVAL_MS (100u)  // lets other messages through between pages, counted from the page TX completion
+#define SEND_RETRY_MS    (1000u) // buffer pool exhausted or connection down
+#define PAGE_ENTRY_LEN   (14u)   // t_offset, samples, sum, min and max of the plain page
+
+typedef enum {
+  PAGE_FIELD_SAMPLES,
+  PAGE_FIELD_SUM,
+  PAGE_FIELD_MIN,
+  PAGE_FIELD_MAX,
+  PAGE_FIELDS_CNT,
+} page_field_t;
+
+typedef struct {
+  time_t start; // beginning of the first entry
+  uint16_t entries_num;
+  bool last;
+  uint32_t t_offset[PAGE_ENTRIES];
+  uint16_t samples[PAGE_ENTRIES];
+  int32_t sum[PAGE_ENTRIES];
+  int16_t min[PAGE_ENTRIES];
+  int16_t max[PAGE_ENTRIES];
+} history_page_t;
+
+typedef struct {
+  uint8_t channel;
+  uint32_t resolution; // multiple of the tier step
+  uint32_t step;
+  inv_history_tier_t tier;
+  uint16_t points; // LTTB downsampled page, 0 - all periods merged to the resolution
+  em_rrd_iter_t it;
+} history_request_t;
+
+typedef struct {
+  bool active;
+  bool page_ready; // built and not sent yet
+  uint16_t page_idx;
+  history_request_t rq;
+  em_rrd_slot_t bucket; // periods merged to the resolution, period is ts / resolution
+  history_page_t page;
+} history_query_t;
+
+// owned by the scheduler callback, requests from the dispatcher are handed over through pending
+static history_query_t query = {0};
+static history_request_t pending;
+static bool pending_valid = false;
+static bool page_in_flight = false; // sent page not written yet, the next one waits for its TX completion
+static portMUX_TYPE pending_lock = portMUX_INITIALIZER_UNLOCKED;
+// packed page is sent only when smaller than the plain one, so it fits the same buffer
+static uint8_t packed[PAGE_ENTRIES * PAGE_ENTRY_LEN];
+
+static void page_add(history_page_t *page, uint32_t resolution, const em_rrd_slot_t *bucket)
+{
+  time_t ts = (time_t)bucket->period * resolution;
+  uint16_t idx = page->entries_num++;
+
+  if (idx == 0) {
+    page->start = ts;
+  }
+
+  page->t_offset[idx] = (uint32_t)(ts - page->start);
+  page->samples[idx] = bucket->count;
+  page->sum[idx] = bucket->sum;
+  page->min[idx] = bucket->min;
+  page->max[idx] = bucket->max;
+}
+
+static int64_t page_field(const history_page_t *page, page_field_t field, uint16_t idx)
+{
+  switch (field) {
+  case PAGE_FIELD_SAMPLES:
+    return page->samples[idx];
+  case PAGE_FIELD_SUM:
+    return page->sum[idx];
+  case PAGE_FIELD_MIN:
+    return page->min[idx];
+  default:
+    return page->max[idx];
+  }
+}
+
+// every field as a tscodec stream over t_offset, returns the packed length or 0 when the plain page is smaller
+static size_t pack_page(const history_page_t *page, uint16_t *lens)
+{
+  size_t plain_len = (size_t)page->entries_num * PAGE_ENTRY_LEN;
+  uint16_t restart;
+  em_tscodec_t codec;
+  size_t used = 0;
+
+  for (uint32_t field = 0; field < PAGE_FIELDS_CNT; field++) {
+    // single restart point, the page is decoded as a whole
+    if (em_tscodec_init(&codec, &packed[used], plain_len - used, &restart, 1, UINT16_MAX) != 0) {
+      return 0;
+    }
+
+    for (uint16_t i = 0; i < page->entries_num; i++) {
+      if (em_tscodec_append(&codec, page->t_offset[i], page_field(page, field, i)) != 0) {
+        return 0;
+      }
+    }
+
+    lens[field] = (uint16_t)codec.len;
+    used += codec.len;
+  }
+
+  return used < plain_len ? used : 0;
+}
+
+static void build_page(history_query_t *q)
+{
+  history_page_t *page = &q->page;
+  em_rrd_slot_t slot;
+
+  page->entries_num = 0;
+  page->last = false;
+
+  while (page->entries_num < PAGE_ENTRIES) {
+    if (!inv_history_iter_next(&q->rq.it, &slot)) {
+      if (q->bucket.count != 0) {
+        page_add(page, q->rq.resolution, &q->bucket);
+      }
+
+      page->last = true;
+      return;
+    }
+
+    uint32_t bucket = (uint32_t)(((uint64_t)slot.period * q->rq.step) / q->rq.resolution);
+
+    if (q->bucket.count != 0 && q->bucket.period != bucket) {
+      page_add(page, q->rq.resolution, &q->bucket);
+      memset(&q->bucket, 0, sizeof(q->bucket));
+    }
+
+    q->bucket.period = bucket;
+    em_rrd_slot_merge(&q->bucket, &slot);
+  }
+}
+
+static void lttb_get(size_t idx, int64_t *ts, int32_t *value, void *ctx)
+{
+  const history_request_t *rq = &((const history_query_t *)ctx)->rq;
+  em_rrd_slot_t slot;
+
+  *ts = (int64_t)(rq->it.period + idx) * rq->step;
+  *value = inv_history_read(rq->channel, rq->tier, (time_t)*ts, &slot) == 0 ? slot.sum / slot.count : 0;
+}
+
+static void lttb_emit(int64_t ts, int32_t value, void *ctx)
+{
+  ESP_UNUSED(value);
+
+  history_query_t *q = ctx;
+  em_rrd_slot_t slot;
+
+  // empty periods only shape the triangles, they are not sent
+  if (inv_history_read(q->rq.channel, q->rq.tier, (time_t)ts, &slot) == 0) {
+    page_add(&q->page, q->rq.step, &slot);
+  }
+}
+
+// single page of the periods selected by LTTB, read directly from the archive
+static void build_downsampled_page(history_query_t *q)
+{
+  history_page_t *page = &q->page;
+  size_t n = q->rq.it.end >= q->rq.it.period ? q->rq.it.end - q->rq.it.period + 1 : 0;
+
+  page->entries_num = 0;
+  page->last = true;
+  em_downsample_lttb(n, q->rq.points, lttb_get, lttb_emit, q);
+}
+
+static void send_page_handler(uint32_t param, void *usr_ctx);
+
+// TCP TX task, the page left the send queue
+static void page_sent(const shared_buffer_t *sb, void *ctx)
+{
+  ESP_UNUSED(sb);
+  ESP_UNUSED(ctx);
+
+  taskENTER_CRITICAL(&pending_lock);
+  page_in_flight = false;
+  taskEXIT_CRITICAL(&pending_lock);
+
+  scheduler_set_callback(send_page_handler, SCH_PARAM_NONE, SCH_CTX_NONE, PAGE_INTERVAL_MS);
+}
+
+static void send_page_handler(uint32_t param, void *usr_ctx)
+{
+  ESP_UNUSED(param);
+  ESP_UNUSED(usr_ctx);
+
+  taskENTER_CRITICAL(&pending_lock);
+  bool in_flight = page_in_flight;
+  bool restart = !in_flight && pending_valid;
+
+  if (restart) {
+    query.rq = pending;
+    pending_valid = false;
+  }
+  taskEXIT_CRITICAL(&pending_lock);
+
+  // called again from the TX completion
+  if (in_flight) {
+    return;
+  }
+
+  if (restart) {
+    query.active = true;
+    query.page_ready = false;
+    query.page_idx = 0;
+    memset(&query.bucket, 0, sizeof(query.bucket));
+  }
+
+  if (!query.active) {
+    return;
+  }
+
+  if (!query.page_ready) {
+    if (query.rq.points != 0) {
+      build_downsampled_page(&query);
+    } else {
+      build_page(&query);
+    }
+
+    query.page_ready = true;
+  }
+
+  // set before sending, the TX completion can run before the send returns
+  taskENTER_CRITICAL(&pending_lock);
+  page_in_flight = true;
+  taskEXIT_CRITICAL(&pending_lock);
+
+  history_page_t *page = &query.page;
+  uint16_t lens[PAGE_FIELDS_CNT];
+  size_t packed_len = pack_page(page, lens);
+  int ret;
+
+  if (packed_len != 0) {
+    ret = protocol_send_inverter_history_packed(query.rq.channel, query.rq.resolution, page->start, query.page_idx,
+                                                page->last, page->entries_num, lens, PAGE_FIELDS_CNT, packed,
+                                                (uint16_t)packed_len, page_sent, NULL);
+  } else {
+    ret = protocol_send_inverter_history(query.rq.channel, query.rq.resolution, page->start, query.page_idx,
+                                         page->last, page->t_offset, page->samples, page->sum, page->min, page->max,
+                                         page->entries_num, page_sent, NULL);
+  }
+
+  if (ret != ESP_OK) {
+    taskENTER_CRITICAL(&pending_lock);
+    page_in_flight = false;
+    taskEXIT_CRITICAL(&pending_lock);
+
+    ESP_LOGW(LOG_TAG, "Send page[%u] err=%d", query.page_idx, ret);
+    scheduler_set_callback(send_page_handler, SCH_PARAM_NONE, SCH_CTX_NONE, SEND_RETRY_MS);
+    return;
+  }
+
+  query.page_ready = false;
+
+  if (page->last) {
+    ESP_LOGI(LOG_TAG, "Query ch=%u done, %u pages", query.rq.channel, query.page_idx + 1);
+    query.active = false;
+    return;
+  }
+
+  // next page is built once this one is written
+  query.page_idx++;
+}
+
+int inv_history_query(uint8_t channel, time_t from, time_t to, uint32_t resolution_s, uint16_t points)
+{
+  time_t now = time(NULL);
+
+  if (now < em_utils_get_compile_time()) {
+    return ESP_ERR_INVALID_STATE; // time not synchronized
+  }
+
+  if (to > now) {
+    to = now;
+  }
+
+  if (channel >= INV_CH_CNT || from > to) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  inv_history_tier_t tier = inv_history_select_tier(from, resolution_s);
+  history_request_t rq = {.channel = channel, .step = inv_history_tier_step(tier), .tier = tier};
+
+  // resolutions finer than the tier can't be served, coarser are merged from whole tier periods
+  rq.resolution = resolution_s > rq.step ? (resolution_s / rq.step) * rq.step : rq.step;
+
+  // downsampled entries are single tier periods picked from the range, they have to fit one page
+  if (points != 0) {
+    rq.resolution = rq.step;
+    rq.points = points > PAGE_ENTRIES ? PAGE_ENTRIES : points;
+  }
+
+  if (inv_history_iter_init(&rq.it, channel, tier, from, to) != 0) {
+    return ESP_ERR_NOT_SUPPORTED;
+  }
+
+  ESP_LOGI(LOG_TAG, "Query ch=%u from=%lld to=%lld res=%lu tier=%d points=%u", channel, from, to, rq.resolution, tier,
+           rq.points);
+
+  taskENTER_CRITICAL(&pending_lock);
+  pending = rq;
+  pending_valid = true;
+  taskEXIT_CRITICAL(&pending_lock);
+
+  scheduler_set_callback(send_page_handler, SCH_PARAM_NONE, SCH_CTX_NONE, SCH_NO_DELAY);
+  return ESP_OK;
+}
@@ -5,6 +5,122 @@
 #ifndef INVERTER_H
 #define INVERTER_H
 
+#include "em/inverter_defs.h"
+
+#include <stdint.h>
+#include <time.h>
+
+// measurement channels reported to the server, the value is the channel id on the wire
+typedef enum {
+  INV_CH_GRID_VOLTAGE = 0,  // in 0.1V
+  INV_CH_GRID_POWER = 1,    // in W
+  INV_CH_GRID_FREQ = 2,     // in 0.1Hz
+  INV_CH_BATTERY_VOLTAGE = 3, // in 0.1V
+  INV_CH_BATTERY_POWER = 4, // in W, negative for discharge
+  INV_CH_AC_OUT_VOLTAGE = 5, // in 0.1V
+  INV_CH_AC_OUT_POWER = 6,  // in W
+  INV_CH_AC_OUT_FREQ = 7,   // in 0.1Hz
+  INV_CH_PV_VOLTAGE = 8,    // in 0.1V
+  INV_CH_PV_POWER = 9,      // in W
+  // cumulative energy counters in Wh, same order as inv_energy_channel_t
+  INV_CH_ENERGY_GRID_CONSUMED = 10,
+  INV_CH_ENERGY_GRID_PROVIDED = 11,
+  INV_CH_ENERGY_AC_OUTPUT = 12,
+  INV_CH_ENERGY_PV = 13,
+  INV_CH_ENERGY_BATTERY_CHARGE = 14,
+  INV_CH_ENERGY_BATTERY_DISCHARGE = 15,
+  INV_CH_CNT
+} inv_channel_t;
+
+// inverter settings readable by the server, the value is the setting id on the wire
+typedef enum {
+  INV_SETTING_RATED_INFO = 0,                  // QPIRI
+  INV_SETTING_FLAGS = 1,                       // QFLAG
+  INV_SETTING_FW_VERSION = 2,                  // QVFW
+  INV_SETTING_MAX_CHARGE_CURRENTS = 3,         // QMCHGCR
+  INV_SETTING_MAX_UTILITY_CHARGE_CURRENTS = 4, // QMUCHGCR
+  INV_SETTINGS_CNT
+} inv_setting_t;
+
+#define INV_SET_BATCH_MAX_ITEMS (8u)
+#define INV_SET_ITEM_MAX_LEN    (16u) // command text with arguments e.g. "MCHGC040"
+#define INV_SET_BATCH_ID_CHARGE_PLAN (0xFFFFu) // results of the priorities set by the charge plan
+
+// result of the setting command of the batch, the value is sent to the server
+typedef enum {
+  INV_SET_VERIFIED = 0, // acknowledged and confirmed by the read-back
+  INV_SET_ACKED,        // acknowledged, the setting is not reported by the read-back
+  INV_SET_REJECTED,     // NAK
+  INV_SET_TIMEOUT,      // no response
+  INV_SET_MISMATCH,     // acknowledged, the read-back differs
+  INV_SET_UNVERIFIED,   // acknowledged, the read-back failed
+  INV_SET_INVALID,      // unknown command or malformed arguments
+  INV_SET_NOT_SENT,     // skipped after a failure or an invalid command in the batch
+  INV_SET_SEND_FAILED,  // not accepted by the serial client after the retries
+} inv_set_result_t;
+
+#define INV_POLL_PLAN_MAX_ITEMS     (8u)
+#define INV_POLL_PLAN_MAX_DEADBANDS (8u)
+
+// serial commands polled from the inverter and deadbands of the channels measured by them
+typedef struct {
+  uint8_t polls_num;
+  uint16_t cmds[INV_POLL_PLAN_MAX_ITEMS]; // serial protocol command id
+  uint32_t intervals[INV_POLL_PLAN_MAX_ITEMS]; // in ms
+  uint8_t priorities[INV_POLL_PLAN_MAX_ITEMS]; // 0 - highest, sent first when polls are due together
+  uint8_t deadbands_num;
+  uint8_t channels[INV_POLL_PLAN_MAX_DEADBANDS];
+  uint32_t thresholds[INV_POLL_PLAN_MAX_DEADBANDS];   // in channel units
+  uint32_t max_silences[INV_POLL_PLAN_MAX_DEADBANDS]; // in s
+} inv_poll_plan_t;
+
 int inv_init();
 
+// safe to call from any task, returns 0 or ESP_ERR_TIMEOUT when writer kept updating the snapshot
+// after reboot the last known state is returned with its stale bits until the inverter answers
+int inv_snapshot_read(inv_snapshot_t *out);
+
+// threshold in channel units (0 - every change), max_silence_s - heartbeat period (0 - disabled)
+int inv_deadband_set(uint8_t channel, uint32_t threshold, uint32_t max_silence_s);
+int inv_deadband_get(uint8_t channel, uint32_t *threshold, uint32_t *max_silence_s);
+
+/*
+ * Streams power history of the channel in [from, to] to the server, page by page.
+ * Resolution is rounded to the coarsest archive tier not exceeding it, range outside the tier retention is skipped.
+ * With points != 0 the tier periods are downsampled with LTTB to at most points entries sent in one page
+ * (EM_INVERTER_HISTORY_PAGE_ENTRIES at most), resolution then only selects the tier.
+ * New query cancels the one in progress.
+ */
+int inv_history_query(uint8_t channel, time_t from, time_t to, uint32_t resolution_s, uint16_t points);
+
+/*
+ * Sends the setting response text to the server. Served from the cache when it is not older than max_age_s
+ * (0 - always read the inverter), otherwise read from the inverter and sent once it responds.
+ * Cached text marked as stale is sent when the inverter doesn't respond.
+ */
+int inv_setting_get(uint8_t setting, uint32_t max_age_s);
+
+/*
+ * Sends the setting commands to the inverter one after another, nothing is sent when one of them is invalid
+ * and the batch stops at the first rejected or unanswered command. Changed settings are read back at once
+ * and the result of every command is sent to the server. New batch is refused until the previous one is done.
+ */
+int inv_set_batch(uint16_t id, const char *const *items, const uint8_t *items_len, uint16_t items_num);
+
+/*
+ * Replaces the polled commands and applies the deadbands at once, the plan is kept in flash.
+ * Plan without QPIGS, with unknown or repeated commands, or exceeding the serial line airtime budget is refused
+ * and the one in use stays.
+ */
+int inv_poll_plan_set(const inv_poll_plan_t *plan);
+void inv_poll_plan_get(inv_poll_plan_t *plan);
+
+/*
+ * Keeps the price list of the day in flash, prices of equal slots from the day start. The charge plan
+ * (CONFIG_EM_INVERTER_CHARGE_PLAN) is recalculated at once, its priorities are set through SET batches
+ * with id INV_SET_BATCH_ID_CHARGE_PLAN.
+ */
+int inv_charge_plan_set_prices(uint16_t tariff, time_t day, int8_t price_factor, const int16_t *prices,
+                               uint16_t prices_len);
+
 #endif /* INVERTER_H */
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#ifndef INVERTER_DEFS_H
+#define INVERTER_DEFS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sdkconfig.h>
+#include "em/dataset.h"
+
+#define INV_MAX_PV_INPUTS CONFIG_EM_INVERTER_PV_INPUTS
+
+// default deadband thresholds in the units of the measurement channels
+#define INV_MIN_AC_VOLTAGE_DIFF (20u)  // 2V
+#define INV_MIN_DC_VOLTAGE_DIFF (1u)   // 0.1V
+#define INV_MIN_POWER_DIFF      (50u)  // W
+#define INV_MIN_FREQ_DIFF       (2u)   // 0.2Hz
+#define INV_MIN_ENERGY_DIFF     (250u) // Wh
+
+typedef struct {
+  char model[16];
+  uint32_t fw_ver;
+  uint32_t protocol_ver;
+} inv_info_t;
+
+/*
+Power On Mode P Power on mode
+Standby Mode S Standby mode
+Bypass Mode Y Bypass mode
+Line Mode L Line Mode
+Battery Mode B Battery mode
+Battery Test Mode T Battery test mode
+Fault Mode F Fault mode
+Shutdown Mode D Shutdown Mode
+Grid mode Ｇ Grid mode
+Charge mode C Charge mode
+*/
+typedef struct {
+  uint32_t mode; // char 'P' - Power on, 'S' - Standby etc...
+  uint32_t status_flags;  // QPIGS device status b7..b0 in bits 7..0, device status 2 b10..b8 in bits 18..16
+  uint64_t warning_flags; // bit n - QPIWS warning a<n>
+  uint32_t fault_code;    // QPICF characters, the first one in the most significant byte
+} inv_status_t;
+
+typedef struct {
+  time_t timestamp; // timestamp of the measurement
+  uint64_t energy; // in Ws
+} energy_t;
+
+typedef struct {
+  energy_t grid_consumed;
+  energy_t grid_provided;
+  energy_t ac_output; // taken from the inverter output
+  energy_t pv; // produced by the PV panels
+  energy_t battery_charge;
+  energy_t battery_discharge;
+} inv_energy_meas_t;
+
+typedef struct {
+  time_t timestamp;
+  uint16_t voltage; // in 0.1V
+ //int16_t current;  // in 0.01A
+  dataset_t power_samples; // in W// TODO: init
+  uint16_t power; // in W
+  uint16_t freq; // in 0.1Hz
+} inv_grid_meas_t;
+
+typedef struct {
+  time_t timestamp;
+  uint16_t voltage; // in 0.1V
+  //int16_t charge_current;  // in 0.01A
+  dataset_t power_samples; // in W// TODO: init
+  int32_t charge_power;  // in W, negative for discharge
+  uint8_t soc; // in %
+} inv_battery_meas_t;
+
+typedef struct {
+  time_t timestamp;
+  uint16_t voltage; // in 0.1V
+  //uint16_t current; // in 0.01A
+  dataset_t power_samples; // in W // TODO: init
+  uint32_t power; // in W
+  uint16_t freq; // in 0.1Hz
+  uint8_t output_load; // in %
+  uint16_t power_factor; // in 0.001
+} inv_ac_output_meas_t;
+
+// single MPPT tracker
+typedef struct {
+  time_t timestamp;
+  uint16_t voltage; // in 0.1V
+  uint16_t current; // in 0.1A
+  uint16_t power;   // in W
+  energy_t energy;  // produced since boot
+} inv_pv_input_meas_t;
+
+typedef struct {
+  time_t timestamp;
+  uint16_t voltage; // in 0.1V, of the first input
+  dataset_t power_samples; // in W // TODO: init
+  uint32_t power; // in W, of all inputs
+  uint8_t strings_cnt; // inputs reported so far
+  inv_pv_input_meas_t inputs[INV_MAX_PV_INPUTS];
+} inv_pv_meas_t;
+
+typedef struct {
+  uint16_t bus_voltage; // in 0.1V
+} inv_other_meas_t;
+
+// parts of the snapshot restored at boot and not answered by the inverter since
+#define INV_STALE_MEAS     (1u << 0) // QPIGS measurements and status flags
+#define INV_STALE_MODE     (1u << 1) // QMOD
+#define INV_STALE_WARNINGS (1u << 2) // QPIWS
+#define INV_STALE_FAULT    (1u << 3) // QPICF
+#define INV_STALE_FW_VER   (1u << 4) // QVFW
+#define INV_STALE_ALL      (INV_STALE_MEAS | INV_STALE_MODE | INV_STALE_WARNINGS | INV_STALE_FAULT | INV_STALE_FW_VER)
+
+// consistent copy of the inverter state, generation is incremented on every publish
+typedef struct {
+  uint32_t generation;
+  uint32_t stale; // INV_STALE_* of the values restored at boot
+  inv_grid_meas_t grid;
+  inv_battery_meas_t battery;
+  inv_ac_output_meas_t ac_output;
+  inv_pv_meas_t pv;
+  inv_energy_meas_t energy;
+  inv_status_t status;
+  inv_info_t info;
+} inv_snapshot_t;
+
+#endif /* INVERTER_DEFS_H */
@@ -2,18 +2,36 @@
  * Copyright (C) 2025 EmbeddedSolutions.pl
  */
 #include "em/inverter_priv.h"
-#include "em/defs.h"
+#include "em/inverter_defs.h"
+#include "em/burst.h"
+#include "em/charge_plan.h"
+#include "em/deadband.h"
+#include "em/energy.h"
+#include "em/energy_reconcile.h"
+#include "em/energy_store.h"
+#include "em/fixed.h"
+#include "em/history.h"
+#include "em/poll_plan.h"
+#include "em/power_stats.h"
+#include "em/set_batch.h"
+#include "em/settings_cache.h"
+#include "em/protocol.h"
+#include "em/status_agg.h"
+#include "em/warm_cache.h"
 #include "em/rs232_2400_protocol.h"
 #include "em/serial_client.h"
+#include <assert.h>
+#include <esp_err.h>
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stdatomic.h>
 #include <string.h>
 
 #define LOG_TAG "INV"
-#define MAX_PV_INPUTS (1u)
 
-#define METER_DATASET_LEN (11u) // 5 items in the dataset
-
-//static inv_energy_history_t energy_history = {0};
+#define SNAPSHOT_READ_RETRIES (4u)
 
 // last know measurements
 static inv_grid_meas_t grid_meas =  {.voltage = 0, .power = 0, .freq = 0, .timestamp = 0};
@@ -23,6 +41,20 @@ static inv_pv_meas_t pv_meas = {.voltage = 0, .power_samples = {0,}, .power = 0,
 static inv_energy_meas_t energy_meas = {.grid_consumed = {0}, .grid_provided = {0}, .ac_output = {0}, .pv = {0}, .battery_charge = {0}, .battery_discharge = {0},};
 static inv_status_t inv_status = {0,};
 static inv_info_t inv_info = {0,};
+static uint32_t stale_mask = 0; // INV_STALE_* of the values above restored at boot
+
+/*
+ * Seqlock protected copy of the state above for readers in other tasks.
+ * Only the serial client task publishes, sequence is odd while the copy is being written.
+ */
+static inv_snapshot_t snapshot = {0};
+static atomic_uint_fast32_t snapshot_seq = 0;
+
+// energy integrators, fed on monotonic time
+static inv_energy_integrator_t grid_energy_int = {0};
+static inv_energy_integrator_t battery_energy_int = {0};
+static inv_energy_integrator_t ac_out_energy_int = {0};
+static inv_energy_integrator_t pv_energy_int[INV_MAX_PV_INPUTS] = {0};
 
 static const serial_rsp_handler_t rsp_handlers[] = {
     {.protocol_idx = 0,
@@ -31,9 +63,24 @@ static const serial_rsp_handler_t rsp_handlers[] = {
     {.protocol_idx = 0,
      .msg_type = EM_RS232_2400_QVFW,
      .msg_handler = inv_fw_ver_handler},
+    {.protocol_idx = 0,
+     .msg_type = EM_RS232_2400_QPIRI,
+     .msg_handler = inv_rated_info_handler},
+    {.protocol_idx = 0,
+     .msg_type = EM_RS232_2400_QFLAG,
+     .msg_handler = inv_flags_handler},
+    {.protocol_idx = 0,
+     .msg_type = EM_RS232_2400_QMCHGCR,
+     .msg_handler = inv_max_charge_currents_handler},
+    {.protocol_idx = 0,
+     .msg_type = EM_RS232_2400_QMUCHGCR,
+     .msg_handler = inv_max_utility_charge_currents_handler},
     {.protocol_idx = 0,
      .msg_type = EM_RS232_2400_QPIGS,
      .msg_handler = inv_meas_qpigs_handler},
+    {.protocol_idx = 0,
+     .msg_type = EM_RS232_2400_QPIGS2,
+     .msg_handler = inv_meas_qpigs2_handler},
     {.protocol_idx = 0,
      .msg_type = EM_RS232_2400_QPICF,
      .msg_handler = inv_fault_handler},
@@ -46,6 +93,64 @@ static const serial_rsp_handler_t rsp_handlers[] = {
     {.protocol_idx = 0,
      .msg_type = EM_RS232_2400_QMOD,
      .msg_handler = inv_model_handler},
+    {.protocol_idx = 0,
+     .msg_type = EM_RS232_2400_QET,
+     .msg_handler = inv_energy_total_handler},
+    {.protocol_idx = 0,
+     .msg_type = EM_RS232_2400_QEY,
+     .msg_handler = inv_energy_year_handler},
+    {.protocol_idx = 0,
+     .msg_type = EM_RS232_2400_QEM,
+     .msg_handler = inv_energy_month_handler},
+    {.protocol_idx = 0,
+     .msg_type = EM_RS232_2400_QED,
+     .msg_handler = inv_energy_day_handler},
+    {.protocol_idx = 0,
+     .msg_type = EM_RS232_2400_QEH,
+     .msg_handler = inv_energy_hour_handler},
+    // setting commands, ACK and NAK of the batch in progress
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_PE, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_PD, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_PF, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_F, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_POP, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_PBCV, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_PBDV, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_PCP, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_PGR, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_PBT, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_PSDV, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_PCVV, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_PBFT, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_DAT, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_GOLF, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_GOHF, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_GOLV, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_GOHV, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_OPMP, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_MPPTHV, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_MPPTLV, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_PVIPHV, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_PVIPLV, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_LST, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_MCHGC, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_MCHGV, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_BCHGV, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_GLTHV, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_BSDV, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_DSUBV, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_PRIO, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_ENF, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_LBF, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_SOPF, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_SMDCC, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_ABGP, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_PKT, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_LDT, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_BSDP, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_DMODEL, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_PSPB, .msg_handler = inv_set_ack_handler},
+    {.protocol_idx = 0, .msg_type = EM_RS232_2400_MUCHGC, .msg_handler = inv_set_ack_handler},
 };
 
 static serial_protocol_t protocols[] = {
@@ -61,373 +166,351 @@ static serial_protocol_t protocols[] = {
 
 // bl0942_settings_t bl0942_settings = {.funx_0x18 = UINT8_MAX, .mode_0x19 =
 // UINT16_MAX, .gain_cr_0x1A = UINT8_MAX};
-em_sc_t sc = {.supported_protocols = protocols,
+em_sc_t sc = {.uart = {.port = CONFIG_EM_UART_PORT_NUM, .txd = CONFIG_EM_UART_TXD, .rxd = CONFIG_EM_UART_RXD},
+              .supported_protocols = protocols,
               .supported_protocols_cnt =
                   sizeof(protocols) / sizeof(protocols[0])};
 
-int inv_init() {
-  ESP_LOGI(LOG_TAG, "Init start");
+// last known state is shown until the first responses, before the serial client task starts
+static void inv_restore_state(void) {
+  inv_snapshot_t restored = {0};
 
-  /*static uint32_t ac_out_power_buf[METER_DATASET_LEN] = {
-      0,
-  };
-  static uint32_t pv_power_buf[METER_DATASET_LEN] = {
-      0,
-  };*/
-
-  // Initialize datasets
-  /*if (em_dataset_init(&ds_ac_out_power, ac_out_power_buf,
-                      sizeof(ac_out_power_buf[0]), METER_DATASET_LEN) != 0) {
-    ESP_LOGE(LOG_TAG, "Failed init voltage dataset");
-    return -1;
+  if (!inv_warm_cache_restore(&restored)) {
+    return;
   }
 
-  if (em_dataset_init(&ds_pv_power, pv_power_buf, sizeof(pv_power_buf[0]),
-                      METER_DATASET_LEN) != 0) {
-    ESP_LOGE(LOG_TAG, "Failed init power dataset");
-    return -1;
-  }*/
-
-  em_sc_init(&sc, 0);
+  grid_meas.timestamp = restored.grid.timestamp;
+  grid_meas.voltage = restored.grid.voltage;
+  grid_meas.power = restored.grid.power;
+  grid_meas.freq = restored.grid.freq;
+  battery_meas.timestamp = restored.battery.timestamp;
+  battery_meas.voltage = restored.battery.voltage;
+  battery_meas.charge_power = restored.battery.charge_power;
+  ac_output_meas.timestamp = restored.ac_output.timestamp;
+  ac_output_meas.voltage = restored.ac_output.voltage;
+  ac_output_meas.power = restored.ac_output.power;
+  ac_output_meas.freq = restored.ac_output.freq;
+  ac_output_meas.output_load = restored.ac_output.output_load;
+  ac_output_meas.power_factor = restored.ac_output.power_factor;
+  pv_meas.timestamp = restored.pv.timestamp;
+  pv_meas.voltage = restored.pv.voltage;
+  pv_meas.power = restored.pv.power;
+  inv_status = restored.status;
+  inv_info = restored.info;
+  stale_mask = INV_STALE_ALL;
+
+  inv_snapshot_publish();
+}
 
-  /* firmware version */
-  uint8_t qvfw[] = {'Q', 'V', 'F', 'W'};
-  assert(0 <= em_sc_send_periodic(&sc, EM_RS232_2400_QVFW, qvfw, sizeof(qvfw),
-                                  10000));
+// clears the stale part, true when it was restored and the first response has to be reported even if unchanged
+static bool inv_refresh(uint32_t part) {
+  bool stale = (stale_mask & part) != 0;
+  stale_mask &= ~part;
+  return stale;
+}
 
-  /* measurements */
-  uint8_t qpigs[] = {'Q', 'P', 'I', 'G', 'S'};
-  assert(0 <= em_sc_send_periodic(&sc, EM_RS232_2400_QPIGS, qpigs,
-                                  sizeof(qpigs), 15000));
+int inv_init() {
+  ESP_LOGI(LOG_TAG, "Init start");
 
-  /* warnings */
-  uint8_t qpiws[] = {'Q', 'P', 'I', 'W', 'S'};
-  assert(0 <= em_sc_send_periodic(&sc, EM_RS232_2400_QPIWS, qpiws,
-                                  sizeof(qpiws), 600000));
+  inv_energy_store_init();
+  inv_deadband_init();
+  inv_status_agg_init();
+  inv_power_stats_init();
+  inv_history_init();
+  inv_energy_reconcile_init();
+  inv_burst_init();
+  inv_settings_cache_init();
+  inv_set_batch_init();
+  inv_restore_state();
+  em_sc_init(&sc, 0);
 
-  /* mode */
-  uint8_t qmod[] = {'Q', 'M', 'O', 'D'};
-  assert(0 <= em_sc_send_periodic(&sc, EM_RS232_2400_QMOD, qmod, sizeof(qmod),
-                                  600000));
+  /* firmware version, measurements, warnings and mode polled by the stored plan */
+  inv_poll_plan_init();
+  inv_charge_plan_init();
 
   ESP_LOGI(LOG_TAG, "Init done");
   return 0;
 }
 
-/*
-void inv_store_meas() {
-  if (energy_history.size > 0 && !energy_history.store_rq) {
-    return;
-  }
+void inv_snapshot_publish(void) {
+  uint_fast32_t seq = atomic_load_explicit(&snapshot_seq, memory_order_relaxed);
 
-  time_t now = time(NULL);
-  uint16_t battery_charging_power = battery_meas.charge_current *
-battery_meas.voltage / 100; uint16_t battery_discharging_power =
-battery_meas.discharge_current * battery_meas.voltage / 100; update_energy(now,
-ac_output_meas.power, pv_meas.power, battery_charging_power,
-battery_discharging_power);
-
-  // store energy to flash every 15 min
-  if(energy_meas.perm_storage_timestamp == 0 ||
-    (now - energy_meas.perm_storage_timestamp > 15*60 - 5)) {
-    energy_meas.perm_storage_timestamp = now;
-
-    if(energy_history.index == 0){
-      energy_history.ref_timestamp = now;
-      energy_history.ref_ac_output_energy = energy_meas.ac_output_energy;
-      energy_history.ref_pv_energy = energy_meas.energy;
-      energy_history.ref_battery_charge = energy_meas.battery_charge;
-      energy_history.ref_battery_discharge = energy_meas.battery_discharge;
-      energy_history.ac_output_energy[energy_history.index] =
-energy_meas.energy; energy_history.pv_energy[energy_history.index] =
-energy_meas.energy; energy_history.battery_charge[energy_history.index] =
-energy_meas.battery_charge;
-      energy_history.battery_discharge[energy_history.index] =
-energy_meas.battery_discharge; energy_history.time_offset[energy_history.index]
-= 0; } else { energy_history.ac_output_energy[energy_history.index] =
-energy_meas.energy - energy_history.ref_ac_output_energy;
-      energy_history.pv_energy[energy_history.index] = energy_meas.energy -
-energy_history.ref_pv_energy;
-      energy_history.battery_charge[energy_history.index] =
-energy_meas.battery_charge - energy_history.ref_battery_charge;
-      energy_history.battery_discharge[energy_history.index] =
-energy_meas.battery_discharge - energy_history.ref_battery_discharge;
-      energy_history.time_offset[energy_history.index] = now -
-energy_history.ref_timestamp;
-    }
+  atomic_store_explicit(&snapshot_seq, seq + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+
+  snapshot.generation = (uint32_t)(seq / 2 + 1);
+  snapshot.stale = stale_mask;
+  snapshot.grid = grid_meas;
+  snapshot.battery = battery_meas;
+  snapshot.ac_output = ac_output_meas;
+  snapshot.pv = pv_meas;
+  snapshot.energy = energy_meas;
+  snapshot.status = inv_status;
+  snapshot.info = inv_info;
+
+  atomic_store_explicit(&snapshot_seq, seq + 2, memory_order_release);
+
+  inv_warm_cache_save(&snapshot);
+}
+
+int inv_snapshot_read(inv_snapshot_t *out) {
+  assert(out);
+
+  for (uint32_t i = 0; i < SNAPSHOT_READ_RETRIES; i++) {
+    uint_fast32_t begin = atomic_load_explicit(&snapshot_seq, memory_order_acquire);
 
-    energy_history.index++;
-
-    ESP_LOGI(LOG_TAG, "Total AC out energy: %.2fkWh", energy_meas.energy /
-3600.0/1000); ESP_LOGI(LOG_TAG, "Total PV energy: %.2fkWh", energy_meas.energy /
-3600.0/1000); ESP_LOGI(LOG_TAG, "Total battery charge: %.2fkWh",
-energy_meas.battery_charge / 3600.0/1000); ESP_LOGI(LOG_TAG, "Total battery
-discharge: %.2fkWh", energy_meas.battery_discharge / 3600.0/1000);
-    ESP_LOGI(LOG_TAG, "Energy history: [kWh]");
-
-    for (int i = 0; i < energy_history.index; i++) {
-      ESP_LOGI(LOG_TAG, "%d: %ldmin out:%.2f pv:%.2f chg:%.2f dis:%.2f", i,
-        energy_history.time_offset[i]/60,
-        energy_history.ac_output_energy[i]/3600.0/1000,
-        energy_history.pv_energy[i]/3600.0/1000,
-        energy_history.battery_charge[i]/3600.0/1000,
-        energy_history.battery_discharge[i]/3600.0/1000);
+    if (begin & 1) {
+      // writer was preempted in the middle of publish, let it finish
+      vTaskDelay(1);
+      continue;
     }
 
-    if (energy_history.index >= 96) {
-      //send to server
-      energy_history.index = 0;
-      ESP_LOGI(LOG_TAG, "Clear energy history");
+    memcpy(out, &snapshot, sizeof(*out));
+    atomic_thread_fence(memory_order_acquire);
+
+    if (atomic_load_explicit(&snapshot_seq, memory_order_relaxed) == begin) {
+      return 0;
     }
   }
-}*/
 
-void inv_store_energy_meas() {
-  time_t now = time(NULL);
+  return ESP_ERR_TIMEOUT;
+}
 
-  if (energy_history.size == 0) {
-    energy_history.ref_timestamp = now;
-    energy_history.ref_grid = energy_meas.grid_consumed;
-    energy_history.ref_ac_output = energy_meas.ac_output;
-    energy_history.ref_pv = energy_meas.pv;
-    energy_history.ref_battery_charge = energy_meas.battery_charge;
-    energy_history.ref_battery_discharge = energy_meas.battery_discharge;
-  } else {
-    if (energy_meas.grid_consumed.energy < min_energy_diff &&
-        energy_meas.ac_output.energy < min_energy_diff &&
-        energy_meas.pv.energy < min_energy_diff &&
-        energy_meas.battery_charge.energy < min_energy_diff &&
-        energy_meas.battery_discharge.energy < min_energy_diff) {
-      /*struct tm timeinfo;
-      localtime_r(&now, &timeinfo);
-
-      char strftime_buf[sizeof(time_t) * sizeof(time_t)] = {0};
-      strftime(strftime_buf, sizeof(strftime_buf), "%c", &timeinfo);
-      ESP_LOGI(LOG_TAG, "XX INV meas[%d] %s", energy_history.size,
-      strftime_buf); ESP_LOGI(LOG_TAG, "Total grid energy consumed: %.2fkWh",
-      energy_meas.grid_consumed / 3600.0/1000); ESP_LOGI(LOG_TAG, "Total AC out
-      energy: %.2fkWh", energy_meas.ac_output / 3600.0/1000); ESP_LOGI(LOG_TAG,
-      "Total PV energy: %.2fkWh", energy_meas.pv / 3600.0/1000);
-      ESP_LOGI(LOG_TAG, "Total battery charge: %.2fkWh",
-      energy_meas.battery_charge / 3600.0/1000); ESP_LOGI(LOG_TAG, "Total
-      battery discharge: %.2fkWh\n", energy_meas.battery_discharge /
-      3600.0/1000);*/
-      return;
+static bool pv_reported(const uint8_t *channels, size_t cnt) {
+  for (size_t i = 0; i < cnt; i++) {
+    if (channels[i] == INV_CH_PV_VOLTAGE || channels[i] == INV_CH_PV_POWER || channels[i] == INV_CH_ENERGY_PV) {
+      return true;
     }
   }
 
-  // block storing entries more frequently then 5 min.
-
-  ++energy_history.size;
-
-  energy_history.grid[energy_history.size - 1] = energy_meas.grid_consumed;
-  energy_history.ac_output[energy_history.size - 1] = energy_meas.ac_output;
-  energy_history.pv[energy_history.size - 1] = energy_meas.pv;
-  energy_history.battery_charge[energy_history.size - 1] =
-      energy_meas.battery_charge;
-  energy_history.battery_discharge[energy_history.size - 1] =
-      energy_meas.battery_discharge;
-  energy_history.time_offset[energy_history.size - 1] =
-      now - energy_history.ref_timestamp;
-
-  struct tm timeinfo;
-  localtime_r(&now, &timeinfo);
-
-  char strftime_buf[sizeof(time_t) * sizeof(time_t)] = {0};
-  strftime(strftime_buf, sizeof(strftime_buf), "%c", &timeinfo);
-
-  ESP_LOGI(LOG_TAG, "INV energy[%d] %s", energy_history.size - 1, strftime_buf);
-  ESP_LOGI(LOG_TAG, "Total grid energy consumed: %.2fkWh",
-           energy_meas.grid_consumed.energy / 3600.0 / 1000);
-  ESP_LOGI(LOG_TAG, "Total AC out energy: %.2fkWh",
-           energy_meas.ac_output.energy / 3600.0 / 1000);
-  ESP_LOGI(LOG_TAG, "Total PV energy: %.2fkWh", energy_meas.pv.energy / 3600.0 / 1000);
-  ESP_LOGI(LOG_TAG, "Total battery charge: %.2fkWh",
-           energy_meas.battery_charge.energy / 3600.0 / 1000);
-  ESP_LOGI(LOG_TAG, "Total battery discharge: %.2fkWh",
-           energy_meas.battery_discharge.energy / 3600.0 / 1000);
-
-  memset(&energy_meas, 0, sizeof(energy_meas));
-
-  if (energy_history.size >= sizeof(energy_history.time_offset) /
-                                 sizeof(energy_history.time_offset[0])) {
-    ESP_LOGI(LOG_TAG, "Send and clear INV energy history");
-    //protocol_send_inv_energy(&energy_history);
-    energy_history.size = 0;
+  return false;
+}
+
+// all inputs in one message, sent whenever the PV channels are
+static void inv_send_pv_inputs(void) {
+  uint16_t voltages[INV_MAX_PV_INPUTS];
+  uint16_t currents[INV_MAX_PV_INPUTS];
+  uint16_t powers[INV_MAX_PV_INPUTS];
+  uint32_t energies[INV_MAX_PV_INPUTS];
+  uint8_t inputs_num = pv_meas.strings_cnt;
+
+  for (uint8_t i = 0; i < inputs_num; i++) {
+    const inv_pv_input_meas_t *input = &pv_meas.inputs[i];
+    voltages[i] = input->voltage;
+    currents[i] = input->current;
+    powers[i] = input->power;
+    energies[i] = (uint32_t)(input->energy.energy / 3600); // in Wh
+  }
+
+  int ret = protocol_send_inverter_pv_inputs(time(NULL), voltages, currents, powers, energies, inputs_num);
+
+  if (ret != ESP_OK) {
+    ESP_LOGW(LOG_TAG, "Send %d PV inputs err=%d", inputs_num, ret);
   }
 }
 
-// voltage in 0.1V, current in 0.01A, freq in 0.1Hz
-void inv_set_meas_grid(uint16_t voltage, int16_t power, uint16_t freq) {
-  time_t now = time(NULL);
+// sends channels which left the deadband or reached max silence
+void inv_send_meas(void) {
+  int64_t now_us = esp_timer_get_time();
 
-  if (grid_meas.timestamp != 0) {
-    // ESP_LOGI(LOG_TAG, "GRID: voltage:%.1f current %.2fA %lld sec",
-    // voltage/10.0, current/100.0, now - grid_meas.timestamp);
-    int64_t delta_energy =
-        (grid_meas.power * (now - grid_meas.timestamp) + 500) / 1000;
-
-    if (delta_energy >= 0) {
-      energy_meas.grid_consumed.energy += delta_energy;
-      // ESP_LOGI(LOG_TAG, "UPDATE Grid consumed: %.3f Wh (+%.3f Wh) %.2fA",
-      // energy_meas.grid_consumed/3600.0, delta_energy/3600.0, current/100.0);
-    } else {
-      energy_meas.grid_provided.energy -= delta_energy;
-      // ESP_LOGI(LOG_TAG, "UPDATE Grid produced: %.3f Wh (%.3f Wh)",
-      // energy_meas.grid_produced/3600.0, delta_energy/3600.0);
-    }
+  // energy is reported as cumulative counters, so what is not sent now is included in the next report
+  for (uint32_t i = 0; i < INV_ENERGY_CHANNELS_CNT; i++) {
+    inv_deadband_feed(INV_CH_ENERGY_GRID_CONSUMED + i, (int32_t)(inv_energy_store_total(i) / 3600));
   }
 
+  uint8_t channels[INV_CH_CNT];
+  int32_t values[INV_CH_CNT];
+  size_t cnt = inv_deadband_collect(channels, values, INV_CH_CNT, now_us);
+
+  if (cnt == 0) {
+    return;
+  }
+
+  int ret = protocol_send_inverter_measurements(time(NULL), channels, values, cnt);
+
+  if (ret != ESP_OK) {
+    ESP_LOGW(LOG_TAG, "Send %zu measurements err=%d", cnt, ret);
+    return;
+  }
+
+  inv_deadband_commit(channels, values, cnt, now_us);
+
+  // single input is fully described by the PV channels
+  if (INV_MAX_PV_INPUTS > 1 && pv_reported(channels, cnt)) {
+    inv_send_pv_inputs();
+  }
+}
+
+// voltage in 0.1V, current in 0.01A, freq in 0.1Hz
+void inv_set_meas_grid(uint16_t voltage, int16_t power, uint16_t freq) {
+  uint64_t consumed = 0;
+  uint64_t provided = 0;
+  inv_energy_integrate(&grid_energy_int, esp_timer_get_time(), power, &consumed, &provided);
+  em_fixed_add_u64(&energy_meas.grid_consumed.energy, consumed);
+  em_fixed_add_u64(&energy_meas.grid_provided.energy, provided);
+  inv_energy_store_add(INV_ENERGY_GRID_CONSUMED, consumed);
+  inv_energy_store_add(INV_ENERGY_GRID_PROVIDED, provided);
+
   grid_meas.voltage = voltage;
   grid_meas.power = power;
   grid_meas.freq = freq;
-  grid_meas.timestamp = now;
-}
+  grid_meas.timestamp = time(NULL);
 
-// voltage in 0.1V, power in W
-void inv_set_meas_battery(uint16_t voltage, int16_t power) {
-  time_t now = time(NULL);
+  inv_deadband_feed(INV_CH_GRID_VOLTAGE, voltage);
+  inv_deadband_feed(INV_CH_GRID_POWER, power);
+  inv_power_stats_add(INV_CH_GRID_POWER, power, grid_meas.timestamp);
+  inv_history_add(INV_CH_GRID_POWER, power, grid_meas.timestamp);
+  inv_deadband_feed(INV_CH_GRID_FREQ, freq);
+}
 
-  if (battery_meas.timestamp != 0) {
-    int64_t delta_energy =
-        battery_meas.charge_power * (now - battery_meas.timestamp);
-
-    if (delta_energy > 0) {
-      energy_meas.battery_charge.energy += delta_energy;
-      // ESP_LOGI(LOG_TAG, "UPDATE bat charge: %.3f Wh (+%.3f Wh)",
-      // energy_meas.battery_charge/3600.0, delta_energy/3600.0);
-    } else {
-      energy_meas.battery_discharge.energy -= delta_energy;
-      // ESP_LOGI(LOG_TAG, "UPDATE bat discharge: %.3f Wh (%.3f Wh)",
-      // energy_meas.battery_discharge/3600.0, delta_energy/3600.0);
-    }
-  }
+// voltage in 0.1V, power in W, soc in %
+void inv_set_meas_battery(uint16_t voltage, int16_t power, uint8_t soc) {
+  uint64_t charged = 0;
+  uint64_t discharged = 0;
+  inv_energy_integrate(&battery_energy_int, esp_timer_get_time(), power, &charged, &discharged);
+  em_fixed_add_u64(&energy_meas.battery_charge.energy, charged);
+  em_fixed_add_u64(&energy_meas.battery_discharge.energy, discharged);
+  inv_energy_store_add(INV_ENERGY_BATTERY_CHARGE, charged);
+  inv_energy_store_add(INV_ENERGY_BATTERY_DISCHARGE, discharged);
 
   battery_meas.voltage = voltage;
   battery_meas.charge_power = power;
-  battery_meas.timestamp = now;
+  battery_meas.soc = soc;
+  battery_meas.timestamp = time(NULL);
+
+  inv_deadband_feed(INV_CH_BATTERY_VOLTAGE, voltage);
+  inv_deadband_feed(INV_CH_BATTERY_POWER, power);
+  inv_power_stats_add(INV_CH_BATTERY_POWER, power, battery_meas.timestamp);
+  inv_history_add(INV_CH_BATTERY_POWER, power, battery_meas.timestamp);
 }
 
-// voltage in 0.1V, power in W, freq in 0.1Hz, load in %, power factor in 0.01
+// voltage in 0.1V, power in W, freq in 0.1Hz, load in %, power factor in 0.001
 void inv_set_meas_ac_out(uint16_t voltage, uint16_t power, uint16_t freq,
-                         uint8_t load, uint8_t power_factor) {
+                         uint8_t load, uint16_t power_factor) {
   time_t now = time(NULL);
-
-  if (ac_output_meas.timestamp != 0) {
-    int16_t prev_power =
-        power_history_last_entry(&ac_out_power_history); // in W
-    int64_t delta_energy = prev_power * (now - pv_meas.timestamp);
-    energy_meas.ac_output.energy += delta_energy;
-    // ESP_LOGI(LOG_TAG, "UPDATE ac output: %.3f Wh (+%.3f Wh)",
-    // energy_meas.ac_output/3600.0, delta_energy/3600.0);
-  }
+  uint64_t delta_energy = 0;
+  uint64_t unused = 0;
+  inv_energy_integrate(&ac_out_energy_int, esp_timer_get_time(), power, &delta_energy, &unused);
+  em_fixed_add_u64(&energy_meas.ac_output.energy, delta_energy);
+  inv_energy_store_add(INV_ENERGY_AC_OUTPUT, delta_energy);
 
   ac_output_meas.voltage = voltage;
-  bool power_ready =
-      em_utils_set_uint16_add(&ac_output_meas.power, power); // average power
+  ac_output_meas.power = power;
   ac_output_meas.freq = freq;
   ac_output_meas.output_load = load;
   ac_output_meas.power_factor = power_factor;
   ac_output_meas.timestamp = now;
 
-  if (power_ready) {
-    uint16_t avg_power = em_utils_set_uint16_avg(&ac_output_meas.power);
-    em_utils_set_uint16_clear(&ac_output_meas.power);
-
-    int res = power_history_add_entry(&ac_out_power_history, now, avg_power);
-
-    if (res != 0) {
-      ESP_LOGI(LOG_TAG, "AC out new power[%d] %d time=%lld",
-               ac_out_power_history.size - 1, avg_power,
-               now - ac_out_power_history.ref_timestamp);
-
-      if (res < 0) {
-        ESP_LOGI(LOG_TAG, "Send and clear ac out power history");
-        protocol_send_inv_ac_out_power_history(&ac_out_power_history);
-        ac_out_power_history.size = 0;
-      }
-    }
-  }
+  inv_deadband_feed(INV_CH_AC_OUT_VOLTAGE, voltage);
+  inv_deadband_feed(INV_CH_AC_OUT_POWER, power);
+  inv_power_stats_add(INV_CH_AC_OUT_POWER, power, now);
+  inv_history_add(INV_CH_AC_OUT_POWER, power, now);
+  inv_deadband_feed(INV_CH_AC_OUT_FREQ, freq);
 }
 
-// TODO: idx not used
-void inv_set_meas_pv(uint8_t idx, uint16_t voltage, uint16_t power) {
-  if (idx >= MAX_PV_INPUTS) {
+// voltage in 0.1V, current in 0.1A, power in W, the first input feeds the PV channels with totals of all inputs
+void inv_set_meas_pv(uint8_t idx, uint16_t voltage, uint16_t current, uint16_t power) {
+  if (idx >= INV_MAX_PV_INPUTS) {
     return;
   }
 
   time_t now = time(NULL);
+  inv_pv_input_meas_t *input = &pv_meas.inputs[idx];
+  uint64_t delta_energy = 0;
+  uint64_t unused = 0;
+  inv_energy_integrate(&pv_energy_int[idx], esp_timer_get_time(), power, &delta_energy, &unused);
+  em_fixed_add_u64(&input->energy.energy, delta_energy);
+  input->energy.timestamp = now;
+  input->voltage = voltage;
+  input->current = current;
+  input->power = power;
+  input->timestamp = now;
+
+  if (idx >= pv_meas.strings_cnt) {
+    pv_meas.strings_cnt = idx + 1;
+  }
+
+  // reconciliation corrects the total only, energy of the input stays as integrated
+  delta_energy = inv_energy_reconcile_filter(delta_energy);
+  em_fixed_add_u64(&energy_meas.pv.energy, delta_energy);
+  inv_energy_store_add(INV_ENERGY_PV, delta_energy);
 
-  if (pv_meas.timestamp != 0) {
-    int16_t prev_power = power_history_last_entry(&pv_power_history); // in W
-    int64_t delta_energy = prev_power * (now - pv_meas.timestamp);
-    energy_meas.pv.energy += delta_energy;
-    // ESP_LOGI(LOG_TAG, "UPDATE pv: %.3f Wh (+%.3f Wh)\n",
-    // energy_meas.pv/3600.0, delta_energy/3600.0);
+  if (idx != 0) {
+    return;
   }
 
-  pv_meas.voltage = voltage;
-  bool power_ready =
-      em_utils_set_uint16_add(&pv_meas.power, power); // average power
-  pv_meas.timestamp = now;
+  // other inputs are polled by their own commands, their last values are included
+  uint32_t total = 0;
 
-  if (power_ready) {
-    uint16_t avg_power = em_utils_set_uint16_avg(&pv_meas.power);
-    em_utils_set_uint16_clear(&pv_meas.power);
+  for (uint8_t i = 0; i < pv_meas.strings_cnt; i++) {
+    total += pv_meas.inputs[i].power;
+  }
 
-    int res = power_history_add_entry(&pv_power_history, now, avg_power);
+  uint16_t total_power = em_fixed_sat_u16((int32_t)total);
 
-    if (res != 0) {
-      ESP_LOGI(LOG_TAG, "PV new power[%d] %d time=%lld",
-               pv_power_history.size - 1, avg_power,
-               now - pv_power_history.ref_timestamp);
+  pv_meas.voltage = voltage;
+  pv_meas.power = total_power;
+  pv_meas.timestamp = now;
 
-      if (res < 0) {
-        protocol_send_inv_pv_power_history(&pv_power_history);
-        pv_power_history.size = 0;
-      }
-    }
-  }
+  inv_deadband_feed(INV_CH_PV_VOLTAGE, voltage);
+  inv_deadband_feed(INV_CH_PV_POWER, total_power);
+  inv_power_stats_add(INV_CH_PV_POWER, total_power, now);
+  inv_history_add(INV_CH_PV_POWER, total_power, now);
 }
 /*
 11110110 - day, charging 30A from PV, almost 100% SoC
 */
+void inv_add_energy_correction(uint64_t energy) {
+  em_fixed_add_u64(&energy_meas.pv.energy, energy);
+  inv_energy_store_add(INV_ENERGY_PV, energy);
+}
+
 void inv_set_status(uint32_t status_flags) {
-  if (inv_status.status_flags != status_flags) {
+  uint32_t changed = inv_status.status_flags ^ status_flags;
+  bool stale = inv_refresh(INV_STALE_MEAS);
+
+  if (changed != 0 || stale) {
     inv_status.status_flags = status_flags;
-    ESP_LOGI(LOG_TAG, "Status flags: %lx", status_flags);
-    inv_status.changed = true;
+    ESP_LOGI(LOG_TAG, "Status flags: %lx changed=%d", status_flags, __builtin_popcount(changed));
+    inv_status_agg_update(&inv_status, time(NULL));
   }
 }
 
 void inv_set_warnings(uint64_t warning_flags) {
-  if (inv_status.warning_flags != warning_flags) {
+  uint64_t changed = inv_status.warning_flags ^ warning_flags;
+  bool stale = inv_refresh(INV_STALE_WARNINGS);
+
+  if (changed != 0 || stale) {
+    uint64_t raised = changed & warning_flags;
+    inv_burst_warnings_raised(raised);
     inv_status.warning_flags = warning_flags;
-    ESP_LOGW(LOG_TAG, "Warning flags: %llx", warning_flags);
-    inv_status.changed = true;
+    ESP_LOGW(LOG_TAG, "Warning flags: %llx raised=%d cleared=%d", warning_flags, __builtin_popcountll(raised),
+             __builtin_popcountll(changed & ~raised));
+    inv_status_agg_update(&inv_status, time(NULL));
   }
 }
 
 void inv_set_fault(uint32_t fault_code) {
-  if (inv_status.fault_code != fault_code) {
+  bool stale = inv_refresh(INV_STALE_FAULT);
+
+  if (inv_status.fault_code != fault_code || stale) {
     inv_status.fault_code = fault_code;
     ESP_LOGW(LOG_TAG, "Fault code: %c%c / %x", (char)(fault_code >> 24),
              (char)(fault_code >> 16), (uint16_t)fault_code);
-    inv_status.changed = true;
+    inv_status_agg_update(&inv_status, time(NULL));
   }
 }
 
 void inv_set_mode(uint32_t mode) {
+  bool stale = inv_refresh(INV_STALE_MODE);
+
   if (inv_status.mode != mode) {
     inv_status.mode = mode;
     ESP_LOGW(LOG_TAG, "Mode: %c / %lx", (char)mode, mode);
-    inv_status.changed = true;
-  }
-
-  if (inv_status.changed) {
-    // TOOD: send this whewhen assured if all data received
-    inv_status.changed = false;
-    protocol_send_inv_status(&inv_status);
+    inv_burst_mode_changed(mode);
+    inv_status_agg_update(&inv_status, time(NULL));
+  } else if (stale) {
+    inv_status_agg_update(&inv_status, time(NULL));
   }
 }
 
@@ -440,6 +523,8 @@ void inv_set_model(uint32_t *model, size_t data_len) {
 }
 
 void inv_set_fw_ver(uint32_t fw_ver) {
+  (void)inv_refresh(INV_STALE_FW_VER);
+
   if (inv_info.fw_ver != fw_ver) {
     inv_info.fw_ver = fw_ver;
     ESP_LOGW(LOG_TAG, "FW version: %d.%d.%d.%d", (uint8_t)(fw_ver >> 24),
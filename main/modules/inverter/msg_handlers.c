@@ -3,62 +3,118 @@
  */
 
 
+#include "em/fixed.h"
 #include "em/rs232_2400_protocol.h"
 #include "em/serial_client.h"
 #include "em/storage.h"
 #include "em/inverter_priv.h"
+#include "em/energy_reconcile.h"
+#include "em/burst.h"
+#include "em/settings_cache.h"
+#include "em/set_batch.h"
+#include "em/poll_plan.h"
+#include <assert.h>
+#include <stdio.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <esp_cpu.h>
+#include <esp_timer.h>
+#include <sdkconfig.h>
 
 #include <esp_log.h>
 
 #define LOG_TAG "RS232"
 
+static int64_t meas_us = 0; // last QPIGS sample fed to the measurement path
+
  int inv_meas_qpigs_handler(void *data, size_t data_len)
  {
    assert(data);
    qpigs_response_t *rsp = (qpigs_response_t *)data;
 
-   uint8_t power_factor = (100.0 * (float)rsp->ac_output_active_power/(float)rsp->ac_output_appearent_power);
+#if CONFIG_EM_INVERTER_QPIGS_CYCLES_LOG
+   uint32_t start_cycles = esp_cpu_get_cycle_count();
+#endif
+
+   int32_t power_factor = 0; // in 0.001
+
+   if (rsp->ac_output_appearent_power > 0) {
+     em_fixed_mul_div(rsp->ac_output_active_power, 1000, rsp->ac_output_appearent_power, &power_factor);
+   }
 
    /*ESP_LOGI(LOG_TAG, "---- ");
-   ESP_LOGI(LOG_TAG, "Grid : %.1fV %.1fHz", rsp->grid_voltage, rsp->grid_frequency);
-   ESP_LOGI(LOG_TAG, "ACout: %.1fV %.1fHz %dW %d%% factor: %.2f",rsp->ac_output_voltage,  rsp->ac_output_frequency,
-     rsp->ac_output_active_power, rsp->output_load_percent, (float)power_factor/100.0);
-   ESP_LOGI(LOG_TAG, "PV_in: %.1fV %.2fA %dW", rsp->pv_input_voltage, rsp->pv_input_current, rsp->pv_input_power);
+   ESP_LOGI(LOG_TAG, "Grid : %dV/10 %dHz/10", rsp->grid_voltage, rsp->grid_frequency);
+   ESP_LOGI(LOG_TAG, "ACout: %dV/10 %dHz/10 %dW %d%% factor: %ld/1000",rsp->ac_output_voltage,  rsp->ac_output_frequency,
+     rsp->ac_output_active_power, rsp->output_load_percent, power_factor);
+   ESP_LOGI(LOG_TAG, "PV_in: %dV/10 %dA/10 %dW", rsp->pv_input_voltage, rsp->pv_input_current, rsp->pv_input_power);
    ESP_LOGI(LOG_TAG, "Temp : %d°C BUS voltage: %dV", rsp->temperature, rsp->bus_voltage);
-   ESP_LOGI(LOG_TAG, "Device status 1: %#lx 2: %#x", rsp->device_status_1, rsp->device_status_2);*/
-   int16_t battery_charge_power = 0;
+   ESP_LOGI(LOG_TAG, "Device status 1: %#x 2: %#x", rsp->device_status_1, rsp->device_status_2);*/
+   int32_t battery_charge_power = 0; // A * 0.1V / 10 = W
 
    if (rsp->battery_discharging_current > 0){
-     battery_charge_power = (int16_t)(rsp->battery_discharging_current * rsp->battery_voltage);
-     //ESP_LOGI(LOG_TAG, "Battery: %.1fV -%dA -%ldW", rsp->battery_voltage, rsp->battery_discharging_current, battery_charge_power);
-     inv_set_meas_battery(10 * rsp->battery_voltage, -battery_charge_power);
+     em_fixed_mul_div(-rsp->battery_discharging_current, rsp->battery_voltage, 10, &battery_charge_power);
    } else {
-     battery_charge_power = (int16_t)(rsp->battery_charging_current * rsp->battery_voltage);
-     //ESP_LOGI(LOG_TAG, "Battery: %.1fV %dA %ldW", rsp->battery_voltage, rsp->battery_charging_current, battery_charge_power);
-     inv_set_meas_battery(10 * rsp->battery_voltage, battery_charge_power);
+     em_fixed_mul_div(rsp->battery_charging_current, rsp->battery_voltage, 10, &battery_charge_power);
    }
-    //ESP_LOGI(LOG_TAG, "ac: %d bat: %ld pv: %d grid_power=%ldW, cur=%.2f", rsp->ac_output_active_power, battery_charge_power, rsp->pv_input_power, grid_power, grid_current/100.0);
-   inv_set_meas_grid(10 * rsp->grid_voltage, 0, rsp->grid_frequency);
-   inv_set_meas_ac_out(10 * rsp->ac_output_voltage, rsp->ac_output_active_power, rsp->ac_output_frequency, rsp->output_load_percent, power_factor);
-   inv_set_meas_pv(0, 10 * rsp->pv_input_voltage, rsp->pv_input_power);
-   inv_set_status(rsp->device_status_1 + (rsp->device_status_2 << 16));
-   inv_store_energy_meas();
+
+   int64_t now_us = esp_timer_get_time();
+   inv_burst_sample_t sample = {.time_us = now_us};
+   sample.values[INV_BURST_GRID_VOLTAGE] = em_fixed_sat_i16(rsp->grid_voltage);
+   sample.values[INV_BURST_GRID_FREQ] = em_fixed_sat_i16(rsp->grid_frequency);
+   sample.values[INV_BURST_AC_OUT_VOLTAGE] = em_fixed_sat_i16(rsp->ac_output_voltage);
+   sample.values[INV_BURST_AC_OUT_POWER] = em_fixed_sat_i16(rsp->ac_output_active_power);
+   sample.values[INV_BURST_BATTERY_VOLTAGE] = em_fixed_sat_i16(rsp->battery_voltage);
+   sample.values[INV_BURST_BATTERY_POWER] = em_fixed_sat_i16(battery_charge_power);
+   sample.values[INV_BURST_PV_POWER] = em_fixed_sat_i16(rsp->pv_input_power);
+   inv_burst_add(&sample);
+
+   // burst capture or the poll plan may poll faster, the measurement path keeps its period (half a poll of jitter allowed)
+   int64_t poll_ms = inv_poll_plan_interval(EM_RS232_2400_QPIGS);
+   if (meas_us != 0 && now_us - meas_us < (int64_t)INV_MEAS_PERIOD_MS * 1000 - poll_ms * 500) {
+     return 0;
+   }
+
+   meas_us = now_us;
+
+   inv_set_meas_battery(rsp->battery_voltage, em_fixed_sat_i16(battery_charge_power), rsp->battery_capacity);
+   inv_set_meas_grid(rsp->grid_voltage, 0, rsp->grid_frequency);
+   inv_set_meas_ac_out(rsp->ac_output_voltage, rsp->ac_output_active_power, rsp->ac_output_frequency, rsp->output_load_percent,
+                       em_fixed_sat_u16(power_factor));
+   inv_set_meas_pv(0, rsp->pv_input_voltage, rsp->pv_input_current, rsp->pv_input_power);
+   inv_set_status(rsp->device_status);
+   inv_snapshot_publish();
+   inv_send_meas();
+
+#if CONFIG_EM_INVERTER_QPIGS_CYCLES_LOG
+   ESP_LOGI(LOG_TAG, "QPIGS cycle: %lu cycles", esp_cpu_get_cycle_count() - start_cycles);
+#endif
    return 0;
  }
 
+ // second tracker, fed at its poll interval, the totals go out with the next QPIGS
+ int inv_meas_qpigs2_handler(void *data, size_t data_len)
+ {
+  assert(data);
+  const qpigs2_response_t *rsp = (const qpigs2_response_t *)data;
+  inv_set_meas_pv(1, rsp->pv_input_voltage, rsp->pv_input_current, rsp->pv_input_power);
+  inv_snapshot_publish();
+  return 0;
+ }
+
  int inv_warning_flags_handler(void *data, size_t data_len)
  {
   assert(data);
-  inv_set_warnings(*(uint64_t *)data);
+  const qpiws_response_t *rsp = (const qpiws_response_t *)data;
+  inv_set_warnings(rsp->bits);
+  inv_snapshot_publish();
   return 0;
  }
 
  int inv_fault_handler(void *data, size_t data_len)
  {
   assert(data);
-  inv_set_fault(*(uint64_t *)data);
+  inv_set_fault(*(const qpicf_response_t *)data);
+  inv_snapshot_publish();
   return 0;
  }
 
@@ -66,6 +122,7 @@
  {
   assert(data);
   inv_set_mode(*(uint32_t *)data);
+  inv_snapshot_publish();
   return 0;
  }
 
@@ -73,6 +130,7 @@
  {
   assert(data);
   inv_set_model((uint32_t*)data, data_len);
+  inv_snapshot_publish();
   return 0;
  }
 
@@ -87,7 +145,84 @@
  int inv_fw_ver_handler(void *data, size_t data_len)
  {
   assert(data);
-  inv_set_fw_ver(*(uint32_t *)data);
+  uint32_t fw_ver = *(uint32_t *)data;
+  inv_set_fw_ver(fw_ver);
+  inv_snapshot_publish();
   em_sc_remove_periodic(&sc, EM_RS232_2400_QVFW);
+
+  // parsed to a number, cached as the inverter sent it
+  char text[24];
+  snprintf(text, sizeof(text), "VERFW:%05lu.%02u", (unsigned long)(fw_ver >> 8), (unsigned)(fw_ver & 0xFF));
+  inv_settings_cache_store(INV_SETTING_FW_VERSION, text);
+  return 0;
+ }
+
+ int inv_rated_info_handler(void *data, size_t data_len)
+ {
+  assert(data);
+  inv_settings_cache_store(INV_SETTING_RATED_INFO, (const char *)data);
+  return 0;
+ }
+
+ int inv_flags_handler(void *data, size_t data_len)
+ {
+  assert(data);
+  inv_settings_cache_store(INV_SETTING_FLAGS, (const char *)data);
   return 0;
- }
\ No newline at end of file
+ }
+
+ int inv_max_charge_currents_handler(void *data, size_t data_len)
+ {
+  assert(data);
+  inv_settings_cache_store(INV_SETTING_MAX_CHARGE_CURRENTS, (const char *)data);
+  return 0;
+ }
+
+ int inv_max_utility_charge_currents_handler(void *data, size_t data_len)
+ {
+  assert(data);
+  inv_settings_cache_store(INV_SETTING_MAX_UTILITY_CHARGE_CURRENTS, (const char *)data);
+  return 0;
+ }
+
+ int inv_set_ack_handler(void *data, size_t data_len)
+ {
+  assert(data);
+  inv_set_batch_ack(*(uint32_t *)data != 0);
+  return 0;
+ }
+
+ int inv_energy_total_handler(void *data, size_t data_len)
+ {
+  assert(data);
+  inv_energy_reconcile_counter(INV_ENERGY_COUNTER_TOTAL, *(uint32_t *)data);
+  return 0;
+ }
+
+ int inv_energy_year_handler(void *data, size_t data_len)
+ {
+  assert(data);
+  inv_energy_reconcile_counter(INV_ENERGY_COUNTER_YEAR, *(uint32_t *)data);
+  return 0;
+ }
+
+ int inv_energy_month_handler(void *data, size_t data_len)
+ {
+  assert(data);
+  inv_energy_reconcile_counter(INV_ENERGY_COUNTER_MONTH, *(uint32_t *)data);
+  return 0;
+ }
+
+ int inv_energy_day_handler(void *data, size_t data_len)
+ {
+  assert(data);
+  inv_energy_reconcile_counter(INV_ENERGY_COUNTER_DAY, *(uint32_t *)data);
+  return 0;
+ }
+
+ int inv_energy_hour_handler(void *data, size_t data_len)
+ {
+  assert(data);
+  inv_energy_reconcile_counter(INV_ENERGY_COUNTER_HOUR, *(uint32_t *)data);
+  return 0;
+ }
@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#include "em/poll_plan.h"
+#include "em/deadband.h"
+#include "em/inverter_priv.h"
+#include "em/rs232_2400_protocol.h"
+#include "em/serial_client.h"
+#include "em/storage.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+#include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+#include <sdkconfig.h>
+
+#include <esp_log.h>
+#define LOG_TAG "INV_POLL"
+
+#define MIN_INTERVAL_MS  (500u)
+#define MAX_INTERVAL_MS  (24u * 3600u * 1000u)
+#define RESERVED_RQS     (3u)   // one-shot reads of the settings cache, SET batch and energy reconciliation
+#define RQ_OVERHEAD      (3u)   // CRC and CR
+#define TURNAROUND_MS    (100u) // inverter response delay
+#define BITS_IN_CHAR     (10u)  // start, 8 data and stop bit
+#define MS_IN_S          (1000u)
+#define PERMILLE         (1000u)
+
+_Static_assert(INV_POLL_PLAN_MAX_ITEMS <= MAX_POLL_PLAN_ITEMS, "Poll plan doesn't fit the storage");
+_Static_assert(INV_POLL_PLAN_MAX_DEADBANDS <= MAX_POLL_PLAN_DBS, "Poll plan deadbands don't fit the storage");
+
+typedef struct {
+  uint16_t cmd;
+  const char *rq;
+  uint16_t rsp_len; // longest response with CRC and CR
+} poll_cmd_def_t;
+
+// commands allowed in the plan, the ones with handlers feeding the measurements and the status
+static const poll_cmd_def_t cmd_defs[] = {
+  {.cmd = EM_RS232_2400_QPIGS, .rq = "QPIGS", .rsp_len = 110},
+  {.cmd = EM_RS232_2400_QPIGS2, .rq = "QPIGS2", .rsp_len = 30},
+  {.cmd = EM_RS232_2400_QPIWS, .rq = "QPIWS", .rsp_len = 40},
+  {.cmd = EM_RS232_2400_QMOD, .rq = "QMOD", .rsp_len = 5},
+  {.cmd = EM_RS232_2400_QPICF, .rq = "QPICF", .rsp_len = 12},
+  {.cmd = EM_RS232_2400_QVFW, .rq = "QVFW", .rsp_len = 18},
+};
+
+#if INV_MAX_PV_INPUTS > 1
+#define DEFAULT_POLLS_NUM (5u)
+#else
+#define DEFAULT_POLLS_NUM (4u)
+#endif
+
+_Static_assert(DEFAULT_POLLS_NUM <= CONFIG_EM_SERIAL_CLIENT_MAX_RQS - RESERVED_RQS,
+               "Default poll plan and the reserved requests don't fit the serial client");
+
+// QVFW stops polling itself at the first response, the second PV tracker keeps the measurement period
+static const inv_poll_plan_t default_plan = {
+  .polls_num = DEFAULT_POLLS_NUM,
+#if INV_MAX_PV_INPUTS > 1
+  .cmds = {EM_RS232_2400_QPIGS, EM_RS232_2400_QPIGS2, EM_RS232_2400_QMOD, EM_RS232_2400_QPIWS, EM_RS232_2400_QVFW},
+  .intervals = {INV_QPIGS_POLL_MS, INV_MEAS_PERIOD_MS, 600000, 600000, 10000},
+  .priorities = {0, 0, 1, 1, 2},
+#else
+  .cmds = {EM_RS232_2400_QPIGS, EM_RS232_2400_QMOD, EM_RS232_2400_QPIWS, EM_RS232_2400_QVFW},
+  .intervals = {INV_QPIGS_POLL_MS, 600000, 600000, 10000},
+  .priorities = {0, 1, 1, 2},
+#endif
+  .deadbands_num = 0,
+};
+
+// written by the dispatcher, read by the serial client task
+static inv_poll_plan_t plan;
+static portMUX_TYPE plan_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static const poll_cmd_def_t *find_def(uint16_t cmd)
+{
+  for (size_t i = 0; i < sizeof(cmd_defs) / sizeof(cmd_defs[0]); i++) {
+    if (cmd_defs[i].cmd == cmd) {
+      return &cmd_defs[i];
+    }
+  }
+
+  return NULL;
+}
+
+// share of the line kept busy by the polls, in permille
+static uint32_t airtime_permille(const inv_poll_plan_t *p, uint32_t baud_rate)
+{
+  uint32_t permille = 0;
+
+  for (uint8_t i = 0; i < p->polls_num; i++) {
+    const poll_cmd_def_t *def = find_def(p->cmds[i]);
+    uint32_t chars = strlen(def->rq) + RQ_OVERHEAD + def->rsp_len;
+    uint32_t exchange_ms = chars * BITS_IN_CHAR * MS_IN_S / baud_rate + TURNAROUND_MS;
+    permille += exchange_ms * PERMILLE / p->intervals[i];
+  }
+
+  return permille;
+}
+
+static int validate(const inv_poll_plan_t *p)
+{
+  bool qpigs = false;
+
+  if (p->polls_num > INV_POLL_PLAN_MAX_ITEMS || p->polls_num > CONFIG_EM_SERIAL_CLIENT_MAX_RQS - RESERVED_RQS ||
+      p->deadbands_num > INV_POLL_PLAN_MAX_DEADBANDS) {
+    ESP_LOGW(LOG_TAG, "Too many polls=%d deadbands=%d", p->polls_num, p->deadbands_num);
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  for (uint8_t i = 0; i < p->polls_num; i++) {
+    if (find_def(p->cmds[i]) == NULL || p->intervals[i] < MIN_INTERVAL_MS || p->intervals[i] > MAX_INTERVAL_MS) {
+      ESP_LOGW(LOG_TAG, "Poll %d cmd=%d interval=%lums refused", i, p->cmds[i], p->intervals[i]);
+      return ESP_ERR_INVALID_ARG;
+    }
+
+    for (uint8_t j = 0; j < i; j++) {
+      if (p->cmds[j] == p->cmds[i]) {
+        ESP_LOGW(LOG_TAG, "Cmd %d polled twice", p->cmds[i]);
+        return ESP_ERR_INVALID_ARG;
+      }
+    }
+
+    qpigs |= p->cmds[i] == EM_RS232_2400_QPIGS;
+  }
+
+  if (!qpigs) {
+    ESP_LOGW(LOG_TAG, "Plan without QPIGS");
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  for (uint8_t i = 0; i < p->deadbands_num; i++) {
+    if (p->channels[i] >= INV_CH_CNT) {
+      ESP_LOGW(LOG_TAG, "Deadband of unknown channel %d", p->channels[i]);
+      return ESP_ERR_INVALID_ARG;
+    }
+  }
+
+  assert(sc.selected_protocol_idx < sc.supported_protocols_cnt);
+  uint32_t baud_rate = (uint32_t)sc.supported_protocols[sc.selected_protocol_idx].baud_rate;
+  uint32_t permille = airtime_permille(p, baud_rate);
+
+  if (permille > CONFIG_EM_INVERTER_POLL_AIRTIME_PCT * (PERMILLE / 100u)) {
+    ESP_LOGW(LOG_TAG, "Plan airtime %lu%% over budget", permille / (PERMILLE / 100u));
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  return ESP_OK;
+}
+
+// stable, polls of the same priority keep the order from the server
+static void sort_by_priority(inv_poll_plan_t *p)
+{
+  for (uint8_t i = 1; i < p->polls_num; i++) {
+    for (uint8_t j = i; j > 0 && p->priorities[j - 1] > p->priorities[j]; j--) {
+      uint16_t cmd = p->cmds[j];
+      uint32_t interval = p->intervals[j];
+      uint8_t priority = p->priorities[j];
+      p->cmds[j] = p->cmds[j - 1];
+      p->intervals[j] = p->intervals[j - 1];
+      p->priorities[j] = p->priorities[j - 1];
+      p->cmds[j - 1] = cmd;
+      p->intervals[j - 1] = interval;
+      p->priorities[j - 1] = priority;
+    }
+  }
+}
+
+static int apply(const inv_poll_plan_t *p)
+{
+  em_sc_periodic_rq_t rqs[INV_POLL_PLAN_MAX_ITEMS];
+
+  for (uint8_t i = 0; i < p->polls_num; i++) {
+    const poll_cmd_def_t *def = find_def(p->cmds[i]);
+    assert(def);
+    rqs[i] = (em_sc_periodic_rq_t){
+      .rq_id = def->cmd, .period = p->intervals[i], .payload = (const uint8_t *)def->rq, .payload_len = strlen(def->rq)};
+  }
+
+  if (em_sc_replace_periodic(&sc, rqs, p->polls_num) != 0) {
+    ESP_LOGE(LOG_TAG, "Replace polls failed");
+    return ESP_FAIL;
+  }
+
+  // deadbands of the previous plan fall back to the defaults unless the new plan sets them again
+  for (uint8_t i = 0; i < plan.deadbands_num; i++) {
+    inv_deadband_reset(plan.channels[i]);
+  }
+
+  for (uint8_t i = 0; i < p->deadbands_num; i++) {
+    (void)inv_deadband_set(p->channels[i], p->thresholds[i], p->max_silences[i]);
+  }
+
+  taskENTER_CRITICAL(&plan_lock);
+  plan = *p;
+  taskEXIT_CRITICAL(&plan_lock);
+
+  ESP_LOGI(LOG_TAG, "Plan applied polls=%d deadbands=%d", p->polls_num, p->deadbands_num);
+  return ESP_OK;
+}
+
+static void to_storage(const inv_poll_plan_t *p, storage_poll_plan_t *out)
+{
+  memset(out, 0, sizeof(*out));
+  out->polls_num = p->polls_num;
+  out->deadbands_num = p->deadbands_num;
+
+  for (uint8_t i = 0; i < p->polls_num; i++) {
+    out->cmds[i] = p->cmds[i];
+    out->intervals[i] = p->intervals[i];
+    out->priorities[i] = p->priorities[i];
+  }
+
+  for (uint8_t i = 0; i < p->deadbands_num; i++) {
+    out->channels[i] = p->channels[i];
+    out->thresholds[i] = p->thresholds[i];
+    out->max_silences[i] = p->max_silences[i];
+  }
+}
+
+static void from_storage(const storage_poll_plan_t *in, inv_poll_plan_t *p)
+{
+  memset(p, 0, sizeof(*p));
+  p->polls_num = in->polls_num < INV_POLL_PLAN_MAX_ITEMS ? in->polls_num : INV_POLL_PLAN_MAX_ITEMS;
+  p->deadbands_num = in->deadbands_num < INV_POLL_PLAN_MAX_DEADBANDS ? in->deadbands_num : INV_POLL_PLAN_MAX_DEADBANDS;
+
+  for (uint8_t i = 0; i < p->polls_num; i++) {
+    p->cmds[i] = in->cmds[i];
+    p->intervals[i] = in->intervals[i];
+    p->priorities[i] = in->priorities[i];
+  }
+
+  for (uint8_t i = 0; i < p->deadbands_num; i++) {
+    p->channels[i] = in->channels[i];
+    p->thresholds[i] = in->thresholds[i];
+    p->max_silences[i] = in->max_silences[i];
+  }
+}
+
+void inv_poll_plan_init(void)
+{
+  storage_poll_plan_t stored = storage_poll_plan();
+  inv_poll_plan_t restored;
+  from_storage(&stored, &restored);
+
+  // stored plan passed the checks once, the budget may have shrunk with the firmware update
+  if (restored.polls_num > 0 && validate(&restored) == ESP_OK && apply(&restored) == ESP_OK) {
+    return;
+  }
+
+  ESP_LOGI(LOG_TAG, "Default plan");
+
+  // sizes are checked at build time, the airtime depends on the burst poll period and the budget
+  if (validate(&default_plan) != ESP_OK) {
+    ESP_LOGE(LOG_TAG, "Default plan over the limits, applied anyway");
+  }
+
+  int ret = apply(&default_plan);
+  assert(ret == ESP_OK);
+  (void)ret;
+}
+
+uint32_t inv_poll_plan_interval(uint16_t cmd)
+{
+  uint32_t interval = 0;
+
+  taskENTER_CRITICAL(&plan_lock);
+  for (uint8_t i = 0; i < plan.polls_num; i++) {
+    if (plan.cmds[i] == cmd) {
+      interval = plan.intervals[i];
+      break;
+    }
+  }
+  taskEXIT_CRITICAL(&plan_lock);
+
+  return interval;
+}
+
+int inv_poll_plan_set(const inv_poll_plan_t *new_plan)
+{
+  assert(new_plan);
+
+  int ret = validate(new_plan);
+  if (ret != ESP_OK) {
+    return ret;
+  }
+
+  inv_poll_plan_t sorted = *new_plan;
+  sort_by_priority(&sorted);
+
+  ret = apply(&sorted);
+  if (ret != ESP_OK) {
+    return ret;
+  }
+
+  storage_poll_plan_t stored;
+  to_storage(&sorted, &stored);
+  storage_set_poll_plan(&stored);
+  return ESP_OK;
+}
+
+void inv_poll_plan_get(inv_poll_plan_t *out)
+{
+  assert(out);
+
+  taskENTER_CRITICAL(&plan_lock);
+  *out = plan;
+  taskEXIT_CRITICAL(&plan_lock);
+}
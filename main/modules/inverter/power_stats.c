@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#include "em/power_stats.h"
+#include "em/p2.h"
+#include "em/protocol.h"
+#include "em/time.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <esp_log.h>
+#define LOG_TAG "INV_PSTAT"
+
+#define POWER_CHANNELS_CNT (4u)
+
+typedef enum {
+  QUANTILE_P5 = 0,
+  QUANTILE_P50,
+  QUANTILE_P95,
+  QUANTILES_CNT
+} quantile_t;
+
+typedef struct {
+  em_p2_t quantiles[QUANTILES_CNT];
+  int32_t peak; // sample with the largest magnitude
+  uint16_t samples;
+} power_stats_t;
+
+typedef struct {
+  time_t start;
+  uint16_t entries_num;
+  uint8_t channels[POWER_CHANNELS_CNT];
+  uint16_t samples[POWER_CHANNELS_CNT];
+  int32_t p5[POWER_CHANNELS_CNT];
+  int32_t p50[POWER_CHANNELS_CNT];
+  int32_t p95[POWER_CHANNELS_CNT];
+  int32_t peak[POWER_CHANNELS_CNT];
+} power_summary_t;
+
+static const inv_channel_t power_channels[POWER_CHANNELS_CNT] = {
+  INV_CH_GRID_POWER,
+  INV_CH_BATTERY_POWER,
+  INV_CH_AC_OUT_POWER,
+  INV_CH_PV_POWER,
+};
+
+static const uint16_t quantiles_permille[QUANTILES_CNT] = {50, 500, 950};
+
+static power_stats_t stats[POWER_CHANNELS_CNT];
+static time_t quarter_start = 0;
+static power_summary_t pending = {0}; // summary not sent yet, entries_num = 0 - none
+static time_t last_send_attempt = 0;
+
+static void reset_stats(void)
+{
+  for (uint32_t i = 0; i < POWER_CHANNELS_CNT; i++) {
+    for (uint32_t q = 0; q < QUANTILES_CNT; q++) {
+      em_p2_init(&stats[i].quantiles[q], quantiles_permille[q]);
+    }
+
+    stats[i].peak = 0;
+    stats[i].samples = 0;
+  }
+}
+
+static void summarize(time_t start, power_summary_t *summary)
+{
+  memset(summary, 0, sizeof(*summary));
+  summary->start = start;
+
+  for (uint32_t i = 0; i < POWER_CHANNELS_CNT; i++) {
+    if (stats[i].samples == 0) {
+      continue;
+    }
+
+    uint16_t idx = summary->entries_num++;
+    summary->channels[idx] = (uint8_t)power_channels[i];
+    summary->samples[idx] = stats[i].samples;
+    summary->peak[idx] = stats[i].peak;
+    em_p2_get(&stats[i].quantiles[QUANTILE_P5], &summary->p5[idx]);
+    em_p2_get(&stats[i].quantiles[QUANTILE_P50], &summary->p50[idx]);
+    em_p2_get(&stats[i].quantiles[QUANTILE_P95], &summary->p95[idx]);
+  }
+}
+
+static void send_pending(time_t now)
+{
+  if (pending.entries_num == 0 || (now - last_send_attempt) < SECONDS_IN_MINUTE) {
+    return;
+  }
+
+  last_send_attempt = now;
+
+  int ret = protocol_send_inverter_power_summary(pending.start, SECONDS_IN_QUARTER, pending.channels, pending.samples,
+                                                 pending.p5, pending.p50, pending.p95, pending.peak,
+                                                 pending.entries_num);
+
+  if (ret != 0) {
+    ESP_LOGW(LOG_TAG, "Send summary err=%d", ret);
+    return;
+  }
+
+  pending.entries_num = 0;
+}
+
+void inv_power_stats_init(void)
+{
+  quarter_start = 0;
+  pending.entries_num = 0;
+  last_send_attempt = 0;
+  reset_stats();
+}
+
+void inv_power_stats_add(inv_channel_t channel, int32_t power, time_t now)
+{
+  if (now < em_utils_get_compile_time()) {
+    return; // time not synchronized
+  }
+
+  time_t start = now - (now % SECONDS_IN_QUARTER);
+
+  if (start != quarter_start) {
+    if (quarter_start != 0) {
+      // summary of the previous quarter replaces the unsent one
+      summarize(quarter_start, &pending);
+      last_send_attempt = 0;
+    }
+
+    reset_stats();
+    quarter_start = start;
+  }
+
+  send_pending(now);
+
+  for (uint32_t i = 0; i < POWER_CHANNELS_CNT; i++) {
+    if (power_channels[i] != channel) {
+      continue;
+    }
+
+    power_stats_t *ch = &stats[i];
+
+    for (uint32_t q = 0; q < QUANTILES_CNT; q++) {
+      em_p2_add(&ch->quantiles[q], power);
+    }
+
+    if (ch->samples == 0 || abs(power) > abs(ch->peak)) {
+      ch->peak = power;
+    }
+
+    if (ch->samples < UINT16_MAX) {
+      ch->samples++;
+    }
+    return;
+  }
+
+  assert(0); // not a power channel
+}
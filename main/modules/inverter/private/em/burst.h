@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#ifndef INV_BURST_H
+#define INV_BURST_H
+
+#include <stdint.h>
+
+typedef enum {
+  INV_BURST_TRIGGER_MODE = 0,   // detail - new mode
+  INV_BURST_TRIGGER_WARNING,    // detail - raised warning bits
+  INV_BURST_TRIGGER_POWER_STEP, // detail - channel id of the step
+} inv_burst_trigger_t;
+
+typedef enum {
+  INV_BURST_GRID_VOLTAGE = 0,
+  INV_BURST_GRID_FREQ,
+  INV_BURST_AC_OUT_VOLTAGE,
+  INV_BURST_AC_OUT_POWER,
+  INV_BURST_BATTERY_VOLTAGE,
+  INV_BURST_BATTERY_POWER,
+  INV_BURST_PV_POWER,
+  INV_BURST_CHANNELS_CNT
+} inv_burst_channel_t;
+
+typedef struct {
+  int64_t time_us; // esp_timer time of the response
+  int16_t values[INV_BURST_CHANNELS_CNT]; // in units of the measurement channels
+} inv_burst_sample_t;
+
+/*
+ * Event triggered capture of every QPIGS sample. Samples go to a pre-trigger RAM ring,
+ * trigger freezes the samples before it, the ones after it are added until the ring holds
+ * the configured post-trigger count. Burst is sent as one message of tscodec compressed channels
+ * and the ring is armed again. Samples and triggers must come from the serial client task.
+ */
+void inv_burst_init(void);
+// power step between consecutive samples above the configured threshold triggers the capture
+void inv_burst_add(const inv_burst_sample_t *sample);
+// trigger when the inverter changed to one of the configured modes
+void inv_burst_mode_changed(uint32_t mode);
+// trigger when one of the configured warning bits was raised
+void inv_burst_warnings_raised(uint64_t raised);
+
+#endif /* INV_BURST_H */
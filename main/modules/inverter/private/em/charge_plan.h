@@ -0,0 +1,21 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#ifndef INV_CHARGE_PLAN_H
+#define INV_CHARGE_PLAN_H
+
+#include <stdbool.h>
+
+/*
+ * Charger and output source priorities planned on the device from the stored price lists, so the plan keeps
+ * running while the server is unreachable. At every price slot the remaining slots of the stored days get
+ * their mode: the most expensive loads are covered by the battery, the cheapest slots before them charge
+ * from the grid when the stored energy and the PV surplus don't cover them. Loads and PV of the slots come
+ * from the quarter history of the last days. Mode of the current slot is set with a SET batch.
+ */
+void inv_charge_plan_init(void);
+// result of the batch with id INV_SET_BATCH_ID_CHARGE_PLAN, success when every command is verified or acked
+void inv_charge_plan_batch_done(bool success);
+
+#endif /* INV_CHARGE_PLAN_H */
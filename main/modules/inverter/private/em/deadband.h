@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#ifndef INV_DEADBAND_H
+#define INV_DEADBAND_H
+
+#include "em/inverter.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Report-by-exception filter. A channel becomes pending when its value moved by at least
+ * the threshold from the last reported one, or when nothing was reported for max silence.
+ * Values are compared against the last reported value (not the last sample), so slow drift
+ * is reported once it accumulates and the error on the server side stays below the threshold.
+ * Energy channels carry cumulative counters, energy not reported yet is carried by the next report.
+ */
+void inv_deadband_init(void);
+void inv_deadband_feed(inv_channel_t channel, int32_t value);
+// restores the default threshold and max silence, the last reported value is kept
+void inv_deadband_reset(inv_channel_t channel);
+
+// copies pending channels to the arrays, returns their count, state is changed only by commit
+size_t inv_deadband_collect(uint8_t *channels, int32_t *values, size_t max_cnt, int64_t now_us);
+void inv_deadband_commit(const uint8_t *channels, const int32_t *values, size_t cnt, int64_t now_us);
+
+#endif /* INV_DEADBAND_H */
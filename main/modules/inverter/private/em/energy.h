@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#ifndef INV_ENERGY_H
+#define INV_ENERGY_H
+
+#include <stdint.h>
+
+/*
+ * Trapezoidal power integrator on monotonic time (esp_timer, us).
+ * Positive and negative flows are accumulated separately, interval crossing
+ * zero is split at the crossing point. Sub-Ws remainders are kept in mWs
+ * so nothing is lost between calls.
+ */
+typedef struct {
+  int64_t last_us;       // time of the last sample, 0 - no sample yet
+  int32_t last_power;    // in W
+  uint32_t pos_rem_mws;  // not yet reported positive energy, < 1000 mWs
+  uint32_t neg_rem_mws;  // not yet reported negative energy, < 1000 mWs
+  uint64_t skipped_us;   // time not integrated due to too long gaps
+} inv_energy_integrator_t;
+
+// adds sample and returns energy integrated since the previous one in whole Ws
+void inv_energy_integrate(inv_energy_integrator_t *ei, int64_t now_us, int32_t power, uint64_t *pos_ws,
+                          uint64_t *neg_ws);
+void inv_energy_integrator_reset(inv_energy_integrator_t *ei);
+
+#endif /* INV_ENERGY_H */
@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#ifndef INV_ENERGY_RECONCILE_H
+#define INV_ENERGY_RECONCILE_H
+
+#include <stdint.h>
+
+// inverter's own PV energy counters
+typedef enum {
+  INV_ENERGY_COUNTER_TOTAL = 0, // QET, kWh
+  INV_ENERGY_COUNTER_YEAR,      // QEY, kWh
+  INV_ENERGY_COUNTER_MONTH,     // QEM, kWh
+  INV_ENERGY_COUNTER_DAY,       // QED, Wh
+  INV_ENERGY_COUNTER_HOUR,      // QEH, Wh
+  INV_ENERGY_COUNTERS_CNT
+} inv_energy_counter_t;
+
+/*
+ * Reconciles integrated PV energy with the inverter counters polled at low priority.
+ * Daily counter corrects drift: missing energy is added, excess is withheld from the following integration.
+ * Lifetime counter fills gaps longer than its 1kWh resolution (downtime spanning days).
+ * Observed drift is reported after every polling round.
+ */
+void inv_energy_reconcile_init(void);
+void inv_energy_reconcile_counter(inv_energy_counter_t counter, uint32_t value);
+// returns part of the integrated energy [Ws] to be counted, withholds excess found by reconciliation
+uint64_t inv_energy_reconcile_filter(uint64_t energy);
+
+#endif /* INV_ENERGY_RECONCILE_H */
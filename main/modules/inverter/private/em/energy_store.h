@@ -0,0 +1,28 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#ifndef INV_ENERGY_STORE_H
+#define INV_ENERGY_STORE_H
+
+#include <stdint.h>
+
+typedef enum {
+  INV_ENERGY_GRID_CONSUMED = 0,
+  INV_ENERGY_GRID_PROVIDED,
+  INV_ENERGY_AC_OUTPUT,
+  INV_ENERGY_PV,
+  INV_ENERGY_BATTERY_CHARGE,
+  INV_ENERGY_BATTERY_DISCHARGE,
+  INV_ENERGY_CHANNELS_CNT
+} inv_energy_channel_t;
+
+/*
+ * Cumulative energy counters. Running values live in RTC memory guarded by CRC so they
+ * survive software resets, flash checkpoints are limited by energy delta, time and daily budget.
+ */
+void inv_energy_store_init(void);
+void inv_energy_store_add(inv_energy_channel_t channel, uint64_t energy);
+uint64_t inv_energy_store_total(inv_energy_channel_t channel);
+
+#endif /* INV_ENERGY_STORE_H */
@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#ifndef INV_HISTORY_H
+#define INV_HISTORY_H
+
+#include "em/inverter.h"
+#include "em/rrd.h"
+
+#include <stdint.h>
+#include <time.h>
+
+typedef enum {
+  INV_HISTORY_TIER_MINUTE = 0, // 2 hours
+  INV_HISTORY_TIER_QUARTER,    // 7 days
+  INV_HISTORY_TIER_HOUR,       // 90 days
+  INV_HISTORY_TIER_DAY,        // 2 years
+  INV_HISTORY_TIERS_CNT
+} inv_history_tier_t;
+
+/*
+ * Power history of the power channels in tiered round-robin archives (sum, min, max, count per period),
+ * every tier is fed from the one below. Closed periods are kept in the "history" flash partition,
+ * so the footprint is fixed: 80kB of flash per channel and only the open periods in RAM.
+ * History is disabled when the partition is missing (device flashed with an older partition table).
+ */
+int inv_history_init(void);
+void inv_history_add(inv_channel_t channel, int32_t power, time_t now);
+
+// returns 0 when the period containing ts holds samples, -1 otherwise
+int inv_history_read(inv_channel_t channel, inv_history_tier_t tier, time_t ts, em_rrd_slot_t *slot);
+// periods of [from, to] holding samples, returns -1 when history is disabled or channel is not archived
+int inv_history_iter_init(em_rrd_iter_t *it, inv_channel_t channel, inv_history_tier_t tier, time_t from, time_t to);
+bool inv_history_iter_next(em_rrd_iter_t *it, em_rrd_slot_t *slot);
+// coarsest tier with step not longer than resolution_s which still keeps from
+inv_history_tier_t inv_history_select_tier(time_t from, uint32_t resolution_s);
+uint32_t inv_history_tier_step(inv_history_tier_t tier);
+
+#endif /* INV_HISTORY_H */
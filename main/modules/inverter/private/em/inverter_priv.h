@@ -11,22 +11,44 @@
 #include <time.h>
 #include "em/dataset.h"
 #include "em/serial_client.h"
+#include <sdkconfig.h>
+
+#define INV_MEAS_PERIOD_MS (15000u) // QPIGS samples fed to the measurement path
+#if CONFIG_EM_INVERTER_BURST_CAPTURE
+#define INV_QPIGS_POLL_MS CONFIG_EM_INVERTER_BURST_POLL_MS
+#else
+#define INV_QPIGS_POLL_MS INV_MEAS_PERIOD_MS
+#endif
 
 extern em_sc_t sc;
 
 int inv_id_handler(void *data, size_t data_len);
 int inv_fw_ver_handler(void *data, size_t data_len);
+int inv_rated_info_handler(void *data, size_t data_len);
+int inv_flags_handler(void *data, size_t data_len);
+int inv_max_charge_currents_handler(void *data, size_t data_len);
+int inv_max_utility_charge_currents_handler(void *data, size_t data_len);
+int inv_set_ack_handler(void *data, size_t data_len);
 int inv_model_handler(void *data, size_t data_len);
 int inv_meas_qpigs_handler(void *data, size_t data_len);
+int inv_meas_qpigs2_handler(void *data, size_t data_len);
 int inv_warning_flags_handler(void *data, size_t data_len);
 int inv_fault_handler(void *data, size_t data_len);
 int inv_mode_handler(void *data, size_t data_len);
+int inv_energy_total_handler(void *data, size_t data_len);
+int inv_energy_year_handler(void *data, size_t data_len);
+int inv_energy_month_handler(void *data, size_t data_len);
+int inv_energy_day_handler(void *data, size_t data_len);
+int inv_energy_hour_handler(void *data, size_t data_len);
 
-void inv_store_energy_meas();
+void inv_send_meas(void);
+void inv_snapshot_publish(void);
 void inv_set_meas_grid(uint16_t voltage, int16_t power, uint16_t freq);
-void inv_set_meas_battery(uint16_t voltage, int16_t power);
-void inv_set_meas_ac_out(uint16_t voltage, uint16_t power, uint16_t freq, uint8_t load, uint8_t power_factor);
-void inv_set_meas_pv(uint8_t idx, uint16_t voltage, uint16_t power);
+void inv_set_meas_battery(uint16_t voltage, int16_t power, uint8_t soc);
+void inv_set_meas_ac_out(uint16_t voltage, uint16_t power, uint16_t freq, uint8_t load, uint16_t power_factor);
+void inv_set_meas_pv(uint8_t idx, uint16_t voltage, uint16_t current, uint16_t power);
+// adds PV energy [Ws] found missing by reconciliation with the inverter counters
+void inv_add_energy_correction(uint64_t energy);
 void inv_set_status(uint32_t status_flags);
 void inv_set_warnings(uint64_t warning_flags);
 void inv_set_fault(uint32_t fault_code);
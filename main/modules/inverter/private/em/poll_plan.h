@@ -0,0 +1,21 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#ifndef INV_POLL_PLAN_H
+#define INV_POLL_PLAN_H
+
+#include "em/inverter.h"
+
+#include <stdint.h>
+
+/*
+ * Periodic serial commands of the inverter. The plan pushed by the server replaces all of them in one step
+ * of the serial client, request slots follow the priorities so the higher one goes first when both are due.
+ * Stored plan is restored at init, the default one is used when there is none.
+ */
+void inv_poll_plan_init(void);
+// poll interval of the command in ms, 0 when it is not polled
+uint32_t inv_poll_plan_interval(uint16_t cmd);
+
+#endif /* INV_POLL_PLAN_H */
@@ -0,0 +1,21 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#ifndef INV_POWER_STATS_H
+#define INV_POWER_STATS_H
+
+#include "em/inverter.h"
+
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * Quarter-hour power summaries: p5, p50, p95 (P² estimators) and peak per power channel.
+ * Quarters are aligned to wall-clock, the summary of the finished quarter is sent
+ * with the first sample of the next one. Samples are dropped until time is synchronized.
+ */
+void inv_power_stats_init(void);
+void inv_power_stats_add(inv_channel_t channel, int32_t power, time_t now);
+
+#endif /* INV_POWER_STATS_H */
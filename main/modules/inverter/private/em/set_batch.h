@@ -0,0 +1,19 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#ifndef INV_SET_BATCH_H
+#define INV_SET_BATCH_H
+
+#include <stdbool.h>
+
+/*
+ * Batch of setting commands from the server. Commands go out back to back from the scheduler callback,
+ * each one waits for its ACK or NAK. Settings cache entries changed by the batch are refreshed together
+ * and compared with the requests before the result vector is sent.
+ */
+void inv_set_batch_init(void);
+// response to the setting command in progress, called from the serial client task
+void inv_set_batch_ack(bool ack);
+
+#endif /* INV_SET_BATCH_H */
@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#ifndef INV_SETTINGS_CACHE_H
+#define INV_SETTINGS_CACHE_H
+
+#include "em/inverter.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * RAM cache of the inverter setting responses. Each setting has its own max age, expired ones are refreshed
+ * in the background one at a time so the serial line stays free for the measurements.
+ * Server requests are served from the cache or wait for the live read, SET commands invalidate what they change.
+ */
+void inv_settings_cache_init(void);
+// response text of the setting read from the inverter, called from the serial client task
+void inv_settings_cache_store(inv_setting_t setting, const char *text);
+// marks settings changed by the SET command as outdated, the read in progress is dropped
+void inv_settings_cache_invalidate(uint16_t set_cmd);
+// reads the setting from the inverter as soon as possible, without a server reply
+void inv_settings_cache_refresh(inv_setting_t setting);
+// copies the cached text, false when it was not read yet or was invalidated since
+bool inv_settings_cache_text(inv_setting_t setting, char *text, size_t text_len);
+
+#endif /* INV_SETTINGS_CACHE_H */
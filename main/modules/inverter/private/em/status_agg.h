@@ -0,0 +1,20 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#ifndef INV_STATUS_AGG_H
+#define INV_STATUS_AGG_H
+
+#include "em/inverter_defs.h"
+
+#include <time.h>
+
+/*
+ * Coalesces inverter status changes. First change opens a window, changes inside the window
+ * are merged and one status message is sent when it closes. Warning bits raised at any time
+ * in the window are kept in the seen mask even if they were cleared before the report.
+ */
+void inv_status_agg_init(void);
+void inv_status_agg_update(const inv_status_t *status, time_t now);
+
+#endif /* INV_STATUS_AGG_H */
@@ -0,0 +1,21 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#ifndef INV_WARM_CACHE_H
+#define INV_WARM_CACHE_H
+
+#include "em/inverter_defs.h"
+
+#include <stdbool.h>
+
+/*
+ * Last published measurements, status and identity of the inverter. Kept in RTC memory guarded by CRC so they
+ * survive software resets, RAM copy in the storage gets to flash with the shutdown dump for power cycles.
+ * Restored values are only shown until the inverter answers, they never feed deadbands nor energy integrators.
+ */
+// fills measurements, status and info of the snapshot, false when nothing was stored
+bool inv_warm_cache_restore(inv_snapshot_t *out);
+void inv_warm_cache_save(const inv_snapshot_t *snapshot);
+
+#endif /* INV_WARM_CACHE_H */
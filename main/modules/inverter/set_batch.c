@@ -0,0 +1,457 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#include "em/set_batch.h"
+#include "em/charge_plan.h"
+#include "em/fixed.h"
+#include "em/inverter.h"
+#include "em/inverter_priv.h"
+#include "em/protocol.h"
+#include "em/rs232_2400_protocol.h"
+#include "em/scheduler.h"
+#include "em/settings_cache.h"
+
+#include <assert.h>
+#include <ctype.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <esp_err.h>
+#include <esp_macros.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+
+#include <esp_log.h>
+#define LOG_TAG "INV_SET"
+
+#define ITEM_TIMEOUT_MS      (2000u)
+#define ITEM_RETRIES         (1u)    // settings are absolute, repeating one is harmless
+#define ITEM_DEADLINE_MS     (7000u) // retries and requests queued before the command
+#define READBACK_DEADLINE_MS (12000u)
+#define READBACK_POLL_MS     (500u)
+#define SEND_RETRY_MS        (1000u) // buffer pool exhausted, connection down or serial client queue full
+#define SEND_RETRIES         (3u)
+#define US_IN_MS             (1000LL)
+
+typedef enum {
+  BATCH_IDLE = 0,
+  BATCH_LOADING,   // claimed by the caller, commands being copied
+  BATCH_SENDING,   // commands go out one after another
+  BATCH_READBACK,  // waiting for the settings cache refresh
+  BATCH_REPORTING, // result vector not sent yet
+} batch_state_t;
+
+typedef struct {
+  uint16_t id;
+  uint16_t items_num;
+  uint16_t current;    // command in progress
+  bool awaiting;       // current command sent, response not received yet
+  uint8_t send_failures; // of the current command
+  int64_t deadline_us; // of the response or the read-back
+  uint32_t readback;   // settings read back, bit per inv_setting_t
+  uint16_t cmds[INV_SET_BATCH_MAX_ITEMS];
+  uint8_t lens[INV_SET_BATCH_MAX_ITEMS];
+  char items[INV_SET_BATCH_MAX_ITEMS][INV_SET_ITEM_MAX_LEN];
+  uint8_t results[INV_SET_BATCH_MAX_ITEMS];
+  batch_state_t state;
+} batch_t;
+
+// filled by the dispatcher while idle, then stepped by the scheduler callback and the serial client task
+static batch_t batch = {0};
+static portMUX_TYPE batch_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// commands read back through QPIRI, the value is taken from the last characters of the command text
+typedef struct {
+  uint16_t cmd;
+  uint8_t arg_len;  // e.g. 3 for "MCHGC040", a leading parallel machine digit is not part of it
+  uint8_t decimals;
+  size_t offset;    // of the field in qpiri_settings_t
+} qpiri_cmd_def_t;
+
+static const qpiri_cmd_def_t qpiri_cmds[] = {
+  {.cmd = EM_RS232_2400_MCHGC, .arg_len = 3, .decimals = 0, .offset = offsetof(qpiri_settings_t, max_charging_current)},
+  {.cmd = EM_RS232_2400_MUCHGC, .arg_len = 3, .decimals = 0,
+   .offset = offsetof(qpiri_settings_t, max_ac_charging_current)},
+  {.cmd = EM_RS232_2400_POP, .arg_len = 2, .decimals = 0, .offset = offsetof(qpiri_settings_t, output_source_priority)},
+  {.cmd = EM_RS232_2400_PCP, .arg_len = 2, .decimals = 0, .offset = offsetof(qpiri_settings_t, charger_source_priority)},
+  {.cmd = EM_RS232_2400_PBCV, .arg_len = 4, .decimals = 1,
+   .offset = offsetof(qpiri_settings_t, battery_recharge_voltage)},
+  {.cmd = EM_RS232_2400_PBDV, .arg_len = 4, .decimals = 1,
+   .offset = offsetof(qpiri_settings_t, battery_redischarge_voltage)},
+  {.cmd = EM_RS232_2400_PSDV, .arg_len = 4, .decimals = 1, .offset = offsetof(qpiri_settings_t, battery_under_voltage)},
+};
+
+static const qpiri_cmd_def_t *find_qpiri_cmd(uint16_t cmd)
+{
+  for (size_t i = 0; i < sizeof(qpiri_cmds) / sizeof(qpiri_cmds[0]); i++) {
+    if (qpiri_cmds[i].cmd == cmd) {
+      return &qpiri_cmds[i];
+    }
+  }
+
+  return NULL;
+}
+
+// setting which reports the command back in a form comparable with it, INV_SETTINGS_CNT when none does
+static inv_setting_t readback_setting(uint16_t cmd)
+{
+  if (cmd == EM_RS232_2400_PE || cmd == EM_RS232_2400_PD) {
+    return INV_SETTING_FLAGS;
+  }
+
+  return find_qpiri_cmd(cmd) != NULL ? INV_SETTING_RATED_INFO : INV_SETTINGS_CNT;
+}
+
+// commands after the current one are not sent, called with the lock held
+static void skip_rest(void)
+{
+  for (uint16_t i = batch.current; i < batch.items_num; i++) {
+    batch.results[i] = INV_SET_NOT_SENT;
+  }
+
+  batch.current = batch.items_num;
+}
+
+// "PEab" / "PDab" against QFLAG "ExxxDxxx", flag letters are compared case insensitive
+static inv_set_result_t verify_flags(const char *item, uint8_t item_len, const char *flags)
+{
+  bool enable = item[1] == 'E';
+
+  for (uint8_t i = 2; i < item_len; i++) {
+    bool section_enabled = false;
+    bool found = false;
+
+    for (const char *c = flags; *c != '\0'; c++) {
+      if (*c == 'E' || *c == 'D') {
+        section_enabled = *c == 'E';
+      } else if (tolower((unsigned char)*c) == tolower((unsigned char)item[i])) {
+        found = true;
+        break;
+      }
+    }
+
+    if (!found || section_enabled != enable) {
+      return INV_SET_MISMATCH;
+    }
+  }
+
+  return INV_SET_VERIFIED;
+}
+
+// "MCHGC040", "PBCV44.0" etc. against the QPIRI field
+static inv_set_result_t verify_qpiri(const char *item, uint8_t item_len, const qpiri_cmd_def_t *def,
+                                     const qpiri_settings_t *settings)
+{
+  size_t prefix_len = 0;
+
+  while (prefix_len < item_len && item[prefix_len] >= 'A' && item[prefix_len] <= 'Z') {
+    prefix_len++;
+  }
+
+  if (item_len < prefix_len + def->arg_len) {
+    return INV_SET_UNVERIFIED;
+  }
+
+  size_t arg_start = (size_t)item_len - def->arg_len;
+
+  // QPIRI reports the unit it was read from, other machines of a parallel system are not verified
+  for (size_t i = prefix_len; i < arg_start; i++) {
+    if (item[i] != '0') {
+      return INV_SET_ACKED;
+    }
+  }
+
+  int32_t value = 0;
+
+  if (!em_fixed_parse(&item[arg_start], def->arg_len, def->decimals, &value)) {
+    return INV_SET_UNVERIFIED;
+  }
+
+  uint16_t reported = 0;
+  memcpy(&reported, (const uint8_t *)settings + def->offset, sizeof(reported));
+  return value == reported ? INV_SET_VERIFIED : INV_SET_MISMATCH;
+}
+
+static void verify(void)
+{
+  char flags[RS232_2400_TEXT_RSP_MAX_LEN];
+  bool flags_valid = (batch.readback & (1u << INV_SETTING_FLAGS)) &&
+                     inv_settings_cache_text(INV_SETTING_FLAGS, flags, sizeof(flags));
+
+  char rated_info[RS232_2400_TEXT_RSP_MAX_LEN];
+  bool rated_info_valid = (batch.readback & (1u << INV_SETTING_RATED_INFO)) &&
+                          inv_settings_cache_text(INV_SETTING_RATED_INFO, rated_info, sizeof(rated_info));
+  qpiri_settings_t settings = {0};
+  bool settings_reported = rated_info_valid && rs232_2400_qpiri_settings(rated_info, &settings) == 0;
+
+  for (uint16_t i = 0; i < batch.items_num; i++) {
+    if (batch.results[i] != INV_SET_ACKED) {
+      continue;
+    }
+
+    switch (readback_setting(batch.cmds[i])) {
+    case INV_SETTING_FLAGS:
+      batch.results[i] = flags_valid ? verify_flags(batch.items[i], batch.lens[i], flags) : INV_SET_UNVERIFIED;
+      break;
+    case INV_SETTING_RATED_INFO:
+      // models with the short QPIRI response don't report the settings, the ACK is all there is
+      if (!rated_info_valid) {
+        batch.results[i] = INV_SET_UNVERIFIED;
+      } else if (settings_reported) {
+        batch.results[i] = verify_qpiri(batch.items[i], batch.lens[i], find_qpiri_cmd(batch.cmds[i]), &settings);
+      }
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+static void step_handler(uint32_t param, void *usr_ctx);
+
+static void send_step(int64_t now_us)
+{
+  taskENTER_CRITICAL(&batch_lock);
+  if (batch.awaiting && now_us >= batch.deadline_us) {
+    batch.awaiting = false;
+    batch.send_failures = 0;
+    batch.results[batch.current++] = INV_SET_TIMEOUT;
+    skip_rest();
+  }
+
+  bool awaiting = batch.awaiting;
+  bool sent_all = !awaiting && batch.current >= batch.items_num;
+  uint16_t current = batch.current;
+
+  if (!awaiting && !sent_all) {
+    batch.awaiting = true;
+    batch.deadline_us = now_us + ITEM_DEADLINE_MS * US_IN_MS;
+  } else if (sent_all) {
+    batch.readback = 0;
+
+    for (uint16_t i = 0; i < batch.items_num; i++) {
+      inv_setting_t setting = readback_setting(batch.cmds[i]);
+
+      if (batch.results[i] == INV_SET_ACKED && setting < INV_SETTINGS_CNT) {
+        batch.readback |= 1u << setting;
+      }
+    }
+
+    batch.state = batch.readback != 0 ? BATCH_READBACK : BATCH_REPORTING;
+    batch.deadline_us = now_us + READBACK_DEADLINE_MS * US_IN_MS;
+  }
+  taskEXIT_CRITICAL(&batch_lock);
+
+  if (awaiting) {
+    scheduler_set_callback(step_handler, SCH_PARAM_NONE, SCH_CTX_NONE,
+                           (uint32_t)((batch.deadline_us - now_us) / US_IN_MS));
+    return;
+  }
+
+  if (sent_all) {
+    for (uint32_t i = 0; i < INV_SETTINGS_CNT; i++) {
+      if (batch.readback & (1u << i)) {
+        inv_settings_cache_refresh(i);
+      }
+    }
+
+    scheduler_set_callback(step_handler, SCH_PARAM_NONE, SCH_CTX_NONE,
+                           batch.readback != 0 ? READBACK_POLL_MS : SCH_NO_DELAY);
+    return;
+  }
+
+  // deadline first, the response may come before this returns
+  scheduler_set_callback(step_handler, SCH_PARAM_NONE, SCH_CTX_NONE, ITEM_DEADLINE_MS);
+
+  if (em_sc_send(&sc, batch.cmds[current], (const uint8_t *)batch.items[current], batch.lens[current],
+                 ITEM_TIMEOUT_MS, ITEM_RETRIES) == 0) {
+    return;
+  }
+
+  ESP_LOGW(LOG_TAG, "Send %.*s failed", batch.lens[current], batch.items[current]);
+
+  // not queued, so nothing answers it, sent again or given up without waiting for the deadline
+  taskENTER_CRITICAL(&batch_lock);
+  batch.awaiting = false;
+  bool give_up = ++batch.send_failures > SEND_RETRIES;
+
+  if (give_up) {
+    batch.send_failures = 0;
+    batch.results[batch.current++] = INV_SET_SEND_FAILED;
+    skip_rest();
+  }
+  taskEXIT_CRITICAL(&batch_lock);
+
+  scheduler_set_callback(step_handler, SCH_PARAM_NONE, SCH_CTX_NONE, give_up ? SCH_NO_DELAY : SEND_RETRY_MS);
+}
+
+static void readback_step(int64_t now_us)
+{
+  char text[RS232_2400_TEXT_RSP_MAX_LEN];
+  bool done = true;
+
+  for (uint32_t i = 0; i < INV_SETTINGS_CNT; i++) {
+    if ((batch.readback & (1u << i)) && !inv_settings_cache_text(i, text, sizeof(text))) {
+      done = false;
+    }
+  }
+
+  if (!done && now_us < batch.deadline_us) {
+    scheduler_set_callback(step_handler, SCH_PARAM_NONE, SCH_CTX_NONE, READBACK_POLL_MS);
+    return;
+  }
+
+  verify();
+
+  taskENTER_CRITICAL(&batch_lock);
+  batch.state = BATCH_REPORTING;
+  taskEXIT_CRITICAL(&batch_lock);
+
+  scheduler_set_callback(step_handler, SCH_PARAM_NONE, SCH_CTX_NONE, SCH_NO_DELAY);
+}
+
+static bool batch_succeeded(void)
+{
+  for (uint16_t i = 0; i < batch.items_num; i++) {
+    if (batch.results[i] != INV_SET_VERIFIED && batch.results[i] != INV_SET_ACKED) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void report_step(void)
+{
+  bool charge_plan = batch.id == INV_SET_BATCH_ID_CHARGE_PLAN;
+  int ret = protocol_send_inverter_set_result(batch.id, batch.results, batch.items_num);
+
+  // the charge plan runs without the server, its result is reported only when possible
+  if (ret != ESP_OK && !charge_plan) {
+    ESP_LOGW(LOG_TAG, "Send result err=%d", ret);
+    scheduler_set_callback(step_handler, SCH_PARAM_NONE, SCH_CTX_NONE, SEND_RETRY_MS);
+    return;
+  }
+
+  bool success = batch_succeeded();
+  ESP_LOGI(LOG_TAG, "Batch %u done%s", batch.id, success ? "" : ", failed");
+
+  taskENTER_CRITICAL(&batch_lock);
+  batch.state = BATCH_IDLE;
+  taskEXIT_CRITICAL(&batch_lock);
+
+  if (charge_plan) {
+    inv_charge_plan_batch_done(success);
+  }
+}
+
+static void step_handler(uint32_t param, void *usr_ctx)
+{
+  ESP_UNUSED(param);
+  ESP_UNUSED(usr_ctx);
+
+  taskENTER_CRITICAL(&batch_lock);
+  batch_state_t state = batch.state;
+  taskEXIT_CRITICAL(&batch_lock);
+
+  int64_t now_us = esp_timer_get_time();
+
+  switch (state) {
+  case BATCH_SENDING:
+    send_step(now_us);
+    break;
+  case BATCH_READBACK:
+    readback_step(now_us);
+    break;
+  case BATCH_REPORTING:
+    report_step();
+    break;
+  default:
+    break;
+  }
+}
+
+void inv_set_batch_init(void)
+{
+  memset(&batch, 0, sizeof(batch));
+}
+
+void inv_set_batch_ack(bool ack)
+{
+  uint16_t cmd = EM_RS232_2400_NONE;
+
+  taskENTER_CRITICAL(&batch_lock);
+  bool expected = batch.state == BATCH_SENDING && batch.awaiting;
+
+  if (expected) {
+    batch.awaiting = false;
+    batch.send_failures = 0;
+    cmd = batch.cmds[batch.current];
+    batch.results[batch.current++] = ack ? INV_SET_ACKED : INV_SET_REJECTED;
+
+    if (!ack) {
+      skip_rest();
+    }
+  }
+  taskEXIT_CRITICAL(&batch_lock);
+
+  if (!expected) {
+    ESP_LOGW(LOG_TAG, "Unexpected %s", ack ? "ACK" : "NAK");
+    return;
+  }
+
+  if (ack) {
+    inv_settings_cache_invalidate(cmd);
+  }
+
+  scheduler_set_callback(step_handler, SCH_PARAM_NONE, SCH_CTX_NONE, SCH_NO_DELAY);
+}
+
+int inv_set_batch(uint16_t id, const char *const *items, const uint8_t *items_len, uint16_t items_num)
+{
+  assert(items != NULL);
+  assert(items_len != NULL);
+
+  if (items_num == 0 || items_num > INV_SET_BATCH_MAX_ITEMS) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  // the dispatcher and the charge plan start batches from different tasks
+  taskENTER_CRITICAL(&batch_lock);
+  bool idle = batch.state == BATCH_IDLE;
+  if (idle) {
+    batch.state = BATCH_LOADING;
+  }
+  taskEXIT_CRITICAL(&batch_lock);
+
+  if (!idle) {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  // other tasks don't touch a loading batch
+  bool valid = true;
+  batch.id = id;
+  batch.items_num = items_num;
+  batch.current = 0;
+  batch.awaiting = false;
+  batch.send_failures = 0;
+
+  for (uint16_t i = 0; i < items_num; i++) {
+    uint8_t len = items_len[i] < INV_SET_ITEM_MAX_LEN ? items_len[i] : INV_SET_ITEM_MAX_LEN;
+    memcpy(batch.items[i], items[i], len);
+    batch.lens[i] = len;
+    batch.cmds[i] = len == items_len[i] ? rs232_2400_set_cmd((const uint8_t *)items[i], len) : EM_RS232_2400_NONE;
+    batch.results[i] = batch.cmds[i] != EM_RS232_2400_NONE ? INV_SET_NOT_SENT : INV_SET_INVALID;
+    valid &= batch.cmds[i] != EM_RS232_2400_NONE;
+  }
+
+  ESP_LOGI(LOG_TAG, "Batch %u, %u commands%s", id, items_num, valid ? "" : ", invalid");
+
+  taskENTER_CRITICAL(&batch_lock);
+  batch.state = valid ? BATCH_SENDING : BATCH_REPORTING;
+  taskEXIT_CRITICAL(&batch_lock);
+
+  scheduler_set_callback(step_handler, SCH_PARAM_NONE, SCH_CTX_NONE, SCH_NO_DELAY);
+  return ESP_OK;
+}
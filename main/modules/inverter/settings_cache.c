@@ -0,0 +1,318 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#include "em/settings_cache.h"
+#include "em/inverter_priv.h"
+#include "em/protocol.h"
+#include "em/rs232_2400_protocol.h"
+#include "em/scheduler.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+#include <esp_err.h>
+#include <esp_macros.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+
+#include <esp_log.h>
+#define LOG_TAG "INV_SETTINGS"
+
+#define FIRST_REFRESH_MS    (90000u) // identification and first measurements go first
+#define REFRESH_INTERVAL_MS (60000u) // one expired setting per interval
+#define READ_TIMEOUT_MS     (2000u)
+#define READ_RETRIES        (2u)
+#define READ_DEADLINE_MS    (8000u) // retries and requests queued before the read
+#define US_IN_MS            (1000LL)
+#define US_IN_S             (1000000LL)
+#define S_IN_H              (3600u)
+
+typedef struct {
+  uint16_t cmd;
+  const char *rq;
+  uint32_t max_age_s; // background refresh period
+} setting_def_t;
+
+typedef struct {
+  char text[RS232_2400_TEXT_RSP_MAX_LEN];
+  uint16_t len;       // 0 - never read
+  int64_t time_us;    // esp_timer time of the response
+  int64_t read_us;    // esp_timer time the read was started
+  bool valid;         // not expired by a SET command
+  bool reading;
+  bool dropped;       // invalidated during the read, the response may predate the change
+  bool reply_pending; // server waits for the live value
+  bool read_pending;  // live value requested without a reply
+} setting_entry_t;
+
+static const setting_def_t defs[INV_SETTINGS_CNT] = {
+  [INV_SETTING_RATED_INFO] = {.cmd = EM_RS232_2400_QPIRI, .rq = "QPIRI", .max_age_s = 6 * S_IN_H},
+  [INV_SETTING_FLAGS] = {.cmd = EM_RS232_2400_QFLAG, .rq = "QFLAG", .max_age_s = 1 * S_IN_H},
+  [INV_SETTING_FW_VERSION] = {.cmd = EM_RS232_2400_QVFW, .rq = "QVFW", .max_age_s = 24 * S_IN_H},
+  [INV_SETTING_MAX_CHARGE_CURRENTS] = {.cmd = EM_RS232_2400_QMCHGCR, .rq = "QMCHGCR", .max_age_s = 6 * S_IN_H},
+  [INV_SETTING_MAX_UTILITY_CHARGE_CURRENTS] = {.cmd = EM_RS232_2400_QMUCHGCR, .rq = "QMUCHGCR",
+                                               .max_age_s = 6 * S_IN_H},
+};
+
+// written by the serial client task, the scheduler callback and the dispatcher
+static setting_entry_t entries[INV_SETTINGS_CNT];
+static portMUX_TYPE entries_lock = portMUX_INITIALIZER_UNLOCKED;
+static int64_t next_refresh_us = 0;
+
+static void service_handler(uint32_t param, void *usr_ctx);
+
+static bool is_fresh(const setting_entry_t *entry, uint32_t max_age_s, int64_t now_us)
+{
+  return entry->valid && entry->len > 0 && now_us - entry->time_us <= (int64_t)max_age_s * US_IN_S;
+}
+
+static void send_setting(inv_setting_t setting, const setting_entry_t *copy, bool stale)
+{
+  uint32_t age_s = (uint32_t)((esp_timer_get_time() - copy->time_us) / US_IN_S);
+  int ret = protocol_send_inverter_setting(setting, age_s, stale, copy->text, copy->len);
+
+  if (ret != ESP_OK) {
+    // server repeats the request
+    ESP_LOGW(LOG_TAG, "Send setting %d err=%d", setting, ret);
+  }
+}
+
+static void start_read(inv_setting_t setting)
+{
+  if (em_sc_send(&sc, defs[setting].cmd, (const uint8_t *)defs[setting].rq, strlen(defs[setting].rq), READ_TIMEOUT_MS,
+                 READ_RETRIES) != 0) {
+    ESP_LOGW(LOG_TAG, "Send %s failed", defs[setting].rq);
+  }
+}
+
+static void service_handler(uint32_t param, void *usr_ctx)
+{
+  ESP_UNUSED(param);
+  ESP_UNUSED(usr_ctx);
+
+  int64_t now_us = esp_timer_get_time();
+  bool timed_out[INV_SETTINGS_CNT] = {false};
+  bool start[INV_SETTINGS_CNT] = {false};
+  bool reading = false;
+
+  taskENTER_CRITICAL(&entries_lock);
+  for (uint32_t i = 0; i < INV_SETTINGS_CNT; i++) {
+    setting_entry_t *entry = &entries[i];
+
+    if (entry->reading && now_us - entry->read_us >= READ_DEADLINE_MS * US_IN_MS) {
+      entry->reading = false;
+      timed_out[i] = entry->reply_pending;
+      entry->reply_pending = false;
+      entry->read_pending = false;
+    }
+
+    // waiting server goes first
+    if (!entry->reading && (entry->reply_pending || entry->read_pending)) {
+      start[i] = true;
+    }
+  }
+
+  bool background = now_us >= next_refresh_us;
+
+  if (background) {
+    next_refresh_us = now_us + REFRESH_INTERVAL_MS * US_IN_MS;
+
+    for (uint32_t i = 0; i < INV_SETTINGS_CNT; i++) {
+      if (!entries[i].reading && !start[i] && !is_fresh(&entries[i], defs[i].max_age_s, now_us)) {
+        start[i] = true;
+        break;
+      }
+    }
+  }
+
+  for (uint32_t i = 0; i < INV_SETTINGS_CNT; i++) {
+    if (start[i]) {
+      entries[i].reading = true;
+      entries[i].dropped = false;
+      entries[i].read_us = now_us;
+    }
+
+    reading |= entries[i].reading;
+  }
+  taskEXIT_CRITICAL(&entries_lock);
+
+  for (uint32_t i = 0; i < INV_SETTINGS_CNT; i++) {
+    if (timed_out[i]) {
+      setting_entry_t copy;
+      taskENTER_CRITICAL(&entries_lock);
+      copy = entries[i];
+      taskEXIT_CRITICAL(&entries_lock);
+
+      if (copy.len > 0) {
+        ESP_LOGW(LOG_TAG, "%s timeout, stale value sent", defs[i].rq);
+        send_setting(i, &copy, true);
+      } else {
+        ESP_LOGW(LOG_TAG, "%s timeout", defs[i].rq);
+        protocol_send_status(MSGTYPE_GET, (uint8_t)ESP_ERR_TIMEOUT); // truncated as in the receiver
+      }
+    }
+
+    if (start[i]) {
+      start_read(i);
+    }
+  }
+
+  int64_t delay_us = reading ? READ_DEADLINE_MS * US_IN_MS : next_refresh_us - now_us;
+  scheduler_set_callback(service_handler, SCH_PARAM_NONE, SCH_CTX_NONE, (uint32_t)(delay_us / US_IN_MS));
+}
+
+void inv_settings_cache_init(void)
+{
+  memset(entries, 0, sizeof(entries));
+  next_refresh_us = esp_timer_get_time() + FIRST_REFRESH_MS * US_IN_MS;
+  scheduler_set_callback(service_handler, SCH_PARAM_NONE, SCH_CTX_NONE, FIRST_REFRESH_MS);
+}
+
+void inv_settings_cache_store(inv_setting_t setting, const char *text)
+{
+  assert(setting < INV_SETTINGS_CNT);
+  assert(text != NULL);
+
+  size_t len = strnlen(text, RS232_2400_TEXT_RSP_MAX_LEN - 1);
+  setting_entry_t copy = {0};
+  bool reply = false;
+
+  taskENTER_CRITICAL(&entries_lock);
+  setting_entry_t *entry = &entries[setting];
+  bool dropped = entry->dropped;
+  entry->reading = false;
+  entry->dropped = false;
+
+  if (!dropped) {
+    memcpy(entry->text, text, len);
+    entry->text[len] = '\0';
+    entry->len = (uint16_t)len;
+    entry->time_us = esp_timer_get_time();
+    entry->valid = true;
+    reply = entry->reply_pending;
+    entry->reply_pending = false;
+    entry->read_pending = false;
+    copy = *entry;
+  }
+  taskEXIT_CRITICAL(&entries_lock);
+
+  if (dropped) {
+    // pending reply gets the value read after the change
+    ESP_LOGI(LOG_TAG, "%s dropped, changed during the read", defs[setting].rq);
+  } else if (reply) {
+    send_setting(setting, &copy, false);
+  }
+
+  scheduler_set_callback(service_handler, SCH_PARAM_NONE, SCH_CTX_NONE, SCH_NO_DELAY);
+}
+
+void inv_settings_cache_invalidate(uint16_t set_cmd)
+{
+  uint32_t mask = 0;
+
+  switch (set_cmd) {
+  case EM_RS232_2400_PE:
+  case EM_RS232_2400_PD:
+    mask = 1u << INV_SETTING_FLAGS;
+    break;
+  case EM_RS232_2400_PF:
+    mask = (1u << INV_SETTINGS_CNT) - 1u;
+    break;
+  case EM_RS232_2400_POP:
+  case EM_RS232_2400_PBCV:
+  case EM_RS232_2400_PBDV:
+  case EM_RS232_2400_PCP:
+  case EM_RS232_2400_PGR:
+  case EM_RS232_2400_PBT:
+  case EM_RS232_2400_PSDV:
+  case EM_RS232_2400_PCVV:
+  case EM_RS232_2400_PBFT:
+  case EM_RS232_2400_OPMP:
+  case EM_RS232_2400_MCHGC:
+  case EM_RS232_2400_MCHGV:
+  case EM_RS232_2400_BCHGV:
+  case EM_RS232_2400_BSDV:
+  case EM_RS232_2400_DSUBV:
+  case EM_RS232_2400_PRIO:
+  case EM_RS232_2400_LBF:
+  case EM_RS232_2400_MUCHGC:
+    mask = 1u << INV_SETTING_RATED_INFO;
+    break;
+  default:
+    return; // not reflected in the cached settings
+  }
+
+  taskENTER_CRITICAL(&entries_lock);
+  for (uint32_t i = 0; i < INV_SETTINGS_CNT; i++) {
+    if (mask & (1u << i)) {
+      entries[i].valid = false;
+      entries[i].dropped = entries[i].reading;
+    }
+  }
+  taskEXIT_CRITICAL(&entries_lock);
+}
+
+void inv_settings_cache_refresh(inv_setting_t setting)
+{
+  assert(setting < INV_SETTINGS_CNT);
+
+  taskENTER_CRITICAL(&entries_lock);
+  entries[setting].read_pending = true;
+  taskEXIT_CRITICAL(&entries_lock);
+
+  scheduler_set_callback(service_handler, SCH_PARAM_NONE, SCH_CTX_NONE, SCH_NO_DELAY);
+}
+
+bool inv_settings_cache_text(inv_setting_t setting, char *text, size_t text_len)
+{
+  assert(setting < INV_SETTINGS_CNT);
+  assert(text != NULL);
+  assert(text_len > 0);
+
+  taskENTER_CRITICAL(&entries_lock);
+  const setting_entry_t *entry = &entries[setting];
+  bool valid = entry->valid && entry->len > 0;
+
+  if (valid) {
+    size_t len = entry->len < text_len ? entry->len : text_len - 1;
+    memcpy(text, entry->text, len);
+    text[len] = '\0';
+  }
+  taskEXIT_CRITICAL(&entries_lock);
+
+  return valid;
+}
+
+int inv_setting_get(uint8_t setting, uint32_t max_age_s)
+{
+  if (setting >= INV_SETTINGS_CNT) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  if (max_age_s > defs[setting].max_age_s) {
+    max_age_s = defs[setting].max_age_s;
+  }
+
+  setting_entry_t copy = {0};
+  int64_t now_us = esp_timer_get_time();
+
+  taskENTER_CRITICAL(&entries_lock);
+  bool fresh = is_fresh(&entries[setting], max_age_s, now_us);
+
+  if (fresh) {
+    copy = entries[setting];
+  } else {
+    entries[setting].reply_pending = true;
+  }
+  taskEXIT_CRITICAL(&entries_lock);
+
+  if (fresh) {
+    send_setting(setting, &copy, false);
+    return ESP_OK;
+  }
+
+  ESP_LOGI(LOG_TAG, "%s read for the server", defs[setting].rq);
+  scheduler_set_callback(service_handler, SCH_PARAM_NONE, SCH_CTX_NONE, SCH_NO_DELAY);
+  return ESP_OK;
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#include "em/status_agg.h"
+#include "em/protocol.h"
+#include "em/scheduler.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+#include <esp_macros.h>
+#include <freertos/FreeRTOS.h>
+#include <sdkconfig.h>
+
+#include <esp_log.h>
+#define LOG_TAG "INV_STAT"
+
+typedef struct {
+  inv_status_t last;       // latest state, kept between windows to detect toggled bits
+  uint64_t warnings_seen;  // warning bits raised in the window
+  uint32_t status_toggled; // status bits changed in the window
+  uint16_t changes;
+  time_t first_ts;
+  time_t last_ts;
+  bool open;
+} status_window_t;
+
+static status_window_t window = {0};
+static portMUX_TYPE window_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void window_close_handler(uint32_t param, void *user_ctx)
+{
+  ESP_UNUSED(param);
+  ESP_UNUSED(user_ctx);
+
+  taskENTER_CRITICAL(&window_lock);
+  status_window_t closed = window;
+  taskEXIT_CRITICAL(&window_lock);
+
+  if (!closed.open) {
+    return;
+  }
+
+  ESP_LOGI(LOG_TAG, "Changes=%d mode=%c warnings=%llx seen=%llx", closed.changes, (char)closed.last.mode,
+           closed.last.warning_flags, closed.warnings_seen);
+
+  int ret = protocol_send_inverter_status(closed.first_ts, closed.last_ts, closed.last.mode, closed.last.status_flags,
+                                          closed.status_toggled, closed.last.warning_flags, closed.warnings_seen,
+                                          closed.last.fault_code, closed.changes);
+
+  if (ret != 0) {
+    // window stays open and collects changes until the retry
+    ESP_LOGW(LOG_TAG, "Send status err=%d", ret);
+    scheduler_set_callback(window_close_handler, SCH_PARAM_NONE, SCH_CTX_NONE, CONFIG_EM_INVERTER_STATUS_COALESCE_MS);
+    return;
+  }
+
+  bool reopen = false;
+
+  taskENTER_CRITICAL(&window_lock);
+  if (window.changes == closed.changes) {
+    window.open = false;
+    window.warnings_seen = 0;
+    window.status_toggled = 0;
+    window.changes = 0;
+  } else {
+    // changed while sending, report these changes in the next window, masks may repeat already sent bits
+    window.changes -= closed.changes;
+    window.first_ts = closed.last_ts;
+    reopen = true;
+  }
+  taskEXIT_CRITICAL(&window_lock);
+
+  if (reopen) {
+    scheduler_set_callback(window_close_handler, SCH_PARAM_NONE, SCH_CTX_NONE, CONFIG_EM_INVERTER_STATUS_COALESCE_MS);
+  }
+}
+
+void inv_status_agg_init(void)
+{
+  taskENTER_CRITICAL(&window_lock);
+  memset(&window, 0, sizeof(window));
+  taskEXIT_CRITICAL(&window_lock);
+}
+
+void inv_status_agg_update(const inv_status_t *status, time_t now)
+{
+  assert(status);
+
+  taskENTER_CRITICAL(&window_lock);
+  bool opened = !window.open;
+
+  if (opened) {
+    window.open = true;
+    window.first_ts = now;
+  }
+
+  window.status_toggled |= window.last.status_flags ^ status->status_flags;
+  window.warnings_seen |= status->warning_flags;
+  window.last = *status;
+  window.last_ts = now;
+  window.changes++;
+  taskEXIT_CRITICAL(&window_lock);
+
+  if (opened) {
+    scheduler_set_callback(window_close_handler, SCH_PARAM_NONE, SCH_CTX_NONE, CONFIG_EM_INVERTER_STATUS_COALESCE_MS);
+  }
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#include "em/warm_cache.h"
+#include "em/storage.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <esp_attr.h>
+#include <esp_rom_crc.h>
+
+#include <esp_log.h>
+#define LOG_TAG "INV_WARM"
+
+#define RTC_MAGIC (0x49535454UL) // "ISTT"
+
+_Static_assert(sizeof(((storage_inv_state_t *)0)->model) == sizeof(((inv_info_t *)0)->model),
+               "Model doesn't fit the storage");
+
+typedef struct {
+  uint32_t magic;
+  storage_inv_state_t state;
+  uint32_t crc;
+} rtc_state_t;
+
+// not initialized on software reset, content is valid only with matching magic and CRC
+static RTC_NOINIT_ATTR rtc_state_t rtc_state;
+
+static uint32_t rtc_crc(void)
+{
+  return esp_rom_crc32_le(0, (const uint8_t *)&rtc_state, offsetof(rtc_state_t, crc));
+}
+
+static void to_state(const inv_snapshot_t *s, storage_inv_state_t *out)
+{
+  memset(out, 0, sizeof(*out));
+  out->timestamp = s->grid.timestamp;
+  out->grid_voltage = s->grid.voltage;
+  out->grid_power = s->grid.power;
+  out->grid_freq = s->grid.freq;
+  out->battery_voltage = s->battery.voltage;
+  out->battery_charge_power = s->battery.charge_power;
+  out->ac_out_voltage = s->ac_output.voltage;
+  out->ac_out_power = s->ac_output.power;
+  out->ac_out_freq = s->ac_output.freq;
+  out->ac_out_load = s->ac_output.output_load;
+  out->ac_out_power_factor = s->ac_output.power_factor;
+  out->pv_voltage = s->pv.voltage;
+  out->pv_power = s->pv.power;
+  out->mode = s->status.mode;
+  out->status_flags = s->status.status_flags;
+  out->warning_flags = s->status.warning_flags;
+  out->fault_code = s->status.fault_code;
+  out->fw_ver = s->info.fw_ver;
+  out->protocol_ver = s->info.protocol_ver;
+  memcpy(out->model, s->info.model, sizeof(out->model));
+}
+
+static void from_state(const storage_inv_state_t *in, inv_snapshot_t *out)
+{
+  time_t timestamp = (time_t)in->timestamp;
+
+  out->grid.timestamp = timestamp;
+  out->grid.voltage = in->grid_voltage;
+  out->grid.power = in->grid_power;
+  out->grid.freq = in->grid_freq;
+  out->battery.timestamp = timestamp;
+  out->battery.voltage = in->battery_voltage;
+  out->battery.charge_power = in->battery_charge_power;
+  out->ac_output.timestamp = timestamp;
+  out->ac_output.voltage = in->ac_out_voltage;
+  out->ac_output.power = in->ac_out_power;
+  out->ac_output.freq = in->ac_out_freq;
+  out->ac_output.output_load = in->ac_out_load;
+  out->ac_output.power_factor = in->ac_out_power_factor;
+  out->pv.timestamp = timestamp;
+  out->pv.voltage = in->pv_voltage;
+  out->pv.power = in->pv_power;
+  out->status.mode = in->mode;
+  out->status.status_flags = in->status_flags;
+  out->status.warning_flags = in->warning_flags;
+  out->status.fault_code = in->fault_code;
+  out->info.fw_ver = in->fw_ver;
+  out->info.protocol_ver = in->protocol_ver;
+  memcpy(out->info.model, in->model, sizeof(out->info.model));
+  out->info.model[sizeof(out->info.model) - 1] = '\0';
+}
+
+bool inv_warm_cache_restore(inv_snapshot_t *out)
+{
+  assert(out);
+
+  if (rtc_state.magic == RTC_MAGIC && rtc_state.crc == rtc_crc()) {
+    ESP_LOGI(LOG_TAG, "State restored from RTC memory");
+  } else {
+    rtc_state.magic = RTC_MAGIC;
+    rtc_state.state = storage_inv_state();
+    rtc_state.crc = rtc_crc();
+    ESP_LOGI(LOG_TAG, "State restored from flash");
+  }
+
+  if (rtc_state.state.timestamp == 0) {
+    return false;
+  }
+
+  from_state(&rtc_state.state, out);
+  ESP_LOGI(LOG_TAG, "Last state of %lld mode=%c", rtc_state.state.timestamp, (char)rtc_state.state.mode);
+  return true;
+}
+
+// called from the serial client task on every publish
+void inv_warm_cache_save(const inv_snapshot_t *snapshot)
+{
+  assert(snapshot);
+
+  // nothing measured yet, keep the restored state for the next boot
+  if (snapshot->grid.timestamp == 0) {
+    return;
+  }
+
+  to_state(snapshot, &rtc_state.state);
+  rtc_state.crc = rtc_crc();
+  storage_set_inv_state(&rtc_state.state);
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#ifndef MODBUS_RTU_H_
+#define MODBUS_RTU_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <sdkconfig.h>
+
+// parsed response header and the values fit the serial client packet, protocol limit is 125
+#define MODBUS_RTU_PACKET_REGS   ((CONFIG_EM_SERIAL_CLIENT_MAX_PACKET_LEN - 8u) / 2u)
+#define MODBUS_RTU_MAX_READ_REGS (MODBUS_RTU_PACKET_REGS < 125u ? MODBUS_RTU_PACKET_REGS : 125u)
+
+typedef enum {
+    MODBUS_RTU_FC_READ_HOLDING = 0x03,
+    MODBUS_RTU_FC_READ_INPUT = 0x04,
+    MODBUS_RTU_FC_WRITE_SINGLE = 0x06,
+    MODBUS_RTU_FC_WRITE_MULTIPLE = 0x10,
+} modbus_rtu_fc_e;
+
+// parsed response, passed on to the handler of the request id
+typedef struct {
+    uint8_t slave;
+    uint8_t fc;
+    uint16_t addr;
+    uint16_t count; // registers read or written
+    uint16_t regs[MODBUS_RTU_MAX_READ_REGS]; // read values in host order
+} modbus_rtu_rsp_t;
+
+// value of the device register map, 32 bit values span two registers with the high word first
+typedef struct {
+    uint16_t id; // application id of the value
+    uint8_t fc;  // MODBUS_RTU_FC_READ_HOLDING or MODBUS_RTU_FC_READ_INPUT
+    uint16_t addr;
+    uint8_t count; // 1 or 2 registers
+} modbus_rtu_reg_t;
+
+// read request covering consecutive values of the register map
+typedef struct {
+    uint8_t fc;
+    uint16_t addr;
+    uint16_t count;
+    uint16_t first_reg; // index of the first value in the register map
+    uint16_t regs_num;  // values in the block
+} modbus_rtu_block_t;
+
+/*
+ * Request ids are chosen by the application and must be unique per request frame,
+ * the response is validated against the frame serialized for its id.
+ * Partial frame followed by CONFIG_EM_MODBUS_RTU_FRAME_GAP_MS of silence is dropped.
+ */
+size_t modbus_rtu_rsp_parse(uint16_t *rq_id, const uint8_t *data_in, size_t len_in, void *output, uint16_t *err);
+uint8_t *modbus_rtu_serialize(uint16_t rq_id, const uint8_t *payload, size_t payload_len, size_t *out_len);
+
+// request frames without CRC to be passed to em_sc_send, return the length or 0 when out is too short
+size_t modbus_rtu_read_rq(uint8_t slave, uint8_t fc, uint16_t addr, uint16_t count, uint8_t *out, size_t out_len);
+size_t modbus_rtu_write_single_rq(uint8_t slave, uint16_t addr, uint16_t value, uint8_t *out, size_t out_len);
+size_t modbus_rtu_write_multiple_rq(uint8_t slave, uint16_t addr, const uint16_t *values, uint16_t count,
+                                    uint8_t *out, size_t out_len);
+
+/*
+ * Groups the register map sorted by function code and address into the fewest read requests.
+ * Gaps up to max_gap registers are read through. Returns the number of blocks or negative value
+ * when the map is not sorted or doesn't fit blocks_len.
+ */
+int modbus_rtu_plan_blocks(const modbus_rtu_reg_t *map, size_t map_len, uint16_t max_gap, modbus_rtu_block_t *blocks,
+                           size_t blocks_len);
+// value of the map entry from the response to its block
+int modbus_rtu_block_value(const modbus_rtu_block_t *block, const modbus_rtu_rsp_t *rsp, const modbus_rtu_reg_t *reg,
+                           uint32_t *value);
+
+uint16_t crc16_modbus(const uint8_t *buf, size_t len);
+
+#endif /* MODBUS_RTU_H_ */
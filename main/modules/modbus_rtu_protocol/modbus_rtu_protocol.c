@@ -0,0 +1,398 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#include "em/modbus_rtu_protocol.h"
+#include "esp_log.h"
+#include <assert.h>
+#include <esp_timer.h>
+#include <sdkconfig.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TAG "MODBUS_RTU"
+
+#define RQ_SLOTS          (16u) // request frames remembered for validating responses
+#define EXCEPTION_FLAG    (0x80u)
+#define EXCEPTION_LEN     (5u) // slave, fc, code, CRC
+#define WRITE_RSP_LEN     (8u) // slave, fc, addr, value or count, CRC
+#define READ_RSP_HDR_LEN  (3u) // slave, fc, byte count
+#define RQ_HDR_LEN        (6u) // slave, fc, addr, count or value
+#define CRC_LEN           (2u)
+#define FRAME_GAP_US      ((int64_t)CONFIG_EM_MODBUS_RTU_FRAME_GAP_MS * 1000LL)
+
+_Static_assert(sizeof(modbus_rtu_rsp_t) <= CONFIG_EM_SERIAL_CLIENT_MAX_PACKET_LEN,
+               "Response doesn't fit the serial client payload");
+_Static_assert(READ_RSP_HDR_LEN + 2 * MODBUS_RTU_MAX_READ_REGS + CRC_LEN <= CONFIG_EM_SERIAL_CLIENT_MAX_PACKET_LEN,
+               "Response frame doesn't fit the serial client packet");
+
+typedef enum {
+  PARSE_STATUS_UNKNOWN = 0,
+  PARSE_STATUS_OK = 1,
+  PARSE_STATUS_NO_PACKET = 2,
+  PARSE_STATUS_INVALID_CRC = 3,
+  PARSE_STATUS_RQ_REJECTED = 4,
+  PARSE_STATUS_RSP_UNEXPECTED = 5,
+  PARSE_STATUS_PACKET_MALFORMED = 6,
+} parse_status_t;
+
+typedef struct {
+  bool used;
+  uint16_t rq_id;
+  uint32_t last_use; // for replacing the least recently used slot
+  uint8_t slave;
+  uint8_t fc;
+  uint16_t addr;
+  uint16_t count; // registers, value for a single write
+} rq_slot_t;
+
+// serialize and parse both run in the serial client task
+static rq_slot_t rqs[RQ_SLOTS];
+static uint32_t use_cnt = 0;
+static size_t pending_len = 0; // incomplete frame waiting for more bytes
+static int64_t pending_us = 0;
+static int crc_err_cnt = 0;
+static int valid_cnt = 0;
+
+static uint16_t get_uint16(const uint8_t *buf)
+{
+  return (uint16_t)(buf[0] << 8 | buf[1]);
+}
+
+static void put_uint16(uint16_t value, uint8_t *buf)
+{
+  buf[0] = (uint8_t)(value >> 8);
+  buf[1] = (uint8_t)value;
+}
+
+static rq_slot_t *find_rq(uint16_t rq_id)
+{
+  for (size_t i = 0; i < RQ_SLOTS; i++) {
+    if (rqs[i].used && rqs[i].rq_id == rq_id) {
+      rqs[i].last_use = ++use_cnt;
+      return &rqs[i];
+    }
+  }
+
+  return NULL;
+}
+
+static rq_slot_t *alloc_rq(uint16_t rq_id)
+{
+  rq_slot_t *slot = find_rq(rq_id);
+
+  if (slot != NULL) {
+    return slot;
+  }
+
+  slot = &rqs[0];
+
+  for (size_t i = 0; i < RQ_SLOTS; i++) {
+    if (!rqs[i].used) {
+      slot = &rqs[i];
+      break;
+    }
+
+    if (rqs[i].last_use < slot->last_use) {
+      slot = &rqs[i];
+    }
+  }
+
+  slot->used = true;
+  slot->rq_id = rq_id;
+  slot->last_use = ++use_cnt;
+  return slot;
+}
+
+static int parse_rsp_read(const rq_slot_t *rq, const uint8_t *frame, modbus_rtu_rsp_t *rsp)
+{
+  if (frame[2] != 2 * rq->count) {
+    return -1; // Malformed
+  }
+
+  rsp->count = rq->count;
+
+  for (uint16_t i = 0; i < rq->count; i++) {
+    rsp->regs[i] = get_uint16(&frame[READ_RSP_HDR_LEN + 2 * i]);
+  }
+
+  return 0;
+}
+
+static int parse_rsp_write(const rq_slot_t *rq, const uint8_t *frame, modbus_rtu_rsp_t *rsp)
+{
+  // echo of the address and the value or the count
+  if (get_uint16(&frame[2]) != rq->addr || get_uint16(&frame[4]) != rq->count) {
+    return -1; // Malformed
+  }
+
+  rsp->count = rq->fc == MODBUS_RTU_FC_WRITE_SINGLE ? 1 : rq->count;
+  return 0;
+}
+
+// returns number of processed bytes
+size_t modbus_rtu_rsp_parse(uint16_t *rq_id, const uint8_t *data_in, size_t len_in, void *output, uint16_t *err)
+{
+  assert(data_in != NULL);
+  assert(output != NULL);
+  *err = PARSE_STATUS_NO_PACKET;
+
+  int64_t now_us = esp_timer_get_time();
+
+  // frames are delimited by silence, leftover of a broken frame would shift the next one
+  if (pending_len > 0 && pending_len <= len_in && now_us - pending_us > FRAME_GAP_US) {
+    size_t stale = pending_len;
+    pending_len = 0;
+    ESP_LOGW(TAG, "Dropped %zu bytes of incomplete frame", stale);
+    return stale;
+  }
+
+  pending_len = 0;
+  const rq_slot_t *rq = find_rq(*rq_id);
+
+  if (rq == NULL) {
+    ESP_LOGW(TAG, "Unknown rq %d", *rq_id);
+    return len_in;
+  }
+
+  if (len_in < EXCEPTION_LEN) {
+    pending_len = len_in;
+    pending_us = now_us;
+    return 0;
+  }
+
+  if (data_in[0] != rq->slave || (data_in[1] & ~EXCEPTION_FLAG) != rq->fc) {
+    return 1; // not a start of the response, resynchronize
+  }
+
+  size_t frame_len = 0;
+
+  if (data_in[1] & EXCEPTION_FLAG) {
+    frame_len = EXCEPTION_LEN;
+  } else if (rq->fc == MODBUS_RTU_FC_READ_HOLDING || rq->fc == MODBUS_RTU_FC_READ_INPUT) {
+    if (data_in[2] != 2 * rq->count) {
+      return 1; // byte count of another frame
+    }
+
+    frame_len = READ_RSP_HDR_LEN + data_in[2] + CRC_LEN;
+  } else {
+    frame_len = WRITE_RSP_LEN;
+  }
+
+  if (len_in < frame_len) {
+    pending_len = len_in;
+    pending_us = now_us;
+    return 0;
+  }
+
+  uint16_t act_crc = (uint16_t)(data_in[frame_len - 1] << 8 | data_in[frame_len - 2]); // low byte first
+  uint16_t exp_crc = crc16_modbus(data_in, frame_len - CRC_LEN);
+
+  if (act_crc != exp_crc) {
+    ++crc_err_cnt;
+    if (crc_err_cnt % 10 == 0) {
+      ESP_LOGI(TAG, "CRC errors=%d valid=%d", crc_err_cnt, valid_cnt);
+    }
+    *err = PARSE_STATUS_INVALID_CRC;
+    return frame_len;
+  }
+
+  if (data_in[1] & EXCEPTION_FLAG) {
+    ESP_LOGW(TAG, "rq %d exception %d", *rq_id, data_in[2]);
+    *err = PARSE_STATUS_RQ_REJECTED;
+    return frame_len;
+  }
+
+  modbus_rtu_rsp_t *rsp = (modbus_rtu_rsp_t *)output;
+  rsp->slave = rq->slave;
+  rsp->fc = rq->fc;
+  rsp->addr = rq->addr;
+
+  int ret = rsp->fc == MODBUS_RTU_FC_READ_HOLDING || rsp->fc == MODBUS_RTU_FC_READ_INPUT
+              ? parse_rsp_read(rq, data_in, rsp)
+              : parse_rsp_write(rq, data_in, rsp);
+
+  if (ret == 0) {
+    valid_cnt++;
+    *err = PARSE_STATUS_OK;
+  } else {
+    *err = PARSE_STATUS_PACKET_MALFORMED;
+  }
+
+  return frame_len;
+}
+
+uint8_t *modbus_rtu_serialize(uint16_t rq_id, const uint8_t *payload, size_t payload_len, size_t *out_len)
+{
+  assert(payload != NULL);
+
+  if (payload_len < RQ_HDR_LEN) {
+    *out_len = 0;
+    return NULL;
+  }
+
+  *out_len = payload_len + CRC_LEN;
+
+  uint8_t *ret = malloc(*out_len);
+  if (ret == NULL) {
+    assert(0);
+    *out_len = 0;
+    return NULL;
+  }
+
+  // remembered for validating the response
+  rq_slot_t *rq = alloc_rq(rq_id);
+  rq->slave = payload[0];
+  rq->fc = payload[1];
+  rq->addr = get_uint16(&payload[2]);
+  rq->count = get_uint16(&payload[4]);
+
+  memcpy(ret, payload, payload_len);
+  uint16_t crc = crc16_modbus(ret, payload_len);
+  ret[payload_len] = crc & 0xFF;       // LSB
+  ret[payload_len + 1] = (crc >> 8);   // MSB
+
+  return ret;
+}
+
+size_t modbus_rtu_read_rq(uint8_t slave, uint8_t fc, uint16_t addr, uint16_t count, uint8_t *out, size_t out_len)
+{
+  assert(out != NULL);
+  assert(fc == MODBUS_RTU_FC_READ_HOLDING || fc == MODBUS_RTU_FC_READ_INPUT);
+
+  if (out_len < RQ_HDR_LEN || count == 0 || count > MODBUS_RTU_MAX_READ_REGS) {
+    return 0;
+  }
+
+  out[0] = slave;
+  out[1] = fc;
+  put_uint16(addr, &out[2]);
+  put_uint16(count, &out[4]);
+  return RQ_HDR_LEN;
+}
+
+size_t modbus_rtu_write_single_rq(uint8_t slave, uint16_t addr, uint16_t value, uint8_t *out, size_t out_len)
+{
+  assert(out != NULL);
+
+  if (out_len < RQ_HDR_LEN) {
+    return 0;
+  }
+
+  out[0] = slave;
+  out[1] = MODBUS_RTU_FC_WRITE_SINGLE;
+  put_uint16(addr, &out[2]);
+  put_uint16(value, &out[4]);
+  return RQ_HDR_LEN;
+}
+
+size_t modbus_rtu_write_multiple_rq(uint8_t slave, uint16_t addr, const uint16_t *values, uint16_t count,
+                                    uint8_t *out, size_t out_len)
+{
+  assert(out != NULL);
+  assert(values != NULL);
+  size_t len = RQ_HDR_LEN + 1 + 2 * (size_t)count; // + byte count
+
+  if (out_len < len || count == 0 || count > MODBUS_RTU_MAX_READ_REGS) {
+    return 0;
+  }
+
+  out[0] = slave;
+  out[1] = MODBUS_RTU_FC_WRITE_MULTIPLE;
+  put_uint16(addr, &out[2]);
+  put_uint16(count, &out[4]);
+  out[RQ_HDR_LEN] = (uint8_t)(2 * count);
+
+  for (uint16_t i = 0; i < count; i++) {
+    put_uint16(values[i], &out[RQ_HDR_LEN + 1 + 2 * i]);
+  }
+
+  return len;
+}
+
+int modbus_rtu_plan_blocks(const modbus_rtu_reg_t *map, size_t map_len, uint16_t max_gap, modbus_rtu_block_t *blocks,
+                           size_t blocks_len)
+{
+  assert(map != NULL);
+  assert(blocks != NULL);
+  size_t blocks_num = 0;
+  modbus_rtu_block_t *block = NULL;
+
+  for (size_t i = 0; i < map_len; i++) {
+    const modbus_rtu_reg_t *reg = &map[i];
+
+    if (reg->count == 0 || reg->count > 2) {
+      return -1;
+    }
+
+    if (i > 0 && (reg->fc < map[i - 1].fc || (reg->fc == map[i - 1].fc && reg->addr < map[i - 1].addr))) {
+      return -2; // not sorted
+    }
+
+    if (block != NULL) {
+      uint32_t end = (uint32_t)reg->addr + reg->count;
+      bool joined = reg->fc == block->fc && reg->addr <= (uint32_t)block->addr + block->count + max_gap &&
+                    end - block->addr <= MODBUS_RTU_MAX_READ_REGS;
+
+      if (joined) {
+        if (end > (uint32_t)block->addr + block->count) {
+          block->count = (uint16_t)(end - block->addr);
+        }
+
+        block->regs_num++;
+        continue;
+      }
+    }
+
+    if (blocks_num >= blocks_len) {
+      return -3;
+    }
+
+    block = &blocks[blocks_num++];
+    block->fc = reg->fc;
+    block->addr = reg->addr;
+    block->count = reg->count;
+    block->first_reg = (uint16_t)i;
+    block->regs_num = 1;
+  }
+
+  return (int)blocks_num;
+}
+
+int modbus_rtu_block_value(const modbus_rtu_block_t *block, const modbus_rtu_rsp_t *rsp, const modbus_rtu_reg_t *reg,
+                           uint32_t *value)
+{
+  assert(block != NULL);
+  assert(rsp != NULL);
+  assert(reg != NULL);
+  assert(value != NULL);
+
+  if (rsp->fc != block->fc || rsp->addr != block->addr || rsp->count != block->count || reg->fc != block->fc ||
+      reg->addr < block->addr || reg->addr + reg->count > block->addr + block->count) {
+    return -1;
+  }
+
+  uint16_t offset = reg->addr - block->addr;
+  *value = rsp->regs[offset];
+
+  if (reg->count == 2) {
+    *value = *value << 16 | rsp->regs[offset + 1];
+  }
+
+  return 0;
+}
+
+uint16_t crc16_modbus(const uint8_t *buf, size_t len)
+{
+  uint16_t crc = 0xFFFF;
+
+  for (size_t i = 0; i < len; i++) {
+    crc ^= buf[i];
+
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+    }
+  }
+
+  return crc;
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#ifndef PYLONTECH_H_
+#define PYLONTECH_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Pylontech RS485 protocol 3.5, ASCII frames "~" VER ADR CID1 CID2 LENGTH INFO CHKSUM CR
+#define PYLONTECH_MAX_CELLS (16u)
+#define PYLONTECH_MAX_TEMPS (8u)
+
+// request id of the command to the pack, the response is matched by both
+#define PYLONTECH_RQ_ID(cid2, adr) ((uint16_t)((uint16_t)(cid2) << 8 | (uint8_t)(adr)))
+#define PYLONTECH_RQ_CID2(rq_id)   ((uint8_t)((rq_id) >> 8))
+#define PYLONTECH_RQ_ADR(rq_id)    ((uint8_t)(rq_id))
+
+typedef enum {
+    PYLONTECH_CID2_ANALOG = 0x42, // Get analog value, INFO - pack address
+} pylontech_cid2_e;
+
+// parsed response to PYLONTECH_CID2_ANALOG
+typedef struct {
+    uint8_t adr;
+    uint8_t cells_num;
+    uint16_t cells[PYLONTECH_MAX_CELLS]; // in mV
+    uint8_t temps_num;
+    int16_t temps[PYLONTECH_MAX_TEMPS]; // in 0.1C, BMS board first
+    int32_t current;                    // in mA, negative for discharge
+    uint32_t voltage;                   // in mV
+    uint32_t remaining;                 // in mAh
+    uint32_t total;                     // in mAh
+    uint16_t cycles;
+} pylontech_analog_t;
+
+/*
+ * Payload passed to em_sc_send is the binary INFO of the command, ADR and CID2 come from the request id.
+ * Responses of other addresses on the bus are skipped, RTN other than normal rejects the request.
+ */
+size_t pylontech_rsp_parse(uint16_t *rq_id, const uint8_t *data_in, size_t len_in, void *output, uint16_t *err);
+uint8_t *pylontech_serialize(uint16_t rq_id, const uint8_t *payload, size_t payload_len, size_t *out_len);
+
+#endif /* PYLONTECH_H_ */
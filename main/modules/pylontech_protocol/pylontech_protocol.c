@@ -0,0 +1,328 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#include "em/pylontech_protocol.h"
+#include "esp_log.h"
+#include <assert.h>
+#include <sdkconfig.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TAG "PYLONTECH"
+
+// used by the BMS only, the serial client packets are too short for analog responses otherwise
+#if CONFIG_EM_BMS
+
+#define SOI            ('~')
+#define EOI            ('\r')
+#define VER            (0x20u)
+#define CID1_BATTERY   (0x46u)
+#define RTN_NORMAL     (0x00u)
+#define HDR_CHARS      (12u) // VER, ADR, CID1, CID2/RTN, LENGTH
+#define CHKSUM_CHARS   (4u)
+#define FRAME_OVERHEAD (1u + HDR_CHARS + CHKSUM_CHARS + 1u)
+#define MAX_LENID      (0xFFFu)
+#define MAX_INFO_LEN   ((CONFIG_EM_SERIAL_CLIENT_MAX_PACKET_LEN - FRAME_OVERHEAD) / 2u)
+#define TEMP_ZERO_C    (2731) // temperatures are sent in 0.1K
+#define USER_DEF_EXT   (4u)   // capacities above 65Ah follow in 3 bytes
+
+// DATAFLAG, pack, cells, temps, current, voltage, remaining, user defined, total, cycles, extended capacities
+#define ANALOG_MAX_INFO_LEN \
+  (3u + 2u * PYLONTECH_MAX_CELLS + 1u + 2u * PYLONTECH_MAX_TEMPS + 2u + 2u + 2u + 1u + 2u + 2u + 3u + 3u)
+
+_Static_assert(sizeof(pylontech_analog_t) <= CONFIG_EM_SERIAL_CLIENT_MAX_PACKET_LEN,
+               "Response doesn't fit the serial client payload");
+_Static_assert(ANALOG_MAX_INFO_LEN <= MAX_INFO_LEN, "Analog response frame doesn't fit the serial client packet");
+
+typedef enum {
+  PARSE_STATUS_UNKNOWN = 0,
+  PARSE_STATUS_OK = 1,
+  PARSE_STATUS_NO_PACKET = 2,
+  PARSE_STATUS_INVALID_CRC = 3,
+  PARSE_STATUS_RQ_REJECTED = 4,
+  PARSE_STATUS_RSP_UNEXPECTED = 5,
+  PARSE_STATUS_PACKET_MALFORMED = 6,
+} parse_status_t;
+
+// INFO reader, err is set on the first read past the end
+typedef struct {
+  const uint8_t *buf;
+  size_t len;
+  size_t pos;
+  bool err;
+} info_reader_t;
+
+static int crc_err_cnt = 0;
+static int valid_cnt = 0;
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+static int hex_nibble(uint8_t c)
+{
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  } else if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  } else if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+
+  return -1;
+}
+
+// returns -1 when the chars are not hex digits
+static int hex_byte(const uint8_t *buf)
+{
+  int hi = hex_nibble(buf[0]);
+  int lo = hex_nibble(buf[1]);
+
+  return hi < 0 || lo < 0 ? -1 : hi << 4 | lo;
+}
+
+static void put_hex(uint32_t value, size_t digits, uint8_t *buf)
+{
+  for (size_t i = 0; i < digits; i++) {
+    buf[digits - 1 - i] = hex_digits[value & 0xF];
+    value >>= 4;
+  }
+}
+
+static uint16_t length_field(uint16_t lenid)
+{
+  uint16_t sum = (lenid & 0xF) + (lenid >> 4 & 0xF) + (lenid >> 8 & 0xF);
+  uint16_t lchksum = (uint16_t)(~sum + 1) & 0xF;
+
+  return (uint16_t)(lchksum << 12 | lenid);
+}
+
+// sum of the chars between SOI and CHKSUM, two's complement
+static uint16_t frame_chksum(const uint8_t *buf, size_t len)
+{
+  uint16_t sum = 0;
+
+  for (size_t i = 0; i < len; i++) {
+    sum += buf[i];
+  }
+
+  return (uint16_t)(~sum + 1);
+}
+
+static uint32_t info_get(info_reader_t *r, size_t bytes)
+{
+  uint32_t value = 0;
+
+  if (r->pos + bytes > r->len) {
+    r->err = true;
+    return 0;
+  }
+
+  for (size_t i = 0; i < bytes; i++) {
+    value = value << 8 | r->buf[r->pos++];
+  }
+
+  return value;
+}
+
+static int parse_rsp_analog(const uint8_t *info, size_t info_len, pylontech_analog_t *out)
+{
+  info_reader_t r = {.buf = info, .len = info_len, .pos = 0, .err = false};
+
+  (void)info_get(&r, 1); // DATAFLAG, alarm and switch changes are not tracked
+  out->adr = (uint8_t)info_get(&r, 1);
+  out->cells_num = (uint8_t)info_get(&r, 1);
+
+  if (out->cells_num > PYLONTECH_MAX_CELLS) {
+    return -1; // Malformed
+  }
+
+  for (uint8_t i = 0; i < out->cells_num; i++) {
+    out->cells[i] = (uint16_t)info_get(&r, 2);
+  }
+
+  out->temps_num = (uint8_t)info_get(&r, 1);
+
+  if (out->temps_num > PYLONTECH_MAX_TEMPS) {
+    return -1; // Malformed
+  }
+
+  for (uint8_t i = 0; i < out->temps_num; i++) {
+    out->temps[i] = (int16_t)((int32_t)info_get(&r, 2) - TEMP_ZERO_C);
+  }
+
+  out->current = (int16_t)info_get(&r, 2) * 10; // in 10mA
+  out->voltage = info_get(&r, 2);
+  out->remaining = info_get(&r, 2);
+  uint8_t user_def = (uint8_t)info_get(&r, 1);
+  out->total = info_get(&r, 2);
+  out->cycles = (uint16_t)info_get(&r, 2);
+
+  if (user_def == USER_DEF_EXT) {
+    out->remaining = info_get(&r, 3);
+    out->total = info_get(&r, 3);
+  }
+
+  return r.err ? -1 : 0;
+}
+
+// returns number of processed bytes
+size_t pylontech_rsp_parse(uint16_t *rq_id, const uint8_t *data_in, size_t len_in, void *output, uint16_t *err)
+{
+  assert(data_in != NULL);
+  assert(output != NULL);
+  *err = PARSE_STATUS_NO_PACKET;
+
+  const uint8_t *soi = memchr(data_in, SOI, len_in);
+
+  if (soi == NULL) {
+    return len_in;
+  }
+
+  if (soi != data_in) {
+    return (size_t)(soi - data_in); // not a start of the response, resynchronize
+  }
+
+  // frames are ASCII delimited, a new SOI before EOI means the previous frame was cut
+  size_t frame_len = 0;
+
+  for (size_t i = 1; i < len_in; i++) {
+    if (data_in[i] == SOI) {
+      ESP_LOGW(TAG, "Dropped %zu bytes of incomplete frame", i);
+      return i;
+    }
+
+    if (data_in[i] == EOI) {
+      frame_len = i + 1;
+      break;
+    }
+  }
+
+  if (frame_len == 0) {
+    // EOI can't be further than the longest frame the client buffers
+    return len_in < CONFIG_EM_SERIAL_CLIENT_MAX_PACKET_LEN ? 0 : 1;
+  }
+
+  if (frame_len < FRAME_OVERHEAD) {
+    *err = PARSE_STATUS_PACKET_MALFORMED;
+    return frame_len;
+  }
+
+  int adr = hex_byte(&data_in[3]);
+  int rtn = hex_byte(&data_in[7]);
+  int len_hi = hex_byte(&data_in[9]);
+  int len_lo = hex_byte(&data_in[11]);
+  int chk_hi = hex_byte(&data_in[frame_len - 1 - CHKSUM_CHARS]);
+  int chk_lo = hex_byte(&data_in[frame_len - 1 - CHKSUM_CHARS + 2]);
+
+  if (adr < 0 || rtn < 0 || len_hi < 0 || len_lo < 0 || chk_hi < 0 || chk_lo < 0) {
+    *err = PARSE_STATUS_PACKET_MALFORMED;
+    return frame_len;
+  }
+
+  uint16_t length = (uint16_t)(len_hi << 8 | len_lo);
+  uint16_t lenid = length & MAX_LENID;
+
+  if (length != length_field(lenid) || frame_len != FRAME_OVERHEAD + lenid || lenid % 2 != 0) {
+    *err = PARSE_STATUS_PACKET_MALFORMED;
+    return frame_len;
+  }
+
+  uint16_t act_chksum = (uint16_t)(chk_hi << 8 | chk_lo);
+  uint16_t exp_chksum = frame_chksum(&data_in[1], frame_len - 1 - CHKSUM_CHARS - 1);
+
+  if (act_chksum != exp_chksum) {
+    ++crc_err_cnt;
+    if (crc_err_cnt % 10 == 0) {
+      ESP_LOGI(TAG, "CRC errors=%d valid=%d", crc_err_cnt, valid_cnt);
+    }
+    *err = PARSE_STATUS_INVALID_CRC;
+    return frame_len;
+  }
+
+  if (adr != PYLONTECH_RQ_ADR(*rq_id)) {
+    ESP_LOGD(TAG, "Rsp of adr %d skipped", adr);
+    return frame_len; // another pack on the bus
+  }
+
+  if (rtn != RTN_NORMAL) {
+    ESP_LOGW(TAG, "rq %x RTN %x", *rq_id, rtn);
+    *err = PARSE_STATUS_RQ_REJECTED;
+    return frame_len;
+  }
+
+  uint8_t info[MAX_INFO_LEN];
+  size_t info_len = lenid / 2;
+
+  for (size_t i = 0; i < info_len; i++) {
+    int byte = hex_byte(&data_in[1 + HDR_CHARS + 2 * i]);
+
+    if (byte < 0) {
+      *err = PARSE_STATUS_PACKET_MALFORMED;
+      return frame_len;
+    }
+
+    info[i] = (uint8_t)byte;
+  }
+
+  int ret = -1;
+
+  switch (PYLONTECH_RQ_CID2(*rq_id)) {
+  case PYLONTECH_CID2_ANALOG:
+    ret = parse_rsp_analog(info, info_len, (pylontech_analog_t *)output);
+    break;
+  default:
+    ESP_LOGW(TAG, "No parser of rq %x", *rq_id);
+    break;
+  }
+
+  if (ret == 0) {
+    valid_cnt++;
+    *err = PARSE_STATUS_OK;
+  } else {
+    *err = PARSE_STATUS_PACKET_MALFORMED;
+  }
+
+  return frame_len;
+}
+
+uint8_t *pylontech_serialize(uint16_t rq_id, const uint8_t *payload, size_t payload_len, size_t *out_len)
+{
+  assert(payload != NULL || payload_len == 0);
+
+  if (2 * payload_len > MAX_LENID) {
+    *out_len = 0;
+    return NULL;
+  }
+
+  uint16_t lenid = (uint16_t)(2 * payload_len);
+  *out_len = FRAME_OVERHEAD + lenid;
+
+  uint8_t *ret = malloc(*out_len);
+  if (ret == NULL) {
+    assert(0);
+    *out_len = 0;
+    return NULL;
+  }
+
+  uint8_t *ptr = ret;
+  *ptr++ = SOI;
+  put_hex(VER, 2, ptr);
+  put_hex(PYLONTECH_RQ_ADR(rq_id), 2, ptr + 2);
+  put_hex(CID1_BATTERY, 2, ptr + 4);
+  put_hex(PYLONTECH_RQ_CID2(rq_id), 2, ptr + 6);
+  put_hex(length_field(lenid), 4, ptr + 8);
+  ptr += HDR_CHARS;
+
+  for (size_t i = 0; i < payload_len; i++) {
+    put_hex(payload[i], 2, ptr);
+    ptr += 2;
+  }
+
+  put_hex(frame_chksum(&ret[1], HDR_CHARS + lenid), CHKSUM_CHARS, ptr);
+  ptr += CHKSUM_CHARS;
+  *ptr = EOI;
+
+  return ret;
+}
+
+#endif /* CONFIG_EM_BMS */
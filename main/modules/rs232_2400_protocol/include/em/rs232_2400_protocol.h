@@ -8,6 +8,7 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
+#include <time.h>
 
 // rsp from https://forums.aeva.asn.au/uploads/293/HS_MS_MSX_RS232_Protocol_20140822_after_current_upgrade.pdf
 typedef enum {
@@ -106,7 +107,8 @@ typedef enum {
     EM_RS232_2400_LDT,        // Setting AC output ON/OFF time
     EM_RS232_2400_BSDP,       // Setting battery stop discharge percentage
     EM_RS232_2400_DMODEL,      // Setting model of device
-    EM_RS232_2400_PSPB      // Set Solar Power Balance
+    EM_RS232_2400_PSPB,     // Set Solar Power Balance
+    EM_RS232_2400_MUCHGC    // Setting utility max charging current
 } em_rs232_2400_cmd_e;
 
 typedef struct {
@@ -149,43 +151,76 @@ typedef struct {
     int topology;                   // Topology (e.g., 0: transformerless, 1: transformer)
 } qpiri_response_t;
 
+// settings reported by the full QPIRI response, voltages in 0.1V, currents in A, priorities as set by POP and PCP
 typedef struct {
-    uint16_t presence;
-    bool silence_buzzer;                  // Enable/disable silence buzzer or open buzzer
-    bool overload_bypass;                 // Enable/Disable overload bypass function
-    bool power_saving;                    // Enable/Disable power saving
-    bool lcd_default_page_timeout;        // Enable/Disable LCD display escape to default page after 1min timeout
-    bool overload_restart;                // Enable/Disable overload restart
-    bool over_temperature_restart;        // Enable/Disable over temperature restart
-    bool backlight_on;                    // Enable/Disable backlight on
-    bool alarm_on_primary_interrupt;      // Enable/Disable alarm on when primary source interrupt
-    bool fault_code_record;               // Enable/Disable fault code record
+    uint16_t battery_recharge_voltage;    // PBCV
+    uint16_t battery_under_voltage;       // PSDV
+    uint16_t battery_redischarge_voltage; // PBDV
+    uint16_t max_ac_charging_current;     // MUCHGC
+    uint16_t max_charging_current;        // MCHGC
+    uint16_t output_source_priority;      // POP
+    uint16_t charger_source_priority;     // PCP
+} qpiri_settings_t;
+
+// bits of the QFLAG flags in qflag_response_t
+typedef enum {
+    RS232_2400_FLAG_BUZZER = 0,        // A - silence buzzer or open buzzer
+    RS232_2400_FLAG_OVERLOAD_BYPASS,   // B - overload bypass function
+    RS232_2400_FLAG_POWER_SAVING,      // J - power saving
+    RS232_2400_FLAG_LCD_TIMEOUT,       // K - LCD escape to default page after 1min timeout
+    RS232_2400_FLAG_OVERLOAD_RESTART,  // U - overload restart
+    RS232_2400_FLAG_OVER_TEMP_RESTART, // V - over temperature restart
+    RS232_2400_FLAG_BACKLIGHT,         // X - backlight on
+    RS232_2400_FLAG_PRIMARY_ALARM,     // Y - alarm on when primary source interrupt
+    RS232_2400_FLAG_FAULT_RECORD,      // Z - fault code record
+    RS232_2400_FLAGS_CNT
+} rs232_2400_flag_e;
+
+typedef struct {
+    uint16_t presence; // flags reported by the inverter
+    uint16_t enabled;
 } qflag_response_t;
 
+// bit n is the warning character a<n> of the response
 typedef struct {
-    float grid_voltage;          // Grid voltage (V)
-    float grid_frequency;        // Grid frequency (Hz)
-    float ac_output_voltage;     // AC output voltage (V)
-    float ac_output_frequency;   // AC output frequency (Hz)
-    int ac_output_active_power;   // AC output power (W)
-    int ac_output_appearent_power; // AC output power (W)
-    int output_load_percent;     // Output load percentage (%)
-    int bus_voltage;         //  BUS voltage (V)
-    float battery_voltage;     // P battery voltage (V)
-    int battery_charging_current; // P battery charging current (A)
-    int battery_discharging_current; // P battery charging current (A)
-    float battery_voltage_from_SCC;
-    int battery_capacity;        // Battery capacity (%)
-    int temperature;       //  temperature (°C)
-    float pv_input_current;        // PV input current  (W)
-    float pv_input_voltage;    // PV input voltage  (V)
-    int pv_input_power;     // PV input power (W)
-    uint16_t device_status_1;      // Device status (binary flags)
+    uint64_t bits;
+    uint8_t len; // warning characters sent by the inverter
+} qpiws_response_t;
+
+// four fault characters, the first one in the most significant byte
+typedef uint32_t qpicf_response_t;
+
+// fixed-point, no floats on the measurement path
+typedef struct {
+    uint16_t grid_voltage;          // Grid voltage (0.1V)
+    uint16_t grid_frequency;        // Grid frequency (0.1Hz)
+    uint16_t ac_output_voltage;     // AC output voltage (0.1V)
+    uint16_t ac_output_frequency;   // AC output frequency (0.1Hz)
+    uint16_t ac_output_active_power;   // AC output active power (W)
+    uint16_t ac_output_appearent_power; // AC output apparent power (VA)
+    uint8_t output_load_percent;     // Output load percentage (%)
+    uint16_t bus_voltage;         //  BUS voltage (V)
+    uint16_t battery_voltage;     // P battery voltage (0.1V)
+    uint16_t battery_charging_current; // P battery charging current (A)
+    uint16_t battery_discharging_current; // P battery discharging current (A)
+    uint16_t battery_voltage_from_SCC; // (0.1V)
+    uint8_t battery_capacity;        // Battery capacity (%)
+    int16_t temperature;       //  temperature (°C)
+    uint16_t pv_input_current;        // PV input current (0.1A)
+    uint16_t pv_input_voltage;    // PV input voltage (0.1V)
+    uint16_t pv_input_power;     // PV input power (W)
+    uint32_t device_status;   // Device status b7..b0 in bits 7..0, device status 2 b10..b8 in bits 18..16
     uint8_t battery_offset;
     uint8_t EEPROM_version;
-    uint8_t device_status_2;      // Device status (binary flags)
 } qpigs_response_t;
 
+// second MPPT of the dual tracker models, the first one is reported by QPIGS
+typedef struct {
+    uint16_t pv_input_current; // PV2 input current (0.1A)
+    uint16_t pv_input_voltage; // PV2 input voltage (0.1V)
+    uint16_t pv_input_power;   // PV2 charging power (W)
+} qpigs2_response_t;
+
 typedef struct {
     int high_voltage;
     int low_voltage;
@@ -198,7 +233,17 @@ typedef struct {
     float bulk_voltage;
 } qchgs_response_t;
 
+// QPIRI, QFLAG, QMCHGCR and QMUCHGCR responses are validated and passed on as NUL terminated text
+// setting commands pass on uint32_t 1 for ACK and 0 for NAK
+#define RS232_2400_TEXT_RSP_MAX_LEN (128u)
+
 size_t rs232_2400_rsp_parse(uint16_t *rq_id, const uint8_t* data_in, size_t len_in, void* output, uint16_t *err);
+// builds QET/QEY/QEM/QED/QEH payload for the date, returns its length or 0
+size_t rs232_2400_energy_rq(uint16_t cmd, const struct tm *date, uint8_t *out, size_t out_len);
+// setting command of the request text e.g. "MCHGC040", EM_RS232_2400_NONE when unknown
+uint16_t rs232_2400_set_cmd(const uint8_t *rq, size_t len);
+// settings of the QPIRI response text, returns -1 for the short response without them
+int rs232_2400_qpiri_settings(const char *text, qpiri_settings_t *settings);
 uint8_t* rs232_2400_serialize(uint16_t cmd, const uint8_t* payload, size_t payload_len, size_t* out_len);
 uint16_t crc16_xmodem(const void *buf, int len);
 
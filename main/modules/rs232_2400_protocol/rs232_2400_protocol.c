@@ -3,13 +3,55 @@
  */
 
 #include "em/rs232_2400_protocol.h"
+#include "em/fixed.h"
 #include "esp_log.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sdkconfig.h>
 
 #define TAG "RS232_2400"
 
+#define QPIGS_FIELDS_CNT (21)
+#define QPIGS2_FIELDS_CNT (3) // further fields differ between the models and are not used
+#define QPIWS_MAX_LEN    (64)
+#define QPIRI_FIELDS_CNT (23) // full response up to the battery re-discharge voltage, later fields differ
+
+// '0' and '1' characters are unpacked eight at a time, character k sits in byte k of the word
+#define ASCII_ZEROS (0x3030303030303030ULL)
+#define LOW_BITS    (0x0101010101010101ULL)
+#define GATHER_LSB  (0x0102040810204080ULL) // bit 0 of byte k to bit 56 + k
+#define GATHER_MSB  (0x8040201008040201ULL) // bit 0 of byte k to bit 63 - k
+
+_Static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "Bit gathering expects little endian words");
+_Static_assert(RS232_2400_TEXT_RSP_MAX_LEN <= CONFIG_EM_SERIAL_CLIENT_MAX_PACKET_LEN,
+               "Response texts don't fit the serial client packet");
+
+// QPIGS status fields, bit b<n> of the field goes to bit shift + n of the device status
+typedef struct {
+  uint8_t field;
+  uint8_t chars;
+  uint8_t shift;
+} status_field_t;
+
+static const status_field_t qpigs_status_fields[] = {
+  {.field = 16, .chars = 8, .shift = 0},  // b7..b0
+  {.field = 20, .chars = 3, .shift = 16}, // b10..b8
+};
+
+// QFLAG letter to its flag bit, 0 for letters the inverter doesn't report
+static const uint16_t qflag_masks['Z' - 'A' + 1] = {
+  ['A' - 'A'] = 1u << RS232_2400_FLAG_BUZZER,
+  ['B' - 'A'] = 1u << RS232_2400_FLAG_OVERLOAD_BYPASS,
+  ['J' - 'A'] = 1u << RS232_2400_FLAG_POWER_SAVING,
+  ['K' - 'A'] = 1u << RS232_2400_FLAG_LCD_TIMEOUT,
+  ['U' - 'A'] = 1u << RS232_2400_FLAG_OVERLOAD_RESTART,
+  ['V' - 'A'] = 1u << RS232_2400_FLAG_OVER_TEMP_RESTART,
+  ['X' - 'A'] = 1u << RS232_2400_FLAG_BACKLIGHT,
+  ['Y' - 'A'] = 1u << RS232_2400_FLAG_PRIMARY_ALARM,
+  ['Z' - 'A'] = 1u << RS232_2400_FLAG_FAULT_RECORD,
+};
+
 typedef enum {
   PARSE_STATUS_UNKNOWN = 0,
   PARSE_STATUS_OK = 1,
@@ -89,6 +131,54 @@ typedef enum {
   EM_INV_RS232_2400_FAULT_PARALLEL_OUTPUT_SETTING_DIFF = 86
 } em_inv_rs232_2400_fault_code_t;
 
+// eight '0'/'1' characters to a byte in a few word operations, -1 on any other character
+static int pack8(const uint8_t *chars, uint64_t gather, uint8_t *bits)
+{
+  uint64_t word;
+  memcpy(&word, chars, sizeof(word));
+  word ^= ASCII_ZEROS;
+
+  if (word & ~LOW_BITS) {
+    return -1;
+  }
+
+  *bits = (uint8_t)((word * gather) >> 56);
+  return 0;
+}
+
+// character k to bit k, up to 64 characters
+static int pack_bits_lsb(const uint8_t *chars, size_t len, uint64_t *bits)
+{
+  assert(len <= 64);
+  *bits = 0;
+
+  for (size_t i = 0; i < len; i += 8) {
+    uint8_t chunk[8];
+    uint8_t byte = 0;
+    memset(chunk, '0', sizeof(chunk));
+    memcpy(chunk, &chars[i], len - i < sizeof(chunk) ? len - i : sizeof(chunk));
+
+    if (pack8(chunk, GATHER_LSB, &byte) != 0) {
+      return -1;
+    }
+
+    *bits |= (uint64_t)byte << i;
+  }
+
+  return 0;
+}
+
+// most significant bit first, up to 8 characters
+static int pack_bits_msb(const uint8_t *chars, size_t len, uint8_t *bits)
+{
+  assert(len <= 8);
+  uint8_t chunk[8];
+  memset(chunk, '0', sizeof(chunk));
+  memcpy(&chunk[sizeof(chunk) - len], chars, len);
+
+  return pack8(chunk, GATHER_MSB, bits);
+}
+
 static int parse_rsp_is_nak(const uint8_t *read_ptr, size_t len)
 {
   assert(read_ptr != NULL);
@@ -100,6 +190,32 @@ static int parse_rsp_is_nak(const uint8_t *read_ptr, size_t len)
   return strncmp((const char *)read_ptr, "NAK", 3);
 }
 
+static bool is_set_cmd(uint16_t cmd)
+{
+  return cmd >= EM_RS232_2400_PE && cmd <= EM_RS232_2400_MUCHGC;
+}
+
+// setting commands response "ACK" or "NAK"
+static int parse_rsp_ack(const uint8_t *read_ptr, size_t len, uint32_t *ack)
+{
+  assert(read_ptr != NULL);
+  assert(ack != NULL);
+
+  if (len != 3) {
+    return -1; // Malformed
+  }
+
+  if (strncmp((const char *)read_ptr, "ACK", 3) == 0) {
+    *ack = 1;
+  } else if (strncmp((const char *)read_ptr, "NAK", 3) == 0) {
+    *ack = 0;
+  } else {
+    return -2;
+  }
+
+  return 0;
+}
+
 static int parse_rsp_qpi(const uint8_t *read_ptr, size_t len, uint32_t *protocol_id)
 {
   assert(read_ptr != NULL);
@@ -186,6 +302,52 @@ static int parse_rsp_qmd(const uint8_t *read_ptr, size_t len, char *model)
   return 0;
 }
 
+/* BBB.B CC.C DDD.D EE.E FF.F HHHH IIII JJ.J KK.K JJ.J KK.K LL.L O PPP QQQ O P Q R SS T U VV.V ...
+ * fields 8, 9 and 22 are the battery re-charge, under and re-discharge voltages, 13 and 14 the max AC and max
+ * charging currents, 16 and 17 the output and charger source priorities */
+static int parse_qpiri_settings(const uint8_t *read_ptr, size_t len, qpiri_settings_t *settings)
+{
+  assert(read_ptr != NULL);
+  assert(settings != NULL);
+
+  static const int8_t decimals[QPIRI_FIELDS_CNT] = {1, 1, 1, 1, 1, 0, 0, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+  int32_t fields[QPIRI_FIELDS_CNT] = {0};
+  int parsed = 0;
+  size_t pos = 0;
+
+  while (parsed < QPIRI_FIELDS_CNT && pos < len) {
+    while (pos < len && read_ptr[pos] == ' ') {
+      pos++;
+    }
+
+    size_t start = pos;
+
+    while (pos < len && read_ptr[pos] != ' ') {
+      pos++;
+    }
+
+    if (pos == start ||
+        !em_fixed_parse((const char *)&read_ptr[start], pos - start, (uint8_t)decimals[parsed], &fields[parsed])) {
+      return -2; // Malformed
+    }
+
+    parsed++;
+  }
+
+  if (parsed != QPIRI_FIELDS_CNT) {
+    return -1; // short response without the settings
+  }
+
+  settings->battery_recharge_voltage = em_fixed_sat_u16(fields[8]);
+  settings->battery_under_voltage = em_fixed_sat_u16(fields[9]);
+  settings->battery_redischarge_voltage = em_fixed_sat_u16(fields[22]);
+  settings->max_ac_charging_current = em_fixed_sat_u16(fields[13]);
+  settings->max_charging_current = em_fixed_sat_u16(fields[14]);
+  settings->output_source_priority = em_fixed_sat_u16(fields[16]);
+  settings->charger_source_priority = em_fixed_sat_u16(fields[17]);
+  return 0;
+}
+
 static int parse_rsp_qpiri(const uint8_t *read_ptr, size_t len, qpiri_response_t *response)
 {
   assert(read_ptr != NULL);
@@ -194,7 +356,9 @@ static int parse_rsp_qpiri(const uint8_t *read_ptr, size_t len, qpiri_response_t
                              // III.I EEE.E DDD.D AA.A GGG.G R MM T
 
   if (len != msg_len) {
-    return -1; // Malformed
+    // models with the full response report the settings instead, validated here and read from the text
+    qpiri_settings_t settings;
+    return parse_qpiri_settings(read_ptr, len, &settings) == 0 ? 0 : -1;
   }
 
   const char *data = (const char *)read_ptr;
@@ -220,9 +384,6 @@ static int parse_rsp_qpigs(const uint8_t *read_ptr, size_t len, qpigs_response_t
     return -1;             // Malformed
   }
 
-  uint32_t status1 = 0;
-  uint32_t status2 = 0;
-
   /* 228.2 49.9 220.9 50.0 0132 0084 003 397 26.60 000 100 0031 00.1 050.0 00.00
    * 00004 status1=00010/110 00 00 00009 010 */
   /* 237.3 50.0 220.4 50.0 0242 0067 005 455 27.80 000 100 0029 01.7 088.6 00.00
@@ -244,22 +405,114 @@ static int parse_rsp_qpigs(const uint8_t *read_ptr, size_t len, qpigs_response_t
   101: Charging on with AC charge on
   111: Charging on with SCC and AC charge on
   */
-  int parsed =
-    sscanf((char *)read_ptr, "%f %f %f %f %d %d %d %d %f %d %d %d %f %f %f %d %lx %hhd %hhd %d %lx", &response->grid_voltage, &response->grid_frequency,
-           &response->ac_output_voltage, &response->ac_output_frequency, &response->ac_output_appearent_power, &response->ac_output_active_power,
-           &response->output_load_percent, &response->bus_voltage, &response->battery_voltage, &response->battery_charging_current, &response->battery_capacity,
-           &response->temperature, &response->pv_input_current, &response->pv_input_voltage, &response->battery_voltage_from_SCC,
-           &response->battery_discharging_current, &status1, &response->battery_offset, &response->EEPROM_version, &response->pv_input_power, &status2);
+  /* decimal places kept in the fixed-point value of each field, -1 for the status bits */
+  static const int8_t decimals[QPIGS_FIELDS_CNT] = {1, 1, 1, 1, 0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 0, -1, 0, 0, 0, -1};
+  int32_t fields[QPIGS_FIELDS_CNT] = {0};
+  const uint8_t *tokens[QPIGS_FIELDS_CNT] = {NULL};
+  uint8_t tokens_len[QPIGS_FIELDS_CNT] = {0};
+  int parsed = 0;
+  size_t pos = 0;
+
+  while (parsed < QPIGS_FIELDS_CNT && pos < len) {
+    while (pos < len && read_ptr[pos] == ' ') {
+      pos++;
+    }
+
+    size_t start = pos;
+
+    while (pos < len && read_ptr[pos] != ' ') {
+      pos++;
+    }
+
+    if (pos == start) {
+      break;
+    }
+
+    if (decimals[parsed] < 0) {
+      tokens[parsed] = &read_ptr[start];
+      tokens_len[parsed] = (uint8_t)(pos - start < UINT8_MAX ? pos - start : UINT8_MAX);
+    } else if (!em_fixed_parse((const char *)&read_ptr[start], pos - start, (uint8_t)decimals[parsed], &fields[parsed])) {
+      ESP_LOGW(TAG, "Invalid field %d", parsed);
+    }
+
+    parsed++;
+  }
+
+  response->grid_voltage = em_fixed_sat_u16(fields[0]);
+  response->grid_frequency = em_fixed_sat_u16(fields[1]);
+  response->ac_output_voltage = em_fixed_sat_u16(fields[2]);
+  response->ac_output_frequency = em_fixed_sat_u16(fields[3]);
+  response->ac_output_appearent_power = em_fixed_sat_u16(fields[4]);
+  response->ac_output_active_power = em_fixed_sat_u16(fields[5]);
+  response->output_load_percent = em_fixed_sat_u8(fields[6]);
+  response->bus_voltage = em_fixed_sat_u16(fields[7]);
+  response->battery_voltage = em_fixed_sat_u16(fields[8]);
+  response->battery_charging_current = em_fixed_sat_u16(fields[9]);
+  response->battery_capacity = em_fixed_sat_u8(fields[10]);
+  response->temperature = em_fixed_sat_i16(fields[11]);
+  response->pv_input_current = em_fixed_sat_u16(fields[12]);
+  response->pv_input_voltage = em_fixed_sat_u16(fields[13]);
+  response->battery_voltage_from_SCC = em_fixed_sat_u16(fields[14]);
+  response->battery_discharging_current = em_fixed_sat_u16(fields[15]);
+  response->battery_offset = em_fixed_sat_u8(fields[17]);
+  response->EEPROM_version = em_fixed_sat_u8(fields[18]);
+  response->pv_input_power = em_fixed_sat_u16(fields[19]);
+
+  response->device_status = 0;
+
+  for (size_t i = 0; i < sizeof(qpigs_status_fields) / sizeof(qpigs_status_fields[0]); i++) {
+    const status_field_t *status = &qpigs_status_fields[i];
+    uint8_t bits = 0;
+
+    if (tokens_len[status->field] != status->chars ||
+        pack_bits_msb(tokens[status->field], status->chars, &bits) != 0) {
+      ESP_LOGW(TAG, "Invalid status field %d", status->field);
+      continue;
+    }
 
-  for (int i = 0; i < 8; i++) {
-    response->device_status_1 |= ((status1 >> i * 4) & 0x01) << i;
-    response->device_status_2 |= ((status2 >> i * 4) & 0x01) << i;
+    response->device_status |= (uint32_t)bits << status->shift;
   }
 
-  if (parsed != 21) {
-    ESP_LOGW(TAG, "Parsed %d fields, expected 21", parsed);
+  if (parsed != QPIGS_FIELDS_CNT) {
+    ESP_LOGW(TAG, "Parsed %d fields, expected %d", parsed, QPIGS_FIELDS_CNT);
+  }
+
+  return 0;
+}
+
+static int parse_rsp_qpigs2(const uint8_t *read_ptr, size_t len, qpigs2_response_t *response)
+{
+  assert(read_ptr != NULL);
+  assert(response != NULL);
+  const size_t min_msg_len = 17; // BB.B CCC.C DDDDD
+
+  if (len < min_msg_len) {
+    return -1; // Malformed
+  }
+
+  static const uint8_t decimals[QPIGS2_FIELDS_CNT] = {1, 1, 0};
+  int32_t fields[QPIGS2_FIELDS_CNT] = {0};
+  size_t pos = 0;
+
+  for (int i = 0; i < QPIGS2_FIELDS_CNT; i++) {
+    while (pos < len && read_ptr[pos] == ' ') {
+      pos++;
+    }
+
+    size_t start = pos;
+
+    while (pos < len && read_ptr[pos] != ' ') {
+      pos++;
+    }
+
+    if (pos == start || !em_fixed_parse((const char *)&read_ptr[start], pos - start, decimals[i], &fields[i])) {
+      return -2; // the second tracker is reported in one response, partial values are not used
+    }
   }
 
+  response->pv_input_current = em_fixed_sat_u16(fields[0]);
+  response->pv_input_voltage = em_fixed_sat_u16(fields[1]);
+  response->pv_input_power = em_fixed_sat_u16(fields[2]);
   return 0;
 }
 
@@ -279,56 +532,23 @@ static int parse_rsp_qflag(const uint8_t *read_ptr, size_t len, qflag_response_t
 
   bool enable = false;
 
-  for (int i = 0; i < len; i++) {
-    if (read_ptr[i] == 'E') {
-      enable = true;
-    } else if (read_ptr[i] == 'D') {
-      enable = false;
-    } else {
-      switch (read_ptr[i]) {
-      case 'A':
-        response->silence_buzzer = enable;
-        response->presence |= 0x01;
-        break;
-      case 'B':
-        response->overload_bypass = enable;
-        response->presence |= 0x02;
-        break;
-      case 'J':
-        response->power_saving = enable;
-        response->presence |= 0x04;
-        break;
-      case 'K':
-        response->lcd_default_page_timeout = enable;
-        response->presence |= 0x08;
-        break;
-      case 'U':
-        response->overload_restart = enable;
-        response->presence |= 0x10;
-        break;
-      case 'V':
-        response->over_temperature_restart = enable;
-        response->presence |= 0x20;
-        break;
-      case 'X':
-        response->backlight_on = enable;
-        response->presence |= 0x40;
-        break;
-      case 'Y':
-        response->alarm_on_primary_interrupt = enable;
-        response->presence |= 0x80;
-        break;
-      case 'Z':
-        response->fault_code_record = enable;
-        response->presence |= 0x100;
-        break;
-      default:
-        return -3; // Unknown flag
-      }
+  for (size_t i = 0; i < len; i++) {
+    if (read_ptr[i] == 'E' || read_ptr[i] == 'D') {
+      enable = read_ptr[i] == 'E';
+      continue;
     }
+
+    uint16_t mask = read_ptr[i] >= 'A' && read_ptr[i] <= 'Z' ? qflag_masks[read_ptr[i] - 'A'] : 0;
+
+    if (mask == 0) {
+      return -3; // Unknown flag
+    }
+
+    response->presence |= mask;
+    response->enabled = enable ? response->enabled | mask : response->enabled & ~mask;
   }
 
-  if (response->presence != 0x1FF) {
+  if (response->presence != (1u << RS232_2400_FLAGS_CNT) - 1) {
     return -4; // Missing flag
   }
 
@@ -398,48 +618,34 @@ static int parse_rsp_qgof(const uint8_t *read_ptr, size_t len, qgof_response_t *
   return 0;
 }
 
-static int parse_rsp_qpiws(const uint8_t *read_ptr, size_t len, uint64_t *warning_flags)
+static int parse_rsp_qpiws(const uint8_t *read_ptr, size_t len, qpiws_response_t *response)
 {
   assert(read_ptr != NULL);
-  assert(warning_flags != NULL);
+  assert(response != NULL);
 
-  if (len > 64) {
-    len = 64;
+  if (len == 0 || len > QPIWS_MAX_LEN) {
+    return -1; // Malformed
   }
 
-  *warning_flags = 0;
-
-  for (int i = 0; i < len; i++) {
-    if (read_ptr[i] == '1') {
-      *warning_flags |= 0x1;
-    } else if (read_ptr[i] == '0') {
-    } else {
-      ESP_LOGE(TAG, "Invalid character in warning flags: %c", read_ptr[i]);
-    }
-
-    *warning_flags <<= 1;
+  if (pack_bits_lsb(read_ptr, len, &response->bits) != 0) {
+    ESP_LOGE(TAG, "Invalid character in warning flags");
+    return -2;
   }
 
+  response->len = (uint8_t)len;
   return 0;
 }
 
-static int parse_rsp_qpicf(const uint8_t *read_ptr, size_t len, uint32_t *fault)
+static int parse_rsp_qpicf(const uint8_t *read_ptr, size_t len, qpicf_response_t *fault)
 {
   assert(read_ptr != NULL);
   assert(fault != NULL);
-  const size_t msg_len = 4;
 
-  if (len != msg_len) {
+  if (len != sizeof(*fault)) {
     return -1; // Malformed
   }
 
-  *fault = 0;
-
-  for (int i = 0; i < len; i++) {
-    *fault |= read_ptr[i];
-    *fault <<= 8;
-  }
-
+  *fault = (uint32_t)read_ptr[0] << 24 | (uint32_t)read_ptr[1] << 16 | (uint32_t)read_ptr[2] << 8 | read_ptr[3];
   return 0;
 }
 
@@ -618,6 +824,61 @@ static int parse_rsp_qchgs(const uint8_t *read_ptr, size_t len, qchgs_response_t
 
   return 0;
 }
+// QET, QEY, QEM, QED, QEH response "NNNNNNNN", kWh for total/year/month, Wh for day/hour
+static int parse_rsp_energy(const uint8_t *read_ptr, size_t len, uint32_t *energy)
+{
+  assert(read_ptr != NULL);
+  assert(energy != NULL);
+  const size_t msg_len = 8;
+  int32_t value = 0;
+
+  if (len != msg_len) {
+    return -1; // Malformed
+  }
+
+  if (!em_fixed_parse((const char *)read_ptr, len, 0, &value) || value < 0) {
+    return -2;
+  }
+
+  *energy = (uint32_t)value;
+  return 0;
+}
+
+// QMCHGCR, QMUCHGCR response "NNN NNN NNN ..." - selectable currents in A
+static int parse_rsp_currents(const uint8_t *read_ptr, size_t len)
+{
+  assert(read_ptr != NULL);
+  const size_t min_msg_len = 3;
+
+  if (len < min_msg_len) {
+    return -1; // Malformed
+  }
+
+  for (size_t i = 0; i < len; i++) {
+    if ((read_ptr[i] < '0' || read_ptr[i] > '9') && read_ptr[i] != ' ') {
+      return -2;
+    }
+  }
+
+  return 0;
+}
+
+// validated response passed on as NUL terminated text
+static int copy_rsp_text(int err, const uint8_t *read_ptr, size_t len, char *text)
+{
+  if (err != 0) {
+    return err;
+  }
+
+  if (len + 1 > RS232_2400_TEXT_RSP_MAX_LEN) {
+    return -10;
+  }
+
+  memcpy(text, read_ptr, len);
+  text[len] = '\0';
+  return 0;
+}
+
 // returns number of processed bytes
 size_t rs232_2400_rsp_parse(uint16_t *rq_id, const uint8_t *data_in, size_t len_in, void *output, uint16_t *err)
 {
@@ -694,7 +955,8 @@ size_t rs232_2400_rsp_parse(uint16_t *rq_id, const uint8_t *data_in, size_t len_
 
   int nak_err = parse_rsp_is_nak(packet, packet_len);
 
-  if (nak_err == 0) {
+  // rejected setting is a regular response for its handler
+  if (nak_err == 0 && !is_set_cmd(*rq_id)) {
     *err = PARSE_STATUS_RQ_REJECTED;
     // ESP_LOGW(TAG, "cmd %#x NAKed", cmd);
     memcpy(output, packet, packet_len);
@@ -719,15 +981,17 @@ size_t rs232_2400_rsp_parse(uint16_t *rq_id, const uint8_t *data_in, size_t len_
   case EM_RS232_2400_QVFW3:
     *err = parse_rsp_qvfw(packet, packet_len, (uint64_t *)output);
     break;
-  case EM_RS232_2400_QPIRI:
-    *err = parse_rsp_qpiri(packet, packet_len, (qpiri_response_t *)output);
-    break;
+  case EM_RS232_2400_QPIRI: {
+    qpiri_response_t qpiri = {0};
+    *err = copy_rsp_text(parse_rsp_qpiri(packet, packet_len, &qpiri), packet, packet_len, (char *)output);
+  } break;
   case EM_RS232_2400_QMD:
     *err = parse_rsp_qmd(packet, packet_len, (char *)output);
     break;
-  case EM_RS232_2400_QFLAG:
-    *err = parse_rsp_qflag(packet, packet_len, (qflag_response_t *)output);
-    break;
+  case EM_RS232_2400_QFLAG: {
+    qflag_response_t qflag = {0};
+    *err = copy_rsp_text(parse_rsp_qflag(packet, packet_len, &qflag), packet, packet_len, (char *)output);
+  } break;
   case EM_RS232_2400_QPIGS:
     *err = parse_rsp_qpigs(packet, packet_len, ((qpigs_response_t *)output));
     break;
@@ -767,6 +1031,13 @@ size_t rs232_2400_rsp_parse(uint16_t *rq_id, const uint8_t *data_in, size_t len_
   case EM_RS232_2400_QPIHF:
     *err = parse_rsp_qpihf(packet, packet_len, (uint32_t *)output);
     break;
+  case EM_RS232_2400_QET:
+  case EM_RS232_2400_QEY:
+  case EM_RS232_2400_QEM:
+  case EM_RS232_2400_QED:
+  case EM_RS232_2400_QEH:
+    *err = parse_rsp_energy(packet, packet_len, (uint32_t *)output);
+    break;
   // case EM_RS232_2400_QBSDV: *err = parse_rsp_qbsdv(packet, packet_len,
   // (float*)output); break; case EM_RS232_2400_QPRIO: *err =
   // parse_rsp_qprio(packet, packet_len, (uint32_t*)output); break; case
@@ -780,40 +1051,152 @@ size_t rs232_2400_rsp_parse(uint16_t *rq_id, const uint8_t *data_in, size_t len_
   // (uint32_t*)output); break; case EM_RS232_2400_QLDT: *err =
   // parse_rsp_qldt(packet, packet_len, (uint32_t*)output); break; case
   // EM_RS232_2400_QBSDP: *err = parse_rsp_qbsdp(packet, packet_len,
-  // (uint32_t*)output); break; case EM_RS232_2400_QPIGS2: *err =
-  // parse_rsp_qpigs2(packet, packet_len, ((float*)output), ((float*)output +
-  // 1)); break;
+  // (uint32_t*)output); break;
+  case EM_RS232_2400_QPIGS2:
+    *err = parse_rsp_qpigs2(packet, packet_len, (qpigs2_response_t *)output);
+    break;
   case EM_RS232_2400_QCHGS:
     *err = parse_rsp_qchgs(packet, packet_len, (qchgs_response_t *)output);
     break;
   // case EM_RS232_2400_QVFTR: *err = parse_rsp_qvftr(packet, packet_len,
   // (float*)output); break;
   case EM_RS232_2400_QPICF:
-    *err = parse_rsp_qpicf(packet, packet_len, (uint32_t *)output);
+    *err = parse_rsp_qpicf(packet, packet_len, (qpicf_response_t *)output);
     break;
   case EM_RS232_2400_QPIWS:
-    *err = parse_rsp_qpiws(packet, packet_len, (uint64_t *)output);
+    *err = parse_rsp_qpiws(packet, packet_len, (qpiws_response_t *)output);
+    break;
+  case EM_RS232_2400_QMCHGCR:
+  case EM_RS232_2400_QMUCHGCR:
+    *err = copy_rsp_text(parse_rsp_currents(packet, packet_len), packet, packet_len, (char *)output);
     break;
   // case EM_RS232_2400_QDI: *err = parse_rsp_qdi(packet, packet_len,
-  // (uint32_t*)output); break; case EM_RS232_2400_QMCHGCR: *err =
-  // parse_rsp_qmchgcr(packet, packet_len, (uint32_t*)output); break; case
-  // EM_RS232_2400_QMUCHGCR: *err = parse_rsp_qmuchgcr(packet, packet_len,
   // (uint32_t*)output); break; case EM_RS232_2400_QBOOT: *err =
   // parse_rsp_qboot(packet, packet_len, (uint32_t*)output); break; case
   // EM_RS232_2400_QOPM: *err = parse_rsp_qopm(packet, packet_len,
   // (uint32_t*)output); break;
   default:
+    if (is_set_cmd(*rq_id)) {
+      *err = parse_rsp_ack(packet, packet_len, (uint32_t *)output);
+      break;
+    }
+
     ESP_LOGW(TAG, "Unsupported rq %d", *rq_id);
     return packet_end_offset + 1; // Unsupported command
   }
 
+  // serial client acks and dispatches only PARSE_STATUS_OK, parsers return 0 or negative error
   if (*err == 0) {
     valid_cnt++;
+    *err = PARSE_STATUS_OK;
+  } else {
+    *err = PARSE_STATUS_PACKET_MALFORMED;
   }
 
   return packet_end_offset + 1; // consume packet with '\r'
 }
 
+int rs232_2400_qpiri_settings(const char *text, qpiri_settings_t *settings)
+{
+  assert(text != NULL);
+
+  return parse_qpiri_settings((const uint8_t *)text, strlen(text), settings) == 0 ? 0 : -1;
+}
+
+uint16_t rs232_2400_set_cmd(const uint8_t *rq, size_t len)
+{
+  assert(rq != NULL);
+
+  static const struct {
+    const char *prefix;
+    uint16_t cmd;
+  } set_cmds[] = {
+    {"PE", EM_RS232_2400_PE},         {"PD", EM_RS232_2400_PD},         {"PF", EM_RS232_2400_PF},
+    {"F", EM_RS232_2400_F},           {"POP", EM_RS232_2400_POP},       {"PBCV", EM_RS232_2400_PBCV},
+    {"PBDV", EM_RS232_2400_PBDV},     {"PCP", EM_RS232_2400_PCP},       {"PGR", EM_RS232_2400_PGR},
+    {"PBT", EM_RS232_2400_PBT},       {"PSDV", EM_RS232_2400_PSDV},     {"PCVV", EM_RS232_2400_PCVV},
+    {"PBFT", EM_RS232_2400_PBFT},     {"DAT", EM_RS232_2400_DAT},       {"GOLF", EM_RS232_2400_GOLF},
+    {"GOHF", EM_RS232_2400_GOHF},     {"GOLV", EM_RS232_2400_GOLV},     {"GOHV", EM_RS232_2400_GOHV},
+    {"OPMP", EM_RS232_2400_OPMP},     {"MPPTHV", EM_RS232_2400_MPPTHV}, {"MPPTLV", EM_RS232_2400_MPPTLV},
+    {"PVIPHV", EM_RS232_2400_PVIPHV}, {"PVIPLV", EM_RS232_2400_PVIPLV}, {"LST", EM_RS232_2400_LST},
+    {"MCHGC", EM_RS232_2400_MCHGC},   {"MCHGV", EM_RS232_2400_MCHGV},   {"BCHGV", EM_RS232_2400_BCHGV},
+    {"GLTHV", EM_RS232_2400_GLTHV},   {"BSDV", EM_RS232_2400_BSDV},     {"DSUBV", EM_RS232_2400_DSUBV},
+    {"PRIO", EM_RS232_2400_PRIO},     {"ENF", EM_RS232_2400_ENF},       {"LBF", EM_RS232_2400_LBF},
+    {"SOPF", EM_RS232_2400_SOPF},     {"SMDCC", EM_RS232_2400_SMDCC},   {"ABGP", EM_RS232_2400_ABGP},
+    {"PKT", EM_RS232_2400_PKT},       {"LDT", EM_RS232_2400_LDT},       {"BSDP", EM_RS232_2400_BSDP},
+    {"DMODEL", EM_RS232_2400_DMODEL}, {"PSPB", EM_RS232_2400_PSPB},     {"MUCHGC", EM_RS232_2400_MUCHGC},
+  };
+
+  uint16_t cmd = EM_RS232_2400_NONE;
+  size_t cmd_len = 0;
+
+  // longest matching prefix, the rest are arguments
+  for (size_t i = 0; i < sizeof(set_cmds) / sizeof(set_cmds[0]); i++) {
+    size_t prefix_len = strlen(set_cmds[i].prefix);
+
+    if (prefix_len > cmd_len && prefix_len <= len && memcmp(rq, set_cmds[i].prefix, prefix_len) == 0) {
+      cmd = set_cmds[i].cmd;
+      cmd_len = prefix_len;
+    }
+  }
+
+  for (size_t i = cmd_len; i < len; i++) {
+    if (rq[i] <= ' ' || rq[i] > '~' || rq[i] == '(') {
+      return EM_RS232_2400_NONE; // would break the framing
+    }
+  }
+
+  return cmd;
+}
+
+size_t rs232_2400_energy_rq(uint16_t cmd, const struct tm *date, uint8_t *out, size_t out_len)
+{
+  assert(date != NULL);
+  assert(out != NULL);
+
+  char rq[24] = {0};
+  int len = 0;
+
+  switch (cmd) {
+  case EM_RS232_2400_QET:
+    len = snprintf(rq, sizeof(rq), "QET");
+    break;
+  case EM_RS232_2400_QEY:
+    len = snprintf(rq, sizeof(rq), "QEY%04d", date->tm_year + 1900);
+    break;
+  case EM_RS232_2400_QEM:
+    len = snprintf(rq, sizeof(rq), "QEM%04d%02d", date->tm_year + 1900, date->tm_mon + 1);
+    break;
+  case EM_RS232_2400_QED:
+    len = snprintf(rq, sizeof(rq), "QED%04d%02d%02d", date->tm_year + 1900, date->tm_mon + 1, date->tm_mday);
+    break;
+  case EM_RS232_2400_QEH:
+    len = snprintf(rq, sizeof(rq), "QEH%04d%02d%02d%02d", date->tm_year + 1900, date->tm_mon + 1, date->tm_mday,
+                   date->tm_hour);
+    break;
+  default:
+    return 0;
+  }
+
+  if (cmd != EM_RS232_2400_QET) {
+    // dated inquiries end with "nnn", sum of the preceding characters
+    uint32_t sum = 0;
+
+    for (int i = 0; i < len; i++) {
+      sum += (uint8_t)rq[i];
+    }
+
+    len += snprintf(&rq[len], sizeof(rq) - len, "%03lu", sum % 1000);
+  }
+
+  if (len <= 0 || (size_t)len > out_len) {
+    return 0;
+  }
+
+  memcpy(out, rq, len);
+  return (size_t)len;
+}
+
 uint8_t *rs232_2400_serialize(uint16_t cmd, const uint8_t *payload, size_t payload_len, size_t *out_len)
 {
   *out_len = payload_len + 2 + 1; //  + 2 ASCII CRC + '\r'
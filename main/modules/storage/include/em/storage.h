@@ -14,6 +14,9 @@
 #define QUARTERS_IN_DAY       (24UL * 4UL)
 #define MAX_METER_ENTRIES     (48)
 #define MAX_ENERGY_ENTRIES    (4 * 24) // quarters for the whole day
+#define MAX_POLL_PLAN_ITEMS   (8)
+#define MAX_POLL_PLAN_DBS     (8)
+#define MAX_PRICE_DAYS        (2) // today and tomorrow
 
 typedef enum storage_section_e {
   STORAGE,
@@ -21,7 +24,16 @@ typedef enum storage_section_e {
   STORAGE_DEVICE,
   /* Contains device's datasets */
   STORAGE_DS,
-  STORAGE_MASK = 1U << STORAGE_DEVICE | 1U << STORAGE_DS,
+  /* Contains checkpoint of cumulative energy counters */
+  STORAGE_ENERGY,
+  /* Contains poll plan pushed by the server */
+  STORAGE_POLL_PLAN,
+  /* Contains last known inverter state, restored as stale at boot */
+  STORAGE_INV_STATE,
+  /* Contains energy price lists of the days */
+  STORAGE_PRICES,
+  STORAGE_MASK = 1U << STORAGE_DEVICE | 1U << STORAGE_DS | 1U << STORAGE_ENERGY | 1U << STORAGE_POLL_PLAN |
+                 1U << STORAGE_INV_STATE | 1U << STORAGE_PRICES,
 } storage_section_t;
 
 typedef struct {
@@ -50,6 +62,85 @@ typedef struct {
   flash_ds_t perm;
 } storage_datasets_t;
 
+/* Cumulative energy since install, in Ws */
+typedef struct {
+  uint64_t grid_consumed;
+  uint64_t grid_provided;
+  uint64_t ac_output;
+  uint64_t pv;
+  uint64_t battery_charge;
+  uint64_t battery_discharge;
+} __attribute__((packed)) storage_energy_counters_t;
+
+typedef struct {
+  /* checksum has to be the first member */
+  uint32_t checksum;
+  storage_energy_counters_t counters;
+} __attribute__((packed)) flash_energy_t;
+
+/* Serial commands polled from the inverter and deadbands of the channels, empty plan means defaults */
+typedef struct {
+  uint8_t polls_num;
+  uint16_t cmds[MAX_POLL_PLAN_ITEMS];
+  uint32_t intervals[MAX_POLL_PLAN_ITEMS]; // in ms
+  uint8_t priorities[MAX_POLL_PLAN_ITEMS];
+  uint8_t deadbands_num;
+  uint8_t channels[MAX_POLL_PLAN_DBS];
+  uint32_t thresholds[MAX_POLL_PLAN_DBS];
+  uint32_t max_silences[MAX_POLL_PLAN_DBS]; // in s
+} __attribute__((packed)) storage_poll_plan_t;
+
+typedef struct {
+  /* checksum has to be the first member */
+  uint32_t checksum;
+  storage_poll_plan_t plan;
+} __attribute__((packed)) flash_poll_plan_t;
+
+/* Last measurements, status and identity of the inverter, zero timestamp means nothing stored */
+typedef struct {
+  int64_t timestamp; // of the last measurement
+  uint16_t grid_voltage;
+  uint16_t grid_power;
+  uint16_t grid_freq;
+  uint16_t battery_voltage;
+  int32_t battery_charge_power;
+  uint16_t ac_out_voltage;
+  uint32_t ac_out_power;
+  uint16_t ac_out_freq;
+  uint8_t ac_out_load;
+  uint16_t ac_out_power_factor;
+  uint16_t pv_voltage;
+  uint32_t pv_power;
+  uint32_t mode;
+  uint32_t status_flags;
+  uint64_t warning_flags;
+  uint32_t fault_code;
+  uint32_t fw_ver;
+  uint32_t protocol_ver;
+  char model[16];
+} __attribute__((packed)) storage_inv_state_t;
+
+typedef struct {
+  /* checksum has to be the first member */
+  uint32_t checksum;
+  storage_inv_state_t state;
+} __attribute__((packed)) flash_inv_state_t;
+
+/* Prices of equal slots from the day start, zero prices_len means empty entry */
+typedef struct {
+  int64_t day; // start of the day
+  uint16_t tariff;
+  int8_t price_factor;
+  uint16_t prices_len;
+  int16_t prices[QUARTERS_IN_DAY];
+} __attribute__((packed)) storage_price_day_t;
+
+typedef struct {
+  /* checksum has to be the first member */
+  uint32_t checksum;
+  storage_price_day_t days[MAX_PRICE_DAYS];
+} __attribute__((packed)) flash_prices_t;
+
 typedef struct {
   uint16_t len;
   int32_t current_val;
@@ -79,6 +170,10 @@ typedef struct database_s {
   storage_meter_t meter_power;
   storage_energy_t meter_energy;
   storage_datasets_t ds;
+  flash_energy_t energy;
+  flash_poll_plan_t poll_plan;
+  flash_inv_state_t inv_state;
+  flash_prices_t prices;
 } database_t;
 
 void storage_init(void);
@@ -90,10 +185,17 @@ storage_device_t storage_device(void);
 storage_datasets_t storage_datasets(void);
 
 void storage_set_device_unique_id(uint32_t unique_id);
-void storage_set_energy_price_list(uint16_t tariff, int8_t price_factor, time_t day, int16_t *prices, uint32_t prices_len);
+void storage_set_energy_price_list(uint16_t tariff, int8_t price_factor, time_t day, const int16_t *prices, uint32_t prices_len);
+bool storage_energy_price_list(time_t ts, storage_price_day_t *out);
 void storage_increase_energy_accumulated(uint64_t delta_energy);
 uint64_t storage_energy_accumulated();
 void storage_set_coordinates(int64_t latitude, int64_t longitude);
+storage_energy_counters_t storage_energy_counters(void);
+void storage_set_energy_counters(const storage_energy_counters_t *counters, bool save);
+storage_poll_plan_t storage_poll_plan(void);
+void storage_set_poll_plan(const storage_poll_plan_t *plan);
+storage_inv_state_t storage_inv_state(void);
+void storage_set_inv_state(const storage_inv_state_t *state);
 
 int storage_set_meter_value(time_t datetime, uint16_t meas_type, int32_t value);
 int32_t storage_meter_value(uint16_t meas_type, time_t *timestamp);
@@ -5,6 +5,7 @@
 #include "em/protocol.h"
 #include "em/scheduler.h"
 #include "em/storage.h"
+#include "em/time.h"
 #include "em/utils.h"
 
 #include <stdint.h>
@@ -128,6 +129,70 @@ static struct nvs_mapper_s {
                     .section = STORAGE_DS,
                     .is_used = true,
                   },
+                  {
+                    .entry_db_ptr = &database.energy.checksum,
+                    .entry_size = sizeof(database.energy.checksum),
+                    .entry_type = NVS_TYPE_U32,
+                    .key = "e/crc",
+                    .section = STORAGE_ENERGY,
+                    .is_used = true,
+                  },
+                  {
+                    .entry_db_ptr = &database.energy.counters,
+                    .entry_size = sizeof(database.energy.counters),
+                    .entry_type = NVS_TYPE_BLOB,
+                    .key = "e/counters",
+                    .section = STORAGE_ENERGY,
+                    .is_used = true,
+                  },
+                  {
+                    .entry_db_ptr = &database.poll_plan.checksum,
+                    .entry_size = sizeof(database.poll_plan.checksum),
+                    .entry_type = NVS_TYPE_U32,
+                    .key = "pp/crc",
+                    .section = STORAGE_POLL_PLAN,
+                    .is_used = true,
+                  },
+                  {
+                    .entry_db_ptr = &database.poll_plan.plan,
+                    .entry_size = sizeof(database.poll_plan.plan),
+                    .entry_type = NVS_TYPE_BLOB,
+                    .key = "pp/plan",
+                    .section = STORAGE_POLL_PLAN,
+                    .is_used = true,
+                  },
+                  {
+                    .entry_db_ptr = &database.inv_state.checksum,
+                    .entry_size = sizeof(database.inv_state.checksum),
+                    .entry_type = NVS_TYPE_U32,
+                    .key = "is/crc",
+                    .section = STORAGE_INV_STATE,
+                    .is_used = true,
+                  },
+                  {
+                    .entry_db_ptr = &database.inv_state.state,
+                    .entry_size = sizeof(database.inv_state.state),
+                    .entry_type = NVS_TYPE_BLOB,
+                    .key = "is/state",
+                    .section = STORAGE_INV_STATE,
+                    .is_used = true,
+                  },
+                  {
+                    .entry_db_ptr = &database.prices.checksum,
+                    .entry_size = sizeof(database.prices.checksum),
+                    .entry_type = NVS_TYPE_U32,
+                    .key = "pr/crc",
+                    .section = STORAGE_PRICES,
+                    .is_used = true,
+                  },
+                  {
+                    .entry_db_ptr = &database.prices.days,
+                    .entry_size = sizeof(database.prices.days),
+                    .entry_type = NVS_TYPE_BLOB,
+                    .key = "pr/days",
+                    .section = STORAGE_PRICES,
+                    .is_used = true,
+                  },
                 };
 
 static esp_err_t process_db_entry(nvs_handle_t handle, void *entry_db_pointer, size_t entry_size, const char *key, nvs_type_t nvs_type, nvs_db_action_t action)
@@ -314,6 +379,26 @@ static void write_db_entries(nvs_handle_t handle)
   }
 }
 
+static uint32_t energy_checksum(void)
+{
+  return esp_rom_crc32_le(0, (uint8_t *)&database.energy.counters, sizeof(database.energy.counters));
+}
+
+static uint32_t poll_plan_checksum(void)
+{
+  return esp_rom_crc32_le(0, (uint8_t *)&database.poll_plan.plan, sizeof(database.poll_plan.plan));
+}
+
+static uint32_t inv_state_checksum(void)
+{
+  return esp_rom_crc32_le(0, (uint8_t *)&database.inv_state.state, sizeof(database.inv_state.state));
+}
+
+static uint32_t prices_checksum(void)
+{
+  return esp_rom_crc32_le(0, (uint8_t *)&database.prices.days, sizeof(database.prices.days));
+}
+
 static void save_crc_of_section(nvs_handle_t handle, storage_section_t section)
 {
   void *crc_ptr = NULL;
@@ -325,6 +410,11 @@ static void save_crc_of_section(nvs_handle_t handle, storage_section_t section)
 
   case STORAGE_DS:
     crc_ptr = &database.ds.perm.checksum;
+    break;
+
+  case STORAGE_INV_STATE:
+    crc_ptr = &database.inv_state.checksum;
+    break;
 
   default:
     return;
@@ -338,6 +428,16 @@ static void save_crc_of_section(nvs_handle_t handle, storage_section_t section)
   ESP_ERROR_CHECK(nvs_set_u32(handle, nvs_mapper[idx].key, *((uint32_t *)crc_ptr)));
 }
 
+static void call_on_changed_callbacks(void)
+{
+  on_changed_cb_node_t *node, *temp;
+
+  SLIST_FOREACH_SAFE(node, &storage_slist, next, temp)
+  {
+    node->callback();
+  }
+}
+
 static void dump_check(uint32_t param, void *user_ctx)
 {
   ESP_UNUSED(param);
@@ -375,6 +475,15 @@ static void dump_check(uint32_t param, void *user_ctx)
     }
   }
 
+  if (dump_request & (1U << STORAGE_INV_STATE)) {
+    crc32 = inv_state_checksum();
+    if (crc32 == database.inv_state.checksum) {
+      dump_request &= ~(1U << STORAGE_INV_STATE);
+    } else {
+      database.inv_state.checksum = crc32;
+    }
+  }
+
   if (!dump_request) {
     /* Checksum did not change */
     ESP_LOGI(LOG_TAG, "No change in storage checksum");
@@ -397,18 +506,16 @@ static void dump_check(uint32_t param, void *user_ctx)
     save_crc_of_section(handle, STORAGE_DS);
   }
 
+  if (dump_request & (1U << STORAGE_INV_STATE)) {
+    save_crc_of_section(handle, STORAGE_INV_STATE);
+  }
+
   dump_request = 0U;
   /* Save all pending nvs_set_* calls */
   ESP_ERROR_CHECK(nvs_commit(handle));
   nvs_close(handle);
 
-  /* Call on storage changed callbacks */
-  on_changed_cb_node_t *node, *temp;
-
-  SLIST_FOREACH_SAFE(node, &storage_slist, next, temp)
-  {
-    node->callback();
-  }
+  call_on_changed_callbacks();
 }
 
 static void section_dump_request(enum storage_section_e section)
@@ -447,12 +554,56 @@ static void storage_save_db_entry(void *entry_db_ptr)
   section_dump_request(nvs_mapper[idx].section);
 }
 
+/* Blob and its checksum (already updated in RAM) are written from the same RAM copy and committed at once, so no new
+ * value can get in between them. Has to be called with storage_mtx taken.
+ */
+static esp_err_t storage_save_checked_entry(void *entry_db_ptr, void *crc_ptr)
+{
+  assert(entry_db_ptr);
+  assert(crc_ptr);
+
+  uint32_t idx = find_entry_db_idx(entry_db_ptr);
+  uint32_t crc_idx = find_entry_db_idx(crc_ptr);
+  if (idx == ENTRY_NOT_FOUND || crc_idx == ENTRY_NOT_FOUND) {
+    ESP_LOGE(LOG_TAG, "Can't find such entry in database");
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  nvs_handle_t handle = 0;
+  esp_err_t ret = nvs_open(__STRINGIFY(STORAGE), NVS_READWRITE, &handle);
+  if (ret) {
+    ESP_LOGE(LOG_TAG, "Can't open storage:0x%04X", ret);
+    return ret;
+  }
+
+  ret = process_db_entry(handle, nvs_mapper[idx].entry_db_ptr, nvs_mapper[idx].entry_size, nvs_mapper[idx].key, nvs_mapper[idx].entry_type, NVS_WRITE);
+
+  if (ret == ESP_OK) {
+    ret = process_db_entry(handle, nvs_mapper[crc_idx].entry_db_ptr, nvs_mapper[crc_idx].entry_size, nvs_mapper[crc_idx].key,
+                           nvs_mapper[crc_idx].entry_type, NVS_WRITE);
+  }
+
+  if (ret == ESP_OK) {
+    ret = nvs_commit(handle);
+  }
+
+  if (ret) {
+    ESP_LOGE(LOG_TAG, "Can't write entry=%lu:0x%04X", idx, ret);
+  }
+
+  nvs_close(handle);
+  return ret;
+}
+
 static void save_database(void)
 {
   nvs_handle_t handle = 0;
   ESP_ERROR_CHECK(nvs_open(__STRINGIFY(STORAGE), NVS_READWRITE, &handle));
 
   xSemaphoreTake(storage_mtx, portMAX_DELAY);
+  /* Energy counters and inverter state are updated in RAM without the dump, refresh their checksums */
+  database.energy.checksum = energy_checksum();
+  database.inv_state.checksum = inv_state_checksum();
   write_db_entries(handle);
   ESP_ERROR_CHECK(nvs_commit(handle));
   xSemaphoreGive(storage_mtx);
@@ -529,6 +680,26 @@ void storage_init(void)
   clear_unused_db_entries(handle);
   read_db_entries(handle);
 
+  if (energy_checksum() != database.energy.checksum) {
+    ESP_LOGW(LOG_TAG, "Energy counters invalid, reset");
+    memset(&database.energy, 0, sizeof(database.energy));
+  }
+
+  if (poll_plan_checksum() != database.poll_plan.checksum) {
+    ESP_LOGW(LOG_TAG, "Poll plan invalid, reset");
+    memset(&database.poll_plan, 0, sizeof(database.poll_plan));
+  }
+
+  if (inv_state_checksum() != database.inv_state.checksum) {
+    ESP_LOGW(LOG_TAG, "Inverter state invalid, reset");
+    memset(&database.inv_state, 0, sizeof(database.inv_state));
+  }
+
+  if (prices_checksum() != database.prices.checksum) {
+    ESP_LOGW(LOG_TAG, "Price lists invalid, reset");
+    memset(&database.prices, 0, sizeof(database.prices));
+  }
+
   nvs_close(handle);
   ESP_LOGI(LOG_TAG, "Storage initialized");
 }
@@ -567,6 +738,138 @@ void storage_set_coordinates(int64_t latitude, int64_t longitude)
   xSemaphoreGive(storage_mtx);
 }
 
+storage_energy_counters_t storage_energy_counters(void)
+{
+  xSemaphoreTake(storage_mtx, portMAX_DELAY);
+  storage_energy_counters_t counters = database.energy.counters;
+  xSemaphoreGive(storage_mtx);
+  return counters;
+}
+
+/* Without save only RAM copy is updated, it gets to flash with the next save or with the shutdown dump */
+void storage_set_energy_counters(const storage_energy_counters_t *counters, bool save)
+{
+  assert(counters);
+
+  esp_err_t ret = ESP_OK;
+
+  xSemaphoreTake(storage_mtx, portMAX_DELAY);
+  database.energy.counters = *counters;
+
+  if (save) {
+    database.energy.checksum = energy_checksum();
+    ret = storage_save_checked_entry(&database.energy.counters, &database.energy.checksum);
+  }
+
+  xSemaphoreGive(storage_mtx);
+
+  if (save && ret == ESP_OK) {
+    call_on_changed_callbacks();
+  }
+}
+
+storage_poll_plan_t storage_poll_plan(void)
+{
+  xSemaphoreTake(storage_mtx, portMAX_DELAY);
+  storage_poll_plan_t plan = database.poll_plan.plan;
+  xSemaphoreGive(storage_mtx);
+  return plan;
+}
+
+void storage_set_poll_plan(const storage_poll_plan_t *plan)
+{
+  assert(plan);
+
+  xSemaphoreTake(storage_mtx, portMAX_DELAY);
+  database.poll_plan.plan = *plan;
+  database.poll_plan.checksum = poll_plan_checksum();
+  esp_err_t ret = storage_save_checked_entry(&database.poll_plan.plan, &database.poll_plan.checksum);
+  xSemaphoreGive(storage_mtx);
+
+  if (ret == ESP_OK) {
+    call_on_changed_callbacks();
+  }
+}
+
+storage_inv_state_t storage_inv_state(void)
+{
+  xSemaphoreTake(storage_mtx, portMAX_DELAY);
+  storage_inv_state_t state = database.inv_state.state;
+  xSemaphoreGive(storage_mtx);
+  return state;
+}
+
+/* Updated too often for the flash, only RAM copy is updated and it gets to flash with the shutdown dump */
+void storage_set_inv_state(const storage_inv_state_t *state)
+{
+  assert(state);
+
+  xSemaphoreTake(storage_mtx, portMAX_DELAY);
+  database.inv_state.state = *state;
+  xSemaphoreGive(storage_mtx);
+}
+
+/* List of the same day is replaced, otherwise the one of the oldest day */
+void storage_set_energy_price_list(uint16_t tariff, int8_t price_factor, time_t day, const int16_t *prices, uint32_t prices_len)
+{
+  assert(prices);
+
+  if (prices_len > QUARTERS_IN_DAY) {
+    prices_len = QUARTERS_IN_DAY;
+  }
+
+  xSemaphoreTake(storage_mtx, portMAX_DELAY);
+  storage_price_day_t *entry = &database.prices.days[0];
+
+  for (uint32_t i = 0; i < MAX_PRICE_DAYS; i++) {
+    storage_price_day_t *d = &database.prices.days[i];
+
+    if (d->day == day) {
+      entry = d;
+      break;
+    }
+
+    if (d->day < entry->day) {
+      entry = d;
+    }
+  }
+
+  memset(entry, 0, sizeof(*entry));
+  entry->day = day;
+  entry->tariff = tariff;
+  entry->price_factor = price_factor;
+  entry->prices_len = (uint16_t)prices_len;
+  memcpy(entry->prices, prices, prices_len * sizeof(prices[0]));
+  database.prices.checksum = prices_checksum();
+  esp_err_t ret = storage_save_checked_entry(&database.prices.days, &database.prices.checksum);
+  xSemaphoreGive(storage_mtx);
+
+  if (ret == ESP_OK) {
+    call_on_changed_callbacks();
+  }
+}
+
+/* Price list of the day containing ts, false when there is none */
+bool storage_energy_price_list(time_t ts, storage_price_day_t *out)
+{
+  assert(out);
+  bool found = false;
+
+  xSemaphoreTake(storage_mtx, portMAX_DELAY);
+  for (uint32_t i = 0; i < MAX_PRICE_DAYS; i++) {
+    const storage_price_day_t *d = &database.prices.days[i];
+
+    if (d->prices_len > 0 && ts >= d->day && ts < d->day + (int64_t)SECONDS_IN_DAY) {
+      *out = *d;
+      found = true;
+      break;
+    }
+  }
+  xSemaphoreGive(storage_mtx);
+
+  return found;
+}
+
 int32_t storage_meter_value(uint16_t meas_type, time_t *timestamp)
 {
   int32_t ret = INT32_MAX;
@@ -3,31 +3,90 @@
  */
 
 #include "em/buffer.h"
+#include "em/buffer_pool.h"
 
+#include <assert.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 
 void buffer_clean(buffer_t *ptr)
 {
   ptr->len = 0;
+  ptr->head = 0;
 }
 
 void buffer_pop_front(buffer_t *ptr, uint16_t num)
 {
-  if (ptr->len <= num) {
-    ptr->len = 0;
+  if (buffer_available(ptr) <= num) {
+    buffer_clean(ptr);
     return;
   }
 
-  memcpy(ptr->data, ptr->data + num, ptr->len - num);
-  ptr->len -= num;
+  ptr->head += num;
 }
 
 void buffer_push(buffer_t *ptr, uint8_t byte)
 {
+  if (ptr->len >= ptr->cap) {
+    buffer_compact(ptr);
+  }
+
+  assert(ptr->len < ptr->cap);
   ptr->data[ptr->len++] = byte;
 }
 
+int buffer_append(buffer_t *ptr, const uint8_t *data, uint16_t len)
+{
+  if (buffer_available(ptr) + len > ptr->cap) {
+    return -1;
+  }
+
+  if (ptr->len + len > ptr->cap) {
+    buffer_compact(ptr);
+  }
+
+  memcpy(ptr->data + ptr->len, data, len);
+  ptr->len += len;
+  return 0;
+}
+
+uint16_t buffer_available(const buffer_t *ptr)
+{
+  return ptr->len - ptr->head;
+}
+
+const uint8_t *buffer_peek(const buffer_t *ptr)
+{
+  return ptr->data + ptr->head;
+}
+
+buffer_slice_t buffer_slice(const buffer_t *ptr, uint16_t offset, uint16_t len)
+{
+  buffer_slice_t slice = {.data = NULL, .len = 0};
+  uint16_t available = buffer_available(ptr);
+
+  if (offset > available) {
+    return slice;
+  }
+
+  slice.data = ptr->data + ptr->head + offset;
+  slice.len = (len > available - offset) ? available - offset : len;
+  return slice;
+}
+
+void buffer_compact(buffer_t *ptr)
+{
+  if (ptr->head == 0) {
+    return;
+  }
+
+  uint16_t available = buffer_available(ptr);
+  memmove(ptr->data, ptr->data + ptr->head, available);
+  ptr->head = 0;
+  ptr->len = available;
+}
+
 void buffer_dynamic_alloc(buffer_t *ptr, uint16_t cap)
 {
   if (ptr->data != NULL && ptr->dynamic) {
@@ -40,11 +99,16 @@ void buffer_dynamic_alloc(buffer_t *ptr, uint16_t cap)
   assert(ptr->data);
   ptr->cap = cap;
   ptr->len = 0;
+  ptr->head = 0;
   ptr->dynamic = true;
 }
 
 void em_buffer_free(buffer_t *ptr)
 {
+  if (buffer_pool_release(ptr)) {
+    return;
+  }
+
   if (ptr->data != NULL && ptr->dynamic) {
     free(ptr->data);
   }
@@ -52,4 +116,5 @@ void em_buffer_free(buffer_t *ptr)
   ptr->data = NULL;
   ptr->cap = 0;
   ptr->len = 0;
+  ptr->head = 0;
 }
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#include "em/buffer_pool.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#include <freertos/FreeRTOS.h>
+
+#include <esp_log.h>
+#define LOG_TAG "em_buf_pool"
+
+typedef struct {
+  uint8_t *storage;
+  uint16_t buf_size;
+  uint8_t total;
+  uint8_t free_cnt;
+  uint8_t *free_stack; // indexes of free buffers, top at free_cnt - 1
+  uint8_t high_water;
+  uint32_t exhausted;
+} pool_class_t;
+
+static uint8_t small_storage[CONFIG_EM_BUFFER_POOL_SMALL_CNT][CONFIG_EM_BUFFER_POOL_SMALL_SIZE];
+static uint8_t medium_storage[CONFIG_EM_BUFFER_POOL_MEDIUM_CNT][CONFIG_EM_BUFFER_POOL_MEDIUM_SIZE];
+static uint8_t large_storage[CONFIG_EM_BUFFER_POOL_LARGE_CNT][CONFIG_EM_BUFFER_POOL_LARGE_SIZE];
+
+static uint8_t small_free[CONFIG_EM_BUFFER_POOL_SMALL_CNT];
+static uint8_t medium_free[CONFIG_EM_BUFFER_POOL_MEDIUM_CNT];
+static uint8_t large_free[CONFIG_EM_BUFFER_POOL_LARGE_CNT];
+
+static pool_class_t classes[BUFFER_POOL_CLASSES_CNT] = {
+  [BUFFER_POOL_SMALL] = {.storage = &small_storage[0][0],
+                         .buf_size = CONFIG_EM_BUFFER_POOL_SMALL_SIZE,
+                         .total = CONFIG_EM_BUFFER_POOL_SMALL_CNT,
+                         .free_stack = small_free},
+  [BUFFER_POOL_MEDIUM] = {.storage = &medium_storage[0][0],
+                          .buf_size = CONFIG_EM_BUFFER_POOL_MEDIUM_SIZE,
+                          .total = CONFIG_EM_BUFFER_POOL_MEDIUM_CNT,
+                          .free_stack = medium_free},
+  [BUFFER_POOL_LARGE] = {.storage = &large_storage[0][0],
+                         .buf_size = CONFIG_EM_BUFFER_POOL_LARGE_SIZE,
+                         .total = CONFIG_EM_BUFFER_POOL_LARGE_CNT,
+                         .free_stack = large_free},
+};
+
+static portMUX_TYPE pool_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool initialized = false;
+
+// called with pool_lock taken
+static void pool_init(void)
+{
+  for (size_t c = 0; c < BUFFER_POOL_CLASSES_CNT; c++) {
+    for (uint8_t i = 0; i < classes[c].total; i++) {
+      classes[c].free_stack[i] = i;
+    }
+
+    classes[c].free_cnt = classes[c].total;
+  }
+
+  initialized = true;
+}
+
+int buffer_pool_alloc(buffer_t *ptr, uint16_t cap)
+{
+  assert(ptr != NULL);
+
+  int ret = -1;
+  int first_fit = -1;
+
+  taskENTER_CRITICAL(&pool_lock);
+
+  if (!initialized) {
+    pool_init();
+  }
+
+  for (size_t c = 0; c < BUFFER_POOL_CLASSES_CNT; c++) {
+    pool_class_t *pc = &classes[c];
+
+    if (pc->buf_size < cap) {
+      continue;
+    }
+
+    if (first_fit < 0) {
+      first_fit = c;
+    }
+
+    if (pc->free_cnt == 0) {
+      continue;
+    }
+
+    uint8_t idx = pc->free_stack[--pc->free_cnt];
+    uint8_t in_use = pc->total - pc->free_cnt;
+
+    if (in_use > pc->high_water) {
+      pc->high_water = in_use;
+    }
+
+    ptr->data = pc->storage + (size_t)idx * pc->buf_size;
+    ptr->cap = cap;
+    ptr->len = 0;
+    ptr->head = 0;
+    ptr->dynamic = false;
+    ret = 0;
+    break;
+  }
+
+  if (ret != 0 && first_fit >= 0) {
+    classes[first_fit].exhausted++;
+  }
+
+  taskEXIT_CRITICAL(&pool_lock);
+
+  if (ret != 0) {
+    ESP_LOGW(LOG_TAG, "No pool buffer for %u B", cap);
+  }
+
+  return ret;
+}
+
+bool buffer_pool_release(buffer_t *ptr)
+{
+  assert(ptr != NULL);
+
+  if (ptr->data == NULL) {
+    return false;
+  }
+
+  for (size_t c = 0; c < BUFFER_POOL_CLASSES_CNT; c++) {
+    pool_class_t *pc = &classes[c];
+    const uint8_t *end = pc->storage + (size_t)pc->total * pc->buf_size;
+
+    if (ptr->data < pc->storage || ptr->data >= end) {
+      continue;
+    }
+
+    size_t idx = (size_t)(ptr->data - pc->storage) / pc->buf_size;
+
+    taskENTER_CRITICAL(&pool_lock);
+    assert(pc->free_cnt < pc->total);
+    pc->free_stack[pc->free_cnt++] = (uint8_t)idx;
+    taskEXIT_CRITICAL(&pool_lock);
+
+    ptr->data = NULL;
+    ptr->cap = 0;
+    ptr->len = 0;
+    ptr->head = 0;
+    return true;
+  }
+
+  return false;
+}
+
+void buffer_pool_get_stats(buffer_pool_class_t cls, buffer_pool_stats_t *stats)
+{
+  assert(cls < BUFFER_POOL_CLASSES_CNT);
+  assert(stats != NULL);
+
+  taskENTER_CRITICAL(&pool_lock);
+  const pool_class_t *pc = &classes[cls];
+  stats->buf_size = pc->buf_size;
+  stats->total = pc->total;
+  stats->in_use = initialized ? pc->total - pc->free_cnt : 0;
+  stats->high_water = pc->high_water;
+  stats->exhausted = pc->exhausted;
+  taskEXIT_CRITICAL(&pool_lock);
+}
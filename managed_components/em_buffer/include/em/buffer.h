@@ -8,15 +8,31 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+/*
+ * Unread data is in range [head, len). Consuming data only moves head,
+ * content is moved to the beginning only when space is needed at the end.
+ */
 typedef struct {
   uint8_t *data;
   uint16_t cap;
   uint16_t len;
+  uint16_t head; // read offset
   bool dynamic;
 } buffer_t;
 
+// read-only view of buffer content, valid until the buffer is modified
+typedef struct {
+  const uint8_t *data;
+  uint16_t len;
+} buffer_slice_t;
+
 void buffer_pop_front(buffer_t *ptr, uint16_t num);
 void buffer_push(buffer_t *ptr, uint8_t byte);
+int buffer_append(buffer_t *ptr, const uint8_t *data, uint16_t len);
+uint16_t buffer_available(const buffer_t *ptr);
+const uint8_t *buffer_peek(const buffer_t *ptr);
+buffer_slice_t buffer_slice(const buffer_t *ptr, uint16_t offset, uint16_t len);
+void buffer_compact(buffer_t *ptr);
 void buffer_dynamic_alloc(buffer_t *ptr, uint16_t cap);
 void em_buffer_free(buffer_t *ptr);
 void buffer_clean(buffer_t *ptr);
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#ifndef BUFFER_POOL_H_
+#define BUFFER_POOL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "em/buffer.h"
+
+typedef enum {
+  BUFFER_POOL_SMALL = 0,
+  BUFFER_POOL_MEDIUM,
+  BUFFER_POOL_LARGE,
+  BUFFER_POOL_CLASSES_CNT
+} buffer_pool_class_t;
+
+typedef struct {
+  uint16_t buf_size;
+  uint8_t total;
+  uint8_t in_use;
+  uint8_t high_water;
+  uint32_t exhausted; // number of failed acquisitions
+} buffer_pool_stats_t;
+
+/*
+ * Takes a buffer from the smallest size class that fits cap bytes, falls back to bigger class
+ * when the matching one is exhausted. Never touches the heap and never aborts.
+ * Returns 0 on success, -1 if cap is too big or no buffer is free.
+ */
+int buffer_pool_alloc(buffer_t *ptr, uint16_t cap);
+// returns true if the buffer was owned by the pool and has been returned to it
+bool buffer_pool_release(buffer_t *ptr);
+void buffer_pool_get_stats(buffer_pool_class_t cls, buffer_pool_stats_t *stats);
+
+#endif /* BUFFER_POOL_H_ */
@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#ifndef SHARED_BUFFER_H_
+#define SHARED_BUFFER_H_
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "em/buffer.h"
+
+typedef struct shared_buffer_s shared_buffer_t;
+
+// called once, when the last reference is dropped, right before the data is released
+typedef void (*shared_buffer_release_cb_t)(const shared_buffer_t *sb, void *ctx);
+
+/*
+ * Reference counted buffer for passing the same bytes to many consumers without copying.
+ * Producer fills buf after shared_buffer_create(), afterwards the content must not be modified.
+ * Every consumer takes own reference and drops it with shared_buffer_unref() when done.
+ */
+struct shared_buffer_s {
+  buffer_t buf;
+  atomic_uint_fast8_t refcnt;
+  shared_buffer_release_cb_t release_cb;
+  void *release_ctx;
+};
+
+// returns buffer with one reference owned by the caller or NULL when out of descriptors or pool buffers
+shared_buffer_t *shared_buffer_create(uint16_t cap, shared_buffer_release_cb_t release_cb, void *release_ctx);
+shared_buffer_t *shared_buffer_ref(shared_buffer_t *sb);
+void shared_buffer_unref(shared_buffer_t *sb);
+
+#endif /* SHARED_BUFFER_H_ */
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#include "em/shared_buffer.h"
+#include "em/buffer_pool.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <freertos/FreeRTOS.h>
+
+#include <esp_log.h>
+#define LOG_TAG "em_shared_buf"
+
+static shared_buffer_t descriptors[CONFIG_EM_BUFFER_SHARED_CNT];
+static bool descriptor_used[CONFIG_EM_BUFFER_SHARED_CNT];
+static portMUX_TYPE descriptors_lock = portMUX_INITIALIZER_UNLOCKED;
+
+shared_buffer_t *shared_buffer_create(uint16_t cap, shared_buffer_release_cb_t release_cb, void *release_ctx)
+{
+  shared_buffer_t *sb = NULL;
+
+  taskENTER_CRITICAL(&descriptors_lock);
+
+  for (size_t i = 0; i < CONFIG_EM_BUFFER_SHARED_CNT; i++) {
+    if (!descriptor_used[i]) {
+      descriptor_used[i] = true;
+      sb = &descriptors[i];
+      break;
+    }
+  }
+
+  taskEXIT_CRITICAL(&descriptors_lock);
+
+  if (sb == NULL) {
+    ESP_LOGW(LOG_TAG, "No free descriptor");
+    return NULL;
+  }
+
+  sb->buf = (buffer_t){0};
+
+  if (buffer_pool_alloc(&sb->buf, cap) != 0) {
+    taskENTER_CRITICAL(&descriptors_lock);
+    descriptor_used[sb - descriptors] = false;
+    taskEXIT_CRITICAL(&descriptors_lock);
+    return NULL;
+  }
+
+  atomic_init(&sb->refcnt, 1);
+  sb->release_cb = release_cb;
+  sb->release_ctx = release_ctx;
+  return sb;
+}
+
+shared_buffer_t *shared_buffer_ref(shared_buffer_t *sb)
+{
+  assert(sb != NULL);
+
+  uint_fast8_t prev = atomic_fetch_add(&sb->refcnt, 1);
+  assert(prev > 0 && prev < UINT8_MAX);
+  (void)prev;
+  return sb;
+}
+
+void shared_buffer_unref(shared_buffer_t *sb)
+{
+  assert(sb != NULL);
+
+  uint_fast8_t prev = atomic_fetch_sub(&sb->refcnt, 1);
+  assert(prev > 0);
+
+  if (prev != 1) {
+    return;
+  }
+
+  if (sb->release_cb != NULL) {
+    sb->release_cb(sb, sb->release_ctx);
+  }
+
+  em_buffer_free(&sb->buf);
+
+  taskENTER_CRITICAL(&descriptors_lock);
+  descriptor_used[sb - descriptors] = false;
+  taskEXIT_CRITICAL(&descriptors_lock);
+}
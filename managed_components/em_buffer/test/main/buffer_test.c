@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#include "em/buffer.h"
+
+#include <esp_timer.h>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#define SLIP_BEGIN     (0xCF)
+#define SLIP_END       (0xC0)
+#define SLIP_ESC       (0xDB)
+#define SLIP_ESC_BEGIN (0xDE)
+#define SLIP_ESC_END   (0xDC)
+#define SLIP_ESC_ESC   (0xDD)
+
+#define STREAM_LEN  (4096U)
+#define PACKET_LEN  (40U)
+#define DECODED_CAP (128U)
+
+// 4kB of back to back SLIP packets with escaped bytes in every packet
+static uint8_t stream[STREAM_LEN];
+static uint16_t stream_len;
+static uint8_t buf_data[STREAM_LEN];
+static uint8_t legacy_data[STREAM_LEN];
+
+typedef struct {
+  uint32_t packets;
+  uint32_t checksum;
+} decode_result_t;
+
+typedef struct {
+  uint8_t *data;
+  uint16_t len;
+} legacy_buffer_t;
+
+// buffer_pop_front() before the read offset was added, the rest is moved down on every call
+static void legacy_pop_front(legacy_buffer_t *ptr, uint16_t num)
+{
+  if (ptr->len <= num) {
+    ptr->len = 0;
+    return;
+  }
+
+  memmove(ptr->data, ptr->data + num, ptr->len - num);
+  ptr->len -= num;
+}
+
+static void stream_init(void)
+{
+  uint8_t value = 0;
+
+  stream_len = 0;
+
+  while (stream_len + 2 * PACKET_LEN + 2 <= STREAM_LEN) {
+    stream[stream_len++] = SLIP_BEGIN;
+
+    for (uint16_t i = 0; i < PACKET_LEN; i++, value++) {
+      if (value == SLIP_BEGIN || value == SLIP_END || value == SLIP_ESC) {
+        stream[stream_len++] = SLIP_ESC;
+        stream[stream_len++] = value == SLIP_BEGIN ? SLIP_ESC_BEGIN : (value == SLIP_END ? SLIP_ESC_END : SLIP_ESC_ESC);
+      } else {
+        stream[stream_len++] = value;
+      }
+    }
+
+    stream[stream_len++] = SLIP_END;
+  }
+}
+
+typedef struct {
+  bool inside;
+  bool esc;
+  uint8_t decoded[DECODED_CAP];
+  uint16_t decoded_len;
+  decode_result_t result;
+} slip_state_t;
+
+static void slip_feed(slip_state_t *s, uint8_t byte)
+{
+  if (!s->inside) {
+    s->inside = byte == SLIP_BEGIN;
+    s->decoded_len = 0;
+    return;
+  }
+
+  if (byte == SLIP_END) {
+    s->inside = false;
+    s->result.packets++;
+
+    for (uint16_t i = 0; i < s->decoded_len; i++) {
+      s->result.checksum = s->result.checksum * 31 + s->decoded[i];
+    }
+
+    return;
+  }
+
+  if (byte == SLIP_ESC) {
+    s->esc = true;
+    return;
+  }
+
+  if (s->esc) {
+    s->esc = false;
+    byte = byte == SLIP_ESC_BEGIN ? SLIP_BEGIN : (byte == SLIP_ESC_END ? SLIP_END : SLIP_ESC);
+  }
+
+  if (s->decoded_len < DECODED_CAP) {
+    s->decoded[s->decoded_len++] = byte;
+  }
+}
+
+// one byte consumed per pop, the pattern of the old SLIP decoder
+static decode_result_t decode_legacy(void)
+{
+  slip_state_t s = {0};
+  legacy_buffer_t buf = {.data = legacy_data, .len = stream_len};
+
+  memcpy(legacy_data, stream, stream_len);
+
+  while (buf.len != 0) {
+    slip_feed(&s, buf.data[0]);
+    legacy_pop_front(&buf, 1);
+  }
+
+  return s.result;
+}
+
+static decode_result_t decode_buffer(void)
+{
+  slip_state_t s = {0};
+  buffer_t buf = {.data = buf_data, .cap = sizeof(buf_data)};
+
+  TEST_ASSERT_EQUAL_INT(0, buffer_append(&buf, stream, stream_len));
+
+  while (buffer_available(&buf) != 0) {
+    slip_feed(&s, buffer_peek(&buf)[0]);
+    buffer_pop_front(&buf, 1);
+  }
+
+  return s.result;
+}
+
+static void test_buffer_head_index(void)
+{
+  uint8_t data[8];
+  buffer_t buf = {.data = data, .cap = sizeof(data)};
+  const uint8_t abc[] = {'a', 'b', 'c', 'd', 'e', 'f'};
+
+  TEST_ASSERT_EQUAL_INT(0, buffer_append(&buf, abc, sizeof(abc)));
+  buffer_pop_front(&buf, 4);
+  TEST_ASSERT_EQUAL_UINT16(2, buffer_available(&buf));
+  TEST_ASSERT_EQUAL_UINT8('e', buffer_peek(&buf)[0]);
+
+  // no room at the end, unread data is moved to the beginning
+  TEST_ASSERT_EQUAL_INT(0, buffer_append(&buf, abc, 4));
+  TEST_ASSERT_EQUAL_UINT16(0, buf.head);
+  TEST_ASSERT_EQUAL_MEMORY("efabcd", buffer_peek(&buf), 6);
+  TEST_ASSERT_EQUAL_INT(-1, buffer_append(&buf, abc, 3));
+
+  buffer_slice_t slice = buffer_slice(&buf, 2, 10);
+  TEST_ASSERT_EQUAL_UINT16(4, slice.len);
+  TEST_ASSERT_EQUAL_MEMORY("abcd", slice.data, 4);
+  TEST_ASSERT_NULL(buffer_slice(&buf, 7, 1).data);
+
+  buffer_pop_front(&buf, 10);
+  TEST_ASSERT_EQUAL_UINT16(0, buffer_available(&buf));
+  TEST_ASSERT_EQUAL_UINT16(0, buf.head);
+}
+
+static void test_buffer_slip_benchmark(void)
+{
+  stream_init();
+
+  int64_t start = esp_timer_get_time();
+  decode_result_t legacy = decode_legacy();
+  int64_t legacy_us = esp_timer_get_time() - start;
+
+  start = esp_timer_get_time();
+  decode_result_t current = decode_buffer();
+  int64_t current_us = esp_timer_get_time() - start;
+
+  printf("buffer: %u B SLIP stream, %lu packets, memmove pop %lld us, head index pop %lld us\n", stream_len,
+         (unsigned long)current.packets, (long long)legacy_us, (long long)current_us);
+
+  TEST_ASSERT_TRUE(current.packets > 0);
+  TEST_ASSERT_EQUAL_UINT32(legacy.packets, current.packets);
+  TEST_ASSERT_EQUAL_UINT32(legacy.checksum, current.checksum);
+  TEST_ASSERT_TRUE(current_us < legacy_us);
+}
+
+void app_main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_buffer_head_index);
+  RUN_TEST(test_buffer_slip_benchmark);
+  UNITY_END();
+}
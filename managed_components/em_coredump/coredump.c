@@ -19,6 +19,7 @@ static struct {
   size_t addr;
   size_t size_left;
   bool ready;
+  bool end_sent;
 } coredump;
 
 static bool is_coredump_present(void)
@@ -49,29 +50,36 @@ int coredump_on_data_sent_callback(bool success)
     return ESP_ERR_INVALID_STATE;
   }
 
-  if (!success || coredump.size_left <= 0) {
+  if (!success || (coredump.size_left <= 0 && coredump.end_sent)) {
     /* Clear handlers */
     memset(&coredump.api, 0x00, sizeof(coredump.api));
     coredump.ready = false;
     return ESP_ERR_INVALID_SIZE;
   }
 
-  uint16_t block_len = MIN(coredump.size_left, CONFIG_EM_COREDUMP_BLOCK_MAX_SIZE);
-  bool last_block = ((int32_t)coredump.size_left - block_len) <= 0 ? true : false;
+  /* Block or end not queued (e.g. TX buffers exhausted) is sent again on the next TX status */
+  if (coredump.size_left > 0) {
+    uint16_t block_len = MIN(coredump.size_left, CONFIG_EM_COREDUMP_BLOCK_MAX_SIZE);
+    uint8_t block_data[block_len];
+    ESP_ERROR_CHECK(esp_flash_read(esp_flash_default_chip, block_data, coredump.addr, block_len));
 
-  uint8_t block_data[block_len];
-  ESP_ERROR_CHECK(esp_flash_read(esp_flash_default_chip, block_data, coredump.addr, block_len));
+    if (coredump.api.body && coredump.api.body(coredump.ver, block_len, block_data) != ESP_OK) {
+      ESP_LOGW(LOG_TAG, "Coredump block at 0x%x not sent, retry", (unsigned)coredump.addr);
+      return ESP_ERR_NO_MEM;
+    }
 
-  if (coredump.api.body) {
-    coredump.api.body(coredump.ver, block_len, block_data);
+    coredump.addr += block_len;
+    coredump.size_left -= block_len;
   }
 
-  if (last_block && coredump.api.end) {
-    coredump.api.end(coredump.ver);
+  if (coredump.size_left <= 0 && coredump.api.end) {
+    if (coredump.api.end(coredump.ver) != ESP_OK) {
+      ESP_LOGW(LOG_TAG, "Coredump end not sent, retry");
+      return ESP_ERR_NO_MEM;
+    }
   }
 
-  coredump.addr += block_len;
-  coredump.size_left -= block_len;
+  coredump.end_sent = coredump.size_left <= 0;
   return ESP_OK;
 }
 
@@ -85,6 +93,7 @@ int coredump_start(coredump_api_t cfg)
   coredump.ver = esp_random();
   coredump.api = cfg;
   coredump.ready = true;
+  coredump.end_sent = false;
 
   if (coredump.api.valid) {
     coredump.api.valid(coredump.ver);
@@ -34,7 +34,23 @@ typedef struct {
   size_t handlers_cnt;
 } serial_protocol_t;
 
+// periodic request of em_sc_replace_periodic
 typedef struct {
+  uint16_t rq_id;
+  uint32_t period; // in ms
+  const uint8_t *payload;
+  size_t payload_len;
+} em_sc_periodic_rq_t;
+
+// UART of the client, clients running at the same time need different ports
+typedef struct {
+  int port;
+  int txd;
+  int rxd;
+} em_sc_uart_t;
+
+typedef struct {
+  em_sc_uart_t uart;
   uint8_t selected_protocol_idx; // protocol type 0xFF means auto detect
   uint16_t last_rq_id;           // recently sent request cmd
   // int rx_error;
@@ -44,6 +60,8 @@ typedef struct {
   // uint8_t packet_buf[2][CONFIG_EM_SERIAL_CLIENT_MAX_PACKET_LEN]; // swap buffer
   // bool use_first_buf;
   void *pimpl; // private implementation
+  StaticTask_t task_data;
+  StackType_t task_stack[CONFIG_EM_SERIAL_CLIENT_TASK_STACK_SIZE];
 } em_sc_t;
 
 void em_sc_init(em_sc_t *sc, uint8_t protocol_idx);
@@ -54,5 +72,10 @@ int em_sc_send(em_sc_t *sc, uint16_t cmd, const uint8_t *payload, size_t payload
                uint8_t retries);
 int em_sc_send_periodic(em_sc_t *sc, uint16_t cmd, const uint8_t *payload, size_t payload_len, uint32_t period);
 int em_sc_remove_periodic(em_sc_t *sc, uint16_t rq_id);
+/*
+ * Replaces all periodic requests in one step of the client task, request slots follow the order of rqs.
+ * Nothing changes when the new requests don't fit the free slots, returns -2 when they don't fit one command.
+ */
+int em_sc_replace_periodic(em_sc_t *sc, const em_sc_periodic_rq_t *rqs, size_t rqs_cnt);
 
 #endif /* EM_SERIAL_CLIENT_H_ */
@@ -10,12 +10,15 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/timers.h>
 
+#define FIRST_RSP_ROUNDS (3u) // short retries of a periodic request before falling back to its period
+
 typedef enum {
   SC_CMD_ADD_RQ = 1,
   SC_CMD_ADD_RQ_PERIODIC,
   SC_CMD_RM_PERIODIC_RQ,
   SC_CMD_PROCESS_DATA,
   SC_CMD_TIMER,
+  SC_CMD_REPLACE_PERIODIC,
 } sc_cmd_type_t;
 
 typedef struct {
@@ -39,11 +42,12 @@ typedef struct {
 typedef struct {
   uint8_t *payload;
   uint16_t rq_id;
-  uint16_t timeout;
+  uint32_t timeout;
   int32_t since_last_sent;
   uint8_t retries;
   uint8_t max_retries;
   uint8_t payload_len;
+  uint8_t first_rounds; // short retries left of the periodic request not answered yet
   bool active;
   bool periodic;
 } __attribute__((packed)) rq_t;
@@ -51,6 +55,7 @@ typedef struct {
 typedef struct {
   rq_t rq[CONFIG_EM_SERIAL_CLIENT_MAX_RQS];
   TimerHandle_t timer;
+  StaticTimer_t timer_data;
 } sc_impl_t;
 
 #endif /* EM_PRIV_IMPL_H_ */
@@ -179,6 +179,7 @@ void ack_rsp(em_sc_t *sc, uint16_t corresponding_rq)
       // ESP_LOGI(TAG, "Acked ok cmd %d", corresponding_rq);
       pimpl->rq[i].since_last_sent = 0;
       pimpl->rq[i].retries = 0;
+      pimpl->rq[i].first_rounds = 0;
 
       if (pimpl->rq[i].max_retries > 0) { // if not periodic
         ESP_LOGI(TAG, "Rq[%d]=%x satisfied", i, pimpl->rq[i].rq_id);
@@ -28,15 +28,13 @@ void em_sc_init(em_sc_t *sc, uint8_t protocol_idx)
   sc->last_rq_id = EXP_RSP_INVALID;
   em_sc_set_protocol_idx(sc, protocol_idx);
 
-  static StaticTask_t task_data = {0};
-  static StackType_t task_stack[CONFIG_EM_SERIAL_CLIENT_TASK_STACK_SIZE] = {0};
-
   TaskHandle_t handle = xTaskCreateStatic(task, "sc", CONFIG_EM_SERIAL_CLIENT_TASK_STACK_SIZE, (void *)sc,
-                                          CONFIG_EM_SERIAL_CLIENT_TASK_PRIO, task_stack, &task_data);
+                                          CONFIG_EM_SERIAL_CLIENT_TASK_PRIO, sc->task_stack, &sc->task_data);
   assert(handle);
 
   const serial_protocol_t *proto = em_sc_protocol(sc);
-  em_uart_init(proto->baud_rate, proto->parity, proto->stop_bits, 1, uart_rx_cb, (void *)sc);
+  em_uart_init(sc->uart.port, sc->uart.txd, sc->uart.rxd, proto->baud_rate, proto->parity, proto->stop_bits, 1,
+               uart_rx_cb, (void *)sc);
 }
 
 void em_sc_set_protocol_idx(em_sc_t *client, uint8_t idx)
@@ -88,3 +86,41 @@ int em_sc_remove_periodic(em_sc_t *sc, uint16_t rq_id)
 
   return 0;
 }
+
+int em_sc_replace_periodic(em_sc_t *sc, const em_sc_periodic_rq_t *rqs, size_t rqs_cnt)
+{
+  assert(sc != NULL);
+  assert(rqs != NULL || rqs_cnt == 0);
+  sc_cmd_t cmd = {.type = SC_CMD_REPLACE_PERIODIC};
+
+  if (rqs_cnt > CONFIG_EM_SERIAL_CLIENT_MAX_RQS) {
+    return -2;
+  }
+
+  // count, then id, period, payload length and payload of every request
+  cmd.payload[cmd.payload_len++] = (uint8_t)rqs_cnt;
+
+  for (size_t i = 0; i < rqs_cnt; i++) {
+    size_t rq_len = sizeof(rqs[i].rq_id) + sizeof(rqs[i].period) + sizeof(uint8_t) + rqs[i].payload_len;
+
+    if (rqs[i].payload_len > UINT8_MAX || cmd.payload_len + rq_len > sizeof(cmd.payload)) {
+      ESP_LOGE(TAG, "Periodic rqs don't fit the cmd");
+      return -2;
+    }
+
+    memcpy(&cmd.payload[cmd.payload_len], &rqs[i].rq_id, sizeof(rqs[i].rq_id));
+    cmd.payload_len += sizeof(rqs[i].rq_id);
+    memcpy(&cmd.payload[cmd.payload_len], &rqs[i].period, sizeof(rqs[i].period));
+    cmd.payload_len += sizeof(rqs[i].period);
+    cmd.payload[cmd.payload_len++] = (uint8_t)rqs[i].payload_len;
+    memcpy(&cmd.payload[cmd.payload_len], rqs[i].payload, rqs[i].payload_len);
+    cmd.payload_len += rqs[i].payload_len;
+  }
+
+  if (xQueueSend(sc->cmd_queue, &cmd, portMAX_DELAY) != pdTRUE) {
+    ESP_LOGE(TAG, "cmd queue full");
+    return -1;
+  }
+
+  return 0;
+}
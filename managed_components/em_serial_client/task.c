@@ -66,6 +66,10 @@ void task(void *param)
       remove_periodic_rq(sc, cmd.rq_id);
       break;
 
+    case SC_CMD_REPLACE_PERIODIC:
+      replace_periodic_rqs(sc, cmd.payload, cmd.payload_len);
+      break;
+
     case SC_CMD_PROCESS_DATA:
       process_data(sc, &ring, cmd.payload, cmd.payload_len);
       break;
@@ -100,8 +104,8 @@ static void send_rq(em_sc_t *sc)
       continue;
     }
 
-    if (pimpl->rq[i].timeout - pimpl->rq[i].since_last_sent < earliest_rq_delay) {
-      earliest_rq_delay = pimpl->rq[i].timeout - pimpl->rq[i].since_last_sent;
+    if ((int32_t)pimpl->rq[i].timeout - pimpl->rq[i].since_last_sent < earliest_rq_delay) {
+      earliest_rq_delay = (int32_t)pimpl->rq[i].timeout - pimpl->rq[i].since_last_sent;
       send_idx = i;
     }
   }
@@ -118,7 +122,7 @@ static void send_rq(em_sc_t *sc)
 
   assert(pimpl->rq[send_idx].payload_len > 0);
   sc->last_rq_id = pimpl->rq[send_idx].rq_id; // remember id of last sent request
-  int err = em_uart_send(pimpl->rq[send_idx].payload, pimpl->rq[send_idx].payload_len);
+  int err = em_uart_send(sc->uart.port, pimpl->rq[send_idx].payload, pimpl->rq[send_idx].payload_len);
 
   if (err != 0) {
     ESP_LOGE(TAG, "Failed to send rq idx=%d err=%d", send_idx, err);
@@ -143,6 +147,14 @@ static void send_rq(em_sc_t *sc)
       ESP_LOGW(TAG, "No rsp for periodic rq[%d]=%x after %d retries", send_idx, pimpl->rq[send_idx].rq_id,
                pimpl->rq[send_idx].retries);
       pimpl->rq[send_idx].retries = 0;
+
+      // never answered, e.g. the device was still starting up, don't wait the whole period for the first value
+      if (pimpl->rq[send_idx].first_rounds > 0 &&
+          pimpl->rq[send_idx].timeout > (uint32_t)CONFIG_EM_SERIAL_CLIENT_FIRST_RSP_RETRY_MS) {
+        pimpl->rq[send_idx].first_rounds--;
+        pimpl->rq[send_idx].since_last_sent =
+          (int32_t)(pimpl->rq[send_idx].timeout - CONFIG_EM_SERIAL_CLIENT_FIRST_RSP_RETRY_MS);
+      }
     } else {
       pimpl->rq[send_idx].since_last_sent =
         pimpl->rq[send_idx].since_last_sent - response_delay_ms; // retry after 100ms
@@ -157,8 +169,8 @@ static void send_rq(em_sc_t *sc)
       continue;
     }
 
-    if (pimpl->rq[i].timeout - pimpl->rq[i].since_last_sent < next_rq_delay) {
-      next_rq_delay = pimpl->rq[i].timeout - pimpl->rq[i].since_last_sent;
+    if ((int32_t)pimpl->rq[i].timeout - pimpl->rq[i].since_last_sent < next_rq_delay) {
+      next_rq_delay = (int32_t)pimpl->rq[i].timeout - pimpl->rq[i].since_last_sent;
     }
   }
 
@@ -110,6 +110,7 @@ int add_periodic_rq(em_sc_t *sc, uint16_t rq_id, const uint8_t *payload, size_t
   pimpl->rq[idx].active = true;
   pimpl->rq[idx].retries = 0;
   pimpl->rq[idx].max_retries = 0;
+  pimpl->rq[idx].first_rounds = FIRST_RSP_ROUNDS;
   pimpl->rq[idx].periodic = true;
 
   ESP_LOGI(TAG, "Add message[%d] cmd=%#x period=%ld", idx, rq_id, period);
@@ -149,6 +150,99 @@ int remove_periodic_rq(em_sc_t *sc, uint16_t rq_id)
   ESP_LOGE(TAG, "Periodic rq[%#x] not found", rq_id);
   return -1; // not found
 }
+
+int replace_periodic_rqs(em_sc_t *sc, const uint8_t *packed, size_t packed_len)
+{
+  assert(packed != NULL);
+  assert(packed_len > 0);
+  assert(sc->selected_protocol_idx < sc->supported_protocols_cnt);
+
+  sc_impl_t *pimpl = (sc_impl_t *)sc->pimpl;
+  assert(pimpl != NULL);
+
+  size_t entries_cnt = sizeof(pimpl->rq) / sizeof(pimpl->rq[0]);
+  size_t rqs_cnt = packed[0];
+  size_t free_cnt = 0;
+
+  // slots of the replaced periodic requests are reused
+  for (size_t i = 0; i < entries_cnt; ++i) {
+    if (!pimpl->rq[i].active || pimpl->rq[i].periodic) {
+      free_cnt++;
+    }
+  }
+
+  if (rqs_cnt > free_cnt) {
+    ESP_LOGE(TAG, "No slots for %d periodic rqs, free=%d", rqs_cnt, free_cnt);
+    return -1;
+  }
+
+  // serialized first, so a failure leaves the current requests running
+  serial_protocol_t *protocol = &sc->supported_protocols[sc->selected_protocol_idx];
+  uint8_t *payloads[CONFIG_EM_SERIAL_CLIENT_MAX_RQS] = {NULL};
+  size_t payloads_len[CONFIG_EM_SERIAL_CLIENT_MAX_RQS] = {0};
+  uint16_t rq_ids[CONFIG_EM_SERIAL_CLIENT_MAX_RQS] = {0};
+  uint32_t periods[CONFIG_EM_SERIAL_CLIENT_MAX_RQS] = {0};
+  const uint8_t *ptr = &packed[1];
+
+  for (size_t k = 0; k < rqs_cnt; ++k) {
+    memcpy(&rq_ids[k], ptr, sizeof(rq_ids[k]));
+    ptr += sizeof(rq_ids[k]);
+    memcpy(&periods[k], ptr, sizeof(periods[k]));
+    ptr += sizeof(periods[k]);
+    uint8_t len = *ptr++;
+    assert(ptr + len <= packed + packed_len);
+    assert(periods[k] > 1);
+
+    payloads[k] = protocol->serialize_func(rq_ids[k], ptr, len, &payloads_len[k]);
+    ptr += len;
+
+    if (payloads[k] == NULL) {
+      ESP_LOGE(TAG, "Allocate memory for periodic message");
+
+      for (size_t j = 0; j < k; ++j) {
+        free(payloads[j]);
+      }
+
+      return -2;
+    }
+  }
+
+  for (size_t i = 0; i < entries_cnt; ++i) {
+    if (pimpl->rq[i].active && pimpl->rq[i].periodic) {
+      deactivate_rq(pimpl, i);
+    }
+  }
+
+  size_t k = 0;
+
+  for (uint8_t idx = 0; idx < entries_cnt && k < rqs_cnt; ++idx) {
+    if (pimpl->rq[idx].active) {
+      continue;
+    }
+
+    pimpl->rq[idx].payload = payloads[k];
+    pimpl->rq[idx].rq_id = rq_ids[k];
+    pimpl->rq[idx].payload_len = payloads_len[k];
+    pimpl->rq[idx].timeout = periods[k];
+    pimpl->rq[idx].since_last_sent = periods[k] - (k + 1) * 500; // start sending after some time with offset
+    pimpl->rq[idx].active = true;
+    pimpl->rq[idx].retries = 0;
+    pimpl->rq[idx].max_retries = 0;
+    pimpl->rq[idx].first_rounds = FIRST_RSP_ROUNDS;
+    pimpl->rq[idx].periodic = true;
+    ++k;
+  }
+
+  ESP_LOGI(TAG, "Replaced periodic rqs, cnt=%d", rqs_cnt);
+
+  if (rqs_cnt > 0 && start_timer(sc, 2000) != 0) {
+    ESP_LOGE(TAG, "Start timer failed");
+    return -3;
+  }
+
+  return 0;
+}
+
 /*
 void sender_stop(void)
 {
@@ -176,11 +270,8 @@ int start_timer(em_sc_t *sc, uint32_t duration_ms)
   assert(pimpl != NULL);
 
   if (pimpl->timer == NULL) {
-    static StaticTimer_t t_buf = {
-      0,
-    };
-    pimpl->timer =
-      xTimerCreateStatic("Sender", pdMS_TO_TICKS(duration_ms), pdFALSE, (void *)sc->cmd_queue, sender_timer_cb, &t_buf);
+    pimpl->timer = xTimerCreateStatic("Sender", pdMS_TO_TICKS(duration_ms), pdFALSE, (void *)sc->cmd_queue,
+                                      sender_timer_cb, &pimpl->timer_data);
 
     if (pimpl->timer == NULL) {
       ESP_LOGE(TAG, "Failed to create periodic timer");
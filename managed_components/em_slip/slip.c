@@ -47,16 +47,19 @@ static slip_err_t decode(buffer_t *decoded, buffer_t *encoded, uint16_t *process
 {
   *processedNum = 0;
 
-  if (encoded->len == 0) {
+  /* Parse in place, consumed bytes are dropped by the caller in O(1) */
+  buffer_slice_t in = buffer_slice(encoded, 0, buffer_available(encoded));
+
+  if (in.len == 0) {
     return ERR_PACKET_START_NOT_FOUND;
   }
 
-  for (; *processedNum < encoded->len;) {
-    if (*processedNum >= decoded->cap) {
+  for (; *processedNum < in.len;) {
+    if (decoded->len >= decoded->cap) {
       return ERR_NO_MEMORY;
     }
 
-    uint8_t encodedByte = encoded->data[*processedNum];
+    uint8_t encodedByte = in.data[*processedNum];
     ++(*processedNum);
 
     if (!*insideOfPacket && encodedByte != SLIP_BEGIN) {
@@ -70,7 +73,7 @@ static slip_err_t decode(buffer_t *decoded, buffer_t *encoded, uint16_t *process
       } else {
         /* Put back SLIP_BEGIN to use it when decoding next packet */
         *insideOfPacket = false;
-        --processedNum;
+        --(*processedNum);
         return ERR_PACKET_CUT;
       }
       break;
@@ -144,8 +147,8 @@ static slip_err_t decode(buffer_t *decoded, buffer_t *encoded, uint16_t *process
 
 void slip_clear(slip_codec_t *s)
 {
-  s->decoded.len = 0;
-  s->encoded.len = 0;
+  buffer_clean(&s->decoded);
+  buffer_clean(&s->encoded);
 }
 
 // TODO: add description
@@ -213,15 +216,10 @@ static esp_err_t slip_add_data(slip_codec_t *s, const void *newEncodedData, uint
     return ESP_ERR_INVALID_ARG;
   }
 
-  uint32_t neededBufLen = s->encoded.len + newEncodedDataLen;
-
-  if (s->encoded.cap < neededBufLen) {
+  if (newEncodedDataLen > UINT16_MAX || buffer_append(&s->encoded, newEncodedData, newEncodedDataLen) != 0) {
     return ESP_ERR_NO_MEM;
   }
 
-  memcpy(s->encoded.data + s->encoded.len, newEncodedData, newEncodedDataLen);
-  s->encoded.len += newEncodedDataLen;
-
   return ESP_OK;
 }
 
@@ -9,6 +9,7 @@
 #include <esp_event.h>
 
 #include "em/buffer.h"
+#include "em/shared_buffer.h"
 
 ESP_EVENT_DECLARE_BASE(EM_TCP_CLIENT_EVENT);
 
@@ -38,6 +39,8 @@ typedef struct {
 
 void em_tcp_client_init(tcp_client_api_t api);
 esp_err_t em_tcp_client_send(const buffer_t *buf);
+// takes own reference of sb and drops it once data is written to the socket or dropped
+esp_err_t em_tcp_client_send_shared(shared_buffer_t *sb);
 void em_tcp_client_disconnect_panic(void);
 void em_tcp_client_set_long_reconnecting_delay(void);
 
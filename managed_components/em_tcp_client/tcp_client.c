@@ -46,6 +46,12 @@ typedef enum {
   TCP_RX_RESUME,
 } rx_task_state_t;
 
+// send_q entry, either owned buffer or reference to shared buffer
+typedef struct {
+  buffer_t buf;
+  shared_buffer_t *shared;
+} tx_item_t;
+
 static tcp_client_api_t api;
 
 static connection_state_t conn_state;
@@ -233,23 +239,37 @@ static esp_err_t open_conn_handler(void)
   return ESP_OK;
 }
 
+static void release_tx_item(tx_item_t *item)
+{
+  if (item->shared != NULL) {
+    /* Dropping the reference signals send completion to the producer through its release callback */
+    shared_buffer_unref(item->shared);
+    item->shared = NULL;
+  } else {
+    em_buffer_free(&item->buf);
+  }
+}
+
 static esp_err_t send_handler(void)
 {
-  buffer_t buf = {0};
+  tx_item_t item = {0};
 
-  if (pdFALSE == xQueueReceive(send_q, &buf, 0)) {
+  /* Command is queued before its item, wait for the producer to finish submitting */
+  if (pdFALSE == xQueueReceive(send_q, &item, pdMS_TO_TICKS(CONFIG_EM_TCP_MSG_SUBMIT_TIMEOUT_MS))) {
     ESP_LOGE(LOG_TAG, "send_q empty");
     return ESP_ERR_NOT_FOUND;
   }
 
   if (get_conn_state() != STATE_CONNECTED) {
-    em_buffer_free(&buf);
+    release_tx_item(&item);
     ESP_LOGE(LOG_TAG, "Not connected dropping data to send");
     return ESP_FAIL;
   }
 
-  if (buf.len == 0) {
-    em_buffer_free(&buf);
+  const buffer_t *buf = (item.shared != NULL) ? &item.shared->buf : &item.buf;
+
+  if (buf->len == 0) {
+    release_tx_item(&item);
     return ESP_ERR_INVALID_SIZE;
   }
 
@@ -257,37 +277,41 @@ static esp_err_t send_handler(void)
   uint32_t out_len = 0;
 
   if (api.tx_net_proto_cb) {
-    const esp_err_t ret = api.tx_net_proto_cb(buf.data, buf.len, &data_out, &out_len);
+    const esp_err_t ret = api.tx_net_proto_cb(buf->data, buf->len, &data_out, &out_len);
     if (ret != ESP_OK) {
-      em_buffer_free(&buf);
+      release_tx_item(&item);
       return ret;
     }
   } else {
-    data_out = buf.data;
-    out_len = buf.len;
+    data_out = buf->data;
+    out_len = buf->len;
   }
 
-  em_buffer_free(&buf);
-
   assert(out_len <= INT32_MAX && out_len > 0);
   assert(data_out);
 
   int32_t len = (int32_t)out_len;
   int32_t widx = 0;
+  esp_err_t ret = ESP_OK;
 
   while (len > 0) {
     /* Do not timeout (-1) write until error or success */
     int32_t wlen = esp_transport_write(ssl_handle, (char *)data_out + widx, len, -1);
     if (wlen <= 0) {
       ESP_LOGE(LOG_TAG, "send failed: errno %d", errno);
-      return ESP_FAIL;
+      ret = ESP_FAIL;
+      break;
     }
 
     widx += wlen;
     len -= wlen;
   }
 
-  return ESP_OK;
+  /* errno is reported by the caller, keep it untouched by the release callback */
+  const int write_errno = errno;
+  release_tx_item(&item);
+  errno = write_errno;
+  return ret;
 }
 
 static void tx_task(void *param)
@@ -427,8 +451,8 @@ void em_tcp_client_init(tcp_client_api_t tcp_api)
   configASSERT(cmd_q);
 
   static StaticQueue_t send_q_data = {0};
-  static uint8_t send_q_storage[CONFIG_EM_TCP_TX_SEND_MSG_Q_MAX * sizeof(buffer_t)] = {0};
-  send_q = xQueueCreateStatic(CONFIG_EM_TCP_TX_SEND_MSG_Q_MAX, sizeof(buffer_t), send_q_storage, &send_q_data);
+  static uint8_t send_q_storage[CONFIG_EM_TCP_TX_SEND_MSG_Q_MAX * sizeof(tx_item_t)] = {0};
+  send_q = xQueueCreateStatic(CONFIG_EM_TCP_TX_SEND_MSG_Q_MAX, sizeof(tx_item_t), send_q_storage, &send_q_data);
   configASSERT(send_q);
 
   static StaticQueue_t rx_q_data = {0};
@@ -449,8 +473,24 @@ void em_tcp_client_init(tcp_client_api_t tcp_api)
   configASSERT(handle);
 }
 
-/* TODO: TCP: em_tcp_client_send should allow to register ON SEND CALLBACK. I mean that CMD_SEND should allow to pass
- * the function pointer over queue. If NULL then do not execute */
+static esp_err_t submit_tx_item(const tx_item_t *item)
+{
+  /* Command goes first, so an item never waits in send_q without a command to take it out. When the item can't be
+   * queued after its command, the caller keeps it and the spare command only times out in send_handler.
+   */
+  cmd_t cmd = CMD_SEND;
+  if (xQueueSend(cmd_q, &cmd, pdMS_TO_TICKS(CONFIG_EM_TCP_MSG_SUBMIT_TIMEOUT_MS)) != pdTRUE) {
+    ESP_LOGW(LOG_TAG, "cmd_q full, drop");
+    return ESP_FAIL;
+  }
+
+  if (xQueueSend(send_q, item, pdMS_TO_TICKS(CONFIG_EM_TCP_MSG_SUBMIT_TIMEOUT_MS)) != pdTRUE) {
+    ESP_LOGW(LOG_TAG, "send_q full, drop");
+    return ESP_FAIL;
+  }
+
+  return ESP_OK;
+}
 
 esp_err_t em_tcp_client_send(const buffer_t *buf)
 {
@@ -460,18 +500,26 @@ esp_err_t em_tcp_client_send(const buffer_t *buf)
 
   assert(buf->data != NULL);
 
-  if (xQueueSend(send_q, buf, pdMS_TO_TICKS(CONFIG_EM_TCP_MSG_SUBMIT_TIMEOUT_MS)) != pdTRUE) {
-    ESP_LOGW(LOG_TAG, "send_q full, drop");
-    return ESP_FAIL;
+  const tx_item_t item = {.buf = *buf, .shared = NULL};
+  return submit_tx_item(&item);
+}
+
+esp_err_t em_tcp_client_send_shared(shared_buffer_t *sb)
+{
+  assert(sb != NULL);
+
+  if (sb->buf.len == 0U) {
+    return ESP_ERR_INVALID_SIZE;
   }
 
-  cmd_t cmd = CMD_SEND;
-  if (xQueueSend(cmd_q, &cmd, pdMS_TO_TICKS(CONFIG_EM_TCP_MSG_SUBMIT_TIMEOUT_MS)) != pdTRUE) {
-    ESP_LOGW(LOG_TAG, "cmd_q full, drop");
-    return ESP_FAIL;
+  const tx_item_t item = {.shared = shared_buffer_ref(sb)};
+  esp_err_t ret = submit_tx_item(&item);
+
+  if (ret != ESP_OK) {
+    shared_buffer_unref(sb);
   }
 
-  return ESP_OK;
+  return ret;
 }
 
 void em_tcp_client_disconnect_panic(void)
@@ -18,6 +18,10 @@
 #define MAX_SNAPSHOTS_ENTRIES (12)
 #define MAX_MEAS_ENTRIES      (48)
 #define MAX_MEAS_TYPES        (8)
+#define INVERTER_SET_ITEMS    (8)  // setting commands in one batch
+#define INVERTER_SET_ITEM_LEN (16) // command text with arguments, without CRC and CR
+#define INVERTER_POLL_PLAN_ITEMS     (8) // commands of the poll plan
+#define INVERTER_POLL_PLAN_DEADBANDS (8) // channel deadbands of the poll plan
 
 typedef uint16_t msg_type_t;
 enum {
@@ -88,7 +92,26 @@ enum {
   MSGTYPE_ENVIRONMENT_SET_POSITION = 0x74,
   MSGTYPE_ENVIRONMENT_POSITION = 0x75,
 
+  // INVERTER
+  MSGTYPE_INVERTER_MEASUREMENT = 0x80, // Channels out of the deadband, GET returns all power, voltage and freq channels
+  MSGTYPE_INVERTER_SET_DEADBAND = 0x81, // Set reporting threshold of the channel
+  MSGTYPE_INVERTER_DEADBAND = 0x82,     // Get reporting threshold of the channel, param - channel
+  MSGTYPE_INVERTER_STATUS = 0x83,       // Mode, status, warnings and fault merged over the coalescing window
+  MSGTYPE_INVERTER_POWER_SUMMARY = 0x84, // p5, p50, p95 and peak power of the period
+  MSGTYPE_INVERTER_HISTORY_QUERY = 0x85, // Request history of the channel in the time range at the resolution
+  MSGTYPE_INVERTER_HISTORY = 0x86,       // Page of the history query result
+  MSGTYPE_INVERTER_ENERGY_DRIFT = 0x87,  // Integrated PV energy compared with the inverter counters
+  MSGTYPE_INVERTER_BURST = 0x88,         // Samples around a trigger, tscodec compressed per channel
+  MSGTYPE_INVERTER_SETTING = 0x89,       // Get inverter setting response text, param - setting, served from cache
+  MSGTYPE_INVERTER_SET_BATCH = 0x8A,     // Setting commands applied one after another and read back
+  MSGTYPE_INVERTER_SET_RESULT = 0x8B,    // Result of every command of the batch
+  MSGTYPE_INVERTER_SET_POLL_PLAN = 0x8C, // Polled commands with intervals and priorities, deadbands of the channels
+  MSGTYPE_INVERTER_POLL_PLAN = 0x8D,     // Get poll plan in use
+  MSGTYPE_INVERTER_PV_INPUTS = 0x8E,     // Voltage, current, power and energy of every PV input (MPPT)
+  MSGTYPE_INVERTER_HISTORY_PACKED = 0x8F, // Page of the history query result, tscodec compressed per field
+
   // BMS
+  MSGTYPE_BMS_PACK = 0xA0, // Pack telemetry, cell voltages as offsets from the lowest cell
   MSGTYPE_BMS_SOC = 0xA5,
   MSGTYPE_BMS_CYCLES = 0xAB,
 
@@ -197,6 +220,55 @@ typedef struct {
   uint64_t mask;
 } meter_alarms_msg_t;
 
+typedef struct {
+  msg_type_t type;
+  uint8_t channel;
+  uint32_t threshold;   // in channel units, 0 - report every change
+  uint32_t max_silence; // in s, 0 - no heartbeat
+} inverter_deadband_msg_t;
+
+typedef struct {
+  msg_type_t type;
+  time_t first_ts; // first change in the window
+  time_t last_ts;  // last change in the window
+  uint32_t mode;
+  uint32_t status_flags;
+  uint32_t status_toggled; // status bits changed in the window
+  uint64_t warning_flags;
+  uint64_t warnings_seen; // warning bits raised in the window
+  uint32_t fault_code;
+  uint16_t changes;
+} inverter_status_msg_t;
+
+typedef struct {
+  msg_type_t type;
+  uint8_t channel;
+  time_t from;
+  time_t to;
+  uint32_t resolution; // in s, the coarsest archive tier not exceeding it is used
+  uint16_t points;     // LTTB downsampled to this many entries, 0 - all entries (optional, older servers omit it)
+} inverter_history_query_msg_t;
+
+typedef struct {
+  msg_type_t type;
+  uint16_t id; // echoed in the result
+  uint16_t items_num;
+  uint8_t items_len[INVERTER_SET_ITEMS];
+  char items[INVERTER_SET_ITEMS][INVERTER_SET_ITEM_LEN]; // e.g. "MCHGC040", not NUL terminated
+} inverter_set_batch_msg_t;
+
+typedef struct {
+  msg_type_t type;
+  uint16_t polls_num;
+  uint16_t cmds[INVERTER_POLL_PLAN_ITEMS];      // serial protocol command id
+  uint32_t intervals[INVERTER_POLL_PLAN_ITEMS]; // in ms
+  uint8_t priorities[INVERTER_POLL_PLAN_ITEMS]; // 0 - highest
+  uint16_t deadbands_num;
+  uint8_t channels[INVERTER_POLL_PLAN_DEADBANDS];
+  uint32_t thresholds[INVERTER_POLL_PLAN_DEADBANDS];   // in channel units
+  uint32_t max_silences[INVERTER_POLL_PLAN_DEADBANDS]; // in s
+} inverter_poll_plan_msg_t;
+
 typedef struct {
   msg_type_t type;
   uint16_t tariff;
@@ -387,6 +459,7 @@ typedef struct {
   msg_type_t type;
   msg_type_t rq_type;
   uint32_t param;
+  uint32_t max_age; // in s, accepted age of cached values, optional on the wire (UINT32_MAX when absent)
 } get_msg_t;
 
 #endif /* MESSAGES_H_ */
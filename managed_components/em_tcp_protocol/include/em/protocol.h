@@ -5,11 +5,13 @@
 #ifndef PROTOCOL_H_
 #define PROTOCOL_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <time.h>
 
 #include "em/buffer.h"
 #include "em/messages.h"
+#include "em/shared_buffer.h"
 
 #define COORDINATES_FIXED_FACTOR        (-5)
 #define PRICE_LIMIT_THRESHOLD_UNDEFINED (INT32_MIN)
@@ -47,6 +49,10 @@ void protocol_register_rx_handler(app_msg_dispatcher_cb_t handler);
 typedef int (*net_tx_medium_cb_t)(const buffer_t *buf);
 void protocol_register_tx_handler(net_tx_medium_cb_t handler);
 
+// medium takes own reference of the shared buffer and drops it once the data is written or dropped
+typedef int (*net_tx_shared_medium_cb_t)(shared_buffer_t *sb);
+void protocol_register_tx_shared_handler(net_tx_shared_medium_cb_t handler);
+
 /** RX **/
 int protocol_receiver_dispatcher(const uint8_t *data, uint32_t len);
 
@@ -86,6 +92,46 @@ int protocol_send_meter_measurements_history(time_t ref_timestamp, uint8_t meas_
 int protocol_send_meter_current_limit(int32_t limit);
 int protocol_send_meter_alarms(uint64_t mask);
 
+int protocol_send_inverter_measurements(time_t timestamp, const uint8_t *channels, const int32_t *values,
+                                        uint16_t entries_num);
+int protocol_send_inverter_deadband(uint8_t channel, uint32_t threshold, uint32_t max_silence);
+int protocol_send_inverter_status(time_t first_ts, time_t last_ts, uint32_t mode, uint32_t status_flags,
+                                  uint32_t status_toggled, uint64_t warning_flags, uint64_t warnings_seen,
+                                  uint32_t fault_code, uint16_t changes);
+int protocol_send_inverter_power_summary(time_t start, uint32_t period, const uint8_t *channels,
+                                         const uint16_t *samples, const int32_t *p5, const int32_t *p50,
+                                         const int32_t *p95, const int32_t *peak, uint16_t entries_num);
+/*
+ * sent_cb is called from the network task when the page has been written to the connection or dropped from
+ * the send queue, it is not called when this function fails.
+ */
+int protocol_send_inverter_history(uint8_t channel, uint32_t resolution, time_t start, uint16_t page, bool last,
+                                   const uint32_t *t_offset, const uint16_t *samples, const int32_t *sum,
+                                   const int16_t *min, const int16_t *max, uint16_t entries_num,
+                                   shared_buffer_release_cb_t sent_cb, void *sent_ctx);
+// history page as tscodec streams of samples, sum, min and max over t_offset, sent_cb as above
+int protocol_send_inverter_history_packed(uint8_t channel, uint32_t resolution, time_t start, uint16_t page, bool last,
+                                          uint16_t entries_num, const uint16_t *lens, uint16_t fields_num,
+                                          const uint8_t *data, uint16_t data_len, shared_buffer_release_cb_t sent_cb,
+                                          void *sent_ctx);
+int protocol_send_inverter_energy_drift(time_t timestamp, time_t window_start, uint32_t inverter_wh,
+                                        uint32_t integrated_wh, int32_t correction_wh, uint32_t gap_wh,
+                                        const uint32_t *counters, uint16_t counters_num);
+int protocol_send_inverter_burst(uint8_t trigger, uint32_t detail, time_t trigger_ts, uint16_t pre_samples,
+                                 const uint8_t *channels, const uint16_t *counts, const uint16_t *lens,
+                                 uint16_t channels_num, const uint8_t *data, uint16_t data_len);
+int protocol_send_inverter_setting(uint8_t setting, uint32_t age_s, bool stale, const char *text, uint16_t text_len);
+int protocol_send_inverter_set_result(uint16_t id, const uint8_t *results, uint16_t results_num);
+int protocol_send_inverter_poll_plan(const inverter_poll_plan_msg_t *msg);
+// voltages in 0.1V, currents in 0.1A, powers in W, energies in Wh since boot, one entry per input
+int protocol_send_inverter_pv_inputs(time_t timestamp, const uint16_t *voltages, const uint16_t *currents,
+                                     const uint16_t *powers, const uint32_t *energies, uint16_t inputs_num);
+
+// voltage in mV, current in mA, capacities in mAh, temps in 0.1C, cell mV = cell_base + (offset << cell_shift)
+int protocol_send_bms_pack(time_t timestamp, uint8_t pack, uint32_t voltage, int32_t current, uint8_t soc,
+                           uint32_t remaining, uint32_t total, uint16_t cycles, uint16_t cell_base, uint8_t cell_shift,
+                           const uint8_t *cell_offsets, uint16_t cells_num, const int16_t *temps, uint16_t temps_num);
+
 int protocol_send_energy_accumulated(time_t timestamp, uint8_t meas_type, uint64_t energy);
 int protocol_send_energy_history(uint8_t meas_type, time_t ref_timestamp, uint32_t interval, uint32_t *entries,
                                  uint16_t entries_num);
@@ -216,6 +216,137 @@ meter_alarms_msg_t parse_meter_clear_alarms_msg(const uint8_t *buf, uint32_t buf
   return msg;
 }
 
+inverter_deadband_msg_t parse_inverter_deadband_msg(const uint8_t *buf, uint32_t buf_len)
+{
+  inverter_deadband_msg_t msg = {0};
+
+  if (buf_len != sizeof(uint16_t) + sizeof(uint8_t) + 2 * sizeof(uint32_t)) {
+    msg.type = (msg_type_t)MSGTYPE_INVALID;
+    return msg;
+  }
+
+  const uint8_t *ptr = buf;
+  msg.type = parse_uint16(&ptr);
+  msg.channel = parse_uint8(&ptr);
+  msg.threshold = parse_uint32(&ptr);
+  msg.max_silence = parse_uint32(&ptr);
+  return msg;
+}
+
+inverter_history_query_msg_t parse_inverter_history_query_msg(const uint8_t *buf, uint32_t buf_len)
+{
+  inverter_history_query_msg_t msg = {0};
+
+  const uint32_t base_len = sizeof(uint16_t) + sizeof(uint8_t) + 2 * sizeof(uint64_t) + sizeof(uint32_t);
+
+  if (buf_len != base_len && buf_len != base_len + sizeof(uint16_t)) {
+    msg.type = (msg_type_t)MSGTYPE_INVALID;
+    return msg;
+  }
+
+  const uint8_t *ptr = buf;
+  msg.type = parse_uint16(&ptr);
+  msg.channel = parse_uint8(&ptr);
+  msg.from = parse_uint64(&ptr);
+  msg.to = parse_uint64(&ptr);
+  msg.resolution = parse_uint32(&ptr);
+
+  if (buf_len > base_len) {
+    msg.points = parse_uint16(&ptr);
+  }
+
+  return msg;
+}
+
+inverter_set_batch_msg_t parse_inverter_set_batch_msg(const uint8_t *buf, uint32_t buf_len)
+{
+  inverter_set_batch_msg_t msg = {0};
+  const uint32_t header_len = 3 * sizeof(uint16_t);
+
+  if (buf_len < header_len) {
+    msg.type = (msg_type_t)MSGTYPE_INVALID;
+    return msg;
+  }
+
+  const uint8_t *ptr = buf;
+  msg.type = parse_uint16(&ptr);
+  msg.id = parse_uint16(&ptr);
+  msg.items_num = parse_uint16(&ptr);
+
+  if (msg.items_num == 0 || msg.items_num > INVERTER_SET_ITEMS) {
+    msg.type = (msg_type_t)MSGTYPE_INVALID;
+    return msg;
+  }
+
+  // every item is its length followed by the text
+  for (uint16_t i = 0; i < msg.items_num; i++) {
+    if ((uint32_t)(ptr - buf) + sizeof(uint8_t) > buf_len) {
+      msg.type = (msg_type_t)MSGTYPE_INVALID;
+      return msg;
+    }
+
+    msg.items_len[i] = parse_uint8(&ptr);
+
+    if (msg.items_len[i] == 0 || msg.items_len[i] > INVERTER_SET_ITEM_LEN ||
+        (uint32_t)(ptr - buf) + msg.items_len[i] > buf_len) {
+      msg.type = (msg_type_t)MSGTYPE_INVALID;
+      return msg;
+    }
+
+    memcpy(msg.items[i], ptr, msg.items_len[i]);
+    ptr += msg.items_len[i];
+  }
+
+  if ((uint32_t)(ptr - buf) != buf_len) {
+    msg.type = (msg_type_t)MSGTYPE_INVALID;
+  }
+
+  return msg;
+}
+
+inverter_poll_plan_msg_t parse_inverter_poll_plan_msg(const uint8_t *buf, uint32_t buf_len)
+{
+  inverter_poll_plan_msg_t msg = {0};
+  const uint32_t poll_len = sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint8_t);
+  const uint32_t deadband_len = sizeof(uint8_t) + 2 * sizeof(uint32_t);
+
+  if (buf_len < 2 * sizeof(uint16_t)) {
+    msg.type = (msg_type_t)MSGTYPE_INVALID;
+    return msg;
+  }
+
+  const uint8_t *ptr = buf;
+  msg.type = parse_uint16(&ptr);
+  msg.polls_num = parse_uint16(&ptr);
+
+  if (msg.polls_num > INVERTER_POLL_PLAN_ITEMS || (uint32_t)(ptr - buf) + msg.polls_num * poll_len + sizeof(uint16_t) > buf_len) {
+    msg.type = (msg_type_t)MSGTYPE_INVALID;
+    return msg;
+  }
+
+  for (uint16_t i = 0; i < msg.polls_num; i++) {
+    msg.cmds[i] = parse_uint16(&ptr);
+    msg.intervals[i] = parse_uint32(&ptr);
+    msg.priorities[i] = parse_uint8(&ptr);
+  }
+
+  msg.deadbands_num = parse_uint16(&ptr);
+
+  if (msg.deadbands_num > INVERTER_POLL_PLAN_DEADBANDS ||
+      (uint32_t)(ptr - buf) + msg.deadbands_num * deadband_len != buf_len) {
+    msg.type = (msg_type_t)MSGTYPE_INVALID;
+    return msg;
+  }
+
+  for (uint16_t i = 0; i < msg.deadbands_num; i++) {
+    msg.channels[i] = parse_uint8(&ptr);
+    msg.thresholds[i] = parse_uint32(&ptr);
+    msg.max_silences[i] = parse_uint32(&ptr);
+  }
+
+  return msg;
+}
+
 energy_price_day_msg_t parse_energy_price_day_msg(const uint8_t *buf, uint32_t buf_len)
 {
   energy_price_day_msg_t msg = {0};
@@ -593,8 +724,9 @@ status_msg_t parse_status_msg(const uint8_t *buf, uint32_t buf_len)
 get_msg_t parse_get_msg(const uint8_t *buf, uint32_t buf_len)
 {
   get_msg_t msg = {0};
+  const uint32_t base_len = 2 * sizeof(uint16_t) + sizeof(uint32_t);
 
-  if (buf_len != 2 * sizeof(uint16_t) + sizeof(uint32_t)) {
+  if (buf_len != base_len && buf_len != base_len + sizeof(uint32_t)) {
     msg.type = (msg_type_t)MSGTYPE_INVALID;
     return msg;
   }
@@ -603,5 +735,6 @@ get_msg_t parse_get_msg(const uint8_t *buf, uint32_t buf_len)
   msg.type = parse_uint16(&ptr);
   msg.rq_type = parse_uint16(&ptr);
   msg.param = parse_uint32(&ptr);
+  msg.max_age = buf_len > base_len ? parse_uint32(&ptr) : UINT32_MAX;
   return msg;
 }
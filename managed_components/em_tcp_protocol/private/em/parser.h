@@ -44,6 +44,11 @@ environment_position_msg_t parse_environment_position_msg(const uint8_t *buf, ui
 meter_current_limit_msg_t parse_meter_current_limit_msg(const uint8_t *buf, uint32_t buf_len);
 meter_alarms_msg_t parse_meter_clear_alarms_msg(const uint8_t *buf, uint32_t buf_len);
 
+inverter_deadband_msg_t parse_inverter_deadband_msg(const uint8_t *buf, uint32_t buf_len);
+inverter_history_query_msg_t parse_inverter_history_query_msg(const uint8_t *buf, uint32_t buf_len);
+inverter_set_batch_msg_t parse_inverter_set_batch_msg(const uint8_t *buf, uint32_t buf_len);
+inverter_poll_plan_msg_t parse_inverter_poll_plan_msg(const uint8_t *buf, uint32_t buf_len);
+
 diag_set_logs_settings_msg_t parse_diag_set_logs_settings(const uint8_t *buf, uint32_t buf_len);
 
 status_msg_t parse_status_msg(const uint8_t *buf, uint32_t buffer_len);
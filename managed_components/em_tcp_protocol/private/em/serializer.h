@@ -7,6 +7,8 @@
 
 #include "em/messages.h"
 
+#include <stdbool.h>
+
 ptrdiff_t serialize_client_info_msg(const client_info_msg_t *msg, uint8_t *buffer);
 
 ptrdiff_t serialize_installed_fw_msg(const installed_fw_msg_t *msg, uint8_t *buffer);
@@ -47,6 +49,41 @@ ptrdiff_t serialize_meter_meas_history_msg(time_t ref_timestamp, uint8_t meas_ty
 ptrdiff_t serialize_meter_current_limit_msg(int32_t current_limit, uint8_t *buffer);
 ptrdiff_t serialize_meter_alarms_msg(uint64_t mask, uint8_t *buffer);
 
+ptrdiff_t serialize_inverter_meas_msg(time_t timestamp, const uint8_t *channels, const int32_t *values,
+                                      uint16_t entries_num, uint8_t *buffer);
+ptrdiff_t serialize_inverter_deadband_msg(const inverter_deadband_msg_t *msg, uint8_t *buffer);
+ptrdiff_t serialize_inverter_status_msg(const inverter_status_msg_t *msg, uint8_t *buffer);
+ptrdiff_t serialize_inverter_power_summary_msg(time_t start, uint32_t period, const uint8_t *channels,
+                                               const uint16_t *samples, const int32_t *p5, const int32_t *p50,
+                                               const int32_t *p95, const int32_t *peak, uint16_t entries_num,
+                                               uint8_t *buffer);
+ptrdiff_t serialize_inverter_history_msg(uint8_t channel, uint32_t resolution, time_t start, uint16_t page, bool last,
+                                         const uint32_t *t_offset, const uint16_t *samples, const int32_t *sum,
+                                         const int16_t *min, const int16_t *max, uint16_t entries_num,
+                                         uint8_t *buffer);
+ptrdiff_t serialize_inverter_history_packed_msg(uint8_t channel, uint32_t resolution, time_t start, uint16_t page,
+                                                bool last, uint16_t entries_num, const uint16_t *lens,
+                                                uint16_t fields_num, const uint8_t *data, uint16_t data_len,
+                                                uint8_t *buffer);
+ptrdiff_t serialize_inverter_energy_drift_msg(time_t timestamp, time_t window_start, uint32_t inverter_wh,
+                                              uint32_t integrated_wh, int32_t correction_wh, uint32_t gap_wh,
+                                              const uint32_t *counters, uint16_t counters_num, uint8_t *buffer);
+ptrdiff_t serialize_inverter_burst_msg(uint8_t trigger, uint32_t detail, time_t trigger_ts, uint16_t pre_samples,
+                                      const uint8_t *channels, const uint16_t *counts, const uint16_t *lens,
+                                      uint16_t channels_num, const uint8_t *data, uint16_t data_len, uint8_t *buffer);
+ptrdiff_t serialize_inverter_setting_msg(uint8_t setting, uint32_t age_s, bool stale, const char *text,
+                                         uint16_t text_len, uint8_t *buffer);
+ptrdiff_t serialize_inverter_set_result_msg(uint16_t id, const uint8_t *results, uint16_t results_num, uint8_t *buffer);
+ptrdiff_t serialize_inverter_poll_plan_msg(const inverter_poll_plan_msg_t *msg, uint8_t *buffer);
+ptrdiff_t serialize_inverter_pv_inputs_msg(time_t timestamp, const uint16_t *voltages, const uint16_t *currents,
+                                           const uint16_t *powers, const uint32_t *energies, uint16_t inputs_num,
+                                           uint8_t *buffer);
+
+ptrdiff_t serialize_bms_pack_msg(time_t timestamp, uint8_t pack, uint32_t voltage, int32_t current, uint8_t soc,
+                                 uint32_t remaining, uint32_t total, uint16_t cycles, uint16_t cell_base,
+                                 uint8_t cell_shift, const uint8_t *cell_offsets, uint16_t cells_num,
+                                 const int16_t *temps, uint16_t temps_num, uint8_t *buffer);
+
 ptrdiff_t serialize_energy_accumulated_msg(time_t timestamp, uint8_t meas_type, uint64_t energy, uint8_t *buffer);
 ptrdiff_t serialize_energy_history_msg(time_t timestamp, uint8_t meas_type, uint32_t interval, uint32_t *energy,
                                        uint16_t entries_num, uint8_t *buffer);
@@ -368,6 +368,58 @@ static int parse_message(const uint8_t *data, uint32_t len, msg_type_t *out_type
     return ESP_OK;
   };
 
+  case MSGTYPE_INVERTER_SET_DEADBAND: {
+    ESP_LOGI(LOG_TAG, "%s: Len=%ld", __STRINGIFY(MSGTYPE_INVERTER_SET_DEADBAND), len);
+    inverter_deadband_msg_t msg = parse_inverter_deadband_msg(data, len);
+
+    if (msg.type == MSGTYPE_INVALID) {
+      ESP_LOGW(LOG_TAG, "Can't parse %s", __STRINGIFY(MSGTYPE_INVERTER_SET_DEADBAND));
+      return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    memcpy(msg_buffer, &msg, sizeof(inverter_deadband_msg_t));
+    return ESP_OK;
+  };
+
+  case MSGTYPE_INVERTER_HISTORY_QUERY: {
+    ESP_LOGI(LOG_TAG, "%s: Len=%ld", __STRINGIFY(MSGTYPE_INVERTER_HISTORY_QUERY), len);
+    inverter_history_query_msg_t msg = parse_inverter_history_query_msg(data, len);
+
+    if (msg.type == MSGTYPE_INVALID) {
+      ESP_LOGW(LOG_TAG, "Can't parse %s", __STRINGIFY(MSGTYPE_INVERTER_HISTORY_QUERY));
+      return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    memcpy(msg_buffer, &msg, sizeof(inverter_history_query_msg_t));
+    return ESP_OK;
+  };
+
+  case MSGTYPE_INVERTER_SET_BATCH: {
+    ESP_LOGI(LOG_TAG, "%s: Len=%ld", __STRINGIFY(MSGTYPE_INVERTER_SET_BATCH), len);
+    inverter_set_batch_msg_t msg = parse_inverter_set_batch_msg(data, len);
+
+    if (msg.type == MSGTYPE_INVALID) {
+      ESP_LOGW(LOG_TAG, "Can't parse %s", __STRINGIFY(MSGTYPE_INVERTER_SET_BATCH));
+      return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    memcpy(msg_buffer, &msg, sizeof(inverter_set_batch_msg_t));
+    return ESP_OK;
+  };
+
+  case MSGTYPE_INVERTER_SET_POLL_PLAN: {
+    ESP_LOGI(LOG_TAG, "%s: Len=%ld", __STRINGIFY(MSGTYPE_INVERTER_SET_POLL_PLAN), len);
+    inverter_poll_plan_msg_t msg = parse_inverter_poll_plan_msg(data, len);
+
+    if (msg.type == MSGTYPE_INVALID) {
+      ESP_LOGW(LOG_TAG, "Can't parse %s", __STRINGIFY(MSGTYPE_INVERTER_SET_POLL_PLAN));
+      return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    memcpy(msg_buffer, &msg, sizeof(inverter_poll_plan_msg_t));
+    return ESP_OK;
+  };
+
   case MSGTYPE_DIAG_COREDUMP_CONFIRMED: {
     ESP_LOGI(LOG_TAG, "%s: Len=%ld", __STRINGIFY(MSGTYPE_DIAG_COREDUMP_CONFIRMED), len);
     memcpy(msg_buffer, &type, sizeof(msg_type_t));
@@ -6,9 +6,11 @@
 #include <string.h>
 
 #include "em/buffer.h"
+#include "em/buffer_pool.h"
 #include "em/messages.h"
 #include "em/protocol.h"
 #include "em/serializer.h"
+#include "em/shared_buffer.h"
 
 #include <esp_log.h>
 #include <esp_random.h>
@@ -17,6 +19,19 @@
 #define LOG_TAG "em_tcp_tx"
 
 static net_tx_medium_cb_t net_tx_handler;
+static net_tx_shared_medium_cb_t net_tx_shared_handler;
+
+// message buffer from the pool, exhaustion is logged by the pool
+static int alloc_msg(buffer_t *b, size_t len)
+{
+  *b = (buffer_t){0};
+
+  if (len > UINT16_MAX || buffer_pool_alloc(b, (uint16_t)len) != 0) {
+    return ESP_ERR_NO_MEM;
+  }
+
+  return ESP_OK;
+}
 
 static int send_data(buffer_t *data)
 {
@@ -36,6 +51,30 @@ static int send_data(buffer_t *data)
   return ESP_OK;
 }
 
+// drops the reference of the caller, release callback runs only when the medium took the buffer
+static int send_shared(shared_buffer_t *sb)
+{
+  int ret = ESP_ERR_INVALID_STATE;
+
+  if (net_tx_shared_handler) {
+    ret = net_tx_shared_handler(sb);
+
+    if (ret != ESP_OK) {
+      ESP_LOGE(LOG_TAG, "Send shared data err: %d", ret);
+    }
+  } else {
+    ESP_LOGW(LOG_TAG, "TCP TX handler missing");
+  }
+
+  if (ret != ESP_OK) {
+    // the medium keeps no reference on failure, so this is the last one
+    sb->release_cb = NULL;
+  }
+
+  shared_buffer_unref(sb);
+  return ret;
+}
+
 int protocol_send_client_info(uint32_t unique_id, uint64_t dev_id, uint8_t hw_ver, uint32_t app_ver,
                               uint8_t reconn_reason, uint16_t dev_type, uint32_t ip_addr, uint8_t reset_reason,
                               uint16_t session_id)
@@ -53,8 +92,11 @@ int protocol_send_client_info(uint32_t unique_id, uint64_t dev_id, uint8_t hw_ve
                            .reset_reason = reset_reason,
                            .session_id = session_id,
                            .CRC = 0};
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, sizeof(client_info_msg_t));
+  buffer_t serialized;
+  if (alloc_msg(&serialized, sizeof(client_info_msg_t)) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_client_info_msg(&msg, serialized.data);
 
   // calculate crc32 over the whole message excluding the crc field
@@ -75,8 +117,11 @@ int protocol_send_installed_fw(uint32_t fw_ver, uint32_t downloaded_fw_ver, uint
     .build_time = build_time,
   };
 
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, sizeof(installed_fw_msg_t));
+  buffer_t serialized;
+  if (alloc_msg(&serialized, sizeof(installed_fw_msg_t)) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_installed_fw_msg(&msg, serialized.data);
   return send_data(&serialized);
 }
@@ -92,8 +137,11 @@ int protocol_send_update_status(uint32_t fw_ver, uint8_t progress, uint8_t phase
     .error = error,
   };
 
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, sizeof(update_status_msg_t));
+  buffer_t serialized;
+  if (alloc_msg(&serialized, sizeof(update_status_msg_t)) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_update_status_msg(&msg, serialized.data);
   return send_data(&serialized);
 }
@@ -105,8 +153,11 @@ int protocol_send_wireless_status(uint8_t protocol, uint8_t enabled, uint32_t ip
   size_t len =
     sizeof(uint16_t) + sizeof(uint8_t) + sizeof(uint8_t) + sizeof(uint32_t) + sizeof(int8_t) + sizeof(uint8_t);
 
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, len);
+  buffer_t serialized;
+  if (alloc_msg(&serialized, len) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_wireless_status_msg(protocol, enabled, ip, rssi, lqi, serialized.data);
   return send_data(&serialized);
 }
@@ -131,8 +182,11 @@ int protocol_send_wireless_credentials(uint8_t protocol, const char *network, co
   size_t len = sizeof(msg.type) + sizeof(msg.protocol) + sizeof(msg.network_len) + network_len +
                sizeof(msg.password_len) + password_len;
 
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, len);
+  buffer_t serialized;
+  if (alloc_msg(&serialized, len) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_wireless_credentials_msg(&msg, serialized.data);
   return send_data(&serialized);
 }
@@ -140,8 +194,11 @@ int protocol_send_wireless_credentials(uint8_t protocol, const char *network, co
 int protocol_send_wireless_tx_power(uint8_t protocol, int16_t tx_power)
 {
   ESP_LOGD(LOG_TAG, "%s", __func__);
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, sizeof(uint16_t) + sizeof(uint8_t) + sizeof(int16_t));
+  buffer_t serialized;
+  if (alloc_msg(&serialized, sizeof(uint16_t) + sizeof(uint8_t) + sizeof(int16_t)) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_wireless_tx_power_msg(protocol, tx_power, serialized.data);
   return send_data(&serialized);
 }
@@ -149,8 +206,11 @@ int protocol_send_wireless_tx_power(uint8_t protocol, int16_t tx_power)
 int protocol_send_wireless_channel(uint8_t protocol, uint8_t channel)
 {
   ESP_LOGD(LOG_TAG, "%s", __func__);
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, sizeof(uint16_t) + 2 * sizeof(uint8_t));
+  buffer_t serialized;
+  if (alloc_msg(&serialized, sizeof(uint16_t) + 2 * sizeof(uint8_t)) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_wireless_tx_power_msg(protocol, channel, serialized.data);
   return send_data(&serialized);
 }
@@ -164,8 +224,11 @@ int protocol_send_energy_price_day_get(uint32_t req_tariff, time_t req_day_time)
     .day_time = req_day_time,
   };
 
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, sizeof(energy_price_day_get_msg_t));
+  buffer_t serialized;
+  if (alloc_msg(&serialized, sizeof(energy_price_day_get_msg_t)) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_energy_price_day_get_msg(&msg, serialized.data);
   return send_data(&serialized);
 }
@@ -174,8 +237,11 @@ int protocol_send_energy_threshold(int32_t price)
 {
   ESP_LOGD(LOG_TAG, "%s", __func__);
   energy_price_threshold_msg_t msg = {.type = (uint16_t)MSGTYPE_ENERGYPRICE_PRICE_THRESHOLD, .price = price};
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, sizeof(energy_price_threshold_msg_t));
+  buffer_t serialized;
+  if (alloc_msg(&serialized, sizeof(energy_price_threshold_msg_t)) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_energy_price_threshold_msg(&msg, serialized.data);
   return send_data(&serialized);
 }
@@ -184,8 +250,11 @@ int protocol_send_energy_cheap_period(uint8_t quarters)
 {
   ESP_LOGD(LOG_TAG, "%s", __func__);
   energy_price_cheap_period_msg_t msg = {.type = (uint16_t)MSGTYPE_ENERGYPRICE_CHEAP_PERIOD, .quarters = quarters};
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, sizeof(energy_price_cheap_period_msg_t));
+  buffer_t serialized;
+  if (alloc_msg(&serialized, sizeof(energy_price_cheap_period_msg_t)) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_energy_price_cheap_period_msg(&msg, serialized.data);
   return send_data(&serialized);
 }
@@ -198,8 +267,11 @@ int protocol_send_energy_active_price_limit(int32_t price)
     .price = price,
   };
 
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, sizeof(energy_price_active_price_limit_msg_t));
+  buffer_t serialized;
+  if (alloc_msg(&serialized, sizeof(energy_price_active_price_limit_msg_t)) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_energy_price_active_price_limit_msg(&msg, serialized.data);
   return send_data(&serialized);
 }
@@ -208,8 +280,11 @@ int protocol_send_energy_sunnyhours(uint8_t percentage)
 {
   ESP_LOGD(LOG_TAG, "%s", __func__);
   environment_sunny_time_msg_t msg = {.type = (uint16_t)MSGTYPE_ENVIRONMENT_SUNNY_TIME, .percentage = percentage};
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, sizeof(environment_sunny_time_msg_t));
+  buffer_t serialized;
+  if (alloc_msg(&serialized, sizeof(environment_sunny_time_msg_t)) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_environment_sunny_time_msg(&msg, serialized.data);
   return send_data(&serialized);
 }
@@ -218,8 +293,11 @@ int protocol_send_energy_tariff(uint16_t tariff)
 {
   ESP_LOGD(LOG_TAG, "%s", __func__);
   energy_price_tariff_msg_t msg = {.type = (uint16_t)MSGTYPE_ENERGYPRICE_TARIFF, .tariff = tariff};
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, sizeof(energy_price_tariff_msg_t));
+  buffer_t serialized;
+  if (alloc_msg(&serialized, sizeof(energy_price_tariff_msg_t)) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_energy_price_tariff_msg(&msg, serialized.data);
   return send_data(&serialized);
 }
@@ -228,8 +306,11 @@ int protocol_send_relay_mode(uint8_t mode)
 {
   ESP_LOGD(LOG_TAG, "%s", __func__);
   relay_mode_msg_t msg = {.type = (uint16_t)MSGTYPE_RELAY_MODE, .mode = mode};
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, sizeof(relay_mode_msg_t));
+  buffer_t serialized;
+  if (alloc_msg(&serialized, sizeof(relay_mode_msg_t)) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_relay_mode_msg(&msg, serialized.data);
   return send_data(&serialized);
 }
@@ -238,8 +319,11 @@ int protocol_send_relay_state(uint8_t state)
 {
   ESP_LOGD(LOG_TAG, "%s", __func__);
   relay_state_msg_t msg = {.type = (uint16_t)MSGTYPE_RELAY_STATE, .state = state};
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, sizeof(relay_state_msg_t));
+  buffer_t serialized;
+  if (alloc_msg(&serialized, sizeof(relay_state_msg_t)) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_relay_state_msg(&msg, serialized.data);
   return send_data(&serialized);
 }
@@ -248,8 +332,11 @@ int protocol_send_relay_def_state(uint8_t enabled)
 {
   ESP_LOGD(LOG_TAG, "%s", __func__);
   relay_default_state_msg_t msg = {.type = (uint16_t)MSGTYPE_RELAY_DEFAULT_STATE, .state = enabled};
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, sizeof(relay_default_state_msg_t));
+  buffer_t serialized;
+  if (alloc_msg(&serialized, sizeof(relay_default_state_msg_t)) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_relay_default_state_msg(&msg, serialized.data);
   return send_data(&serialized);
 }
@@ -259,8 +346,11 @@ int protocol_send_relay_pwm(uint8_t enabled, uint16_t period_min, uint8_t duty_c
   ESP_LOGD(LOG_TAG, "%s", __func__);
   relay_pwm_msg_t msg = {
     .type = (uint16_t)MSGTYPE_RELAY_PWM, .enabled = enabled, .period = period_min, .duty_cycle = duty_cycle};
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, sizeof(relay_pwm_msg_t));
+  buffer_t serialized;
+  if (alloc_msg(&serialized, sizeof(relay_pwm_msg_t)) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_relay_pwm_msg(&msg, serialized.data);
   return send_data(&serialized);
 }
@@ -268,8 +358,11 @@ int protocol_send_relay_pwm(uint8_t enabled, uint16_t period_min, uint8_t duty_c
 int protocol_send_relay_inverted_output(uint8_t inverted)
 {
   ESP_LOGD(LOG_TAG, "%s", __func__);
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, sizeof(uint16_t) + sizeof(uint8_t));
+  buffer_t serialized;
+  if (alloc_msg(&serialized, sizeof(uint16_t) + sizeof(uint8_t)) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_relay_output_inverted_msg(inverted, serialized.data);
   return send_data(&serialized);
 }
@@ -279,8 +372,11 @@ int protocol_send_relay_button_config(uint8_t *modes, uint8_t mode_len)
   ESP_LOGD(LOG_TAG, "%s", __func__);
   relay_button_config_msg_t msg = {.type = (uint16_t)MSGTYPE_RELAY_BUTTON_CONFIG, .mode_len = mode_len};
   memcpy(msg.modes, modes, mode_len * sizeof(*modes));
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, sizeof(relay_button_config_msg_t));
+  buffer_t serialized;
+  if (alloc_msg(&serialized, sizeof(relay_button_config_msg_t)) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_relay_defined_modes_msg(&msg, serialized.data);
   return send_data(&serialized);
 }
@@ -290,8 +386,11 @@ int protocol_send_relay_schedule(uint8_t *schedule, uint8_t len)
   ESP_LOGD(LOG_TAG, "%s", __func__);
   relay_schedule_msg_t msg = {.type = (uint16_t)MSGTYPE_RELAY_SCHEDULE, .schedule_len = len};
   memcpy(msg.schedule, schedule, len * sizeof(*schedule));
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, sizeof(relay_schedule_msg_t));
+  buffer_t serialized;
+  if (alloc_msg(&serialized, sizeof(relay_schedule_msg_t)) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_relay_schedule_msg(&msg, serialized.data);
   return send_data(&serialized);
 }
@@ -307,8 +406,11 @@ int protocol_send_relay_one_shot(uint8_t enabled, time_t start, time_t end, uint
     .state = state,
   };
 
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, sizeof(relay_one_shot_msg_t));
+  buffer_t serialized;
+  if (alloc_msg(&serialized, sizeof(relay_one_shot_msg_t)) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_relay_one_shot_msg(&msg, serialized.data);
   return send_data(&serialized);
 }
@@ -321,8 +423,11 @@ int protocol_send_relay_snapshots(time_t ref_timestamp, int8_t factor, uint32_t
   size_t len = sizeof(uint16_t) + sizeof(ref_timestamp) + sizeof(factor) +
                entries_num * (sizeof(*t_offset) + sizeof(*snapshot) + sizeof(*thresholds)) + 3 * sizeof(entries_num);
 
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, len); // TODO: this structure is not packed so too much space is allocated
+  buffer_t serialized;
+  if (alloc_msg(&serialized, len) != ESP_OK) { // TODO: this structure is not packed so too much space is allocated
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len =
     serialize_relay_snapshots_msg(ref_timestamp, factor, t_offset, snapshot, thresholds, entries_num, serialized.data);
   return send_data(&serialized);
@@ -337,8 +442,11 @@ int protocol_send_environment_position(int32_t latitude, int32_t longitude)
     .longitude = longitude,
   };
 
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, sizeof(environment_position_msg_t));
+  buffer_t serialized;
+  if (alloc_msg(&serialized, sizeof(environment_position_msg_t)) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_environment_position_msg(&msg, serialized.data);
   return send_data(&serialized);
 }
@@ -349,8 +457,11 @@ int protocol_send_meter_measurements(time_t ref_timestamp, uint8_t *meas_types,
   size_t len = sizeof(uint16_t) + sizeof(ref_timestamp) + entries_num * (sizeof(*meas_types) + sizeof(*values)) +
                2 * sizeof(entries_num);
 
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, len);
+  buffer_t serialized;
+  if (alloc_msg(&serialized, len) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_meter_meas_msg(ref_timestamp, meas_types, values, entries_num, serialized.data);
   return send_data(&serialized);
 }
@@ -362,8 +473,11 @@ int protocol_send_meter_measurements_history(time_t ref_timestamp, uint8_t meas_
   size_t len = sizeof(uint16_t) + sizeof(ref_timestamp) + sizeof(meas_type) +
                entries_num * (sizeof(*t_offset) + sizeof(*values)) + 2 * sizeof(entries_num);
 
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, len);
+  buffer_t serialized;
+  if (alloc_msg(&serialized, len) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len =
     serialize_meter_meas_history_msg(ref_timestamp, meas_type, t_offset, values, entries_num, serialized.data);
   return send_data(&serialized);
@@ -374,8 +488,11 @@ int protocol_send_meter_current_limit(int32_t limit)
   ESP_LOGD(LOG_TAG, "%s", __func__);
   size_t len = sizeof(uint16_t) + sizeof(limit);
 
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, len);
+  buffer_t serialized;
+  if (alloc_msg(&serialized, len) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_meter_current_limit_msg(limit, serialized.data);
   return send_data(&serialized);
 }
@@ -385,19 +502,259 @@ int protocol_send_meter_alarms(uint64_t mask)
   ESP_LOGD(LOG_TAG, "%s", __func__);
   size_t len = sizeof(uint16_t) + sizeof(mask);
 
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, len);
+  buffer_t serialized;
+  if (alloc_msg(&serialized, len) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_meter_alarms_msg(mask, serialized.data);
   return send_data(&serialized);
 }
 
+int protocol_send_inverter_measurements(time_t timestamp, const uint8_t *channels, const int32_t *values,
+                                        uint16_t entries_num)
+{
+  ESP_LOGD(LOG_TAG, "%s", __func__);
+  size_t len = sizeof(uint16_t) + sizeof(timestamp) + entries_num * (sizeof(*channels) + sizeof(*values)) +
+               2 * sizeof(entries_num);
+
+  buffer_t serialized;
+  if (alloc_msg(&serialized, len) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
+  serialized.len = serialize_inverter_meas_msg(timestamp, channels, values, entries_num, serialized.data);
+  return send_data(&serialized);
+}
+
+int protocol_send_inverter_deadband(uint8_t channel, uint32_t threshold, uint32_t max_silence)
+{
+  ESP_LOGD(LOG_TAG, "%s", __func__);
+  inverter_deadband_msg_t msg = {.channel = channel, .threshold = threshold, .max_silence = max_silence};
+  size_t len = sizeof(uint16_t) + sizeof(msg.channel) + sizeof(msg.threshold) + sizeof(msg.max_silence);
+
+  buffer_t serialized;
+  if (alloc_msg(&serialized, len) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
+  serialized.len = serialize_inverter_deadband_msg(&msg, serialized.data);
+  return send_data(&serialized);
+}
+
+int protocol_send_inverter_status(time_t first_ts, time_t last_ts, uint32_t mode, uint32_t status_flags,
+                                  uint32_t status_toggled, uint64_t warning_flags, uint64_t warnings_seen,
+                                  uint32_t fault_code, uint16_t changes)
+{
+  ESP_LOGD(LOG_TAG, "%s", __func__);
+  inverter_status_msg_t msg = {
+    .first_ts = first_ts,
+    .last_ts = last_ts,
+    .mode = mode,
+    .status_flags = status_flags,
+    .status_toggled = status_toggled,
+    .warning_flags = warning_flags,
+    .warnings_seen = warnings_seen,
+    .fault_code = fault_code,
+    .changes = changes,
+  };
+  size_t len = sizeof(uint16_t) + 2 * sizeof(uint64_t) + 3 * sizeof(uint32_t) + 2 * sizeof(uint64_t) +
+               sizeof(uint32_t) + sizeof(uint16_t);
+
+  buffer_t serialized;
+  if (alloc_msg(&serialized, len) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
+  serialized.len = serialize_inverter_status_msg(&msg, serialized.data);
+  return send_data(&serialized);
+}
+
+int protocol_send_inverter_power_summary(time_t start, uint32_t period, const uint8_t *channels,
+                                         const uint16_t *samples, const int32_t *p5, const int32_t *p50,
+                                         const int32_t *p95, const int32_t *peak, uint16_t entries_num)
+{
+  ESP_LOGD(LOG_TAG, "%s", __func__);
+  size_t len = sizeof(uint16_t) + sizeof(start) + sizeof(period) + 6 * sizeof(entries_num) +
+               entries_num * (sizeof(*channels) + sizeof(*samples) + 4 * sizeof(int32_t));
+
+  buffer_t serialized;
+  if (alloc_msg(&serialized, len) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
+  serialized.len =
+    serialize_inverter_power_summary_msg(start, period, channels, samples, p5, p50, p95, peak, entries_num, serialized.data);
+  return send_data(&serialized);
+}
+
+int protocol_send_inverter_history(uint8_t channel, uint32_t resolution, time_t start, uint16_t page, bool last,
+                                   const uint32_t *t_offset, const uint16_t *samples, const int32_t *sum,
+                                   const int16_t *min, const int16_t *max, uint16_t entries_num,
+                                   shared_buffer_release_cb_t sent_cb, void *sent_ctx)
+{
+  ESP_LOGD(LOG_TAG, "%s", __func__);
+  size_t len = sizeof(uint16_t) + sizeof(channel) + sizeof(resolution) + sizeof(uint64_t) + sizeof(page) +
+               sizeof(uint8_t) + 5 * sizeof(entries_num) +
+               entries_num * (sizeof(*t_offset) + sizeof(*samples) + sizeof(*sum) + sizeof(*min) + sizeof(*max));
+
+  shared_buffer_t *sb = len <= UINT16_MAX ? shared_buffer_create((uint16_t)len, sent_cb, sent_ctx) : NULL;
+  if (sb == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+
+  sb->buf.len = serialize_inverter_history_msg(channel, resolution, start, page, last, t_offset, samples, sum, min,
+                                               max, entries_num, sb->buf.data);
+  return send_shared(sb);
+}
+
+int protocol_send_inverter_history_packed(uint8_t channel, uint32_t resolution, time_t start, uint16_t page, bool last,
+                                          uint16_t entries_num, const uint16_t *lens, uint16_t fields_num,
+                                          const uint8_t *data, uint16_t data_len, shared_buffer_release_cb_t sent_cb,
+                                          void *sent_ctx)
+{
+  ESP_LOGD(LOG_TAG, "%s", __func__);
+  size_t len = sizeof(uint16_t) + sizeof(channel) + sizeof(resolution) + sizeof(uint64_t) + sizeof(page) +
+               sizeof(uint8_t) + sizeof(entries_num) + 2 * sizeof(fields_num) + fields_num * sizeof(*lens) + data_len;
+
+  shared_buffer_t *sb = len <= UINT16_MAX ? shared_buffer_create((uint16_t)len, sent_cb, sent_ctx) : NULL;
+  if (sb == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+
+  sb->buf.len = serialize_inverter_history_packed_msg(channel, resolution, start, page, last, entries_num, lens,
+                                                      fields_num, data, data_len, sb->buf.data);
+  return send_shared(sb);
+}
+
+int protocol_send_inverter_energy_drift(time_t timestamp, time_t window_start, uint32_t inverter_wh,
+                                        uint32_t integrated_wh, int32_t correction_wh, uint32_t gap_wh,
+                                        const uint32_t *counters, uint16_t counters_num)
+{
+  ESP_LOGD(LOG_TAG, "%s", __func__);
+  size_t len = sizeof(uint16_t) + 2 * sizeof(uint64_t) + sizeof(inverter_wh) + sizeof(integrated_wh) +
+               sizeof(correction_wh) + sizeof(gap_wh) + sizeof(counters_num) + counters_num * sizeof(*counters);
+
+  buffer_t serialized;
+  if (alloc_msg(&serialized, len) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
+  serialized.len = serialize_inverter_energy_drift_msg(timestamp, window_start, inverter_wh, integrated_wh,
+                                                       correction_wh, gap_wh, counters, counters_num, serialized.data);
+  return send_data(&serialized);
+}
+
+int protocol_send_inverter_burst(uint8_t trigger, uint32_t detail, time_t trigger_ts, uint16_t pre_samples,
+                                 const uint8_t *channels, const uint16_t *counts, const uint16_t *lens,
+                                 uint16_t channels_num, const uint8_t *data, uint16_t data_len)
+{
+  ESP_LOGD(LOG_TAG, "%s", __func__);
+  size_t len = sizeof(uint16_t) + sizeof(trigger) + sizeof(detail) + sizeof(uint64_t) + sizeof(pre_samples) +
+               4 * sizeof(channels_num) + channels_num * (sizeof(*channels) + sizeof(*counts) + sizeof(*lens)) + data_len;
+
+  buffer_t serialized;
+  if (alloc_msg(&serialized, len) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
+  serialized.len = serialize_inverter_burst_msg(trigger, detail, trigger_ts, pre_samples, channels, counts, lens,
+                                                channels_num, data, data_len, serialized.data);
+  return send_data(&serialized);
+}
+
+int protocol_send_inverter_setting(uint8_t setting, uint32_t age_s, bool stale, const char *text, uint16_t text_len)
+{
+  ESP_LOGD(LOG_TAG, "%s", __func__);
+  size_t len = sizeof(uint16_t) + sizeof(setting) + sizeof(age_s) + sizeof(uint8_t) + sizeof(text_len) + text_len;
+
+  buffer_t serialized;
+  if (alloc_msg(&serialized, len) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
+  serialized.len = serialize_inverter_setting_msg(setting, age_s, stale, text, text_len, serialized.data);
+  return send_data(&serialized);
+}
+
+int protocol_send_inverter_set_result(uint16_t id, const uint8_t *results, uint16_t results_num)
+{
+  ESP_LOGD(LOG_TAG, "%s", __func__);
+  size_t len = sizeof(uint16_t) + sizeof(id) + sizeof(results_num) + results_num * sizeof(*results);
+
+  buffer_t serialized;
+  if (alloc_msg(&serialized, len) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
+  serialized.len = serialize_inverter_set_result_msg(id, results, results_num, serialized.data);
+  return send_data(&serialized);
+}
+
+int protocol_send_inverter_poll_plan(const inverter_poll_plan_msg_t *msg)
+{
+  ESP_LOGD(LOG_TAG, "%s", __func__);
+  assert(msg);
+  size_t len = sizeof(uint16_t) + sizeof(msg->polls_num) +
+               msg->polls_num * (sizeof(*msg->cmds) + sizeof(*msg->intervals) + sizeof(*msg->priorities)) +
+               sizeof(msg->deadbands_num) +
+               msg->deadbands_num * (sizeof(*msg->channels) + sizeof(*msg->thresholds) + sizeof(*msg->max_silences));
+
+  buffer_t serialized;
+  if (alloc_msg(&serialized, len) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
+  serialized.len = serialize_inverter_poll_plan_msg(msg, serialized.data);
+  return send_data(&serialized);
+}
+
+int protocol_send_inverter_pv_inputs(time_t timestamp, const uint16_t *voltages, const uint16_t *currents,
+                                     const uint16_t *powers, const uint32_t *energies, uint16_t inputs_num)
+{
+  ESP_LOGD(LOG_TAG, "%s", __func__);
+  size_t len = sizeof(uint16_t) + sizeof(uint64_t) + 4 * sizeof(inputs_num) +
+               inputs_num * (sizeof(*voltages) + sizeof(*currents) + sizeof(*powers) + sizeof(*energies));
+
+  buffer_t serialized;
+  if (alloc_msg(&serialized, len) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
+  serialized.len =
+    serialize_inverter_pv_inputs_msg(timestamp, voltages, currents, powers, energies, inputs_num, serialized.data);
+  return send_data(&serialized);
+}
+
+int protocol_send_bms_pack(time_t timestamp, uint8_t pack, uint32_t voltage, int32_t current, uint8_t soc,
+                           uint32_t remaining, uint32_t total, uint16_t cycles, uint16_t cell_base, uint8_t cell_shift,
+                           const uint8_t *cell_offsets, uint16_t cells_num, const int16_t *temps, uint16_t temps_num)
+{
+  ESP_LOGD(LOG_TAG, "%s", __func__);
+  size_t len = sizeof(uint16_t) + sizeof(uint64_t) + sizeof(pack) + sizeof(voltage) + sizeof(current) + sizeof(soc) +
+               sizeof(remaining) + sizeof(total) + sizeof(cycles) + sizeof(cell_base) + sizeof(cell_shift) +
+               2 * sizeof(cells_num) + cells_num * sizeof(*cell_offsets) + temps_num * sizeof(*temps);
+
+  buffer_t serialized;
+  if (alloc_msg(&serialized, len) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
+  serialized.len = serialize_bms_pack_msg(timestamp, pack, voltage, current, soc, remaining, total, cycles, cell_base,
+                                          cell_shift, cell_offsets, cells_num, temps, temps_num, serialized.data);
+  return send_data(&serialized);
+}
+
 int protocol_send_energy_accumulated(time_t timestamp, uint8_t meas_type, uint64_t energy)
 {
   ESP_LOGD(LOG_TAG, "%s", __func__);
   size_t len = sizeof(uint16_t) + sizeof(timestamp) + sizeof(meas_type) + sizeof(energy);
 
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, len);
+  buffer_t serialized;
+  if (alloc_msg(&serialized, len) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_energy_accumulated_msg(timestamp, meas_type, energy, serialized.data);
   return send_data(&serialized);
 }
@@ -410,8 +767,11 @@ int protocol_send_energy_history(uint8_t meas_type, time_t ref_timestamp, uint32
   size_t len = sizeof(uint16_t) + sizeof(meas_type) + sizeof(ref_timestamp) + sizeof(interval) +
                entries_num * sizeof(*entries) + sizeof(entries_num);
 
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, len); // TODO: this structure is not packed so too much space is allocated
+  buffer_t serialized;
+  if (alloc_msg(&serialized, len) != ESP_OK) { // TODO: this structure is not packed so too much space is allocated
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len =
     serialize_energy_history_msg(ref_timestamp, meas_type, interval, entries, entries_num, serialized.data);
   return send_data(&serialized);
@@ -426,8 +786,11 @@ int protocol_send_diag_coredump_start(uint32_t coredump_version)
     .coredump_version = coredump_version,
   };
 
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, sizeof(diag_coredump_start_msg_t));
+  buffer_t serialized;
+  if (alloc_msg(&serialized, sizeof(diag_coredump_start_msg_t)) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_diag_coredump_start_msg(&msg, serialized.data);
   return send_data(&serialized);
 }
@@ -444,8 +807,11 @@ int protocol_send_diag_coredump_body(uint32_t coredump_version, uint16_t block_l
   assert(block_len <= sizeof(msg.block_data));
   memcpy(msg.block_data, data, block_len);
 
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, sizeof(diag_coredump_body_msg_t));
+  buffer_t serialized;
+  if (alloc_msg(&serialized, sizeof(diag_coredump_body_msg_t)) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_diag_coredump_body_msg(&msg, serialized.data);
   return send_data(&serialized);
 }
@@ -458,8 +824,11 @@ int protocol_send_diag_coredump_end(uint32_t coredump_version)
     .coredump_version = coredump_version,
   };
 
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, sizeof(diag_coredump_end_msg_t));
+  buffer_t serialized;
+  if (alloc_msg(&serialized, sizeof(diag_coredump_end_msg_t)) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_diag_coredump_end_msg(&msg, serialized.data);
   return send_data(&serialized);
 }
@@ -474,8 +843,11 @@ int protocol_send_diag_debug_info(const char *info)
   msg.len = (uint16_t)strnlen(info, sizeof(msg.data));
   memcpy(msg.data, info, msg.len);
 
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, sizeof(msg.type) + sizeof(msg.len) + msg.len);
+  buffer_t serialized;
+  if (alloc_msg(&serialized, sizeof(msg.type) + sizeof(msg.len) + msg.len) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_diag_debug_info_msg(&msg, serialized.data);
   return send_data(&serialized);
 }
@@ -489,8 +861,11 @@ int protocol_send_diag_logs_settings(uint8_t medium, uint64_t *moduls_levels)
     msg.level_modules[i] = moduls_levels[i];
   }
 
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, sizeof(msg.type) + sizeof(msg.medium) + 6 * sizeof(msg.level_modules));
+  buffer_t serialized;
+  if (alloc_msg(&serialized, sizeof(msg.type) + sizeof(msg.medium) + 6 * sizeof(msg.level_modules)) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_diag_logs_settings_msg(&msg, serialized.data);
   return send_data(&serialized);
 }
@@ -499,8 +874,11 @@ int protocol_send_status(uint16_t rq_type, uint8_t error)
 {
   ESP_LOGD(LOG_TAG, "%s", __func__);
   status_msg_t msg = {.type = (uint16_t)MSGTYPE_STATUS, .error = error, .rq_type = rq_type};
-  buffer_t serialized = {0};
-  buffer_dynamic_alloc(&serialized, sizeof(status_msg_t));
+  buffer_t serialized;
+  if (alloc_msg(&serialized, sizeof(status_msg_t)) != ESP_OK) {
+    return ESP_ERR_NO_MEM;
+  }
+
   serialized.len = serialize_status_msg(&msg, serialized.data);
   return send_data(&serialized);
 }
@@ -509,3 +887,8 @@ void protocol_register_tx_handler(net_tx_medium_cb_t handler)
 {
   net_tx_handler = handler;
 }
+
+void protocol_register_tx_shared_handler(net_tx_shared_medium_cb_t handler)
+{
+  net_tx_shared_handler = handler;
+}
@@ -25,7 +25,7 @@ static void serialize_uint16(uint16_t value, uint8_t **ptr)
   *ptr += sizeof(uint16_t);
 }
 
-__attribute__((unused)) static void serialize_int16(int16_t value, uint8_t **ptr)
+static void serialize_int16(int16_t value, uint8_t **ptr)
 {
   (*ptr)[0] = (uint8_t)(value & 0xFF);
   (*ptr)[1] = (uint8_t)((value >> 8) & 0xFF);
@@ -414,6 +414,325 @@ ptrdiff_t serialize_meter_alarms_msg(uint64_t mask, uint8_t *buffer)
   return (ptrdiff_t)(ptr - buffer);
 }
 
+ptrdiff_t serialize_inverter_meas_msg(time_t timestamp, const uint8_t *channels, const int32_t *values,
+                                      uint16_t entries_num, uint8_t *buffer)
+{
+  uint8_t *ptr = buffer;
+  serialize_uint16(MSGTYPE_INVERTER_MEASUREMENT, &ptr);
+  serialize_uint64(timestamp, &ptr);
+
+  serialize_uint16(entries_num, &ptr);
+  for (uint16_t i = 0; i < entries_num; i++) {
+    serialize_uint8(channels[i], &ptr);
+  }
+
+  serialize_uint16(entries_num, &ptr);
+  for (uint16_t i = 0; i < entries_num; i++) {
+    serialize_int32(values[i], &ptr);
+  }
+  return (ptrdiff_t)(ptr - buffer);
+}
+
+ptrdiff_t serialize_inverter_deadband_msg(const inverter_deadband_msg_t *msg, uint8_t *buffer)
+{
+  uint8_t *ptr = buffer;
+  serialize_uint16(MSGTYPE_INVERTER_DEADBAND, &ptr);
+  serialize_uint8(msg->channel, &ptr);
+  serialize_uint32(msg->threshold, &ptr);
+  serialize_uint32(msg->max_silence, &ptr);
+
+  return (ptrdiff_t)(ptr - buffer);
+}
+
+ptrdiff_t serialize_inverter_status_msg(const inverter_status_msg_t *msg, uint8_t *buffer)
+{
+  uint8_t *ptr = buffer;
+  serialize_uint16(MSGTYPE_INVERTER_STATUS, &ptr);
+  serialize_uint64(msg->first_ts, &ptr);
+  serialize_uint64(msg->last_ts, &ptr);
+  serialize_uint32(msg->mode, &ptr);
+  serialize_uint32(msg->status_flags, &ptr);
+  serialize_uint32(msg->status_toggled, &ptr);
+  serialize_uint64(msg->warning_flags, &ptr);
+  serialize_uint64(msg->warnings_seen, &ptr);
+  serialize_uint32(msg->fault_code, &ptr);
+  serialize_uint16(msg->changes, &ptr);
+
+  return (ptrdiff_t)(ptr - buffer);
+}
+
+ptrdiff_t serialize_inverter_power_summary_msg(time_t start, uint32_t period, const uint8_t *channels,
+                                               const uint16_t *samples, const int32_t *p5, const int32_t *p50,
+                                               const int32_t *p95, const int32_t *peak, uint16_t entries_num,
+                                               uint8_t *buffer)
+{
+  uint8_t *ptr = buffer;
+  serialize_uint16(MSGTYPE_INVERTER_POWER_SUMMARY, &ptr);
+  serialize_uint64(start, &ptr);
+  serialize_uint32(period, &ptr);
+
+  serialize_uint16(entries_num, &ptr);
+  for (uint16_t i = 0; i < entries_num; i++) {
+    serialize_uint8(channels[i], &ptr);
+  }
+
+  serialize_uint16(entries_num, &ptr);
+  for (uint16_t i = 0; i < entries_num; i++) {
+    serialize_uint16(samples[i], &ptr);
+  }
+
+  const int32_t *values[] = {p5, p50, p95, peak};
+
+  for (uint32_t v = 0; v < ARRAY_LENGTH(values); v++) {
+    serialize_uint16(entries_num, &ptr);
+    for (uint16_t i = 0; i < entries_num; i++) {
+      serialize_int32(values[v][i], &ptr);
+    }
+  }
+
+  return (ptrdiff_t)(ptr - buffer);
+}
+
+ptrdiff_t serialize_inverter_history_msg(uint8_t channel, uint32_t resolution, time_t start, uint16_t page, bool last,
+                                         const uint32_t *t_offset, const uint16_t *samples, const int32_t *sum,
+                                         const int16_t *min, const int16_t *max, uint16_t entries_num,
+                                         uint8_t *buffer)
+{
+  uint8_t *ptr = buffer;
+  serialize_uint16(MSGTYPE_INVERTER_HISTORY, &ptr);
+  serialize_uint8(channel, &ptr);
+  serialize_uint32(resolution, &ptr);
+  serialize_uint64(start, &ptr);
+  serialize_uint16(page, &ptr);
+  serialize_uint8(last, &ptr);
+
+  serialize_uint16(entries_num, &ptr);
+  for (uint16_t i = 0; i < entries_num; i++) {
+    serialize_uint32(t_offset[i], &ptr);
+  }
+
+  serialize_uint16(entries_num, &ptr);
+  for (uint16_t i = 0; i < entries_num; i++) {
+    serialize_uint16(samples[i], &ptr);
+  }
+
+  serialize_uint16(entries_num, &ptr);
+  for (uint16_t i = 0; i < entries_num; i++) {
+    serialize_int32(sum[i], &ptr);
+  }
+
+  serialize_uint16(entries_num, &ptr);
+  for (uint16_t i = 0; i < entries_num; i++) {
+    serialize_int16(min[i], &ptr);
+  }
+
+  serialize_uint16(entries_num, &ptr);
+  for (uint16_t i = 0; i < entries_num; i++) {
+    serialize_int16(max[i], &ptr);
+  }
+
+  return (ptrdiff_t)(ptr - buffer);
+}
+
+ptrdiff_t serialize_inverter_history_packed_msg(uint8_t channel, uint32_t resolution, time_t start, uint16_t page,
+                                                bool last, uint16_t entries_num, const uint16_t *lens,
+                                                uint16_t fields_num, const uint8_t *data, uint16_t data_len,
+                                                uint8_t *buffer)
+{
+  uint8_t *ptr = buffer;
+  serialize_uint16(MSGTYPE_INVERTER_HISTORY_PACKED, &ptr);
+  serialize_uint8(channel, &ptr);
+  serialize_uint32(resolution, &ptr);
+  serialize_uint64(start, &ptr);
+  serialize_uint16(page, &ptr);
+  serialize_uint8(last, &ptr);
+  serialize_uint16(entries_num, &ptr);
+
+  serialize_uint16(fields_num, &ptr);
+  for (uint16_t i = 0; i < fields_num; i++) {
+    serialize_uint16(lens[i], &ptr);
+  }
+
+  // streams of samples, sum, min and max one after another, t_offset is the timestamp of every stream
+  serialize_uint16(data_len, &ptr);
+  for (uint16_t i = 0; i < data_len; i++) {
+    serialize_uint8(data[i], &ptr);
+  }
+
+  return (ptrdiff_t)(ptr - buffer);
+}
+
+ptrdiff_t serialize_inverter_energy_drift_msg(time_t timestamp, time_t window_start, uint32_t inverter_wh,
+                                              uint32_t integrated_wh, int32_t correction_wh, uint32_t gap_wh,
+                                              const uint32_t *counters, uint16_t counters_num, uint8_t *buffer)
+{
+  uint8_t *ptr = buffer;
+  serialize_uint16(MSGTYPE_INVERTER_ENERGY_DRIFT, &ptr);
+  serialize_uint64(timestamp, &ptr);
+  serialize_uint64(window_start, &ptr);
+  serialize_uint32(inverter_wh, &ptr);
+  serialize_uint32(integrated_wh, &ptr);
+  serialize_int32(correction_wh, &ptr);
+  serialize_uint32(gap_wh, &ptr);
+
+  serialize_uint16(counters_num, &ptr);
+  for (uint16_t i = 0; i < counters_num; i++) {
+    serialize_uint32(counters[i], &ptr);
+  }
+
+  return (ptrdiff_t)(ptr - buffer);
+}
+
+ptrdiff_t serialize_inverter_burst_msg(uint8_t trigger, uint32_t detail, time_t trigger_ts, uint16_t pre_samples,
+                                      const uint8_t *channels, const uint16_t *counts, const uint16_t *lens,
+                                      uint16_t channels_num, const uint8_t *data, uint16_t data_len, uint8_t *buffer)
+{
+  uint8_t *ptr = buffer;
+  serialize_uint16(MSGTYPE_INVERTER_BURST, &ptr);
+  serialize_uint8(trigger, &ptr);
+  serialize_uint32(detail, &ptr);
+  serialize_uint64(trigger_ts, &ptr);
+  serialize_uint16(pre_samples, &ptr);
+
+  serialize_uint16(channels_num, &ptr);
+  for (uint16_t i = 0; i < channels_num; i++) {
+    serialize_uint8(channels[i], &ptr);
+  }
+
+  serialize_uint16(channels_num, &ptr);
+  for (uint16_t i = 0; i < channels_num; i++) {
+    serialize_uint16(counts[i], &ptr);
+  }
+
+  serialize_uint16(channels_num, &ptr);
+  for (uint16_t i = 0; i < channels_num; i++) {
+    serialize_uint16(lens[i], &ptr);
+  }
+
+  // streams of the channels one after another, lengths above
+  serialize_uint16(data_len, &ptr);
+  for (uint16_t i = 0; i < data_len; i++) {
+    serialize_uint8(data[i], &ptr);
+  }
+
+  return (ptrdiff_t)(ptr - buffer);
+}
+
+ptrdiff_t serialize_inverter_setting_msg(uint8_t setting, uint32_t age_s, bool stale, const char *text,
+                                         uint16_t text_len, uint8_t *buffer)
+{
+  uint8_t *ptr = buffer;
+  serialize_uint16(MSGTYPE_INVERTER_SETTING, &ptr);
+  serialize_uint8(setting, &ptr);
+  serialize_uint32(age_s, &ptr);
+  serialize_uint8(stale, &ptr);
+
+  serialize_uint16(text_len, &ptr);
+  for (uint16_t i = 0; i < text_len; i++) {
+    serialize_uint8((uint8_t)text[i], &ptr);
+  }
+
+  return (ptrdiff_t)(ptr - buffer);
+}
+
+ptrdiff_t serialize_inverter_set_result_msg(uint16_t id, const uint8_t *results, uint16_t results_num, uint8_t *buffer)
+{
+  uint8_t *ptr = buffer;
+  serialize_uint16(MSGTYPE_INVERTER_SET_RESULT, &ptr);
+  serialize_uint16(id, &ptr);
+
+  serialize_uint16(results_num, &ptr);
+  for (uint16_t i = 0; i < results_num; i++) {
+    serialize_uint8(results[i], &ptr);
+  }
+
+  return (ptrdiff_t)(ptr - buffer);
+}
+
+ptrdiff_t serialize_inverter_poll_plan_msg(const inverter_poll_plan_msg_t *msg, uint8_t *buffer)
+{
+  uint8_t *ptr = buffer;
+  serialize_uint16(MSGTYPE_INVERTER_POLL_PLAN, &ptr);
+
+  serialize_uint16(msg->polls_num, &ptr);
+  for (uint16_t i = 0; i < msg->polls_num; i++) {
+    serialize_uint16(msg->cmds[i], &ptr);
+    serialize_uint32(msg->intervals[i], &ptr);
+    serialize_uint8(msg->priorities[i], &ptr);
+  }
+
+  serialize_uint16(msg->deadbands_num, &ptr);
+  for (uint16_t i = 0; i < msg->deadbands_num; i++) {
+    serialize_uint8(msg->channels[i], &ptr);
+    serialize_uint32(msg->thresholds[i], &ptr);
+    serialize_uint32(msg->max_silences[i], &ptr);
+  }
+
+  return (ptrdiff_t)(ptr - buffer);
+}
+
+ptrdiff_t serialize_inverter_pv_inputs_msg(time_t timestamp, const uint16_t *voltages, const uint16_t *currents,
+                                           const uint16_t *powers, const uint32_t *energies, uint16_t inputs_num,
+                                           uint8_t *buffer)
+{
+  uint8_t *ptr = buffer;
+  serialize_uint16(MSGTYPE_INVERTER_PV_INPUTS, &ptr);
+  serialize_uint64(timestamp, &ptr);
+
+  serialize_uint16(inputs_num, &ptr);
+  for (uint16_t i = 0; i < inputs_num; i++) {
+    serialize_uint16(voltages[i], &ptr);
+  }
+
+  serialize_uint16(inputs_num, &ptr);
+  for (uint16_t i = 0; i < inputs_num; i++) {
+    serialize_uint16(currents[i], &ptr);
+  }
+
+  serialize_uint16(inputs_num, &ptr);
+  for (uint16_t i = 0; i < inputs_num; i++) {
+    serialize_uint16(powers[i], &ptr);
+  }
+
+  serialize_uint16(inputs_num, &ptr);
+  for (uint16_t i = 0; i < inputs_num; i++) {
+    serialize_uint32(energies[i], &ptr);
+  }
+
+  return (ptrdiff_t)(ptr - buffer);
+}
+
+ptrdiff_t serialize_bms_pack_msg(time_t timestamp, uint8_t pack, uint32_t voltage, int32_t current, uint8_t soc,
+                                 uint32_t remaining, uint32_t total, uint16_t cycles, uint16_t cell_base,
+                                 uint8_t cell_shift, const uint8_t *cell_offsets, uint16_t cells_num,
+                                 const int16_t *temps, uint16_t temps_num, uint8_t *buffer)
+{
+  uint8_t *ptr = buffer;
+  serialize_uint16(MSGTYPE_BMS_PACK, &ptr);
+  serialize_uint64(timestamp, &ptr);
+  serialize_uint8(pack, &ptr);
+  serialize_uint32(voltage, &ptr);
+  serialize_int32(current, &ptr);
+  serialize_uint8(soc, &ptr);
+  serialize_uint32(remaining, &ptr);
+  serialize_uint32(total, &ptr);
+  serialize_uint16(cycles, &ptr);
+  serialize_uint16(cell_base, &ptr);
+  serialize_uint8(cell_shift, &ptr);
+
+  serialize_uint16(cells_num, &ptr);
+  for (uint16_t i = 0; i < cells_num; i++) {
+    serialize_uint8(cell_offsets[i], &ptr);
+  }
+
+  serialize_uint16(temps_num, &ptr);
+  for (uint16_t i = 0; i < temps_num; i++) {
+    serialize_int16(temps[i], &ptr);
+  }
+
+  return (ptrdiff_t)(ptr - buffer);
+}
+
 ptrdiff_t serialize_energy_accumulated_msg(time_t timestamp, uint8_t meas_type, uint64_t energy, uint8_t *buffer)
 {
   uint8_t *ptr = buffer;
@@ -8,9 +8,11 @@
 #include "driver/uart.h"
 #include "em/uart_rx.h"
 
-void em_uart_init(int baud_rate, uart_parity_t parity, uart_stop_bits_t stop_bits, uint8_t rx_timeout_symbols,
-                  data_received_cb_t cb, void *cb_param);
-int em_uart_send(const uint8_t *data, size_t len);
-void em_uart_change_config(int baud_rate, uart_parity_t parity, uart_stop_bits_t stop_bits, uint8_t rx_timeout);
+// every port has its own driver and rx task, so different ports can be used at the same time
+void em_uart_init(uart_port_t uart_num, int txd, int rxd, int baud_rate, uart_parity_t parity,
+                  uart_stop_bits_t stop_bits, uint8_t rx_timeout_symbols, data_received_cb_t cb, void *cb_param);
+int em_uart_send(uart_port_t uart_num, const uint8_t *data, size_t len);
+void em_uart_change_config(uart_port_t uart_num, int baud_rate, uart_parity_t parity, uart_stop_bits_t stop_bits,
+                           uint8_t rx_timeout);
 
 #endif /* EM_UART_H_ */
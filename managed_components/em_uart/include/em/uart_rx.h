@@ -7,11 +7,12 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include "driver/uart.h"
 
 typedef int (*data_received_cb_t)(const uint8_t *data, size_t len, void *param);
 
-void em_uart_rx_task_init(data_received_cb_t cb, void *cb_param);
-void em_uart_rx_suspend(void);
-void em_uart_rx_resume(void);
+void em_uart_rx_task_init(uart_port_t uart_num, data_received_cb_t cb, void *cb_param);
+void em_uart_rx_suspend(uart_port_t uart_num);
+void em_uart_rx_resume(uart_port_t uart_num);
 
 #endif /* EM_UART_RX_H_ */
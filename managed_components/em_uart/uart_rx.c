@@ -5,6 +5,7 @@
 #include "driver/uart.h"
 #include "em/uart_rx.h"
 #include "esp_log.h"
+#include <assert.h>
 #include <stdlib.h>
 
 #define TAG "UART_RX"
@@ -15,45 +16,57 @@
 // CTS is not used in RS485 Half-Duplex Mode
 // #define ECHO_TEST_CTS   (UART_PIN_NO_CHANGE)
 
-static data_received_cb_t data_received_cb = NULL;
-static void *data_received_cb_param = NULL;
+typedef struct {
+  uart_port_t uart_num;
+  data_received_cb_t cb;
+  void *cb_param;
+  TaskHandle_t task;
+} rx_ctx_t;
+
+static rx_ctx_t rx_ctx[UART_NUM_MAX];
 
 static void rx_task(void *arg);
 
-void em_uart_rx_task_init(data_received_cb_t cb, void *cb_param)
+void em_uart_rx_task_init(uart_port_t uart_num, data_received_cb_t cb, void *cb_param)
 {
+  assert(uart_num < UART_NUM_MAX);
+
   if (cb == NULL) {
     ESP_LOGE(TAG, "Callback function is NULL");
     return;
   }
 
-  data_received_cb = cb;
-  data_received_cb_param = cb_param;
+  rx_ctx[uart_num].uart_num = uart_num;
+  rx_ctx[uart_num].cb = cb;
+  rx_ctx[uart_num].cb_param = cb_param;
 
-  xTaskCreate(rx_task, "uart_rx", CONFIG_EM_UART_TASK_STACK_SIZE, NULL, CONFIG_EM_UART_TASK_PRIO, NULL);
+  xTaskCreate(rx_task, "uart_rx", CONFIG_EM_UART_TASK_STACK_SIZE, &rx_ctx[uart_num], CONFIG_EM_UART_TASK_PRIO,
+              &rx_ctx[uart_num].task);
 }
 
-void em_uart_rx_suspend(void)
+void em_uart_rx_suspend(uart_port_t uart_num)
 {
-  vTaskSuspend(NULL);
+  assert(uart_num < UART_NUM_MAX);
+  vTaskSuspend(rx_ctx[uart_num].task);
 }
 
-void em_uart_rx_resume(void)
+void em_uart_rx_resume(uart_port_t uart_num)
 {
-  vTaskResume(NULL);
+  assert(uart_num < UART_NUM_MAX);
+  vTaskResume(rx_ctx[uart_num].task);
 }
 
 static void rx_task(void *arg)
 {
-  const int uart_num = CONFIG_EM_UART_PORT_NUM;
-  ESP_LOGI(TAG, "start thread");
+  const rx_ctx_t *ctx = (const rx_ctx_t *)arg;
+  ESP_LOGI(TAG, "start thread uart=%d", ctx->uart_num);
 
   while (true) {
     uint8_t data[CONFIG_EM_UART_READ_BUF_SIZE] = {0};
-    int data_len = uart_read_bytes(uart_num, data, sizeof(data), 1);
+    int data_len = uart_read_bytes(ctx->uart_num, data, sizeof(data), 1);
 
     if (data_len != 0) {
-      data_received_cb(data, data_len, data_received_cb_param);
+      ctx->cb(data, data_len, ctx->cb_param);
     }
   }
 }
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#include "em/downsample.h"
+
+#include <assert.h>
+
+static inline size_t bucket_start(size_t bucket, size_t n, size_t buckets)
+{
+  return 1 + bucket * (n - 2) / buckets;
+}
+
+size_t em_downsample_lttb(size_t n, size_t out_cnt, em_downsample_get_cb_t get, em_downsample_emit_cb_t emit, void *ctx)
+{
+  assert(get != NULL);
+  assert(emit != NULL);
+
+  int64_t ts = 0;
+  int32_t value = 0;
+
+  if (out_cnt >= n) {
+    for (size_t i = 0; i < n; i++) {
+      get(i, &ts, &value, ctx);
+      emit(ts, value, ctx);
+    }
+
+    return n;
+  }
+
+  // no inner buckets, only the ends fit
+  if (out_cnt < 3) {
+    if (out_cnt >= 1) {
+      get(0, &ts, &value, ctx);
+      emit(ts, value, ctx);
+    }
+
+    if (out_cnt == 2) {
+      get(n - 1, &ts, &value, ctx);
+      emit(ts, value, ctx);
+    }
+
+    return out_cnt;
+  }
+
+  // inner buckets, first and last sample are fixed
+  const size_t buckets = out_cnt - 2;
+
+  int64_t a_ts = 0;
+  int32_t a_value = 0;
+  get(0, &a_ts, &a_value, ctx);
+  emit(a_ts, a_value, ctx);
+
+  for (size_t b = 0; b < buckets; b++) {
+    size_t start = bucket_start(b, n, buckets);
+    size_t end = bucket_start(b + 1, n, buckets);
+
+    // average of the next bucket (or last sample for the last bucket), kept as sums to stay in integers
+    size_t next_end = (b + 1 < buckets) ? bucket_start(b + 2, n, buckets) : n;
+    int64_t sum_ts = 0;
+    int64_t sum_value = 0;
+
+    for (size_t i = end; i < next_end; i++) {
+      get(i, &ts, &value, ctx);
+      sum_ts += ts - a_ts;
+      sum_value += (int64_t)value - a_value;
+    }
+
+    // doubled triangle area scaled by next bucket size, the same for all candidates so no division needed
+    uint64_t max_area = 0;
+    int64_t sel_ts = 0;
+    int32_t sel_value = 0;
+
+    for (size_t i = start; i < end; i++) {
+      get(i, &ts, &value, ctx);
+      int64_t area = (ts - a_ts) * sum_value - ((int64_t)value - a_value) * sum_ts;
+      uint64_t abs_area = area < 0 ? (uint64_t)-area : (uint64_t)area;
+
+      if (i == start || abs_area > max_area) {
+        max_area = abs_area;
+        sel_ts = ts;
+        sel_value = value;
+      }
+    }
+
+    emit(sel_ts, sel_value, ctx);
+    a_ts = sel_ts;
+    a_value = sel_value;
+  }
+
+  get(n - 1, &ts, &value, ctx);
+  emit(ts, value, ctx);
+  return out_cnt;
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#include "em/fixed.h"
+
+#include <assert.h>
+
+static bool saturate_i32(int64_t value, int32_t *out)
+{
+  if (value > INT32_MAX) {
+    *out = INT32_MAX;
+    return false;
+  }
+
+  if (value < INT32_MIN) {
+    *out = INT32_MIN;
+    return false;
+  }
+
+  *out = (int32_t)value;
+  return true;
+}
+
+bool em_fixed_parse(const char *str, size_t len, uint8_t decimals, int32_t *out)
+{
+  assert(str && out);
+
+  size_t i = 0;
+  bool negative = false;
+
+  if (len > 0 && (str[0] == '-' || str[0] == '+')) {
+    negative = str[0] == '-';
+    i++;
+  }
+
+  if (i == len) {
+    *out = 0;
+    return false;
+  }
+
+  int64_t value = 0;
+  uint8_t frac_digits = 0;
+  uint8_t extra_digits = 0;
+  bool fraction = false;
+  bool round_up = false;
+
+  for (; i < len; i++) {
+    if (str[i] == '.' && !fraction) {
+      fraction = true;
+      continue;
+    }
+
+    if (str[i] < '0' || str[i] > '9') {
+      *out = 0;
+      return false;
+    }
+
+    if (fraction && frac_digits == decimals) {
+      // only the first superfluous digit decides about rounding
+      if (extra_digits++ == 0) {
+        round_up = str[i] >= '5';
+      }
+      continue;
+    }
+
+    value = value * 10 + (str[i] - '0');
+    frac_digits += fraction ? 1 : 0;
+
+    if (value > INT32_MAX) {
+      *out = negative ? INT32_MIN : INT32_MAX;
+      return false;
+    }
+  }
+
+  for (; frac_digits < decimals; frac_digits++) {
+    value *= 10;
+  }
+
+  value += round_up ? 1 : 0;
+  return saturate_i32(negative ? -value : value, out);
+}
+
+bool em_fixed_mul_div(int32_t a, int32_t b, int32_t div, int32_t *out)
+{
+  assert(out);
+  assert(div != 0);
+
+  int64_t num = (int64_t)a * b;
+  int64_t half = (div > 0 ? div : -(int64_t)div) / 2;
+  // round half away from zero
+  int64_t result = (num < 0 ? num - half : num + half) / div;
+  return saturate_i32(result, out);
+}
+
+bool em_fixed_add_u64(uint64_t *acc, uint64_t value)
+{
+  assert(acc);
+
+  if (*acc > UINT64_MAX - value) {
+    *acc = UINT64_MAX;
+    return false;
+  }
+
+  *acc += value;
+  return true;
+}
+
+uint16_t em_fixed_sat_u16(int32_t value)
+{
+  return value < 0 ? 0 : (value > UINT16_MAX ? UINT16_MAX : (uint16_t)value);
+}
+
+int16_t em_fixed_sat_i16(int32_t value)
+{
+  return value < INT16_MIN ? INT16_MIN : (value > INT16_MAX ? INT16_MAX : (int16_t)value);
+}
+
+uint8_t em_fixed_sat_u8(int32_t value)
+{
+  return value < 0 ? 0 : (value > UINT8_MAX ? UINT8_MAX : (uint8_t)value);
+}
@@ -6,7 +6,12 @@
 #define EM_UTILS_H_
 
 #include "em/device.h"
+#include "em/downsample.h"
+#include "em/fixed.h"
 #include "em/math.h"
+#include "em/p2.h"
+#include "em/rrd.h"
 #include "em/time.h"
+#include "em/tscodec.h"
 
 #endif /* EM_UTILS_H_ */
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#include "em/p2.h"
+
+#include <assert.h>
+#include <string.h>
+
+#define Q16_ONE (1LL << 16)
+
+static void sort(int64_t *v, uint32_t cnt)
+{
+  for (uint32_t i = 1; i < cnt; i++) {
+    int64_t key = v[i];
+    int32_t j = (int32_t)i - 1;
+
+    while (j >= 0 && v[j] > key) {
+      v[j + 1] = v[j];
+      j--;
+    }
+
+    v[j + 1] = key;
+  }
+}
+
+// desired position increment of the marker in Q16: 0, p/2, p, (1+p)/2, 1
+static int64_t desired_increment(uint16_t permille, uint32_t marker)
+{
+  static const int64_t num[EM_P2_MARKERS][2] = {{0, 0}, {0, 1}, {0, 2}, {1, 1}, {2, 0}};
+  // (num[0] * 1000 + num[1] * permille) / 2000
+  return (num[marker][0] * 1000 * Q16_ONE + num[marker][1] * permille * Q16_ONE) / 2000;
+}
+
+static int64_t parabolic(const em_p2_t *p2, uint32_t i, int32_t d)
+{
+  int64_t a = p2->n[i] - p2->n[i - 1];
+  int64_t b = p2->n[i + 1] - p2->n[i];
+  int64_t up = (a + d) * (p2->q[i + 1] - p2->q[i]) / b;
+  int64_t down = (b - d) * (p2->q[i] - p2->q[i - 1]) / a;
+  return p2->q[i] + d * (up + down) / (a + b);
+}
+
+static int64_t linear(const em_p2_t *p2, uint32_t i, int32_t d)
+{
+  return p2->q[i] + d * (p2->q[i + d] - p2->q[i]) / (p2->n[i + d] - p2->n[i]);
+}
+
+void em_p2_init(em_p2_t *p2, uint16_t permille)
+{
+  assert(p2);
+  assert(permille <= 1000);
+
+  memset(p2, 0, sizeof(*p2));
+  p2->permille = permille;
+}
+
+void em_p2_add(em_p2_t *p2, int32_t value)
+{
+  assert(p2);
+
+  int64_t x = (int64_t)value << EM_P2_HEIGHT_SHIFT;
+
+  if (p2->count < EM_P2_MARKERS) {
+    p2->q[p2->count++] = x;
+
+    if (p2->count == EM_P2_MARKERS) {
+      sort(p2->q, EM_P2_MARKERS);
+
+      for (uint32_t i = 0; i < EM_P2_MARKERS; i++) {
+        p2->n[i] = (int32_t)i + 1;
+        p2->np[i] = Q16_ONE + 4 * desired_increment(p2->permille, i);
+      }
+    }
+    return;
+  }
+
+  uint32_t k = 0;
+
+  if (x < p2->q[0]) {
+    p2->q[0] = x;
+  } else if (x >= p2->q[EM_P2_MARKERS - 1]) {
+    p2->q[EM_P2_MARKERS - 1] = x > p2->q[EM_P2_MARKERS - 1] ? x : p2->q[EM_P2_MARKERS - 1];
+    k = EM_P2_MARKERS - 2;
+  } else {
+    while (x >= p2->q[k + 1]) {
+      k++;
+    }
+  }
+
+  p2->count++;
+
+  for (uint32_t i = k + 1; i < EM_P2_MARKERS; i++) {
+    p2->n[i]++;
+  }
+
+  for (uint32_t i = 0; i < EM_P2_MARKERS; i++) {
+    p2->np[i] += desired_increment(p2->permille, i);
+  }
+
+  for (uint32_t i = 1; i < EM_P2_MARKERS - 1; i++) {
+    int64_t d = p2->np[i] - ((int64_t)p2->n[i] << 16);
+
+    if ((d >= Q16_ONE && p2->n[i + 1] - p2->n[i] > 1) || (d <= -Q16_ONE && p2->n[i - 1] - p2->n[i] < -1)) {
+      int32_t ds = d > 0 ? 1 : -1;
+      int64_t q = parabolic(p2, i, ds);
+
+      if (p2->q[i - 1] < q && q < p2->q[i + 1]) {
+        p2->q[i] = q;
+      } else {
+        p2->q[i] = linear(p2, i, ds);
+      }
+
+      p2->n[i] += ds;
+    }
+  }
+}
+
+bool em_p2_get(const em_p2_t *p2, int32_t *value)
+{
+  assert(p2 && value);
+
+  if (p2->count == 0) {
+    return false;
+  }
+
+  if (p2->count < EM_P2_MARKERS) {
+    int64_t sorted[EM_P2_MARKERS];
+    memcpy(sorted, p2->q, sizeof(sorted));
+    sort(sorted, p2->count);
+    uint32_t idx = ((p2->count - 1) * p2->permille + 500) / 1000;
+    *value = (int32_t)(sorted[idx] >> EM_P2_HEIGHT_SHIFT);
+    return true;
+  }
+
+  // round to nearest, works for negative heights as well
+  *value = (int32_t)((p2->q[2] + (1 << (EM_P2_HEIGHT_SHIFT - 1))) >> EM_P2_HEIGHT_SHIFT);
+  return true;
+}
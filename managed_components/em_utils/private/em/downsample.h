@@ -0,0 +1,25 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#ifndef EM_DOWNSAMPLE_H_
+#define EM_DOWNSAMPLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// reads sample idx of the source series
+typedef void (*em_downsample_get_cb_t)(size_t idx, int64_t *ts, int32_t *value, void *ctx);
+// receives selected samples in time order
+typedef void (*em_downsample_emit_cb_t)(int64_t ts, int32_t value, void *ctx);
+
+/*
+ * Largest-Triangle-Three-Buckets downsampling of n samples to out_cnt points.
+ * Single pass over the source, no buffers - samples are read through get callback
+ * and selected ones are passed to emit callback. First and last samples are kept when out_cnt allows
+ * (1 - first only, 2 - first and last). When out_cnt >= n all samples are emitted unchanged.
+ * Returns number of emitted points.
+ */
+size_t em_downsample_lttb(size_t n, size_t out_cnt, em_downsample_get_cb_t get, em_downsample_emit_cb_t emit, void *ctx);
+
+#endif /* EM_DOWNSAMPLE_H_ */
@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#ifndef EM_FIXED_H_
+#define EM_FIXED_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Integer helpers for fixed-point values (e.g. 0.1V, 0.001 power factor, Ws).
+ * All of them return false when the result does not fit, the output is then saturated.
+ */
+
+// "228.2" with decimals=1 gives 2282, superfluous fraction digits are rounded half up
+bool em_fixed_parse(const char *str, size_t len, uint8_t decimals, int32_t *out);
+
+// a * b / div rounded to nearest, div must not be 0
+bool em_fixed_mul_div(int32_t a, int32_t b, int32_t div, int32_t *out);
+
+bool em_fixed_add_u64(uint64_t *acc, uint64_t value);
+
+uint16_t em_fixed_sat_u16(int32_t value);
+int16_t em_fixed_sat_i16(int32_t value);
+uint8_t em_fixed_sat_u8(int32_t value);
+
+#endif /* EM_FIXED_H_ */
@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#ifndef EM_P2_H_
+#define EM_P2_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define EM_P2_MARKERS (5)
+
+/*
+ * P² streaming quantile estimator (Jain, Chlamtac 1985), constant memory per quantile.
+ * Integer only: marker heights are kept scaled by 2^EM_P2_HEIGHT_SHIFT, desired positions in Q16.
+ * Until EM_P2_MARKERS samples are added the result is exact.
+ */
+#define EM_P2_HEIGHT_SHIFT (8)
+
+typedef struct {
+  int64_t q[EM_P2_MARKERS];  // marker heights
+  int64_t np[EM_P2_MARKERS]; // desired marker positions, Q16
+  int32_t n[EM_P2_MARKERS];  // marker positions, 1 based
+  uint32_t count;
+  uint16_t permille; // estimated quantile
+} em_p2_t;
+
+void em_p2_init(em_p2_t *p2, uint16_t permille);
+void em_p2_add(em_p2_t *p2, int32_t value);
+// returns false when no sample was added
+bool em_p2_get(const em_p2_t *p2, int32_t *value);
+
+#endif /* EM_P2_H_ */
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#ifndef EM_RRD_H_
+#define EM_RRD_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#define EM_RRD_MAX_TIERS (4)
+
+// consolidated period, 16 bytes so a slot never straddles a flash page
+typedef struct {
+  uint32_t period; // period start / tier step
+  int32_t sum;     // saturated
+  int16_t min;
+  int16_t max;
+  uint16_t count; // samples in the period, 0 - empty
+  uint16_t reserved;
+} em_rrd_slot_t;
+
+typedef struct {
+  uint32_t step_s;    // period length, multiple of the finer tier step
+  uint32_t slots;     // ring length
+  uint32_t retention; // periods guaranteed to be kept, <= slots
+} em_rrd_tier_t;
+
+// slot storage, idx is period % slots of the tier
+typedef struct {
+  int (*write)(void *ctx, uint8_t tier, uint32_t idx, const em_rrd_slot_t *slot);
+  int (*read)(void *ctx, uint8_t tier, uint32_t idx, em_rrd_slot_t *slot);
+  void *ctx;
+} em_rrd_backend_t;
+
+/*
+ * Round-robin tiered archive. Samples are consolidated into the finest tier, every closed period
+ * is stored and merged into the open period of the next tier (closed together with its last period),
+ * so one sample costs O(1) and the footprint is fixed by the tier table. Only the open periods
+ * live in RAM, after restart they are rebuilt from the stored periods of the finer tier.
+ * Not thread safe.
+ */
+typedef struct {
+  const em_rrd_tier_t *tiers;
+  uint8_t tiers_cnt;
+  em_rrd_backend_t backend;
+  em_rrd_slot_t open[EM_RRD_MAX_TIERS];
+  bool restored;
+} em_rrd_t;
+
+typedef struct {
+  const em_rrd_t *rrd;
+  uint8_t tier;
+  uint32_t period; // next period to read
+  uint32_t end;    // last period of the range
+} em_rrd_iter_t;
+
+int em_rrd_init(em_rrd_t *rrd, const em_rrd_tier_t *tiers, uint8_t tiers_cnt, const em_rrd_backend_t *backend);
+
+// returns 0 on success, -1 when sample is older than the open period, backend error otherwise
+int em_rrd_add(em_rrd_t *rrd, time_t ts, int16_t value);
+
+// reads period containing ts from the tier (open period included), returns 0 when it holds samples, -1 otherwise
+int em_rrd_read(const em_rrd_t *rrd, uint8_t tier, time_t ts, em_rrd_slot_t *slot);
+
+// start of the oldest period guaranteed to be kept by the tier
+time_t em_rrd_oldest(const em_rrd_t *rrd, uint8_t tier, time_t now);
+
+/*
+ * Coarsest tier with step not longer than resolution_s which still keeps from.
+ * When no tier is fine enough the finest one keeping from is returned,
+ * when none keeps from the coarsest tier is returned.
+ */
+uint8_t em_rrd_select_tier(const em_rrd_t *rrd, time_t from, time_t now, uint32_t resolution_s);
+
+/*
+ * Iterates periods of the tier overlapping [from, to] which hold samples, oldest first.
+ * Periods are addressed directly (period % slots), empty and overwritten ones are skipped.
+ * from is clamped to the tier retention as of now.
+ */
+void em_rrd_iter_init(em_rrd_iter_t *it, const em_rrd_t *rrd, uint8_t tier, time_t from, time_t to, time_t now);
+bool em_rrd_iter_next(em_rrd_iter_t *it, em_rrd_slot_t *slot);
+
+// merges src into dst, period of dst is not changed
+void em_rrd_slot_merge(em_rrd_slot_t *dst, const em_rrd_slot_t *src);
+
+#endif /* EM_RRD_H_ */
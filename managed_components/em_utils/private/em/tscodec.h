@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#ifndef EM_TSCODEC_H_
+#define EM_TSCODEC_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// worst case of one encoded sample: two 64 bit zig-zag varints
+#define EM_TSCODEC_MAX_SAMPLE_LEN (20U)
+
+/*
+ * Compressed (timestamp, value) series.
+ * Timestamps are stored as zig-zag varint delta-of-delta, values as zig-zag varint delta.
+ * Every restart_interval samples the state is reset and the sample is stored in full,
+ * byte offset of such sample is kept in restarts[] so the stream can be decoded from there.
+ */
+typedef struct {
+  uint8_t *data;
+  size_t cap;
+  size_t len;
+  uint16_t *restarts; // byte offsets of restart points
+  size_t restarts_cap;
+  uint16_t restart_interval; // samples between restart points
+  uint32_t count;            // samples in the stream
+  int64_t prev_ts;
+  int64_t prev_delta;
+  int64_t prev_value;
+} em_tscodec_t;
+
+typedef struct {
+  const em_tscodec_t *codec;
+  size_t pos;
+  uint32_t idx;
+  int64_t ts;
+  int64_t delta;
+  int64_t value;
+} em_tscodec_iter_t;
+
+int em_tscodec_init(em_tscodec_t *codec, uint8_t *data, size_t cap, uint16_t *restarts, size_t restarts_cap,
+                    uint16_t restart_interval);
+void em_tscodec_clear(em_tscodec_t *codec);
+
+// returns 0 on success, -1 when stream or restart table is full (codec state not changed)
+int em_tscodec_append(em_tscodec_t *codec, int64_t ts, int64_t value);
+
+void em_tscodec_iter_init(em_tscodec_iter_t *it, const em_tscodec_t *codec);
+// positions iterator at the restart point at or before sample idx, returns index of that sample or -1
+int32_t em_tscodec_iter_seek(em_tscodec_iter_t *it, uint32_t idx);
+bool em_tscodec_iter_next(em_tscodec_iter_t *it, int64_t *ts, int64_t *value);
+
+#endif /* EM_TSCODEC_H_ */
@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#include "em/rrd.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+void em_rrd_slot_merge(em_rrd_slot_t *dst, const em_rrd_slot_t *src)
+{
+  assert(dst != NULL);
+  assert(src != NULL);
+
+  if (dst->count == 0) {
+    dst->min = src->min;
+    dst->max = src->max;
+  } else {
+    dst->min = src->min < dst->min ? src->min : dst->min;
+    dst->max = src->max > dst->max ? src->max : dst->max;
+  }
+
+  int64_t sum = (int64_t)dst->sum + src->sum;
+  dst->sum = sum > INT32_MAX ? INT32_MAX : (sum < INT32_MIN ? INT32_MIN : (int32_t)sum);
+
+  uint32_t count = (uint32_t)dst->count + src->count;
+  dst->count = count > UINT16_MAX ? UINT16_MAX : (uint16_t)count;
+}
+
+static uint32_t period_of(const em_rrd_t *rrd, uint8_t tier, time_t ts)
+{
+  return (uint32_t)(ts / rrd->tiers[tier].step_s);
+}
+
+static int read_stored(const em_rrd_t *rrd, uint8_t tier, uint32_t period, em_rrd_slot_t *slot)
+{
+  if (rrd->backend.read(rrd->backend.ctx, tier, period % rrd->tiers[tier].slots, slot) != 0) {
+    return -1;
+  }
+
+  // slot may hold a period from the previous ring lap or be erased
+  return (slot->period == period && slot->count != 0) ? 0 : -1;
+}
+
+// stores the open period of the tier and merges it into the next one
+static int close_period(em_rrd_t *rrd, uint8_t tier)
+{
+  em_rrd_slot_t *slot = &rrd->open[tier];
+  const em_rrd_tier_t *cfg = &rrd->tiers[tier];
+  int ret = rrd->backend.write(rrd->backend.ctx, tier, slot->period % cfg->slots, slot);
+
+  if (tier + 1 < rrd->tiers_cnt) {
+    uint8_t parent = tier + 1;
+    em_rrd_slot_t *open = &rrd->open[parent];
+    uint32_t period = (uint32_t)((uint64_t)slot->period * cfg->step_s / rrd->tiers[parent].step_s);
+
+    if (open->count != 0 && open->period != period) {
+      int err = close_period(rrd, parent);
+      ret = ret != 0 ? ret : err;
+    }
+
+    open->period = period;
+    em_rrd_slot_merge(open, slot);
+
+    // last period of the parent one, close it now so it is not kept in RAM until the next sample
+    if (((uint64_t)(slot->period + 1) * cfg->step_s) % rrd->tiers[parent].step_s == 0) {
+      int err = close_period(rrd, parent);
+      ret = ret != 0 ? ret : err;
+    }
+  }
+
+  memset(slot, 0, sizeof(*slot));
+  return ret;
+}
+
+// rebuilds open periods of the coarser tiers from the periods stored by the finer ones
+static void restore(em_rrd_t *rrd, time_t ts)
+{
+  em_rrd_slot_t slot;
+
+  memset(rrd->open, 0, sizeof(rrd->open));
+
+  // finest period is stored already only when the clock moved back over a restart, continue it
+  if (read_stored(rrd, 0, period_of(rrd, 0, ts), &slot) == 0) {
+    rrd->open[0] = slot;
+  }
+
+  for (uint8_t tier = 1; tier < rrd->tiers_cnt; tier++) {
+    const em_rrd_slot_t *child = &rrd->open[tier - 1];
+    uint32_t ratio = rrd->tiers[tier].step_s / rrd->tiers[tier - 1].step_s;
+    uint32_t period = period_of(rrd, tier, ts);
+
+    for (uint32_t p = period * ratio; p < (period + 1) * ratio; p++) {
+      if (child->count != 0 && child->period == p) {
+        continue;
+      }
+
+      if (read_stored(rrd, tier - 1, p, &slot) == 0) {
+        rrd->open[tier].period = period;
+        em_rrd_slot_merge(&rrd->open[tier], &slot);
+      }
+    }
+  }
+}
+
+int em_rrd_init(em_rrd_t *rrd, const em_rrd_tier_t *tiers, uint8_t tiers_cnt, const em_rrd_backend_t *backend)
+{
+  assert(rrd != NULL);
+  assert(tiers != NULL);
+  assert(backend != NULL);
+
+  if (tiers_cnt == 0 || tiers_cnt > EM_RRD_MAX_TIERS || backend->read == NULL || backend->write == NULL) {
+    return -1;
+  }
+
+  for (uint8_t i = 0; i < tiers_cnt; i++) {
+    if (tiers[i].step_s == 0 || tiers[i].slots == 0 || tiers[i].retention > tiers[i].slots) {
+      return -1;
+    }
+
+    if (i > 0 && (tiers[i].step_s <= tiers[i - 1].step_s || (tiers[i].step_s % tiers[i - 1].step_s) != 0)) {
+      return -1;
+    }
+  }
+
+  memset(rrd, 0, sizeof(*rrd));
+  rrd->tiers = tiers;
+  rrd->tiers_cnt = tiers_cnt;
+  rrd->backend = *backend;
+  return 0;
+}
+
+int em_rrd_add(em_rrd_t *rrd, time_t ts, int16_t value)
+{
+  assert(rrd != NULL);
+
+  if (!rrd->restored) {
+    restore(rrd, ts);
+    rrd->restored = true;
+  }
+
+  em_rrd_slot_t *open = &rrd->open[0];
+  uint32_t period = period_of(rrd, 0, ts);
+  int ret = 0;
+
+  if (open->count != 0) {
+    if (period < open->period) {
+      return -1;
+    }
+
+    if (period != open->period) {
+      ret = close_period(rrd, 0);
+    }
+  }
+
+  em_rrd_slot_t sample = {.sum = value, .min = value, .max = value, .count = 1};
+  open->period = period;
+  em_rrd_slot_merge(open, &sample);
+  return ret;
+}
+
+int em_rrd_read(const em_rrd_t *rrd, uint8_t tier, time_t ts, em_rrd_slot_t *slot)
+{
+  assert(rrd != NULL);
+  assert(slot != NULL);
+  assert(tier < rrd->tiers_cnt);
+
+  uint32_t period = period_of(rrd, tier, ts);
+  const em_rrd_slot_t *open = &rrd->open[tier];
+
+  if (open->count != 0 && open->period == period) {
+    *slot = *open;
+    return 0;
+  }
+
+  return read_stored(rrd, tier, period, slot);
+}
+
+time_t em_rrd_oldest(const em_rrd_t *rrd, uint8_t tier, time_t now)
+{
+  assert(rrd != NULL);
+  assert(tier < rrd->tiers_cnt);
+
+  const em_rrd_tier_t *cfg = &rrd->tiers[tier];
+  uint32_t period = period_of(rrd, tier, now);
+
+  if (period < cfg->retention) {
+    return 0;
+  }
+
+  return (time_t)(period - cfg->retention + 1) * cfg->step_s;
+}
+
+uint8_t em_rrd_select_tier(const em_rrd_t *rrd, time_t from, time_t now, uint32_t resolution_s)
+{
+  assert(rrd != NULL);
+
+  uint8_t selected = rrd->tiers_cnt - 1;
+
+  for (int tier = rrd->tiers_cnt - 1; tier >= 0; tier--) {
+    if (from < em_rrd_oldest(rrd, (uint8_t)tier, now)) {
+      continue;
+    }
+
+    if (rrd->tiers[tier].step_s <= resolution_s) {
+      return (uint8_t)tier;
+    }
+
+    // too coarse, remember it in case no finer tier keeps from
+    selected = (uint8_t)tier;
+  }
+
+  return selected;
+}
+
+void em_rrd_iter_init(em_rrd_iter_t *it, const em_rrd_t *rrd, uint8_t tier, time_t from, time_t to, time_t now)
+{
+  assert(it != NULL);
+  assert(rrd != NULL);
+  assert(tier < rrd->tiers_cnt);
+
+  time_t oldest = em_rrd_oldest(rrd, tier, now);
+
+  it->rrd = rrd;
+  it->tier = tier;
+  it->period = period_of(rrd, tier, from < oldest ? oldest : from);
+  it->end = period_of(rrd, tier, to < 0 ? 0 : to);
+}
+
+bool em_rrd_iter_next(em_rrd_iter_t *it, em_rrd_slot_t *slot)
+{
+  assert(it != NULL);
+  assert(slot != NULL);
+
+  while (it->period <= it->end) {
+    uint32_t period = it->period++;
+
+    if (em_rrd_read(it->rrd, it->tier, (time_t)period * it->rrd->tiers[it->tier].step_s, slot) == 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
@@ -0,0 +1,490 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#include "em/downsample.h"
+#include "em/fixed.h"
+#include "em/p2.h"
+#include "em/tscodec.h"
+
+#include <esp_cpu.h>
+#include <esp_timer.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+// one day of 15s samples
+#define PV_SAMPLES (5760U)
+#define PV_PERIOD_S (15)
+#define PV_PEAK_W (5000)
+#define PV_RESTART_INTERVAL (64U)
+#define PV_BENCH_ROUNDS (20U) // encodes and decodes timed together, a single day is too short for the timer
+
+static uint8_t stream[PV_SAMPLES * 4];
+static uint16_t restarts[PV_SAMPLES / PV_RESTART_INTERVAL + 1];
+static int64_t pv_ts[PV_SAMPLES];
+static int64_t pv_value[PV_SAMPLES];
+
+static uint32_t lcg_state = 1;
+
+static uint32_t lcg_next(void)
+{
+  lcg_state = lcg_state * 1103515245U + 12345U;
+  return lcg_state >> 16;
+}
+
+// clear sky parabola between 6:00 and 20:00 with +-2% noise and +-1s timestamp jitter on every 10th sample
+static void pv_curve_init(void)
+{
+  const int64_t day_start = 1735686000;
+  const int64_t sunrise = 6 * 3600;
+  const int64_t sunset = 20 * 3600;
+  const int64_t half = (sunset - sunrise) / 2;
+
+  lcg_state = 1;
+
+  for (uint32_t i = 0; i < PV_SAMPLES; i++) {
+    int64_t t = (int64_t)i * PV_PERIOD_S;
+    int64_t power = 0;
+
+    if (t > sunrise && t < sunset) {
+      int64_t x = t - sunrise - half;
+      power = PV_PEAK_W - PV_PEAK_W * x * x / (half * half);
+      power += power * ((int64_t)(lcg_next() % 41) - 20) / 1000;
+    }
+
+    pv_ts[i] = day_start + t + ((i % 10) == 9 ? (int64_t)(lcg_next() % 3) - 1 : 0);
+    pv_value[i] = power;
+  }
+}
+
+static void pv_encode(em_tscodec_t *codec)
+{
+  TEST_ASSERT_EQUAL_INT(
+    0, em_tscodec_init(codec, stream, sizeof(stream), restarts, sizeof(restarts) / sizeof(restarts[0]), PV_RESTART_INTERVAL));
+
+  for (uint32_t i = 0; i < PV_SAMPLES; i++) {
+    TEST_ASSERT_EQUAL_INT(0, em_tscodec_append(codec, pv_ts[i], pv_value[i]));
+  }
+}
+
+static void test_tscodec_roundtrip(void)
+{
+  em_tscodec_t codec;
+  em_tscodec_iter_t it;
+  int64_t ts = 0;
+  int64_t value = 0;
+
+  pv_curve_init();
+  pv_encode(&codec);
+  TEST_ASSERT_EQUAL_UINT32(PV_SAMPLES, codec.count);
+
+  em_tscodec_iter_init(&it, &codec);
+
+  for (uint32_t i = 0; i < PV_SAMPLES; i++) {
+    TEST_ASSERT_TRUE(em_tscodec_iter_next(&it, &ts, &value));
+    TEST_ASSERT_EQUAL_INT64(pv_ts[i], ts);
+    TEST_ASSERT_EQUAL_INT64(pv_value[i], value);
+  }
+
+  TEST_ASSERT_FALSE(em_tscodec_iter_next(&it, &ts, &value));
+
+  // random access from the restart point before the sample
+  const uint32_t idx = PV_SAMPLES / 2 + 5;
+  int32_t start = em_tscodec_iter_seek(&it, idx);
+  TEST_ASSERT_EQUAL_INT32((idx / PV_RESTART_INTERVAL) * PV_RESTART_INTERVAL, start);
+
+  for (uint32_t i = (uint32_t)start; i <= idx; i++) {
+    TEST_ASSERT_TRUE(em_tscodec_iter_next(&it, &ts, &value));
+  }
+
+  TEST_ASSERT_EQUAL_INT64(pv_ts[idx], ts);
+  TEST_ASSERT_EQUAL_INT64(pv_value[idx], value);
+  TEST_ASSERT_EQUAL_INT32(-1, em_tscodec_iter_seek(&it, PV_SAMPLES));
+}
+
+static void test_tscodec_full(void)
+{
+  em_tscodec_t codec;
+  uint8_t data[16];
+  uint16_t offsets[2];
+
+  TEST_ASSERT_EQUAL_INT(0, em_tscodec_init(&codec, data, sizeof(data), offsets, 2, 4));
+
+  // first sample is stored in full, 5 bytes for the timestamp
+  TEST_ASSERT_EQUAL_INT(0, em_tscodec_append(&codec, 1735686000, -1));
+  TEST_ASSERT_EQUAL_size_t(6, codec.len);
+
+  uint32_t appended = 1;
+
+  while (em_tscodec_append(&codec, 1735686000 + appended * 15, 100) == 0) {
+    appended++;
+  }
+
+  // rejected sample leaves the stream untouched
+  size_t len = codec.len;
+  TEST_ASSERT_EQUAL_UINT32(appended, codec.count);
+  TEST_ASSERT_EQUAL_INT(-1, em_tscodec_append(&codec, 1735686000 + appended * 15, 100));
+  TEST_ASSERT_EQUAL_size_t(len, codec.len);
+  TEST_ASSERT_EQUAL_UINT32(appended, codec.count);
+
+  // restart table limits the stream as well
+  TEST_ASSERT_EQUAL_INT(0, em_tscodec_init(&codec, stream, sizeof(stream), offsets, 2, 4));
+
+  for (uint32_t i = 0; i < 8; i++) {
+    TEST_ASSERT_EQUAL_INT(0, em_tscodec_append(&codec, i, i));
+  }
+
+  TEST_ASSERT_EQUAL_INT(-1, em_tscodec_append(&codec, 8, 8));
+}
+
+static void test_tscodec_ratio(void)
+{
+  em_tscodec_t codec;
+  em_tscodec_iter_t it;
+  int64_t ts = 0;
+  int64_t value = 0;
+
+  pv_curve_init();
+
+  int64_t start = esp_timer_get_time();
+
+  for (uint32_t round = 0; round < PV_BENCH_ROUNDS; round++) {
+    pv_encode(&codec);
+  }
+
+  int64_t encode_us = esp_timer_get_time() - start;
+
+  start = esp_timer_get_time();
+
+  for (uint32_t round = 0; round < PV_BENCH_ROUNDS; round++) {
+    em_tscodec_iter_init(&it, &codec);
+
+    while (em_tscodec_iter_next(&it, &ts, &value)) {
+    }
+  }
+
+  int64_t decode_us = esp_timer_get_time() - start;
+
+  // raw history entry is energy_t {time_t, uint64_t}
+  const size_t raw_len = PV_SAMPLES * (sizeof(int64_t) + sizeof(uint64_t));
+  const size_t packed_len = codec.len + sizeof(restarts);
+  // samples per us are millions of samples per second, raw bytes per us are MB/s
+  const double samples = (double)PV_SAMPLES * PV_BENCH_ROUNDS;
+  const double raw_bytes = (double)raw_len * PV_BENCH_ROUNDS;
+  const double encode_div = encode_us > 0 ? (double)encode_us : 1.0;
+  const double decode_div = decode_us > 0 ? (double)decode_us : 1.0;
+
+  printf("tscodec: %u samples, raw %u B, packed %u B (%u B restarts), ratio %.1f\n", PV_SAMPLES, (unsigned)raw_len,
+         (unsigned)packed_len, (unsigned)sizeof(restarts), (double)raw_len / packed_len);
+  printf("tscodec: %u rounds, encode %lld us (%.2f Msamples/s, %.1f MB/s raw), decode %lld us (%.2f Msamples/s, "
+         "%.1f MB/s raw)\n",
+         PV_BENCH_ROUNDS, (long long)encode_us, samples / encode_div, raw_bytes / encode_div,
+         (long long)decode_us, samples / decode_div, raw_bytes / decode_div);
+
+  TEST_ASSERT_GREATER_OR_EQUAL(5 * packed_len, raw_len);
+}
+
+typedef struct {
+  const int32_t *values;
+  int64_t ts[16];
+  int32_t out[16];
+  size_t out_cnt;
+} lttb_ctx_t;
+
+static void lttb_get(size_t idx, int64_t *ts, int32_t *value, void *ctx)
+{
+  *ts = (int64_t)idx * 60;
+  *value = ((lttb_ctx_t *)ctx)->values[idx];
+}
+
+static void lttb_emit(int64_t ts, int32_t value, void *ctx)
+{
+  lttb_ctx_t *c = ctx;
+
+  TEST_ASSERT_LESS_OR_EQUAL(15, c->out_cnt);
+  c->ts[c->out_cnt] = ts;
+  c->out[c->out_cnt++] = value;
+}
+
+static void test_lttb_points(void)
+{
+  static const int32_t values[] = {0, 10, 20, 30, 3000, 40, 50, 60, 70, 80, 90, 100};
+  const size_t n = sizeof(values) / sizeof(values[0]);
+  lttb_ctx_t ctx = {.values = values};
+
+  // never more points than asked for
+  for (size_t out_cnt = 0; out_cnt <= n + 2; out_cnt++) {
+    ctx.out_cnt = 0;
+    size_t expected = out_cnt < n ? out_cnt : n;
+    TEST_ASSERT_EQUAL_size_t(expected, em_downsample_lttb(n, out_cnt, lttb_get, lttb_emit, &ctx));
+    TEST_ASSERT_EQUAL_size_t(expected, ctx.out_cnt);
+
+    if (expected >= 1) {
+      TEST_ASSERT_EQUAL_INT64(0, ctx.ts[0]);
+    }
+
+    if (expected >= 2) {
+      TEST_ASSERT_EQUAL_INT64((int64_t)(n - 1) * 60, ctx.ts[expected - 1]);
+    }
+
+    for (size_t i = 1; i < ctx.out_cnt; i++) {
+      TEST_ASSERT_TRUE(ctx.ts[i] > ctx.ts[i - 1]);
+    }
+  }
+
+  // the peak survives a single inner bucket
+  ctx.out_cnt = 0;
+  em_downsample_lttb(n, 3, lttb_get, lttb_emit, &ctx);
+  TEST_ASSERT_EQUAL_INT32(3000, ctx.out[1]);
+}
+
+static void test_fixed_parse(void)
+{
+  int32_t v = 0;
+
+  TEST_ASSERT_TRUE(em_fixed_parse("228.2", 5, 1, &v));
+  TEST_ASSERT_EQUAL_INT32(2282, v);
+  TEST_ASSERT_TRUE(em_fixed_parse("0.85", 4, 3, &v));
+  TEST_ASSERT_EQUAL_INT32(850, v);
+  TEST_ASSERT_TRUE(em_fixed_parse("49.95", 5, 1, &v));
+  TEST_ASSERT_EQUAL_INT32(500, v);
+  TEST_ASSERT_TRUE(em_fixed_parse("50.04", 5, 1, &v));
+  TEST_ASSERT_EQUAL_INT32(500, v);
+  TEST_ASSERT_TRUE(em_fixed_parse("-1.5", 4, 0, &v));
+  TEST_ASSERT_EQUAL_INT32(-2, v);
+  TEST_ASSERT_TRUE(em_fixed_parse("0042", 4, 0, &v));
+  TEST_ASSERT_EQUAL_INT32(42, v);
+
+  TEST_ASSERT_FALSE(em_fixed_parse("", 0, 1, &v));
+  TEST_ASSERT_FALSE(em_fixed_parse("-", 1, 1, &v));
+  TEST_ASSERT_FALSE(em_fixed_parse("1.2.3", 5, 1, &v));
+  TEST_ASSERT_FALSE(em_fixed_parse("12a", 3, 0, &v));
+  TEST_ASSERT_FALSE(em_fixed_parse("99999999999", 11, 0, &v));
+  TEST_ASSERT_EQUAL_INT32(INT32_MAX, v);
+  TEST_ASSERT_FALSE(em_fixed_parse("-300000000", 10, 1, &v));
+  TEST_ASSERT_EQUAL_INT32(INT32_MIN, v);
+}
+
+static void test_fixed_mul_div(void)
+{
+  int32_t v = 0;
+  uint64_t acc = UINT64_MAX - 1;
+
+  // power factor in 0.001 of 2000W / 2353VA
+  TEST_ASSERT_TRUE(em_fixed_mul_div(2000, 1000, 2353, &v));
+  TEST_ASSERT_EQUAL_INT32(850, v);
+  TEST_ASSERT_TRUE(em_fixed_mul_div(-5, 1, 2, &v));
+  TEST_ASSERT_EQUAL_INT32(-3, v);
+  TEST_ASSERT_TRUE(em_fixed_mul_div(5, 1, -2, &v));
+  TEST_ASSERT_EQUAL_INT32(-3, v);
+  TEST_ASSERT_TRUE(em_fixed_mul_div(-5, 1, -2, &v));
+  TEST_ASSERT_EQUAL_INT32(3, v);
+  TEST_ASSERT_FALSE(em_fixed_mul_div(INT32_MAX, 2, 1, &v));
+  TEST_ASSERT_EQUAL_INT32(INT32_MAX, v);
+
+  TEST_ASSERT_TRUE(em_fixed_add_u64(&acc, 1));
+  TEST_ASSERT_FALSE(em_fixed_add_u64(&acc, 1));
+  TEST_ASSERT_TRUE(acc == UINT64_MAX);
+
+  TEST_ASSERT_EQUAL_UINT16(0, em_fixed_sat_u16(-1));
+  TEST_ASSERT_EQUAL_UINT16(UINT16_MAX, em_fixed_sat_u16(70000));
+  TEST_ASSERT_EQUAL_INT32(INT16_MIN, em_fixed_sat_i16(-40000));
+  TEST_ASSERT_EQUAL_UINT8(UINT8_MAX, em_fixed_sat_u8(300));
+}
+
+#define QPIGS_SAMPLES (1000U)
+
+typedef struct {
+  char voltage[8];  // 0.1V
+  char power[8];    // W
+  char apparent[8]; // VA
+} qpigs_fields_t;
+
+static qpigs_fields_t qpigs_fields[QPIGS_SAMPLES];
+
+// QPIGS fields of a day of 15s polls: voltage in 0.1V, output power and its apparent power in W and VA
+static void qpigs_fields_init(void)
+{
+  lcg_state = 1;
+
+  for (uint32_t i = 0; i < QPIGS_SAMPLES; i++) {
+    uint32_t power = lcg_next() % 5000;
+
+    snprintf(qpigs_fields[i].voltage, sizeof(qpigs_fields[i].voltage), "%03u.%u", (unsigned)(215 + lcg_next() % 30),
+             (unsigned)(lcg_next() % 10));
+    snprintf(qpigs_fields[i].power, sizeof(qpigs_fields[i].power), "%04u", (unsigned)power);
+    snprintf(qpigs_fields[i].apparent, sizeof(qpigs_fields[i].apparent), "%04u", (unsigned)(power + 1 + lcg_next() % 500));
+  }
+}
+
+static void test_fixed_vs_float(void)
+{
+  static int32_t fixed_voltage[QPIGS_SAMPLES];
+  static int32_t fixed_pf[QPIGS_SAMPLES];
+  static float float_voltage[QPIGS_SAMPLES];
+  static float float_pf[QPIGS_SAMPLES];
+  uint64_t fixed_energy = 0;
+  float float_energy = 0;
+
+  qpigs_fields_init();
+
+  // parse, power factor and Ws accumulation as on the QPIGS path, both paths timed in CPU cycles on the same fields
+  esp_cpu_cycle_count_t start = esp_cpu_get_cycle_count();
+
+  for (uint32_t i = 0; i < QPIGS_SAMPLES; i++) {
+    int32_t power = 0;
+    int32_t apparent = 0;
+
+    em_fixed_parse(qpigs_fields[i].voltage, strlen(qpigs_fields[i].voltage), 1, &fixed_voltage[i]);
+    em_fixed_parse(qpigs_fields[i].power, strlen(qpigs_fields[i].power), 0, &power);
+    em_fixed_parse(qpigs_fields[i].apparent, strlen(qpigs_fields[i].apparent), 0, &apparent);
+    em_fixed_mul_div(power, 1000, apparent, &fixed_pf[i]);
+    em_fixed_add_u64(&fixed_energy, (uint64_t)power * PV_PERIOD_S);
+  }
+
+  uint32_t fixed_cycles = (uint32_t)(esp_cpu_get_cycle_count() - start);
+
+  // the same with floats, energy kept in Wh
+  start = esp_cpu_get_cycle_count();
+
+  for (uint32_t i = 0; i < QPIGS_SAMPLES; i++) {
+    float power = strtof(qpigs_fields[i].power, NULL);
+
+    float_voltage[i] = strtof(qpigs_fields[i].voltage, NULL);
+    float_pf[i] = power / strtof(qpigs_fields[i].apparent, NULL);
+    float_energy += power * PV_PERIOD_S / 3600.0f;
+  }
+
+  uint32_t float_cycles = (uint32_t)(esp_cpu_get_cycle_count() - start);
+
+  for (uint32_t i = 0; i < QPIGS_SAMPLES; i++) {
+    TEST_ASSERT_EQUAL_INT32((int32_t)lroundf(float_voltage[i] * 10.0f), fixed_voltage[i]);
+    TEST_ASSERT_INT32_WITHIN(1, (int32_t)lroundf(float_pf[i] * 1000.0f), fixed_pf[i]);
+  }
+
+  double exact_wh = (double)fixed_energy / 3600.0;
+
+  printf("fixed: %u QPIGS samples, fixed %lu cycles (%lu/sample), float %lu cycles (%lu/sample)\n", QPIGS_SAMPLES,
+         (unsigned long)fixed_cycles, (unsigned long)(fixed_cycles / QPIGS_SAMPLES), (unsigned long)float_cycles,
+         (unsigned long)(float_cycles / QPIGS_SAMPLES));
+  printf("fixed: energy %.3f Wh, float accumulation %.3f Wh\n", exact_wh, (double)float_energy);
+
+  TEST_ASSERT_TRUE(fabs(exact_wh - float_energy) < exact_wh / 1000.0);
+  // ESP32-C3 has no FPU, the fixed path has to stay the cheaper one
+  TEST_ASSERT_LESS_THAN_UINT32(float_cycles, fixed_cycles);
+}
+
+// a quarter of 1s samples
+#define LOAD_SAMPLES (900U)
+
+static int32_t load[LOAD_SAMPLES];
+static int32_t load_sorted[LOAD_SAMPLES];
+
+static int cmp_i32(const void *a, const void *b)
+{
+  int32_t x = *(const int32_t *)a;
+  int32_t y = *(const int32_t *)b;
+  return (x > y) - (x < y);
+}
+
+// household load: 400W base with noise, a kettle 2000W for 3 minutes and short 1500W motor starts
+static void load_trace_init(void)
+{
+  lcg_state = 7;
+
+  for (uint32_t i = 0; i < LOAD_SAMPLES; i++) {
+    int32_t power = 400 + (int32_t)(lcg_next() % 201) - 100;
+
+    if (i >= 300 && i < 480) {
+      power += 2000;
+    }
+
+    if (lcg_next() % 50 == 0) {
+      power += 1500;
+    }
+
+    load[i] = power;
+    load_sorted[i] = power;
+  }
+
+  qsort(load_sorted, LOAD_SAMPLES, sizeof(load_sorted[0]), cmp_i32);
+}
+
+static int32_t exact_quantile(const int32_t *sorted, uint32_t cnt, uint16_t permille)
+{
+  return sorted[((cnt - 1) * permille + 500) / 1000];
+}
+
+static void test_p2_small(void)
+{
+  em_p2_t p2;
+  int32_t v = 0;
+  static const int32_t values[] = {50, -20, 10, 40};
+  int32_t sorted[4];
+
+  em_p2_init(&p2, 500);
+  TEST_ASSERT_FALSE(em_p2_get(&p2, &v));
+
+  // exact until the markers are set
+  for (uint32_t i = 0; i < 4; i++) {
+    em_p2_add(&p2, values[i]);
+    memcpy(sorted, values, sizeof(values));
+    qsort(sorted, i + 1, sizeof(sorted[0]), cmp_i32);
+    TEST_ASSERT_TRUE(em_p2_get(&p2, &v));
+    TEST_ASSERT_EQUAL_INT32(exact_quantile(sorted, i + 1, 500), v);
+  }
+}
+
+static void test_p2_vs_exact(void)
+{
+  static const uint16_t permille[] = {50, 500, 950};
+  em_p2_t p2[3];
+  int32_t v = 0;
+
+  load_trace_init();
+
+  for (uint32_t q = 0; q < 3; q++) {
+    em_p2_init(&p2[q], permille[q]);
+  }
+
+  int64_t start = esp_timer_get_time();
+
+  for (uint32_t i = 0; i < LOAD_SAMPLES; i++) {
+    for (uint32_t q = 0; q < 3; q++) {
+      em_p2_add(&p2[q], load[i]);
+    }
+  }
+
+  int64_t p2_us = esp_timer_get_time() - start;
+  const int32_t range = load_sorted[LOAD_SAMPLES - 1] - load_sorted[0];
+
+  printf("p2: %u samples, 3 quantiles in %lld us, %u B state vs %u B samples\n", LOAD_SAMPLES, (long long)p2_us,
+         (unsigned)sizeof(p2), (unsigned)sizeof(load));
+
+  // within 5% of the value range from the exact quantile of the whole trace
+  for (uint32_t q = 0; q < 3; q++) {
+    int32_t exact = exact_quantile(load_sorted, LOAD_SAMPLES, permille[q]);
+
+    TEST_ASSERT_TRUE(em_p2_get(&p2[q], &v));
+    printf("p2: p%u estimated %ld W, exact %ld W\n", permille[q] / 10, (long)v, (long)exact);
+    TEST_ASSERT_INT32_WITHIN(range / 20, exact, v);
+  }
+}
+
+void app_main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_tscodec_roundtrip);
+  RUN_TEST(test_tscodec_full);
+  RUN_TEST(test_tscodec_ratio);
+  RUN_TEST(test_lttb_points);
+  RUN_TEST(test_fixed_parse);
+  RUN_TEST(test_fixed_mul_div);
+  RUN_TEST(test_fixed_vs_float);
+  RUN_TEST(test_p2_small);
+  RUN_TEST(test_p2_vs_exact);
+  UNITY_END();
+}
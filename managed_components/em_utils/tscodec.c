@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2025 EmbeddedSolutions.pl
+ */
+
+#include "em/tscodec.h"
+
+#include <assert.h>
+#include <string.h>
+
+static inline uint64_t zigzag_encode(int64_t v)
+{
+  return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t zigzag_decode(uint64_t v)
+{
+  return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static size_t varint_write(uint8_t *out, uint64_t v)
+{
+  size_t n = 0;
+
+  while (v >= 0x80) {
+    out[n++] = (uint8_t)(v | 0x80);
+    v >>= 7;
+  }
+
+  out[n++] = (uint8_t)v;
+  return n;
+}
+
+// returns number of consumed bytes, 0 on truncated input
+static size_t varint_read(const uint8_t *in, size_t len, uint64_t *v)
+{
+  uint64_t result = 0;
+
+  for (size_t n = 0; n < len && n < 10; n++) {
+    result |= (uint64_t)(in[n] & 0x7F) << (7 * n);
+
+    if ((in[n] & 0x80) == 0) {
+      *v = result;
+      return n + 1;
+    }
+  }
+
+  return 0;
+}
+
+int em_tscodec_init(em_tscodec_t *codec, uint8_t *data, size_t cap, uint16_t *restarts, size_t restarts_cap,
+                    uint16_t restart_interval)
+{
+  assert(codec != NULL);
+  assert(data != NULL);
+  assert(restarts != NULL);
+
+  if (restarts_cap == 0 || restart_interval == 0 || cap > UINT16_MAX) {
+    return -1;
+  }
+
+  codec->data = data;
+  codec->cap = cap;
+  codec->restarts = restarts;
+  codec->restarts_cap = restarts_cap;
+  codec->restart_interval = restart_interval;
+  em_tscodec_clear(codec);
+  return 0;
+}
+
+void em_tscodec_clear(em_tscodec_t *codec)
+{
+  assert(codec != NULL);
+
+  codec->len = 0;
+  codec->count = 0;
+  codec->prev_ts = 0;
+  codec->prev_delta = 0;
+  codec->prev_value = 0;
+}
+
+int em_tscodec_append(em_tscodec_t *codec, int64_t ts, int64_t value)
+{
+  assert(codec != NULL);
+
+  bool restart = (codec->count % codec->restart_interval) == 0;
+  size_t restart_idx = codec->count / codec->restart_interval;
+
+  if (restart && restart_idx >= codec->restarts_cap) {
+    return -1;
+  }
+
+  int64_t prev_ts = restart ? 0 : codec->prev_ts;
+  int64_t prev_delta = restart ? 0 : codec->prev_delta;
+  int64_t prev_value = restart ? 0 : codec->prev_value;
+
+  int64_t delta = ts - prev_ts;
+  uint8_t tmp[EM_TSCODEC_MAX_SAMPLE_LEN];
+  size_t n = varint_write(tmp, zigzag_encode(delta - prev_delta));
+  n += varint_write(tmp + n, zigzag_encode(value - prev_value));
+
+  if (codec->len + n > codec->cap) {
+    return -1;
+  }
+
+  if (restart) {
+    codec->restarts[restart_idx] = (uint16_t)codec->len;
+  }
+
+  memcpy(codec->data + codec->len, tmp, n);
+  codec->len += n;
+  codec->count++;
+  codec->prev_ts = ts;
+  codec->prev_delta = restart ? 0 : delta;
+  codec->prev_value = value;
+  return 0;
+}
+
+void em_tscodec_iter_init(em_tscodec_iter_t *it, const em_tscodec_t *codec)
+{
+  assert(it != NULL);
+  assert(codec != NULL);
+
+  memset(it, 0, sizeof(*it));
+  it->codec = codec;
+}
+
+int32_t em_tscodec_iter_seek(em_tscodec_iter_t *it, uint32_t idx)
+{
+  assert(it != NULL);
+
+  const em_tscodec_t *codec = it->codec;
+
+  if (idx >= codec->count) {
+    return -1;
+  }
+
+  uint32_t restart_idx = idx / codec->restart_interval;
+  it->pos = codec->restarts[restart_idx];
+  it->idx = restart_idx * codec->restart_interval;
+  it->ts = 0;
+  it->delta = 0;
+  it->value = 0;
+  return (int32_t)it->idx;
+}
+
+bool em_tscodec_iter_next(em_tscodec_iter_t *it, int64_t *ts, int64_t *value)
+{
+  assert(it != NULL);
+
+  const em_tscodec_t *codec = it->codec;
+
+  if (it->idx >= codec->count) {
+    return false;
+  }
+
+  if ((it->idx % codec->restart_interval) == 0) {
+    it->ts = 0;
+    it->delta = 0;
+    it->value = 0;
+  }
+
+  uint64_t raw_dod = 0;
+  uint64_t raw_dv = 0;
+  size_t n = varint_read(codec->data + it->pos, codec->len - it->pos, &raw_dod);
+
+  if (n == 0) {
+    return false;
+  }
+
+  size_t m = varint_read(codec->data + it->pos + n, codec->len - it->pos - n, &raw_dv);
+
+  if (m == 0) {
+    return false;
+  }
+
+  bool restart = (it->idx % codec->restart_interval) == 0;
+  int64_t delta = it->delta + zigzag_decode(raw_dod);
+  it->ts += delta;
+  it->delta = restart ? 0 : delta;
+  it->value += zigzag_decode(raw_dv);
+  it->pos += n + m;
+  it->idx++;
+
+  if (ts != NULL) {
+    *ts = it->ts;
+  }
+
+  if (value != NULL) {
+    *value = it->value;
+  }
+
+  return true;
+}